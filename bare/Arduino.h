@@ -0,0 +1,141 @@
+/*
+ * Arduino.h (runtime minimo)
+ * Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)
+ *
+ * Reemplazo del core de Arduino para el entorno "bare" de
+ * platformio.ini: solo los servicios que utiliza el firmware,
+ * implementados directamente sobre los registros del ATmega328
+ * (ver bare/runtime.cpp). main() invoca setup() y luego loop()
+ * sin serialEventRun() ni otras tareas entre pasadas
+ */
+
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+
+#include "binary.h"
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH            1
+#define LOW             0
+#define INPUT           0
+#define OUTPUT          1
+#define INPUT_PULLUP    2
+
+#define A0             14
+
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper *> (PSTR(s)))
+
+#define noInterrupts()  cli()
+#define interrupts()    sei()
+
+#define bit(b) (1UL << (b))
+
+#define min(a, b) ((a) < (b) ? (a) : (b))
+#define max(a, b) ((a) > (b) ? (a) : (b))
+#define constrain(a, l, h) ((a) < (l) ? (l) : ((a) > (h) ? (h) : (a)))
+
+/*
+ * Numeracion de pines del Nano: 0-7 PORTD, 8-13 PORTB, 14-19 PORTC.
+ * Puertos con la numeracion del core: 2 = B, 3 = C, 4 = D
+ */
+#define digitalPinToPort(p)     ((p) < 8 ? 4 : ((p) < 14 ? 2 : 3))
+#define digitalPinToBitMask(p)  (1 << ((p) < 8 ? (p) : ((p) < 14 ? (p) - 8 : (p) - 14)))
+#define portInputRegister(p)    ((p) == 2 ? &PINB : ((p) == 3 ? &PINC : &PIND))
+#define portOutputRegister(p)   ((p) == 2 ? &PORTB : ((p) == 3 ? &PORTC : &PORTD))
+#define portModeRegister(p)     ((p) == 2 ? &DDRB : ((p) == 3 ? &DDRC : &DDRD))
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+
+/*
+ * Reloj: Timer0 en modo CTC interrumpe cada 1 ms. micros()
+ * agrega el contador del timer (resolucion de 4 us a 16MHz)
+ */
+unsigned long millis(void);
+unsigned long micros(void);
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+long random(long howBig);
+long random(long howSmall, long howBig);
+void randomSeed(unsigned long seed);
+
+// Definidas por el programa (src/main.cpp)
+void setup(void);
+void loop(void);
+
+
+class Print {
+
+public:
+
+  virtual size_t write(uint8_t value) = 0;
+  size_t write(const uint8_t *buffer, size_t size);
+
+  size_t print(const char *text);
+  size_t print(const __FlashStringHelper *text);
+  size_t print(int value);
+  size_t print(unsigned int value);
+  size_t print(long value);
+  size_t print(unsigned long value, int base = 10);
+  size_t println(const char *text);
+  size_t println(const __FlashStringHelper *text);
+  size_t println(unsigned long value, int base = 10);
+  size_t println(void);
+
+};
+
+
+class Stream : public Print {
+
+public:
+
+  virtual int available(void) = 0;
+  virtual int read(void) = 0;
+  virtual int peek(void) = 0;
+
+};
+
+
+/*
+ * Medida (potencia de 2) de los buffers de recepcion
+ * y transmision del puerto serie de hardware
+ */
+#define SERIAL_RX_BUFFER    64
+#define SERIAL_TX_BUFFER    64
+
+/*
+ * USART0 con recepcion y transmision por interrupciones. write()
+ * solo espera con el buffer de transmision lleno
+ */
+class HardwareSerial : public Stream {
+
+public:
+
+  void begin(unsigned long bauds);
+  virtual int available(void);
+  virtual int read(void);
+  virtual int peek(void);
+  virtual size_t write(uint8_t value);
+  using Print::write;
+  int availableForWrite(void);
+  void flush(void);
+
+};
+
+extern HardwareSerial Serial;
+
+#endif
@@ -0,0 +1,233 @@
+/*
+ * DFRobotDFPlayerMini.cpp (runtime minimo)
+ * Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)
+ */
+
+#include <DFRobotDFPlayerMini.h>
+
+
+/*
+ * Trama: 7E FF 06 CMD ACK PH PL CH CL EF, con el checksum
+ * (CH CL) igual al complemento a 2 de la suma de FF..PL
+ */
+#define FRAME_START       0x7E
+#define FRAME_VERSION     0xFF
+#define FRAME_LENGTH      0x06
+#define FRAME_END         0xEF
+
+#define CMD_NEXT          0x01
+#define CMD_PREVIOUS      0x02
+#define CMD_PLAY          0x03
+#define CMD_VOLUME_UP     0x04
+#define CMD_VOLUME_DOWN   0x05
+#define CMD_VOLUME        0x06
+#define CMD_RESET         0x0C
+#define CMD_PLAY_FOLDER   0x0F
+#define CMD_STOP          0x16
+#define CMD_LOOP          0x19
+
+#define MSG_INSERTED      0x3A
+#define MSG_REMOVED       0x3B
+#define MSG_USB_FINISHED  0x3C
+#define MSG_CARD_FINISHED 0x3D
+#define MSG_ONLINE        0x3F
+#define MSG_ERROR         0x40
+
+#define RESET_TIMEOUT_MS  2000
+#define RESET_SETTLE_MS   200
+
+
+void DFRobotDFPlayerMini::command(uint8_t code, uint16_t parameter) {
+
+  uint8_t buffer[DFPLAYER_FRAME_SIZE] = {
+    FRAME_START, FRAME_VERSION, FRAME_LENGTH, code, 0x00,
+    (uint8_t) (parameter >> 8), (uint8_t) parameter, 0x00, 0x00, FRAME_END
+  };
+  uint16_t sum = 0;
+
+  for ( uint8_t i = 1 ; i < 7 ; i++ )
+    sum += buffer[i];
+
+  sum = -sum;
+  buffer[7] = sum >> 8;
+  buffer[8] = sum;
+
+  serial->write(buffer, DFPLAYER_FRAME_SIZE);
+
+}
+
+
+/**
+ * Valida la trama recibida y la traduce al tipo
+ * de mensaje de la biblioteca original
+ */
+byte DFRobotDFPlayerMini::parse(void) {
+
+  uint16_t sum = 0;
+
+  if ( frame[1] != FRAME_VERSION || frame[2] != FRAME_LENGTH || frame[9] != FRAME_END )
+    return 0;
+
+  for ( uint8_t i = 1 ; i < 7 ; i++ )
+    sum += frame[i];
+
+  if ( (uint16_t) (sum + ((frame[7] << 8) | frame[8])) != 0 )
+    return 0;
+
+  handleParameter = (frame[5] << 8) | frame[6];
+
+  switch ( frame[3] ) {
+    case MSG_INSERTED:      handleType = handleParameter & 0x01 ? DFPlayerUSBInserted : DFPlayerCardInserted; break;
+    case MSG_REMOVED:       handleType = handleParameter & 0x01 ? DFPlayerUSBRemoved : DFPlayerCardRemoved; break;
+    case MSG_USB_FINISHED:
+    case MSG_CARD_FINISHED: handleType = DFPlayerPlayFinished; break;
+    case MSG_ONLINE:
+      if ( handleParameter == 0x03 )
+        handleType = DFPlayerCardUSBOnline;
+      else
+        handleType = handleParameter & 0x01 ? DFPlayerUSBOnline : DFPlayerCardOnline;
+      break;
+    case MSG_ERROR:         handleType = DFPlayerError; break;
+    default:                handleType = DFPlayerFeedBack; break;
+  }
+
+  return 1;
+
+}
+
+
+bool DFRobotDFPlayerMini::begin(Stream &stream, bool isACK, bool doReset) {
+
+  unsigned long start;
+
+  serial = &stream;
+  frameCount = 0;
+  handleType = TimeOut;
+  handleParameter = 0;
+
+  if ( ! doReset )
+    return true;
+
+  command(CMD_RESET, 0);
+
+  start = millis();
+  while ( millis() - start < RESET_TIMEOUT_MS )
+    if ( available() && handleType != DFPlayerFeedBack )
+      break;
+
+  delay(RESET_SETTLE_MS);
+
+  return handleType == DFPlayerCardOnline || handleType == DFPlayerUSBOnline || handleType == DFPlayerCardUSBOnline;
+
+}
+
+
+/**
+ * Consume los bytes recibidos; retorna 1 al completar una
+ * trama valida. Los bytes previos al inicio se descartan
+ */
+bool DFRobotDFPlayerMini::available(void) {
+
+  int value;
+
+  while ( ( value = serial->read() ) >= 0 ) {
+
+    if ( frameCount == 0 && value != FRAME_START )
+      continue;
+
+    frame[frameCount++] = value;
+
+    if ( frameCount == DFPLAYER_FRAME_SIZE ) {
+      frameCount = 0;
+      if ( parse() )
+        return true;
+    }
+  }
+
+  return false;
+
+}
+
+
+uint8_t DFRobotDFPlayerMini::readType(void) {
+
+  return handleType;
+
+}
+
+
+uint16_t DFRobotDFPlayerMini::read(void) {
+
+  return handleParameter;
+
+}
+
+
+void DFRobotDFPlayerMini::play(int fileNumber) {
+
+  command(CMD_PLAY, fileNumber);
+
+}
+
+
+void DFRobotDFPlayerMini::playFolder(uint8_t folderNumber, uint8_t fileNumber) {
+
+  command(CMD_PLAY_FOLDER, (folderNumber << 8) | fileNumber);
+
+}
+
+
+void DFRobotDFPlayerMini::stop(void) {
+
+  command(CMD_STOP, 0);
+
+}
+
+
+void DFRobotDFPlayerMini::next(void) {
+
+  command(CMD_NEXT, 0);
+
+}
+
+
+void DFRobotDFPlayerMini::previous(void) {
+
+  command(CMD_PREVIOUS, 0);
+
+}
+
+
+void DFRobotDFPlayerMini::volume(uint8_t volume) {
+
+  command(CMD_VOLUME, volume);
+
+}
+
+
+void DFRobotDFPlayerMini::volumeUp(void) {
+
+  command(CMD_VOLUME_UP, 0);
+
+}
+
+
+void DFRobotDFPlayerMini::volumeDown(void) {
+
+  command(CMD_VOLUME_DOWN, 0);
+
+}
+
+
+void DFRobotDFPlayerMini::enableLoop(void) {
+
+  command(CMD_LOOP, 0x00);
+
+}
+
+
+void DFRobotDFPlayerMini::disableLoop(void) {
+
+  command(CMD_LOOP, 0x01);
+
+}
@@ -0,0 +1,76 @@
+/*
+ * DFRobotDFPlayerMini.h (runtime minimo)
+ * Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)
+ *
+ * Protocolo del DFPlayer con la interfaz de la biblioteca original,
+ * limitada a lo que utiliza MP3Player. Los comandos se envian sin
+ * solicitar confirmacion (ACK) y sin la demora de 10 ms posterior:
+ * AudioManager ya separa los comandos (AUDIO_COMMAND_GAP_MS).
+ * available() arma las tramas recibidas sin bloquear
+ */
+
+#ifndef DFRobotDFPlayerMini_h
+#define DFRobotDFPlayerMini_h
+
+#include <Arduino.h>
+
+// Tipos de mensaje (igual que la biblioteca original)
+#define TimeOut                 0
+#define WrongStack              1
+#define DFPlayerCardInserted    2
+#define DFPlayerCardRemoved     3
+#define DFPlayerCardOnline      4
+#define DFPlayerPlayFinished    5
+#define DFPlayerError           6
+#define DFPlayerUSBInserted     7
+#define DFPlayerUSBRemoved      8
+#define DFPlayerUSBOnline       9
+#define DFPlayerCardUSBOnline  10
+#define DFPlayerFeedBack       11
+
+// Codigos de error
+#define Busy                    1
+#define FileMismatch            6
+
+#define DFPLAYER_FRAME_SIZE    10
+
+
+class DFRobotDFPlayerMini {
+
+  Stream *serial;
+
+  // Trama en recepcion y ultimo mensaje recibido
+  uint8_t frame[DFPLAYER_FRAME_SIZE];
+  uint8_t frameCount;
+  uint8_t handleType;
+  uint16_t handleParameter;
+
+  void command(uint8_t code, uint16_t parameter);
+  byte parse(void);
+
+public:
+
+  /**
+   * Con [doReset] reinicia el modulo y espera (hasta 2 s) a que
+   * informe estar listo, como la biblioteca original. [isACK]
+   * se ignora: los comandos nunca solicitan confirmacion
+   */
+  bool begin(Stream &stream, bool isACK = true, bool doReset = true);
+  bool available(void);
+  uint8_t readType(void);
+  uint16_t read(void);
+
+  void play(int fileNumber);
+  void playFolder(uint8_t folderNumber, uint8_t fileNumber);
+  void stop(void);
+  void next(void);
+  void previous(void);
+  void volume(uint8_t volume);
+  void volumeUp(void);
+  void volumeDown(void);
+  void enableLoop(void);
+  void disableLoop(void);
+
+};
+
+#endif
@@ -0,0 +1,41 @@
+/*
+ * EEPROM.h (runtime minimo)
+ * Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)
+ *
+ * Acceso a la EEPROM por los registros EEAR/EEDR/EECR. Como en
+ * avr-libc, write() espera solo a la escritura anterior y retorna
+ * mientras la nueva se programa (ver eeprom_is_ready())
+ */
+
+#ifndef EEPROM_h
+#define EEPROM_h
+
+#include <Arduino.h>
+
+
+class EEPROMClass {
+
+public:
+
+  uint8_t read(int address);
+  void write(int address, uint8_t value);
+  void update(int address, uint8_t value);
+  uint16_t length(void);
+
+  template <typename T> T &get(int address, T &value) {
+    for ( size_t i = 0 ; i < sizeof(T) ; i++ )
+      ((uint8_t *) &value)[i] = read(address + i);
+    return value;
+  }
+
+  template <typename T> const T &put(int address, const T &value) {
+    for ( size_t i = 0 ; i < sizeof(T) ; i++ )
+      update(address + i, ((const uint8_t *) &value)[i]);
+    return value;
+  }
+
+};
+
+extern EEPROMClass EEPROM;
+
+#endif
@@ -0,0 +1,145 @@
+/*
+ * HardwareSerial.cpp (runtime minimo)
+ * Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)
+ */
+
+#include <Arduino.h>
+
+
+HardwareSerial Serial;
+
+/*
+ * Buffers circulares: la interrupcion de recepcion solo avanza
+ * rxHead y la de transmision solo avanza txTail
+ */
+static volatile uint8_t rxBuffer[SERIAL_RX_BUFFER];
+static volatile uint8_t rxHead;
+static volatile uint8_t rxTail;
+
+static volatile uint8_t txBuffer[SERIAL_TX_BUFFER];
+static volatile uint8_t txHead;
+static volatile uint8_t txTail;
+static volatile uint8_t txWritten;
+
+
+ISR(USART_RX_vect) {
+
+  uint8_t value = UDR0;
+  uint8_t next = (rxHead + 1) & (SERIAL_RX_BUFFER - 1);
+
+  // Con el buffer lleno el byte se descarta
+  if ( next != rxTail ) {
+    rxBuffer[rxHead] = value;
+    rxHead = next;
+  }
+
+}
+
+
+static void transmit(void) {
+
+  UDR0 = txBuffer[txTail];
+  txTail = (txTail + 1) & (SERIAL_TX_BUFFER - 1);
+
+  // Borra TXC (se escribe en 1) para que flush() espere este byte
+  UCSR0A = ( UCSR0A & _BV(U2X0) ) | _BV(TXC0);
+
+  if ( txHead == txTail )
+    UCSR0B &= ~_BV(UDRIE0);
+
+}
+
+
+ISR(USART_UDRE_vect) {
+
+  transmit();
+
+}
+
+
+void HardwareSerial::begin(unsigned long bauds) {
+
+  // Doble velocidad (U2X): menor error en 115200 a 16MHz
+  UCSR0A = _BV(U2X0);
+  UBRR0 = (F_CPU / 4 / bauds - 1) / 2;
+  UCSR0C = _BV(UCSZ01) | _BV(UCSZ00);
+  UCSR0B = _BV(RXEN0) | _BV(TXEN0) | _BV(RXCIE0);
+
+}
+
+
+int HardwareSerial::available(void) {
+
+  return (rxHead - rxTail) & (SERIAL_RX_BUFFER - 1);
+
+}
+
+
+int HardwareSerial::peek(void) {
+
+  if ( rxHead == rxTail )
+    return -1;
+
+  return rxBuffer[rxTail];
+
+}
+
+
+int HardwareSerial::read(void) {
+
+  uint8_t value;
+
+  if ( rxHead == rxTail )
+    return -1;
+
+  value = rxBuffer[rxTail];
+  rxTail = (rxTail + 1) & (SERIAL_RX_BUFFER - 1);
+
+  return value;
+
+}
+
+
+size_t HardwareSerial::write(uint8_t value) {
+
+  uint8_t next = (txHead + 1) & (SERIAL_TX_BUFFER - 1);
+  uint8_t sreg;
+
+  /*
+   * Buffer lleno: espera a la interrupcion o, con las
+   * interrupciones deshabilitadas, transmite por consulta
+   */
+  while ( next == txTail ) {
+    if ( ! (SREG & _BV(SREG_I)) && (UCSR0A & _BV(UDRE0)) )
+      transmit();
+  }
+
+  txBuffer[txHead] = value;
+
+  sreg = SREG;
+  cli();
+  txHead = next;
+  txWritten = 1;
+  UCSR0B |= _BV(UDRIE0);
+  SREG = sreg;
+
+  return 1;
+
+}
+
+
+int HardwareSerial::availableForWrite(void) {
+
+  return (txTail - txHead - 1) & (SERIAL_TX_BUFFER - 1);
+
+}
+
+
+void HardwareSerial::flush(void) {
+
+  if ( ! txWritten )
+    return;
+
+  while ( txHead != txTail || ! (UCSR0A & _BV(TXC0)) ) ;
+
+}
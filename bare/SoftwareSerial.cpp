@@ -0,0 +1,168 @@
+/*
+ * SoftwareSerial.cpp (runtime minimo)
+ * Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)
+ */
+
+#include <SoftwareSerial.h>
+
+
+static SoftwareSerial *instance;
+
+// Cuentas de Timer2 (prescaler 8) por bit
+static uint8_t bitTicks;
+
+static volatile uint8_t rxBuffer[SOFT_SERIAL_RX_BUFFER];
+static volatile uint8_t rxHead;
+static volatile uint8_t rxTail;
+
+
+ISR(PCINT0_vect) {
+
+  if ( instance )
+    instance->receive();
+
+}
+
+
+/**
+ * Espera hasta [ticks] cuentas despues de [mark] y
+ * avanza [mark] sin acumular el error de la espera
+ */
+static inline void waitTicks(uint8_t &mark, uint8_t ticks) {
+
+  while ( (uint8_t) (TCNT2 - mark) < ticks ) ;
+
+  mark += ticks;
+
+}
+
+
+SoftwareSerial::SoftwareSerial(uint8_t rxPin, uint8_t txPin) {
+
+  rxMask = digitalPinToBitMask(rxPin);
+  txMask = digitalPinToBitMask(txPin);
+  txPort = portOutputRegister(digitalPinToPort(txPin));
+
+  // Linea en reposo (1) antes de habilitar la salida
+  digitalWrite(txPin, HIGH);
+  pinMode(txPin, OUTPUT);
+  pinMode(rxPin, INPUT_PULLUP);
+
+}
+
+
+void SoftwareSerial::begin(long bauds) {
+
+  instance = this;
+  bitTicks = F_CPU / 8 / bauds;
+
+  TCCR2A = 0;
+  TCCR2B = _BV(CS21);
+
+  PCMSK0 |= rxMask;
+  PCIFR = _BV(PCIF0);
+  PCICR |= _BV(PCIE0);
+
+}
+
+
+int SoftwareSerial::available(void) {
+
+  return (rxHead - rxTail) & (SOFT_SERIAL_RX_BUFFER - 1);
+
+}
+
+
+int SoftwareSerial::peek(void) {
+
+  if ( rxHead == rxTail )
+    return -1;
+
+  return rxBuffer[rxTail];
+
+}
+
+
+int SoftwareSerial::read(void) {
+
+  uint8_t value;
+
+  if ( rxHead == rxTail )
+    return -1;
+
+  value = rxBuffer[rxTail];
+  rxTail = (rxTail + 1) & (SOFT_SERIAL_RX_BUFFER - 1);
+
+  return value;
+
+}
+
+
+size_t SoftwareSerial::write(uint8_t value) {
+
+  uint8_t sreg = SREG;
+  uint8_t mark;
+
+  cli();
+
+  mark = TCNT2;
+
+  // Bit de inicio, 8 bits de datos (LSB primero) y bit de parada
+  *txPort &= ~txMask;
+  waitTicks(mark, bitTicks);
+
+  for ( uint8_t i = 0 ; i < 8 ; i++ ) {
+    if ( value & 0x01 )
+      *txPort |= txMask;
+    else
+      *txPort &= ~txMask;
+    value >>= 1;
+    waitTicks(mark, bitTicks);
+  }
+
+  *txPort |= txMask;
+  waitTicks(mark, bitTicks);
+
+  SREG = sreg;
+
+  return 1;
+
+}
+
+
+/**
+ * Invocada en cada cambio del pin RX: solo el flanco de bajada
+ * del bit de inicio inicia la recepcion. Los bits se muestrean
+ * en el centro, contando desde la entrada a la interrupcion
+ */
+void SoftwareSerial::receive(void) {
+
+  uint8_t mark = TCNT2;
+  uint8_t value = 0;
+  uint8_t next;
+
+  if ( PINB & rxMask )
+    return;
+
+  waitTicks(mark, bitTicks >> 1);
+
+  for ( uint8_t i = 0 ; i < 8 ; i++ ) {
+    waitTicks(mark, bitTicks);
+    value >>= 1;
+    if ( PINB & rxMask )
+      value |= 0x80;
+  }
+
+  // Centro del bit de parada
+  waitTicks(mark, bitTicks);
+
+  next = (rxHead + 1) & (SOFT_SERIAL_RX_BUFFER - 1);
+  if ( next != rxTail ) {
+    rxBuffer[rxHead] = value;
+    rxHead = next;
+  }
+
+  // Descarta los cambios del pin durante el byte
+  PCIFR = _BV(PCIF0);
+
+}
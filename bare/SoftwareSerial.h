@@ -0,0 +1,47 @@
+/*
+ * SoftwareSerial.h (runtime minimo)
+ * Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)
+ *
+ * Puerto serie por software para el reproductor MP3 (9600 bps).
+ * Los tiempos de bit se miden sobre Timer2 en marcha libre (0,5 us
+ * por cuenta a 16MHz), por lo que no dependen de la duracion del
+ * codigo. La transmision es bloqueante, con interrupciones
+ * deshabilitadas (~1 ms por byte). La recepcion la realiza la
+ * interrupcion de cambio de pin: el pin RX debe ser del PORTB
+ * (8 a 13). Admite una unica instancia
+ */
+
+#ifndef SoftwareSerial_h
+#define SoftwareSerial_h
+
+#include <Arduino.h>
+
+// Medida (potencia de 2) del buffer de recepcion
+#define SOFT_SERIAL_RX_BUFFER  32
+
+
+class SoftwareSerial : public Stream {
+
+  uint8_t rxMask;
+  uint8_t txMask;
+  volatile uint8_t *txPort;
+
+public:
+
+  SoftwareSerial(uint8_t rxPin, uint8_t txPin);
+
+  // Velocidad minima F_CPU / 8 / 255 (7843 bps a 16MHz)
+  void begin(long bauds);
+
+  virtual int available(void);
+  virtual int read(void);
+  virtual int peek(void);
+  virtual size_t write(uint8_t value);
+  using Print::write;
+
+  // Recepcion de un byte desde la interrupcion de cambio de pin
+  void receive(void);
+
+};
+
+#endif
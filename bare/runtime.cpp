@@ -0,0 +1,376 @@
+/*
+ * runtime.cpp (runtime minimo)
+ * Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)
+ *
+ * Reloj, pines, numeros aleatorios, EEPROM, Print y main()
+ */
+
+#include <Arduino.h>
+#include <EEPROM.h>
+#include <avr/eeprom.h>
+
+
+// Tope de Timer0 (prescaler 64) para una interrupcion por milisegundo
+#define TICK_TOP          (F_CPU / 64 / 1000 - 1)
+#define TICK_US           (64 / (F_CPU / 1000000L))
+
+
+EEPROMClass EEPROM;
+
+static volatile unsigned long milliseconds;
+
+
+ISR(TIMER0_COMPA_vect) {
+
+  milliseconds++;
+
+}
+
+
+static void clockBegin(void) {
+
+  TCCR0A = _BV(WGM01);
+  TCCR0B = _BV(CS01) | _BV(CS00);
+  OCR0A = TICK_TOP;
+  TCNT0 = 0;
+  TIMSK0 = _BV(OCIE0A);
+
+}
+
+
+unsigned long millis(void) {
+
+  unsigned long value;
+  uint8_t sreg = SREG;
+
+  cli();
+  value = milliseconds;
+  SREG = sreg;
+
+  return value;
+
+}
+
+
+unsigned long micros(void) {
+
+  unsigned long value;
+  uint8_t count, sreg = SREG;
+
+  cli();
+  value = milliseconds;
+  count = TCNT0;
+
+  // Tope alcanzado con la interrupcion todavia pendiente
+  if ( (TIFR0 & _BV(OCF0A)) && count < TICK_TOP )
+    value++;
+
+  SREG = sreg;
+
+  return value * 1000 + count * TICK_US;
+
+}
+
+
+void delay(unsigned long ms) {
+
+  unsigned long start = millis();
+
+  while ( millis() - start < ms ) ;
+
+}
+
+
+void delayMicroseconds(unsigned int us) {
+
+  unsigned long start = micros();
+
+  while ( micros() - start < us ) ;
+
+}
+
+
+void pinMode(uint8_t pin, uint8_t mode) {
+
+  uint8_t port = digitalPinToPort(pin);
+  uint8_t mask = digitalPinToBitMask(pin);
+  volatile uint8_t *ddr = portModeRegister(port);
+  volatile uint8_t *out = portOutputRegister(port);
+  uint8_t sreg = SREG;
+
+  cli();
+
+  if ( mode == OUTPUT )
+    *ddr |= mask;
+  else {
+    *ddr &= ~mask;
+    if ( mode == INPUT_PULLUP )
+      *out |= mask;
+    else
+      *out &= ~mask;
+  }
+
+  SREG = sreg;
+
+}
+
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+
+  uint8_t mask = digitalPinToBitMask(pin);
+  volatile uint8_t *out = portOutputRegister(digitalPinToPort(pin));
+  uint8_t sreg = SREG;
+
+  cli();
+
+  if ( value == LOW )
+    *out &= ~mask;
+  else
+    *out |= mask;
+
+  SREG = sreg;
+
+}
+
+
+int digitalRead(uint8_t pin) {
+
+  return ( *portInputRegister(digitalPinToPort(pin)) & digitalPinToBitMask(pin) ) ? HIGH : LOW;
+
+}
+
+
+/*
+ * Generador de avr-libc, con el mismo rango que el core
+ * de Arduino (mismas secuencias para la misma semilla)
+ */
+long random(long howBig) {
+
+  if ( howBig == 0 )
+    return 0;
+
+  return ::random() % howBig;
+
+}
+
+
+long random(long howSmall, long howBig) {
+
+  if ( howSmall >= howBig )
+    return howSmall;
+
+  return random(howBig - howSmall) + howSmall;
+
+}
+
+
+void randomSeed(unsigned long seed) {
+
+  if ( seed != 0 )
+    srandom(seed);
+
+}
+
+
+uint8_t EEPROMClass::read(int address) {
+
+  eeprom_busy_wait();
+
+  EEAR = address;
+  EECR |= _BV(EERE);
+
+  return EEDR;
+
+}
+
+
+/**
+ * Borrado y escritura atomicos (3.4 ms). EEPE debe
+ * activarse dentro de los 4 ciclos posteriores a EEMPE
+ */
+void EEPROMClass::write(int address, uint8_t value) {
+
+  uint8_t sreg;
+
+  eeprom_busy_wait();
+
+  EEAR = address;
+  EEDR = value;
+
+  sreg = SREG;
+  cli();
+  EECR |= _BV(EEMPE);
+  EECR |= _BV(EEPE);
+  SREG = sreg;
+
+}
+
+
+void EEPROMClass::update(int address, uint8_t value) {
+
+  if ( read(address) != value )
+    write(address, value);
+
+}
+
+
+uint16_t EEPROMClass::length(void) {
+
+  return E2END + 1;
+
+}
+
+
+size_t Print::write(const uint8_t *buffer, size_t size) {
+
+  size_t count = 0;
+
+  while ( size-- )
+    count += write(*buffer++);
+
+  return count;
+
+}
+
+
+size_t Print::print(const char *text) {
+
+  return write((const uint8_t *) text, strlen(text));
+
+}
+
+
+size_t Print::print(const __FlashStringHelper *text) {
+
+  const char *cursor = (const char *) text;
+  size_t count = 0;
+  char c;
+
+  while ( ( c = pgm_read_byte(cursor++) ) != 0 )
+    count += write(c);
+
+  return count;
+
+}
+
+
+size_t Print::print(int value) {
+
+  return print((long) value);
+
+}
+
+
+size_t Print::print(unsigned int value) {
+
+  return print((unsigned long) value);
+
+}
+
+
+size_t Print::print(long value) {
+
+  if ( value >= 0 )
+    return print((unsigned long) value);
+
+  return write('-') + print((unsigned long) -value);
+
+}
+
+
+size_t Print::print(unsigned long value, int base) {
+
+  char digits[sizeof(unsigned long) * 8 + 1];
+  char *cursor = &digits[sizeof(digits) - 1];
+  uint8_t digit;
+
+  if ( base < 2 )
+    base = 10;
+
+  *cursor = '\0';
+
+  do {
+    digit = value % base;
+    value /= base;
+    *--cursor = digit < 10 ? '0' + digit : 'A' + digit - 10;
+  } while ( value );
+
+  return print(cursor);
+
+}
+
+
+size_t Print::println(const char *text) {
+
+  return print(text) + println();
+
+}
+
+
+size_t Print::println(const __FlashStringHelper *text) {
+
+  return print(text) + println();
+
+}
+
+
+size_t Print::println(unsigned long value, int base) {
+
+  return print(value, base) + println();
+
+}
+
+
+size_t Print::println(void) {
+
+  return write('\r') + write('\n');
+
+}
+
+
+/*
+ * Soporte minimo de C++: MP3Player crea su SoftwareSerial con
+ * new y Print/Stream declaran metodos virtuales puros
+ */
+void *operator new(size_t size) {
+
+  return malloc(size);
+
+}
+
+
+void operator delete(void *pointer) {
+
+  free(pointer);
+
+}
+
+
+void operator delete(void *pointer, size_t) {
+
+  free(pointer);
+
+}
+
+
+extern "C" void __cxa_pure_virtual(void) {
+
+  cli();
+  for ( ;; ) ;
+
+}
+
+
+int main(void) {
+
+  clockBegin();
+  sei();
+
+  setup();
+
+  for ( ;; )
+    loop();
+
+  return 0;
+
+}
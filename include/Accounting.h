@@ -0,0 +1,133 @@
+/*
+ * Accounting.h
+ * Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)
+ */
+
+#ifndef Accounting_h
+#define Accounting_h
+
+#include <Arduino.h>
+
+/*
+ * Contabilidad de uso de recursos por funcionalidad (currentFunction
+ * de RuliBrain), acumulada entre sesiones. Los modulos cuentan sus
+ * operaciones y RuliBrain las entrega en cada pasada (ver
+ * RuliBrain::accountingCheck()); el costo por operacion es un
+ * incremento en RAM
+ */
+#define ACC_MODES          12
+
+/*
+ * Recursos contados por funcionalidad
+ */
+#define ACC_MP3_BYTES       0 // bytes enviados al DFPlayer
+#define ACC_REFRESHES       1 // refrescos del panel de leds
+#define ACC_PIN_WRITES      2 // escrituras de pines de salida (panel y TX del DFPlayer)
+#define ACC_ENCODER_EVENTS  3 // eventos de los encoders
+#define ACC_EEPROM_WRITES   4 // bytes escritos en EEPROM (todas las regiones)
+#define ACC_KINDS           5
+
+/*
+ * Regiones de EEPROM (ver RuliBrain.cpp): las escrituras
+ * se cuentan ademas por region, sin distinguir funcionalidad
+ */
+#define ACC_PARAMS          0 // configuracion (volumen, funcionalidad, unidad)
+#define ACC_SNAPSHOT        1
+#define ACC_OUTCOMES        2
+#define ACC_ANIMATION       3
+#define ACC_ACCOUNTING      4 // la propia contabilidad
+#define ACC_REGIONS         5
+
+/*
+ * Formato en EEPROM (ver tools/usage.py), contadores de 32 bits
+ * little endian:
+ *
+ *   'U', sesiones (16 bits), ACC_REGIONS contadores por region,
+ *   ACC_MODES x ACC_KINDS contadores (funcionalidad * ACC_KINDS + recurso)
+ *
+ * Numero de contador de get() y de la exportacion: 0 sesiones,
+ * 1 a ACC_REGIONS regiones y luego los de cada funcionalidad
+ */
+#define ACC_COUNTERS       (1 + ACC_REGIONS + ACC_MODES * ACC_KINDS)
+#define ACC_SIZE           (3 + (ACC_REGIONS + ACC_MODES * ACC_KINDS) * 4)
+
+/*
+ * Los incrementos se acumulan en RAM y se suman a la EEPROM al
+ * cambiar de funcionalidad o cada ACC_FLUSH_MS, de a un byte por
+ * pasada del lazo principal (ver Animation.h). Un corte de energia
+ * pierde lo acumulado en RAM y, si ocurre durante la suma de un
+ * contador, a lo sumo el incremento en escritura
+ */
+#define ACC_FLUSH_MS       600000UL
+
+
+class Accounting {
+
+  // Region de EEPROM asignada
+  uint16_t baseAddress;
+
+  // Funcionalidad actual y a la que corresponden los incrementos
+  uint8_t mode;
+  uint8_t countMode;
+
+  /*
+   * Incrementos en RAM: recursos de countMode seguidos de las
+   * regiones, y los que se estan sumando a la EEPROM (de pendingMode)
+   */
+  unsigned long counts[ACC_KINDS + ACC_REGIONS];
+  unsigned long pending[ACC_KINDS + ACC_REGIONS];
+  uint8_t pendingMode;
+  unsigned long flushTimestamp;
+
+  /*
+   * Suma en curso: incremento (ACC_KINDS + ACC_REGIONS: ninguno),
+   * byte del contador y nuevo valor. En el formateo cursor
+   * recorre la region
+   */
+  uint8_t flushIndex;
+  uint8_t flushByte;
+  unsigned long flushValue;
+  byte formatting;
+  uint16_t cursor;
+
+  // Proximo contador a exportar (ACC_COUNTERS: ninguno)
+  uint8_t exportIndex;
+
+  uint16_t counterAddress(uint8_t counter);
+  uint16_t incrementAddress(uint8_t index, uint8_t incrementMode);
+  unsigned long readCounter(uint16_t address);
+  void write(uint16_t address, uint8_t value);
+  void startFlush(void);
+
+public:
+
+  /**
+   * Metodo de inicializacion. Los contadores ocupan ACC_SIZE
+   * bytes de EEPROM a partir de [address]. Cuenta una sesion
+   */
+  void begin(uint16_t address);
+
+  // Funcionalidad a la que se atribuyen los proximos incrementos
+  void setMode(uint8_t pmode);
+
+  // Suma [n] al recurso [kind] de la funcionalidad actual
+  void count(uint8_t kind, unsigned long n);
+
+  // Suma [n] bytes escritos en la region [region] de EEPROM
+  void countWrites(uint8_t region, unsigned long n);
+
+  // Valor acumulado del contador [counter] (ver ACC_COUNTERS)
+  unsigned long get(uint8_t counter);
+
+  // Inicia el envio de todos los contadores por telemetria
+  void exportAll(void);
+
+  /**
+   * Debe invocarse en cada pasada: escribe en EEPROM a lo sumo
+   * un byte y envia el proximo registro de exportacion
+   */
+  void update(void);
+
+};
+
+#endif
@@ -0,0 +1,174 @@
+/*
+ * Animation.h
+ * Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)
+ */
+
+#ifndef Animation_h
+#define Animation_h
+
+#include <Arduino.h>
+
+#include "LedsPanel.h"
+
+/*
+ * Formato en EEPROM (ver tools/animation.py):
+ *
+ *   'A', cuadro inicial (5 bytes, secciones BLUE a RED), registros...
+ *
+ * Cada registro comienza con un byte de control: bits 6-7 tipo y
+ * bits 0-5 demora respecto del cuadro anterior en unidades de
+ * ANIMATION_UNIT_MS. Una demora de 63 indica que sigue un byte con
+ * la demora en unidades de ANIMATION_LONG_UNIT_MS
+ *
+ *   ANIMATION_DELTA   + mascara de secciones modificadas (bits 0-4)
+ *                     + un byte XOR por cada seccion modificada
+ *   ANIMATION_RIGHT   rotacion de la rueda a derecha
+ *   ANIMATION_LEFT    rotacion de la rueda a izquierda
+ *   ANIMATION_REPEAT  bits 0-5: cantidad de repeticiones del registro
+ *                     anterior (demora incluida)
+ *
+ * El byte ANIMATION_END indica el fin de la animacion
+ */
+#define ANIMATION_DELTA      0x00
+#define ANIMATION_RIGHT      0x40
+#define ANIMATION_LEFT       0x80
+#define ANIMATION_REPEAT     0xC0
+#define ANIMATION_END        0xFF
+
+#define ANIMATION_UNIT_MS       20
+#define ANIMATION_LONG_UNIT_MS 250
+
+// Pausa (ms) entre el ultimo cuadro y el reinicio del ciclo
+#define ANIMATION_LOOP_MS     1000
+
+/*
+ * Cantidad de bytes pendientes de escritura en EEPROM.
+ * Se escribe un byte por pasada del lazo principal para
+ * no bloquear la lectura de los encoders (~3.3 ms por byte)
+ */
+#define ANIMATION_QUEUE         12
+
+
+class Animation {
+
+  LedsPanel *ledsPanel;
+
+  // Region de EEPROM asignada
+  uint16_t baseAddress;
+  uint16_t endAddress;
+
+  //
+  // Grabacion
+  //
+
+  // Posicion del marcador de fin (proximo registro)
+  uint16_t writePosition;
+
+  // Ultimo cuadro grabado (secciones BLUE a RED)
+  uint8_t lastFrame[5];
+
+  // Ultimo registro grabado, para comprimir repeticiones
+  uint8_t lastRecord[8];
+  uint8_t lastRecordSize;
+  uint16_t repeatPosition;
+  uint8_t repeatCount;
+
+  unsigned long frameTimestamp;
+
+  typedef struct {
+
+    uint16_t address;
+    uint8_t value;
+
+  } Write_t;
+  Write_t queue[ANIMATION_QUEUE];
+  uint8_t queueHead;
+  uint8_t queueCount;
+
+  //
+  // Reproduccion
+  //
+
+  // Posicion del proximo registro a decodificar
+  uint16_t readPosition;
+
+  // Registro a aplicar al vencer la demora (0: cuadro inicial)
+  uint16_t pendingRecord;
+
+  // Ultimo registro decodificado y repeticiones restantes
+  uint16_t lastRecordPosition;
+  uint8_t repeatLeft;
+
+  uint16_t delayMs;
+  unsigned long delayTimestamp;
+
+  // Flags 1/0
+  byte recording;
+  byte playing;
+
+#ifdef RULI_ACCOUNTING
+  // Bytes escritos en EEPROM desde la ultima consulta
+  uint16_t writes;
+#endif
+
+  void put(uint16_t address, uint8_t value);
+  void flushOne(void);
+  void drain(void);
+
+  void append(uint8_t *record, uint8_t size);
+  uint8_t encodeDelay(uint8_t *record, uint8_t type);
+
+  uint16_t readDelay(uint16_t address);
+  uint16_t recordSize(uint16_t address);
+  void apply(uint16_t address);
+  void decodeNext(void);
+
+public:
+
+  /**
+   * Metodo de inicializacion. La animacion se almacena
+   * en [size] bytes de EEPROM a partir de [address]
+   */
+  void begin(LedsPanel *pledsPanel, uint16_t address, uint16_t size);
+
+  /**
+   * Inicia una nueva grabacion a partir del buffer de
+   * leds [leds] (ver LedsPanel::getValue()) como cuadro inicial
+   */
+  void record(uint8_t *leds);
+
+  // Agrega un cuadro con los cambios del buffer [leds]
+  void addFrame(uint8_t *leds);
+
+  // Agrega una rotacion de la rueda en [direction] (RIGHT / LEFT)
+  void addRotation(uint8_t direction, uint8_t *leds);
+
+  /**
+   * Finaliza la grabacion e inicia la reproduccion en ciclo
+   * de la animacion almacenada. Devuelve 0 si no hay ninguna
+   */
+  byte play(void);
+
+  // Finaliza la grabacion o reproduccion en curso
+  void stop(void);
+
+  /**
+   * Debe invocarse en cada pasada, aun sin grabacion ni
+   * reproduccion: escribe en EEPROM un byte pendiente
+   */
+  void update(void);
+
+  // Avanza la reproduccion en curso
+  void tick(void);
+
+  byte isRecording(void);
+  byte isPlaying(void);
+
+#ifdef RULI_ACCOUNTING
+  // Bytes escritos en EEPROM desde la invocacion anterior
+  uint16_t getWrites(void);
+#endif
+
+};
+
+#endif
@@ -0,0 +1,211 @@
+/*
+ * AudioManager.h
+ * Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)
+ */
+
+#ifndef AudioManager_h
+#define AudioManager_h
+
+#include <Arduino.h>
+
+#include "MP3Player.h"
+
+/*
+ * Clases de sonido en orden de prioridad. Un sonido interrumpe
+ * al actual si su clase es igual o mayor; uno de menor prioridad
+ * se descarta, salvo la musica que queda pendiente de fondo
+ */
+#define AUDIO_MUSIC    0 // Temas de music(), se reanudan luego de ser interrumpidos
+#define AUDIO_SPIN     1 // Sonidos de giro de la rueda
+#define AUDIO_EFFECT   2 // Efectos y respuestas de las funcionalidades
+#define AUDIO_VOICE    3 // Mensajes hablados (speak())
+#define AUDIO_NONE     0xFF
+
+/*
+ * Separacion minima (ms) entre comandos enviados al
+ * reproductor, que descarta comandos recibidos mientras
+ * procesa el anterior
+ */
+#define AUDIO_COMMAND_GAP_MS    30
+
+/*
+ * Tiempo (ms) luego de un comando de reproduccion durante el
+ * cual se ignoran los mensajes de fin (duplicados o del sonido
+ * interrumpido, que el reproductor puede enviar tardiamente)
+ */
+#define AUDIO_FINISH_GUARD_MS  150
+
+/*
+ * Con duracion conocida (ver SoundCatalog.h) el sonido finaliza al
+ * cumplirse, sin esperar el mensaje del reproductor. Un mensaje de
+ * fin anterior a la duracion menos AUDIO_DURATION_MARGIN_MS no
+ * corresponde al sonido actual y se descarta
+ */
+#define AUDIO_DURATION_MARGIN_MS  500
+
+/*
+ * Atenuacion de la musica (pasos de volumen) durante el ducking
+ * y al reanudarla, y tiempo (ms) de cada paso de la recuperacion
+ */
+#define AUDIO_DUCK_STEPS         8
+#define AUDIO_RAMP_STEP_MS     120
+
+#ifdef RULI_WARM_BOOT
+/*
+ * Sin el reinicio bloqueante del reproductor (ver MP3Player::begin())
+ * los comandos se retienen hasta que informa estar listo, o como
+ * maximo AUDIO_BOOT_MS (arranque sin corte de energia: no informa)
+ */
+#define AUDIO_BOOT_MS         2000
+#endif
+
+
+/*
+ * Sonido de la tarjeta SD con nombre (cue). Las familias ocupan
+ * [count] archivos consecutivos desde [file]; duration (ms, 0:
+ * desconocida) es la del primero
+ */
+struct SoundCue {
+
+  uint8_t folder;
+  uint8_t file;
+  uint8_t count;
+  unsigned long duration;
+
+  // Archivo [n] de la familia (el ultimo si se excede)
+  constexpr SoundCue at(uint8_t n) const {
+    return { folder, (uint8_t) (file + ( n < count ? n : count - 1 )), 1, 0 };
+  }
+
+  // El mismo cue en la carpeta [pfolder] (cues de cada funcionalidad)
+  constexpr SoundCue inFolder(uint8_t pfolder) const {
+    return { pfolder, file, count, 0 };
+  }
+
+};
+
+#include "SoundCatalog.h"
+
+
+/*
+ * Arbitraje del reproductor MP3 entre las distintas fuentes de
+ * sonido. Las funcionalidades solicitan sonidos con play()/stop()
+ * y update(), una vez por pasada del lazo principal, envia como
+ * maximo un comando por pasada a partir del estado deseado, por lo
+ * que solicitudes que se anulan entre si no generan trafico serie
+ */
+class AudioManager {
+
+  MP3Player *mp3Player;
+
+  typedef struct {
+
+    uint8_t soundClass;
+    uint8_t folder;
+    uint8_t file;
+
+  } Sound_t;
+
+  // Sonido en reproduccion (o ultimo comando enviado)
+  Sound_t current;
+
+  // Sonido solicitado pendiente de envio
+  Sound_t requested;
+  byte playPending;
+  byte stopPending;
+
+  // Volumen a restablecer luego de un reinicio del reproductor
+  byte volumePending;
+
+#ifdef RULI_WARM_BOOT
+  // Reproductor aun no listo luego del arranque
+  byte bootPending;
+#endif
+
+  /*
+   * Tema de music() vigente, a reanudar (desde el principio, el
+   * reproductor no permite retomar la posicion) al finalizar un
+   * sonido de mayor prioridad
+   */
+  Sound_t music;
+  byte musicActive;
+  byte resumePending;
+
+  // Clases finalizadas / musica reiniciada en la ultima update() (bits por clase)
+  uint8_t finishedMask;
+  byte musicRestarted;
+
+  unsigned long commandTimestamp;
+  unsigned long playTimestamp;
+
+  // Duracion (ms) del sonido en reproduccion, 0: desconocida
+  unsigned long currentDuration;
+
+  // Atenuacion actual de la musica y estado del ducking
+  uint8_t duckLevel;
+  byte ducking;
+  unsigned long rampTimestamp;
+
+  void readResponses(void);
+  void soundEnded(void);
+  void resumeMusic(void);
+  uint8_t activeClass(void);
+  uint8_t targetVolume(uint8_t soundClass);
+
+public:
+
+  void begin(MP3Player *pmp3Player);
+
+  /**
+   * Solicita la reproduccion del archivo [file] de la carpeta [folder]
+   * con la clase [soundClass]. Devuelve 0 si fue descartado por haber
+   * un sonido de mayor prioridad en reproduccion
+   */
+  byte play(uint8_t soundClass, uint8_t folder, uint8_t file);
+  byte play(uint8_t soundClass, SoundCue cue);
+
+  /**
+   * Detiene el sonido actual si es de la clase [soundClass]. Detener
+   * AUDIO_MUSIC descarta ademas el tema de fondo pendiente
+   */
+  void stop(uint8_t soundClass);
+
+  /**
+   * Con [on] = 1 atenua la musica en AUDIO_DUCK_STEPS pasos,
+   * con 0 recupera gradualmente el volumen
+   */
+  void setDucking(byte on);
+
+  // Lee las respuestas del reproductor y envia el proximo comando
+  void update(void);
+
+  /**
+   * Devuelve 1 si durante la ultima update() finalizo un
+   * sonido de la clase [soundClass]
+   */
+  byte finished(uint8_t soundClass);
+
+  // Devuelve 1 si hay un sonido de la clase [soundClass] en curso o pendiente
+  byte isPlaying(uint8_t soundClass);
+
+  /**
+   * Devuelve 1 si durante la ultima update() se reinicio el
+   * tema de fondo (luego de un sonido de mayor prioridad)
+   */
+  byte isMusicRestarted(void);
+
+  // Duracion (ms) del archivo [file] de la carpeta [folder], 0 si es desconocida
+  unsigned long getDuration(uint8_t folder, uint8_t file);
+
+  /**
+   * Tiempo restante (ms) del sonido de la clase [soundClass]
+   * en reproduccion, 0 si no lo hay o su duracion es desconocida
+   */
+  unsigned long getRemaining(uint8_t soundClass);
+
+  // Fraccion reproducida (0 a 255) del sonido de la clase [soundClass], idem
+  uint8_t getProgress(uint8_t soundClass);
+
+};
+
+#endif
@@ -0,0 +1,35 @@
+/*
+ * BeatMaps.h
+ * Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)
+ *
+ * ARCHIVO GENERADO por tools/beatmap.py, no editar a mano.
+ * Solo debe ser incluido por BeatSync.cpp
+ */
+
+#ifndef BeatMaps_h
+#define BeatMaps_h
+
+#define BEAT_MAP_TRACKS 40
+
+// Tempo estimado de cada tema (ms por pulso, 0 = sin mapa)
+const uint16_t beatMapTempo[BEAT_MAP_TRACKS] PROGMEM = {
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0
+};
+
+// Desplazamiento de cada tema dentro de beatMapData
+const uint16_t beatMapIndex[BEAT_MAP_TRACKS + 1] PROGMEM = {
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0
+};
+
+const uint8_t beatMapData[] PROGMEM = {
+  0x00
+};
+
+#endif
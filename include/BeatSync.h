@@ -0,0 +1,87 @@
+/*
+ * BeatSync.h
+ * Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)
+ */
+
+#ifndef BeatSync_h
+#define BeatSync_h
+
+#include <Arduino.h>
+
+/*
+ * Eventos devueltos por
+ * el metodo poll()
+ */
+#define NO_BEAT        0
+#define BEAT           1 // Pulso normal
+#define ACCENT_BEAT    2 // Pulso acentuado
+
+/*
+ * Unidad de tiempo (ms) de los deltas almacenados
+ * en la tabla generada por tools/beatmap.py
+ */
+#define BEAT_MAP_UNIT_MS   20
+
+/*
+ * Demora (ms) entre el envio del comando de reproduccion
+ * y el inicio efectivo del audio en el reproductor MP3
+ */
+#define BEAT_SYNC_OFFSET_MS 80
+
+
+class BeatSync {
+
+  // Timestamp (millis()) del inicio del tema
+  unsigned long startTimestamp;
+
+  // Tiempo (ms desde el inicio) del proximo evento
+  unsigned long nextEventTime;
+
+  // Posicion actual y final del mapa del tema en flash
+  uint16_t position;
+  uint16_t end;
+
+  /*
+   * Tempo del tema (ms por pulso). Se utiliza para seguir
+   * marcando pulsos una vez agotado el mapa
+   */
+  uint16_t tempo;
+
+  // Tipo del proximo evento (BEAT o ACCENT_BEAT)
+  uint8_t nextEvent;
+
+  // Indicador 1/0 de sincronizacion en curso
+  byte running;
+
+  /**
+   * Lee desde flash el proximo evento del mapa
+   */
+  void loadNextEvent(void);
+
+public:
+
+  void begin(void);
+
+  /**
+   * Inicia la sincronizacion con el tema [track] (0 a 39)
+   * en el momento en que se envia el comando de reproduccion.
+   * Devuelve 1 si existe mapa de pulsos para el tema
+   */
+  byte start(uint8_t track);
+
+  void stop(void);
+
+  /**
+   * Devuelve NO_BEAT, BEAT o ACCENT_BEAT segun el
+   * tiempo transcurrido desde el inicio del tema
+   */
+  uint8_t poll(void);
+
+  /**
+   * Devuelve 1 si hay un tema sincronizado en curso
+   */
+  byte isRunning(void);
+
+};
+
+#endif
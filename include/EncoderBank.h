@@ -0,0 +1,97 @@
+/*
+ * EncoderBank.h
+ * Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)
+ */
+
+#ifndef EncoderBank_h
+#define EncoderBank_h
+
+#include <Arduino.h>
+
+/*
+ * Cantidad maxima de encoders y de puertos
+ * del microcontrolador (B, C y D en el ATmega328)
+ */
+#define ENCODER_BANK_SIZE   8
+#define ENCODER_BANK_PORTS  3
+
+/*
+ * Valor devuelto por add() cuando el encoder no puede
+ * ser decodificado en paralelo (ver add())
+ */
+#define ENCODER_BANK_FULL   0xFF
+
+
+/*
+ * Decodificador en paralelo de varios encoders rotativos.
+ * Por cada pasada del lazo principal lee una unica vez el
+ * registro PINx de cada puerto utilizado y avanza el estado
+ * de todos los encoders del puerto con operaciones de bits,
+ * por lo que el costo de sample() depende de la cantidad de
+ * puertos y no de la cantidad de encoders
+ */
+class EncoderBank {
+
+  typedef struct {
+
+    volatile uint8_t *pinRegister; // Registro de entrada del puerto
+    uint8_t clkMask;    // Bits CLK de los encoders del puerto
+    uint8_t switchMask; // Bits SWITCH de los encoders del puerto
+    int8_t dataShift;   // Desplazamiento DATA -> CLK, comun al puerto
+    uint8_t lastLevels; // Niveles leidos en la muestra anterior
+    uint8_t leftTurns;  // Giros pendientes de informar, un bit por CLK
+    uint8_t rightTurns;
+
+  } Port_t;
+  Port_t ports[ENCODER_BANK_PORTS];
+  uint8_t portsCount;
+
+  typedef struct {
+
+    uint8_t port;
+    uint8_t clkBit;
+    uint8_t switchBit;
+
+  } Encoder_t;
+  Encoder_t encoders[ENCODER_BANK_SIZE];
+  uint8_t encodersCount;
+
+  // Timestamp (micros()) de la ultima muestra con giros
+  unsigned long sampleTimestamp;
+
+public:
+
+  void begin(void);
+
+  /**
+   * Registra un encoder a partir de sus pines (numeracion Arduino)
+   * y devuelve su indice dentro del banco. Todos los encoders de un
+   * mismo puerto deben tener el pin DATA a igual distancia del pin CLK
+   * (por ejemplo DATA = CLK - 1); caso contrario, o si el banco esta
+   * completo, devuelve ENCODER_BANK_FULL
+   */
+  uint8_t add(uint8_t clkPin, uint8_t dataPin, uint8_t switchPin);
+
+  /**
+   * Lee cada puerto una vez y detecta los flancos de
+   * bajada de CLK de todos los encoders a la vez
+   */
+  void sample(void);
+
+  /**
+   * Devuelve y consume el giro pendiente (LEFT_TURN,
+   * RIGHT_TURN o NONE) del encoder [index]
+   */
+  uint8_t getTurn(uint8_t index);
+
+  /**
+   * Devuelve el nivel del pulsador del
+   * encoder [index] en la ultima muestra
+   */
+  uint8_t getSwitchLevel(uint8_t index);
+
+  unsigned long getSampleTimestamp(void);
+
+};
+
+#endif
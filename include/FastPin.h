@@ -0,0 +1,73 @@
+/*
+ * FastPin.h
+ * Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)
+ */
+
+#ifndef FastPin_h
+#define FastPin_h
+
+#include <Arduino.h>
+
+
+/*
+ * Acceso a un pin (numeracion Arduino Nano / ATmega328) resuelto
+ * en tiempo de compilacion. Puerto y mascara son constantes, por
+ * lo que cada operacion se traduce en una unica instruccion
+ * sbi / cbi / sbis sobre el registro del puerto.
+ *
+ * Ciclos aproximados a 16MHz:
+ *   digitalWrite() ~ 55-70  |  FastPin<N>::high()/low() = 2
+ *   digitalRead()  ~ 50-60  |  FastPin<N>::read()       = 2-3
+ *
+ * Pines 0-7: PORTD, 8-13: PORTB, 14-19 (A0-A5): PORTC
+ */
+template <uint8_t pin>
+struct FastPin {
+
+  static inline volatile uint8_t & port(void) {
+    return pin < 8 ? PORTD : ( pin < 14 ? PORTB : PORTC );
+  }
+
+  static inline volatile uint8_t & ddr(void) {
+    return pin < 8 ? DDRD : ( pin < 14 ? DDRB : DDRC );
+  }
+
+  static inline volatile uint8_t & input(void) {
+    return pin < 8 ? PIND : ( pin < 14 ? PINB : PINC );
+  }
+
+  static inline uint8_t mask(void) {
+    return 1 << ( pin < 8 ? pin : ( pin < 14 ? pin - 8 : pin - 14 ) );
+  }
+
+  static inline void output(void) {
+    ddr() |= mask();
+  }
+
+  static inline void inputPullup(void) {
+    ddr() &= ~mask();
+    port() |= mask();
+  }
+
+  static inline void high(void) {
+    port() |= mask();
+  }
+
+  static inline void low(void) {
+    port() &= ~mask();
+  }
+
+  static inline void write(uint8_t value) {
+    if ( value )
+      high();
+    else
+      low();
+  }
+
+  static inline uint8_t read(void) {
+    return ( input() & mask() ) ? 1 : 0;
+  }
+
+};
+
+#endif
@@ -0,0 +1,67 @@
+/*
+ * LatencyMeter.h
+ * Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)
+ */
+
+#ifndef LatencyMeter_h
+#define LatencyMeter_h
+
+#include <Arduino.h>
+
+/*
+ * Cantidad de rangos del histograma. El rango 0 agrupa
+ * las muestras menores a 256us, luego dos rangos por
+ * cada potencia de 2 hasta aproximadamente 1 segundo
+ */
+#define LATENCY_BUCKETS  24
+
+
+class LatencyMeter {
+
+  // Histograma de muestras (en microsegundos)
+  uint16_t buckets[LATENCY_BUCKETS];
+
+  uint16_t count;
+  unsigned long minValue;
+  unsigned long maxValue;
+
+  /**
+   * Obtiene el rango del histograma correspondiente
+   * a [us] y el limite superior de un rango
+   */
+  static uint8_t bucketOf(unsigned long us);
+  static unsigned long bucketLimit(uint8_t bucket);
+
+#ifdef RULI_SOAK
+  // Acumulacion de los histogramas desde tools/soak/soak.cpp
+  friend class Soak;
+#endif
+
+public:
+
+  void begin(void);
+
+  /**
+   * Registra una muestra de latencia en microsegundos
+   */
+  void record(unsigned long us);
+
+  /**
+   * Devuelve el percentil [percent] (1 a 100) de las muestras
+   * registradas, con la resolucion del histograma (~41%)
+   */
+  unsigned long percentile(uint8_t percent);
+
+  uint16_t getCount(void);
+  unsigned long getMin(void);
+  unsigned long getMax(void);
+
+  /**
+   * Imprime el resumen en formato texto:
+   * n=.. min=.. p50=.. p90=.. p99=.. max=..
+   */
+  void report(Print &out);
+
+};
+
+#endif
@@ -0,0 +1,150 @@
+/*
+ * LightStream.h
+ * Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)
+ */
+
+#ifndef LightStream_h
+#define LightStream_h
+
+#include <Arduino.h>
+
+#include "LedsPanel.h"
+#include "AudioManager.h"
+
+/*
+ * Registros recibidos desde el host por el puerto serie de hardware,
+ * con el mismo formato que los de telemetria (ver Telemetry.h) pero
+ * con su propio byte de sincronismo:
+ *
+ *   0     STREAM_SYNC
+ *   1     tipo de registro
+ *   2     numero de secuencia
+ *   3-4   instante de presentacion (ms del reloj del host, 16 bits)
+ *   5-10  datos (segun el tipo)
+ *   11    suma de control: complemento a 2 de la suma de los bytes 1 a 10
+ *
+ * Ver tools/stream_send.py
+ */
+#define STREAM_SYNC          0x5A
+#define STREAM_RECORD_SIZE   12
+#define STREAM_PAYLOAD_SIZE  6
+#define STREAM_BAUDS         115200
+
+/*
+ * Tipos de registro
+ */
+#define ST_CLOCK    0x01 // inicio del show: fija la referencia del reloj del host
+#define ST_FRAME    0x02 // buffer de leds completo (6 bytes, FUNC_INDICATOR a RED)
+#define ST_CUE      0x03 // clase de sonido, carpeta, archivo (carpeta 0: detener)
+#define ST_END      0x04 // fin del show
+#define ST_EXPORT   0x05 // solicitud de exportacion de estadisticas (no inicia un show)
+
+/*
+ * Demora (ms) agregada a cada instante de presentacion para
+ * absorber la variacion del tiempo de llegada de los registros
+ */
+#define STREAM_JITTER_MS      30
+
+/*
+ * Un cuadro que llega con mas de STREAM_LATE_MS de atraso
+ * respecto de su instante de presentacion se descarta
+ */
+#define STREAM_LATE_MS        20
+
+// Sin registros durante STREAM_TIMEOUT_MS se da por terminado el show
+#define STREAM_TIMEOUT_MS   2000
+
+// Registros en espera de su instante de presentacion
+#define STREAM_SLOTS           6
+
+// Intervalo (ms) de las estadisticas del stream
+#define STREAM_STATS_MS     1000
+
+/*
+ * Valores devueltos por receive()
+ */
+#define STREAM_IDLE      0
+#define STREAM_STARTED   1
+#define STREAM_ENDED     2
+#define STREAM_EXPORT    3 // se recibio ST_EXPORT
+
+
+/*
+ * Show de luces y sonido transmitido en tiempo real por el host.
+ * Los registros se encolan hasta su instante de presentacion y
+ * recien entonces se copian al panel de leds (latch). Si a un
+ * mismo instante llegan varios cuadros vencidos solo se muestra
+ * el mas reciente; los sonidos se envian siempre
+ */
+class LightStream {
+
+  LedsPanel *ledsPanel;
+  AudioManager *audio;
+
+  // Registro en recepcion
+  uint8_t rxBuffer[STREAM_RECORD_SIZE];
+  uint8_t rxCount;
+
+  typedef struct {
+
+    uint8_t type;
+    unsigned long due;  // instante de presentacion (micros())
+    uint8_t data[STREAM_PAYLOAD_SIZE];
+
+  } Slot_t;
+  Slot_t slots[STREAM_SLOTS];
+  uint8_t slotHead;
+  uint8_t slotCount;
+
+  byte active;
+
+  /*
+   * Reloj del host desenvuelto a 32 bits y desplazamiento
+   * (us) hacia la base de tiempo de micros()
+   */
+  unsigned long hostClock;
+  uint16_t lastHostMs;
+  unsigned long clockOffset;
+
+  unsigned long recordTimestamp;
+
+  // Estadisticas
+  uint16_t frames;
+  uint16_t dropped;
+  unsigned long jitterMax;
+  unsigned long statsTimestamp;
+
+  uint8_t record(void);
+  void startClock(uint16_t hostMs);
+  void enqueue(uint8_t type, unsigned long due, const uint8_t *data);
+  void drop(void);
+
+public:
+
+  void begin(LedsPanel *pledsPanel, AudioManager *paudio);
+
+  /**
+   * Procesa los bytes recibidos por el puerto serie sin bloquear.
+   * Devuelve STREAM_STARTED al comenzar un show, STREAM_ENDED al
+   * terminar (registro ST_END o STREAM_TIMEOUT_MS sin registros),
+   * STREAM_EXPORT al recibir ST_EXPORT y STREAM_IDLE en cualquier
+   * otro caso
+   */
+  uint8_t receive(void);
+
+  /**
+   * Presenta los registros cuyo instante ya vencio. Devuelve
+   * 1 si se copio un cuadro nuevo al panel de leds
+   */
+  byte tick(void);
+
+  // Descarta los registros pendientes
+  void flush(void);
+
+  byte isActive(void);
+
+  uint16_t getDropped(void);
+
+};
+
+#endif
@@ -0,0 +1,133 @@
+/*
+ * OutcomeStats.h
+ * Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)
+ */
+
+#ifndef OutcomeStats_h
+#define OutcomeStats_h
+
+#include <Arduino.h>
+
+/*
+ * Modos auditados y cantidad de posibles resultados
+ * de cada uno (numero de led, ver LedsPanel::getWheelNValue())
+ */
+#define OUTCOME_RANDOM_COLOR     0
+#define OUTCOME_SOUND_SHOOTING   1
+#define OUTCOME_MODES            2
+#define OUTCOME_LEDS            40
+#define OUTCOME_COUNTERS        (OUTCOME_MODES * OUTCOME_LEDS)
+
+/*
+ * Formato en EEPROM (ver tools/outcomes.py):
+ *
+ *   'o', estado, OUTCOME_COUNTERS totales (2 bytes), registro
+ *
+ * El registro ocupa el resto de la region: un byte por resultado
+ * (modo * OUTCOME_LEDS + led), OUTCOME_EMPTY en las posiciones libres.
+ * Al completarse se suma a los totales y se borra, de modo que cada
+ * byte de la region se escribe una vez cada tantos resultados como
+ * posiciones tiene el registro.
+ *
+ * La suma sobrevive a un corte de energia sin contar dos veces:
+ *
+ *   estado  etapa (registro, suma o borrado) y epoca actual (bit 7),
+ *           que se alterna al comenzar cada suma
+ *   total   7 bits bajos del valor + epoca, luego 7 bits altos + epoca
+ *
+ * Durante la suma se reescriben todos los totales con la nueva epoca,
+ * primero el byte bajo. Un byte con la epoca actual ya fue sumado, y
+ * con el bajo escrito y el alto aun no, el acarreo se deduce de los
+ * resultados del registro (menos de 128). Al reiniciar, begin() retoma
+ * la suma o el borrado segun el estado
+ */
+#define OUTCOME_EMPTY         0xFF
+
+// Maximo de cada total (14 bits)
+#define OUTCOME_MAX         0x3FFF
+
+/*
+ * Resultados pendientes de escritura en EEPROM. Se escribe un
+ * byte por pasada del lazo principal (ver Animation.h)
+ */
+#define OUTCOME_PENDING          8
+
+
+class OutcomeStats {
+
+  // Region de EEPROM asignada
+  uint16_t baseAddress;
+  uint16_t logAddress;
+  uint8_t logSize;
+
+  // Proxima posicion libre del registro
+  uint8_t logPosition;
+
+  // Resultados aun no escritos
+  uint8_t pending[OUTCOME_PENDING];
+  uint8_t pendingHead;
+  uint8_t pendingCount;
+  uint16_t lost;
+
+  /*
+   * Etapa del mantenimiento de la region (ver OutcomeStats.cpp),
+   * epoca de los totales, posicion actual, byte del total en
+   * escritura y total en consolidacion
+   */
+  uint8_t phase;
+  uint8_t epoch;
+  uint16_t cursor;
+  uint8_t step;
+  uint16_t foldValue;
+
+  // Proximo contador a exportar (OUTCOME_COUNTERS: ninguno)
+  uint8_t exportIndex;
+
+#ifdef RULI_ACCOUNTING
+  // Bytes escritos en EEPROM desde la ultima consulta
+  uint16_t writes;
+#endif
+
+  void write(uint16_t address, uint8_t value);
+  void setState(uint8_t state);
+  uint16_t readTotal(uint8_t counter);
+  uint16_t foldTotal(uint8_t counter);
+  uint8_t logOccurrences(uint8_t counter);
+
+public:
+
+  /**
+   * Metodo de inicializacion. Las estadisticas se almacenan
+   * en [size] bytes de EEPROM a partir de [address]
+   */
+  void begin(uint16_t address, uint16_t size);
+
+  /**
+   * Registra que el modo [mode] se detuvo en el led [led].
+   * Solo encola el resultado, no accede a la EEPROM
+   */
+  void count(uint8_t mode, uint8_t led);
+
+  // Cantidad acumulada de resultados [led] del modo [mode]
+  uint16_t get(uint8_t mode, uint8_t led);
+
+  // Inicia el envio de todos los contadores por telemetria
+  void exportAll(void);
+
+  /**
+   * Debe invocarse en cada pasada: escribe en EEPROM a lo sumo
+   * un byte y envia el proximo registro de exportacion
+   */
+  void update(void);
+
+  // Resultados descartados por cola llena
+  uint16_t getLost(void);
+
+#ifdef RULI_ACCOUNTING
+  // Bytes escritos en EEPROM desde la invocacion anterior
+  uint16_t getWrites(void);
+#endif
+
+};
+
+#endif
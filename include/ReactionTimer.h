@@ -0,0 +1,118 @@
+/*
+ * ReactionTimer.h
+ * Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)
+ */
+
+#ifndef ReactionTimer_h
+#define ReactionTimer_h
+
+#include <Arduino.h>
+
+/*
+ * Cantidad de tiempos de reaccion conservados
+ * por sesion para calcular mediana y ranking
+ */
+#define REACTION_SCORES  8
+
+
+/*
+ * Flancos de CLK a menos de este intervalo (us) del anterior se
+ * consideran rebotes del contacto y no reemplazan a la captura
+ */
+#define REACTION_BOUNCE_US  1000
+
+
+/*
+ * Medicion de tiempos de reaccion con resolucion de 0.5us.
+ *
+ * El Timer1 corre libre con prescaler 8 (2 ticks por us a 16MHz)
+ * y su unidad de captura (input capture) se conecta al comparador
+ * analogico: entrada positiva = referencia interna de 1.1V y entrada
+ * negativa = pin CLK del encoder a traves del multiplexor del ADC.
+ * Cada flanco de bajada de CLK queda registrado por hardware en ICR1,
+ * sin la latencia variable de las interrupciones ni del lazo principal.
+ * El lazo toma la captura al decodificar cada giro (turn()) y la
+ * medicion se cierra con la del giro que alcanzo el color (stop())
+ *
+ * Fuentes de jitter:
+ *   - captura: cuantizacion de 0.5us + 4 ciclos fijos del filtro de ruido
+ *   - rebote del contacto: el filtro de ruido no lo elimina. Se toma el
+ *     primer flanco de cada rafaga (REACTION_BOUNCE_US) y la duracion
+ *     maxima de las rafagas se registra en getBounceMax()
+ *   - latch de los leds: se toma de LedsPanel::getRefreshTimestamp()
+ *     (micros(), resolucion de 4us) y se traslada a la base de Timer1.
+ *     La demora entre el latch y start() se registra en getLatchDelay*()
+ *
+ * Mediana, demoras del latch y rebote se informan por telemetria
+ * (TM_REACTION)
+ */
+class ReactionTimer {
+
+  // Timestamp (ticks de Timer1) del latch de los leds
+  unsigned long latchTicks;
+
+  // Flanco capturado al decodificar el ultimo giro (ticks)
+  unsigned long turnTicks;
+
+  // Demoras minima y maxima (us) entre el latch y start()
+  uint16_t latchDelayMin;
+  uint16_t latchDelayMax;
+
+  /*
+   * Tiempos de la sesion en unidades de 100us (circular),
+   * mejor tiempo exacto en us y cantidad de mediciones
+   */
+  uint16_t scores[REACTION_SCORES];
+  unsigned long bestScore;
+  uint8_t scoresCount;
+  uint8_t scoresNext;
+
+public:
+
+  /**
+   * Configura Timer1 y el comparador analogico para
+   * capturar los flancos del pin [clkPin] (A0 a A5)
+   */
+  void begin(uint8_t clkPin);
+
+  /**
+   * Lee el contador de 32 bits extendido de Timer1
+   */
+  static unsigned long ticks(void);
+
+  /**
+   * Inicia una medicion a partir del latch de los leds
+   * registrado en [latchMicros] (micros())
+   */
+  void start(unsigned long latchMicros);
+
+  /**
+   * Registra el ultimo flanco capturado como el del giro
+   * recien decodificado. Se invoca al leer el encoder
+   */
+  void turn(void);
+
+  /**
+   * Finaliza la medicion con el flanco del ultimo giro registrado,
+   * guarda el tiempo en la sesion y devuelve su ranking (1 = mejor).
+   * Devuelve 0 sin registrar el tiempo si el flanco es anterior al
+   * latch de los leds (giro previo o sin captura nueva)
+   */
+  uint8_t stop(void);
+
+  // Ultimo tiempo de reaccion medido (us)
+  unsigned long getLast(void);
+
+  unsigned long getBest(void);
+  unsigned long getMedian(void);
+  uint8_t getCount(void);
+
+  uint16_t getLatchDelayMin(void);
+  uint16_t getLatchDelayMax(void);
+
+  // Duracion maxima (us) de las rafagas de rebote de la sesion
+  uint16_t getBounceMax(void);
+
+};
+
+#endif
@@ -0,0 +1,119 @@
+/*
+ * RgbLedsPanel.h
+ * Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)
+ */
+
+#ifndef RgbLedsPanel_h
+#define RgbLedsPanel_h
+
+#include <Arduino.h>
+
+#include "LedsPanel.h"
+#include "Ws2812.h"
+
+/*
+ * Leds RGB direccionables en lugar de los shift registers: los 40
+ * leds de la rueda en el orden de setWheelValues() (led N de la
+ * rueda: pixel N) seguidos de los 8 de la columna indicadora, desde
+ * el bit mas significativo de FUNC_INDICATOR
+ */
+#define RGB_WHEEL_PIXELS    40
+#define RGB_PIXELS          48
+
+/*
+ * Cada pixel es un indice de 4 bits en una paleta de RGB_COLORS
+ * colores: 24 bytes de cuadro en lugar de 144. El indice 0 es el
+ * color de los leds apagados, los de 1 a 6 los de cada seccion
+ * encendida y el resto quedan para setSectionColor()
+ */
+#define RGB_COLORS          16
+#define RGB_OFF              0
+
+/*
+ * Escrituras del pin por refresh() (ver Accounting.h):
+ * flanco ascendente y descendente de cada bit
+ */
+#define RGB_REFRESH_PINS   (2 * 24 * RGB_PIXELS)
+
+
+class RgbLedsPanel : public LedsPanel {
+
+protected:
+
+  // Paleta, 3 bytes por color en el orden de los leds (G, R, B)
+  uint8_t palette[RGB_COLORS][WS2812_PIXEL_BYTES];
+
+  // Color de los leds encendidos de cada seccion
+  uint8_t sectionColors[6];
+
+  // Cuadro: indice de color de cada pixel, dos por byte (par en los bits bajos)
+  uint8_t pixels[RGB_PIXELS / 2];
+
+  // Paleta y colores de las secciones por omision (ver begin())
+  void beginPalette(void);
+
+  // Traduce el cuadro combinado [frame] a indices de la paleta en pixels
+  void render(const uint8_t *frame);
+
+
+public:
+
+  /**
+   * Metodo de inicializacion: buffer y capas en cero y
+   * cada seccion con el color de los leds del panel original
+   */
+  void begin(void);
+
+  // Color [index] de la paleta, componentes de 0 a 255
+  void setColor(uint8_t index, uint8_t red, uint8_t green, uint8_t blue);
+
+  // Color de la paleta de los leds encendidos de la seccion [ledsSection]
+  void setSectionColor(uint8_t ledsSection, uint8_t index);
+
+  // Indice de color del pixel [pixel] en el ultimo refresh()
+  uint8_t getPixel(uint8_t pixel);
+
+  // Componentes del color [index] en orden G, R, B
+  const uint8_t * getColor(uint8_t index);
+
+#ifdef RULI_ACCOUNTING
+  virtual uint16_t getRefreshPins(void);
+#endif
+
+};
+
+
+/*
+ * Salida a una cadena de RGB_PIXELS leds WS2812 por el pin
+ * dataPinT (ver Ws2812.h). Cada refresco envia 1152 bits:
+ * ~1.5ms con las interrupciones deshabilitadas salvo
+ * entre led y led, mas WS2812_RESET_US antes del siguiente
+ */
+template <uint8_t dataPinT>
+class Ws2812LedsPanel : public RgbLedsPanel {
+
+public:
+
+  void begin(void) {
+    FastPin<dataPinT>::low();
+    FastPin<dataPinT>::output();
+    RgbLedsPanel::begin();
+  }
+
+protected:
+
+  virtual void output(const uint8_t *frame) {
+
+    render(frame);
+
+    // Los leds presentan el cuadro anterior luego de WS2812_RESET_US en bajo
+    while ( micros() - refreshTimestamp < WS2812_RESET_US )
+      ;
+
+    Ws2812<dataPinT>::sendFrame(pixels, &palette[0][0], RGB_PIXELS);
+
+  }
+
+};
+
+#endif
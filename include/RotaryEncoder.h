@@ -6,6 +6,8 @@
 #ifndef RotaryEncoder_h
 #define RotaryEncoder_h
 
+#include "FastPin.h"
+
 /*
  * Acciones disponibles para
  * el encoder rotativo
@@ -14,12 +16,40 @@
 #define LEFT_TURN       1 // Giro hacia la izquierda (antihorario)
 #define RIGHT_TURN      2 //  "     "    " derecha (horario)
 #define SWITCH_CLICK    3 // Click en el pulsador
-#define SWITCH_HELD     4 // Retencion del pulsador
+#define SWITCH_HELD     4 // Retencion del pulsador (al superar GESTURE_HOLD_US)
+#define SWITCH_DOUBLE_CLICK 5 // Doble click (ver setDoubleClick())
+#define SWITCH_REPEAT   6 // Repeticion mientras se mantiene retenido (ver setRepeat())
 
-class RotaryEncoder {
+/*
+ * Tiempos (us) del reconocimiento de gestos del pulsador
+ */
+#define GESTURE_DEBOUNCE_US     5000UL // Estabilidad minima del nivel del pulsador
+#define GESTURE_HOLD_US       700000UL // Retencion
+#define GESTURE_REPEAT_US     600000UL // Demora de la primera repeticion
+#define GESTURE_REPEAT_MIN_US  60000UL // Periodo minimo de repeticion
 
-  // Ultimo nivel logico leido del pin CLK
-  uint8_t lastClkPinLevel;
+/*
+ * Intervalo (ms) entre detents a partir del cual el giro
+ * se considera lento y la aceleracion vuelve a cero
+ */
+#define ACCELERATION_RESET_MS  250
+
+/*
+ * Tramo de una curva de aceleracion (ver setAcceleration()):
+ * un detent a menos de intervalMs del anterior avanza steps
+ * posiciones. La curva se ordena por intervalMs creciente y
+ * termina con un tramo de intervalMs 0
+ */
+typedef struct {
+
+  uint8_t intervalMs;
+  uint8_t steps;
+
+} Acceleration_t;
+
+class EncoderBank;
+
+class RotaryEncoder {
 
   // Pin "CLK"
   uint8_t clkPin;
@@ -33,6 +63,59 @@ class RotaryEncoder {
   unsigned long switchTimestamp;
   uint8_t savedEvent;
 
+  /*
+   * Reconocimiento de gestos del pulsador: nivel leido y
+   * nivel estable (luego del filtro antirrebote), estado
+   * y tiempos (micros()) del gesto en curso
+   */
+  uint8_t rawSwitchLevel;
+  uint8_t switchLevel;
+  unsigned long rawTimestamp;
+  uint8_t gestureState;
+  unsigned long gestureTimestamp;
+  unsigned long repeatPeriod;
+  unsigned long doubleClickWindow;
+  byte repeatEnabled;
+
+  uint8_t gestureCheck(uint8_t level);
+
+  // Timestamp (micros()) del ultimo flanco de giro detectado
+  unsigned long eventTimestamp;
+
+  /*
+   * Aceleracion del giro: curva en PROGMEM (NULL: sin
+   * aceleracion), sentido del ultimo giro, intervalo
+   * promedio (ms) entre detents y posiciones a avanzar
+   */
+  const Acceleration_t *accelerationCurve;
+  uint8_t lastTurn;
+  uint8_t turnInterval;
+  uint8_t turnSteps;
+
+  void accelerationCheck(uint8_t turn, unsigned long timestamp);
+
+  uint8_t bankIndex;
+
+protected:
+
+  // Ultimo nivel logico leido del pin CLK
+  uint8_t lastClkPinLevel;
+
+  /*
+   * Banco de decodificacion en paralelo al que se asocio
+   * el encoder (NULL: lectura individual de cada pin)
+   */
+  EncoderBank *bank;
+
+  /*
+   * Pasos de getEvent() comunes a la lectura con digitalRead()
+   * y con FastPin: giro detectado en el flanco de bajada de CLK
+   * segun el nivel de DATA, y evento a informar segun el nivel
+   * del pulsador
+   */
+  void turnCheck(uint8_t dataPinLevel);
+  uint8_t eventCheck(uint8_t switchPinLevel);
+
 public:
 
   /**
@@ -44,12 +127,96 @@ public:
   void begin(uint8_t pclkPin, uint8_t pdataPin, uint8_t pswitchPin);
   void begin(uint8_t pclkPin, uint8_t pdataPin);
 
+  /**
+  * Asocia el encoder a un banco de decodificacion en paralelo.
+  * Si sus pines no son compatibles con el banco continua
+  * leyendo cada pin en forma individual
+  */
+  void attach(EncoderBank *pbank);
+
   /**
   * Obtiene la accion o evento
   * producido en el encoder
   */
   uint8_t getEvent(void);
 
+  /**
+  * Obtiene el timestamp (micros()) en que se
+  * detecto el flanco del ultimo evento de giro
+  */
+  unsigned long getEventTimestamp(void);
+
+  /**
+  * Obtiene la cantidad de posiciones que corresponde avanzar
+  * por el ultimo evento de giro segun la curva de aceleracion
+  * (1 con giro lento o sin curva establecida)
+  */
+  uint8_t getSteps(void);
+
+  // Obtiene el pin CLK del encoder
+  uint8_t getClkPin(void);
+
+  /**
+  * Habilita SWITCH_DOUBLE_CLICK con una ventana de [windowMs]
+  * entre clicks (0: deshabilitado). Con doble click habilitado
+  * SWITCH_CLICK se informa al vencer la ventana
+  */
+  void setDoubleClick(uint16_t windowMs);
+
+  /**
+  * Habilita/deshabilita SWITCH_REPEAT: luego de SWITCH_HELD, mientras
+  * el pulsador sigue retenido, con un periodo que se acelera hasta
+  * GESTURE_REPEAT_MIN_US
+  */
+  void setRepeat(byte enabled);
+
+  /**
+  * Establece la curva de aceleracion del giro [curve] (en PROGMEM),
+  * aplicada al intervalo entre detents sucesivos en el mismo
+  * sentido (NULL: deshabilitada, cada detent avanza 1 posicion)
+  */
+  void setAcceleration(const Acceleration_t *curve);
+
+};
+
+
+/*
+ * Variante de RotaryEncoder con los pines resueltos en tiempo de
+ * compilacion (ver FastPin.h): getEvent() lee CLK, DATA y SWITCH
+ * con una instruccion sbis cada uno en lugar de digitalRead().
+ * getEvent() no es virtual: las llamadas a traves de un puntero
+ * a RotaryEncoder (p.ej. desde RuliBrain) usan digitalRead().
+ * Asociado a un banco (attach()) se comporta como RotaryEncoder.
+ * switchPinT = 0 indica encoder sin pulsador
+ */
+template <uint8_t clkPinT, uint8_t dataPinT, uint8_t switchPinT>
+class FastRotaryEncoder : public RotaryEncoder {
+
+public:
+
+  void begin(void) {
+    RotaryEncoder::begin(clkPinT, dataPinT, switchPinT);
+  }
+
+  uint8_t getEvent(void) {
+
+    uint8_t clkPinLevel;
+
+    if ( bank )
+      return RotaryEncoder::getEvent();
+
+    clkPinLevel = FastPin<clkPinT>::read();
+
+    if ( clkPinLevel == 0 && lastClkPinLevel == 1 )
+      turnCheck(FastPin<dataPinT>::read());
+
+    lastClkPinLevel = clkPinLevel;
+
+    return eventCheck(switchPinT ? FastPin<switchPinT>::read() : 1);
+
+  }
+
 };
 
+
 #endif
@@ -1,154 +1,287 @@
-/*
- * RuliBrain.h
- * Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)
- */
-
-#ifndef RuliBrain_h
-#define RuliBrain_h
-
-#include "RotaryEncoder.h"
-#include "MP3Player.h"
-#include "LedsPanel.h"
-
-/* Cantidad maxima de instancias de
- * intervalos que podran ser creadas
- * con el metodo getInterval
- */
-#define INTERVALS    16
-
-/*
- * Medida del buffer de datos de
- * proposito general utilizado por
- * las distintas funcionalidades
- */
-#define DATA_SIZE    8
-
-
-class RuliBrain {
-
-  /*
-   * Declaracion de punteros a
-   * objetos principales de
-   * la aplicacion
-   */
-  RotaryEncoder *mainWheel;
-  RotaryEncoder *rotarySelector;
-  MP3Player *mp3Player;
-  LedsPanel *ledsPanel;
-
-  // Eventos de los encoders
-  uint8_t selectorEvent;
-  uint8_t wheelEvent;
-
-  // Funcionalidad que ejecuto previamente
-  uint8_t prevFunction;
-
-  // Funcionalidad actual en ejecucion
-  uint8_t currentFunction;
-
-  /* Funcionalidad seleccionada momentaneamente
-   * durante la ejecucion del selector
-   * de funcionalidades
-   */
-  uint8_t selectedFunction;
-
-  /* Nivel de volumen establecido
-   * para el reproductor MP3
-   */
-  uint8_t volume;
-
-  /*
-   * Indicador de paso o estado para uso
-   * general en las funcionalidades
-   */
-  uint8_t currentStep;
-
-  /*
-   * Numero de sonido seleccionado para
-   * indicar giro de la rueda principal
-   */
-  uint8_t spinSound;
-
- /*
-  * Flags 1/0 que indican
-  * distintos estados
-  */
-  byte initializeFunction;   // funcionalidad debe ser inicializada
-  byte funcSelectorIsActive; // selector de funcionalidades esta en ejecucion
-  byte volumeSettingIsActive; // ajuste de volumen esta en ejecucion
-  byte speaking;  // ruli esta hablando
-  byte spinning;  // la rueda se encuentra girando
-
- /*
-  * Declaracion de vector para manejo de distintos
-  * intervalos mediante el metodo getInterval
-  */
-  typedef struct {
-
-    unsigned long timestamp;
-    uint8_t currentStep;
-
-  } Interval_t;
-  Interval_t intervals[INTERVALS];
-
-/*
- * Buffer de datos de proposito general utilizado
- * por las distintas funcionalidades
- */
-  byte data[DATA_SIZE];
-
-
-  /**
-   * Devuelve un valor entre 0 y [steps] incrementando dicho valor
-   * siempre y cuando el tiempo sea >= [ms] entre cada invocacion
-   * se devera especificar un indicador de intervalo [interval] que
-   * puede ser de 0 a INTERVALS
-   *
-   */
-  uint8_t getInterval(uint8_t interval, unsigned long ms, uint8_t steps);
-
-  void resetInterval(uint8_t interval);
-
-  void mp3FinishFlush(void);
-
-  void functionSelector(void);
-
-  void volumeSetting(void);
-
-  void speak(uint8_t folderNumber, uint8_t fileNumber);
-
-  void ledSpeakEffect(void);
-
-  void playSpinSound(void);
-
-  void iddleCheck(void);
-
- //
- // Funcionalidades de Ruli
- //
-  void welcome(void);
-  void simpleRoulette(void);
-  void randomColor(void);
-  void followTheColor(void);
-  void turnMeter(void);
-  void velocityMeter(void);
-  void customShape(void);
-  void soundShooting(void);
-  void music(void);
- ///
-
-
-public:
-
-  /**
-   * Metodo de inicializacion
-   * simil constructor
-   */
-  void begin(RotaryEncoder *pmainWheel, RotaryEncoder *protarySelector, MP3Player *pmp3Player, LedsPanel *pledsPanel);
-
-  // Metodo de ejecucion principal
-  void run(void);
-
-};
-
-#endif
+/*
+ * RuliBrain.h
+ * Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)
+ */
+
+#ifndef RuliBrain_h
+#define RuliBrain_h
+
+#include "RotaryEncoder.h"
+#include "MP3Player.h"
+#include "AudioManager.h"
+#include "LedsPanel.h"
+#include "BeatSync.h"
+#include "LatencyMeter.h"
+#include "ReactionTimer.h"
+#include "Telemetry.h"
+#include "RuliVM.h"
+#include "Animation.h"
+#include "LightStream.h"
+#include "OutcomeStats.h"
+#include "Snapshot.h"
+#include "Accounting.h"
+#ifdef RULI_SYNC
+#include "SyncBus.h"
+#endif
+
+/* Cantidad maxima de instancias de
+ * intervalos que podran ser creadas
+ * con el metodo getInterval
+ */
+#define INTERVALS    20
+
+/*
+ * Medida del buffer de datos de
+ * proposito general utilizado por
+ * las distintas funcionalidades
+ */
+#define DATA_SIZE    8
+
+// Cantidad de leds de la rueda principal
+#define WHEEL_LEDS   40
+
+
+class RuliBrain {
+
+  /*
+   * Declaracion de punteros a
+   * objetos principales de
+   * la aplicacion
+   */
+  RotaryEncoder *mainWheel;
+  RotaryEncoder *rotarySelector;
+  MP3Player *mp3Player;
+  LedsPanel *ledsPanel;
+
+  // Arbitraje de los sonidos de las funcionalidades
+  AudioManager audio;
+
+  // Sincronizacion de efectos con los pulsos del tema en reproduccion
+  BeatSync beatSync;
+
+  // Medicion de tiempos de reaccion en followTheColor()
+  ReactionTimer reactionTimer;
+
+  // Animacion grabada en customShape()
+  Animation animation;
+
+  // Interprete de programas del modo userProgram()
+  RuliVM ruliVM;
+
+  // Histogramas de resultados de randomColor() y soundShooting()
+  OutcomeStats outcomes;
+
+  /*
+   * Resguardo del estado en EEPROM y funcionalidad a reanudar
+   * con el estado resguardado (WELCOME: ninguna, ver resuming())
+   */
+  Snapshot snapshot;
+  uint8_t resumeFunction;
+
+  // Eventos de los encoders
+  uint8_t selectorEvent;
+  uint8_t wheelEvent;
+
+  // Funcionalidad que ejecuto previamente
+  uint8_t prevFunction;
+
+  // Funcionalidad actual en ejecucion
+  uint8_t currentFunction;
+
+  /* Funcionalidad seleccionada momentaneamente
+   * durante la ejecucion del selector
+   * de funcionalidades
+   */
+  uint8_t selectedFunction;
+
+  /* Nivel de volumen establecido
+   * para el reproductor MP3
+   */
+  uint8_t volume;
+
+  /*
+   * Indicador de paso o estado para uso
+   * general en las funcionalidades
+   */
+  uint8_t currentStep;
+
+  /*
+   * Numero de sonido seleccionado para indicar
+   * giro de la rueda principal (ver CUE_SPIN)
+   */
+  uint8_t spinSound;
+
+ /*
+  * Flags 1/0 que indican
+  * distintos estados
+  */
+  byte initializeFunction;   // funcionalidad debe ser inicializada
+  byte funcSelectorIsActive; // selector de funcionalidades esta en ejecucion
+  byte volumeSettingIsActive; // ajuste de volumen esta en ejecucion
+  byte speaking;  // ruli esta hablando
+  byte spinning;  // la rueda se encuentra girando
+
+ /*
+  * Declaracion de vector para manejo de distintos
+  * intervalos mediante el metodo getInterval
+  */
+  typedef struct {
+
+    unsigned long timestamp;
+    uint8_t currentStep;
+
+  } Interval_t;
+  Interval_t intervals[INTERVALS];
+
+/*
+ * Buffer de datos de proposito general utilizado
+ * por las distintas funcionalidades
+ */
+  byte data[DATA_SIZE];
+
+#ifdef RULI_STREAM
+  // Show de luces transmitido por el host (ver LightStream.h)
+  LightStream lightStream;
+
+  void streamCheck(void);
+  void streamShow(void);
+#endif
+
+#ifdef RULI_SYNC
+  // Bus de sincronismo con otras unidades (ver attach()) y su evento
+  SyncBus *syncBus;
+  uint8_t syncEvent;
+
+  void syncCheck(void);
+#endif
+
+#ifdef RULI_TELEMETRY
+  // Ultima funcionalidad informada por telemetria
+  uint8_t reportedFunction;
+
+  void telemetryCheck(unsigned long loopStart);
+#endif
+
+#ifdef RULI_ACCOUNTING
+  // Uso de recursos por funcionalidad (ver Accounting.h)
+  Accounting accounting;
+
+  void accountingCheck(void);
+#endif
+
+#ifdef RULI_BENCHMARK
+  // Acceso a los metodos internos desde src/Benchmark.cpp
+  friend class Benchmark;
+#endif
+
+#ifdef RULI_SOAK
+  // Verificacion del estado interno desde tools/soak/soak.cpp
+  friend class Soak;
+#endif
+
+#ifdef RULI_EXPLORE
+  // Estado abstracto para la exploracion de tools/explore/explore.cpp
+  friend class Explorer;
+#endif
+
+#ifdef RULI_LATENCY
+ /*
+  * Medicion de latencia extremo a extremo: desde el flanco
+  * de giro de un encoder hasta el latch de los leds y hasta
+  * el envio completo del comando de sonido
+  */
+  LatencyMeter ledsLatency;
+  LatencyMeter soundLatency;
+  unsigned long inputTimestamp;
+  unsigned long reportTimestamp;
+  byte ledsLatencyPending;
+  byte soundLatencyPending;
+
+  void latencyCheck(void);
+#endif
+
+
+  /**
+   * Devuelve un valor entre 0 y [steps] incrementando dicho valor
+   * siempre y cuando el tiempo sea >= [ms] entre cada invocacion
+   * se devera especificar un indicador de intervalo [interval] que
+   * puede ser de 0 a INTERVALS
+   *
+   */
+  uint8_t getInterval(uint8_t interval, unsigned long ms, uint8_t steps);
+
+  void resetInterval(uint8_t interval);
+
+  void mp3FinishFlush(void);
+
+  void functionSelector(void);
+
+  void volumeSetting(void);
+
+  void speak(SoundCue cue);
+
+  void ledSpeakEffect(void);
+
+  void playSpinSound(void);
+
+  void iddleCheck(void);
+
+  // Valor del indicador de funcionalidad para [function]
+  uint8_t functionIndicator(uint8_t function);
+
+  /**
+   * Posicion de la rueda (0 a WHEEL_LEDS-1) resultante de
+   * avanzar [steps] lugares desde [position] en el sentido
+   * del giro [turn], dando la vuelta en los extremos
+   */
+  uint8_t wheelStep(uint8_t position, uint8_t turn, uint8_t steps);
+
+  // Resguardo del estado con la interfaz en reposo
+  void snapshotCheck(void);
+
+  /**
+   * Invocada al inicializar una funcionalidad: si corresponde
+   * reanudarla restaura su buffer de datos y los leds de la
+   * rueda (sin refrescar) y devuelve 1
+   */
+  byte resuming(void);
+
+ //
+ // Funcionalidades de Ruli
+ //
+  void welcome(void);
+  void simpleRoulette(void);
+  void randomColor(void);
+  void followTheColor(void);
+  void turnMeter(void);
+  void velocityMeter(void);
+  void customShape(void);
+  void soundShooting(void);
+  void music(void);
+  void userProgram(void);
+ ///
+
+
+public:
+
+  /**
+   * Metodo de inicializacion
+   * simil constructor
+   */
+  void begin(RotaryEncoder *pmainWheel, RotaryEncoder *protarySelector, MP3Player *pmp3Player, LedsPanel *pledsPanel);
+
+#ifdef RULI_SYNC
+  /**
+   * Conecta el bus de sincronismo, ya inicializado, y le asigna
+   * el numero de unidad guardado en EEPROM. Debe invocarse
+   * luego de begin() y antes del primer run()
+   */
+  void attach(SyncBus *psyncBus);
+#endif
+
+  // Metodo de ejecucion principal
+  void run(void);
+
+};
+
+#endif
@@ -0,0 +1,27 @@
+/*
+ * RuliProgram.h
+ * Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)
+ *
+ * ARCHIVO GENERADO por tools/ruliasm.py a partir de tools/programs/demo.ruli,
+ * no editar a mano. Programa por defecto del modo USER_PROGRAM
+ * (utilizado cuando no hay un programa valido en EEPROM)
+ */
+
+#ifndef RuliProgram_h
+#define RuliProgram_h
+
+#define RULI_PROGRAM_SIZE 107
+
+const uint8_t ruliProgram[RULI_PROGRAM_SIZE] PROGMEM = {
+  0x01, 0x01, 0x00, 0x01, 0x02, 0x01, 0x01, 0x06, 0x00, 0x12, 0x01, 0x02,
+  0x31, 0x00, 0x02, 0x03, 0x00, 0x0E, 0x03, 0x07, 0x40, 0x03, 0x01, 0x43,
+  0x2F, 0x00, 0x40, 0x03, 0x02, 0x43, 0x40, 0x00, 0x02, 0x03, 0x00, 0x0E,
+  0x03, 0x70, 0x40, 0x03, 0x30, 0x43, 0x54, 0x00, 0x42, 0x0C, 0x00, 0x12,
+  0x01, 0x06, 0x06, 0x01, 0x40, 0x01, 0xFF, 0x44, 0x4E, 0x00, 0x01, 0x01,
+  0x27, 0x42, 0x4E, 0x00, 0x12, 0x01, 0x06, 0x05, 0x01, 0x40, 0x01, 0x28,
+  0x44, 0x4E, 0x00, 0x01, 0x01, 0x00, 0x12, 0x01, 0x02, 0x42, 0x0C, 0x00,
+  0x01, 0x03, 0x02, 0x20, 0x0A, 0x03, 0x01, 0x07, 0x28, 0x14, 0x01, 0x01,
+  0x15, 0x30, 0x0F, 0x00, 0x45, 0x07, 0x5D, 0x00, 0x42, 0x0C, 0x00
+};
+
+#endif
@@ -0,0 +1,139 @@
+/*
+ * RuliVM.h
+ * Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)
+ */
+
+#ifndef RuliVM_h
+#define RuliVM_h
+
+#include <Arduino.h>
+
+#include "LedsPanel.h"
+#include "AudioManager.h"
+
+/*
+ * Cantidad de registros de 8 bits (r0 a r7)
+ */
+#define VM_REGISTERS       8
+
+/*
+ * Cantidad maxima de instrucciones ejecutadas por
+ * invocacion a tick(), para no demorar la lectura
+ * de los encoders en el lazo principal
+ */
+#define VM_BUDGET         32
+
+/*
+ * Tamaño maximo de un programa (bytes)
+ */
+#define VM_PROGRAM_SIZE  126
+
+/*
+ * Codigos de operacion. Operandos: r = registro (1 byte),
+ * i = inmediato (1 byte), w = inmediato (2 bytes, little endian),
+ * a = direccion (2 bytes, little endian)
+ */
+#define OP_HALT     0x00 //                 fin del programa
+#define OP_LDI      0x01 // r, i            r = i
+#define OP_MOV      0x02 // rd, rs          rd = rs
+#define OP_ADD      0x03 // rd, rs          rd += rs
+#define OP_SUB      0x04 // rd, rs          rd -= rs
+#define OP_INC      0x05 // r               r++
+#define OP_DEC      0x06 // r               r--
+#define OP_AND      0x07 // rd, rs          rd &= rs
+#define OP_OR       0x08 // rd, rs          rd |= rs
+#define OP_XOR      0x09 // rd, rs          rd ^= rs
+#define OP_NOT      0x0A // r               r = ~r
+#define OP_SHL      0x0B // r               r <<= 1
+#define OP_SHR      0x0C // r               r >>= 1
+#define OP_RND      0x0D // r, i            r = random(0, i)
+#define OP_ANDI     0x0E // r, i            r &= i
+#define OP_SETS     0x10 // i, r            seccion i de leds = r
+#define OP_GETS     0x11 // r, i            r = seccion i de leds
+#define OP_LED      0x12 // rn, rv          led rn de la rueda = rv
+#define OP_GLED     0x13 // rd, rn          rd = led rn de la rueda
+#define OP_ROT      0x14 // i, i            rotate(direccion, pasos)
+#define OP_SHOW     0x15 //                 refresh() de los leds
+#define OP_PLAY     0x20 // i, r            efecto de sonido: carpeta i, archivo r
+#define OP_STOP     0x21 //                 detiene el efecto de sonido
+#define OP_WAIT     0x30 // w               espera de w ms (16 bits)
+#define OP_WEVT     0x31 // r               espera un evento, r = evento
+#define OP_CMP      0x40 // r, i            Z = (r == i)
+#define OP_CMPR     0x41 // rd, rs          Z = (rd == rs)
+#define OP_JMP      0x42 // a               salto
+#define OP_JZ       0x43 // a               salto si Z
+#define OP_JNZ      0x44 // a               salto si no Z
+#define OP_DJNZ     0x45 // r, a            r--, salto si r != 0
+
+/*
+ * Eventos devueltos por OP_WEVT: bits 0-2 evento de la
+ * rueda principal, bits 4-6 evento del selector (mismos
+ * valores que RotaryEncoder) y bit 7 fin de reproduccion
+ */
+#define VM_EVENT_FINISHED  0x80
+
+/*
+ * Estados de ejecucion
+ */
+#define VM_RUNNING     0
+#define VM_WAIT_TIME   1
+#define VM_WAIT_EVENT  2
+#define VM_HALTED      3
+#define VM_FAULT       4
+
+
+/*
+ * Interprete de programas de luces y sonido (ver tools/ruliasm.py).
+ * El programa se lee desde EEPROM o desde flash, cada instruccion
+ * se decodifica en el momento, y en RAM solo se mantienen los
+ * registros, el contador de programa y el estado de espera
+ */
+class RuliVM {
+
+  LedsPanel *ledsPanel;
+  AudioManager *audio;
+
+  // Programa en flash (NULL: programa en EEPROM)
+  const uint8_t *flashProgram;
+  uint16_t eepromAddress;
+  uint8_t programSize;
+
+  uint8_t registers[VM_REGISTERS];
+  uint8_t pc;
+  uint8_t zeroFlag;
+  uint8_t state;
+  uint8_t waitRegister;
+  unsigned long waitTimestamp;
+  uint16_t waitMs;
+
+  // Indicador 1/0 de leds modificados desde el ultimo refresh()
+  byte dirty;
+
+  uint8_t fetch(void);
+  void jump(uint16_t address);
+
+public:
+
+  void begin(LedsPanel *pledsPanel, AudioManager *paudio);
+
+  /**
+   * Carga el programa desde EEPROM a partir de [address]. El primer
+   * byte debe ser 'V' y el segundo la longitud del codigo. Si no hay
+   * un programa valido se utiliza [fallback] (flash) de [size] bytes
+   */
+  void load(uint16_t address, const uint8_t *fallback, uint8_t size);
+
+  // Reinicia la ejecucion desde el principio del programa
+  void reset(void);
+
+  /**
+   * Ejecuta hasta VM_BUDGET instrucciones o hasta una espera.
+   * [events] contiene los eventos de la pasada actual (ver OP_WEVT)
+   */
+  void tick(uint8_t events);
+
+  uint8_t getState(void);
+
+};
+
+#endif
@@ -0,0 +1,97 @@
+/*
+ * Snapshot.h
+ * Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)
+ */
+
+#ifndef Snapshot_h
+#define Snapshot_h
+
+#include <Arduino.h>
+
+/*
+ * Medida maxima del estado resguardado
+ */
+#define SNAPSHOT_MAX_STATE    16
+
+/*
+ * Formato en EEPROM: dos copias (slots) consecutivas de
+ *
+ *   secuencia, estado (size bytes), CRC-8 de los anteriores
+ *
+ * Cada resguardo nuevo se escribe sobre el slot mas antiguo, de a
+ * un byte por pasada del lazo principal (ver Animation.h). Un corte
+ * de energia durante la escritura deja ese slot con CRC invalido y
+ * al arrancar se restaura el otro, con el resguardo anterior
+ */
+#define SNAPSHOT_SLOT_SIZE(size)  ((size) + 2)
+#define SNAPSHOT_SIZE(size)       (2 * SNAPSHOT_SLOT_SIZE(size))
+
+
+class Snapshot {
+
+  // Region de EEPROM asignada y medida del estado
+  uint16_t baseAddress;
+  uint8_t stateSize;
+
+  /*
+   * Ultimo resguardo (restaurado o solicitado): secuencia,
+   * estado y CRC, tal como se escribe en EEPROM
+   */
+  uint8_t image[SNAPSHOT_MAX_STATE + 2];
+  byte valid;
+
+  // Slot con el ultimo resguardo completo y slot en escritura
+  uint8_t lastSlot;
+  uint8_t writeSlot;
+
+  // Proximo byte a escribir (SNAPSHOT_MAX_STATE + 2: ninguno)
+  uint8_t cursor;
+
+#ifdef RULI_ACCOUNTING
+  // Bytes escritos en EEPROM desde la ultima consulta
+  uint16_t writes;
+#endif
+
+  uint16_t slotAddress(uint8_t slot);
+  uint8_t crc(const uint8_t *buffer, uint8_t size);
+  byte readSlot(uint8_t slot, uint8_t *buffer);
+
+public:
+
+  /**
+   * Metodo de inicializacion. El estado ocupa [size] bytes (hasta
+   * SNAPSHOT_MAX_STATE) y los slots SNAPSHOT_SIZE(size) bytes de
+   * EEPROM a partir de [address]. Carga el resguardo mas reciente
+   */
+  void begin(uint16_t address, uint8_t size);
+
+  /**
+   * Copia en [state] el ultimo resguardo valido.
+   * Devuelve 0 si no hay ninguno (EEPROM en blanco o alterada)
+   */
+  byte restore(uint8_t *state);
+
+  /**
+   * Solicita el resguardo de [state]. Sin cambios respecto del
+   * ultimo no escribe nada; solo copia el estado, la escritura
+   * la realiza update()
+   */
+  void save(const uint8_t *state);
+
+  // Devuelve 1 mientras haya un resguardo pendiente de escritura
+  byte isWriting(void);
+
+  /**
+   * Debe invocarse en cada pasada: escribe en
+   * EEPROM a lo sumo un byte del resguardo
+   */
+  void update(void);
+
+#ifdef RULI_ACCOUNTING
+  // Bytes escritos en EEPROM desde la invocacion anterior
+  uint16_t getWrites(void);
+#endif
+
+};
+
+#endif
@@ -0,0 +1,70 @@
+/*
+ * SoundCatalog.h
+ * Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)
+ *
+ * ARCHIVO GENERADO por tools/soundcatalog.py (sin duraciones), no editar a mano.
+ * Solo debe ser incluido por AudioManager.h
+ */
+
+#ifndef SoundCatalog_h
+#define SoundCatalog_h
+
+// Unidad (ms) de las duraciones de SoundDurations.h
+#define SOUND_UNIT_MS 10
+
+#define SOUND_FOLDERS 10
+
+// Carpeta de los sonidos de la funcionalidad [function]
+constexpr uint8_t soundFolder(uint8_t function) { return function + 1; }
+
+/*
+ * Cues: carpeta (0: la de cada funcionalidad, ver inFolder()), primer
+ * archivo, archivos de la familia (ver at()) y duracion (ms) del primero
+ */
+
+// Nombre de cada funcionalidad, al seleccionarla
+constexpr SoundCue CUE_FUNCTION_NAME = { 0, 1, 1, 0UL };
+
+// Sonidos de giro de la rueda de cada funcionalidad
+constexpr SoundCue CUE_SPIN = { 0, 2, 5, 0UL };
+
+// Saludo al terminar welcome()
+constexpr SoundCue CUE_GREETING = { 1, 1, 1, 0UL };
+
+// Inicio del ajuste de volumen
+constexpr SoundCue CUE_VOLUME = { 1, 2, 1, 0UL };
+
+// Efecto de welcome()
+constexpr SoundCue CUE_WELCOME = { 1, 3, 1, 0UL };
+
+// Voces de inactividad (1, 2, 4 y 8 minutos)
+constexpr SoundCue CUE_IDDLE = { 1, 4, 4, 0UL };
+
+// Seccion elegida por randomColor(), BLUE a RED
+constexpr SoundCue CUE_COLOR_SECTION = { 3, 4, 5, 0UL };
+
+// Frases de followTheColor(), en rotacion
+constexpr SoundCue CUE_FOLLOW_SPEECH = { 4, 2, 5, 0UL };
+
+// Color a seguir, BLUE a RED
+constexpr SoundCue CUE_FOLLOW_COLOR = { 4, 7, 5, 0UL };
+
+// Largada de followTheColor()
+constexpr SoundCue CUE_FOLLOW_START = { 4, 12, 1, 0UL };
+
+// Color alcanzado
+constexpr SoundCue CUE_FOLLOW_HIT = { 4, 13, 1, 0UL };
+
+// Velocidad de velocityMeter(), desde 1
+constexpr SoundCue CUE_VELOCITY = { 6, 2, 40, 0UL };
+
+// Led dibujado en customShape()
+constexpr SoundCue CUE_SHAPE_DRAW = { 7, 3, 1, 0UL };
+
+// Sonidos de soundShooting(), uno por led
+constexpr SoundCue CUE_SHOOTING = { 8, 2, 40, 0UL };
+
+// Temas de music(), uno por led
+constexpr SoundCue CUE_MUSIC_TRACK = { 9, 2, 40, 0UL };
+
+#endif
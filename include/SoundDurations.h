@@ -0,0 +1,42 @@
+/*
+ * SoundDurations.h
+ * Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)
+ *
+ * ARCHIVO GENERADO por tools/soundcatalog.py (sin duraciones), no editar a mano.
+ * Solo debe ser incluido por AudioManager.cpp
+ */
+
+#ifndef SoundDurations_h
+#define SoundDurations_h
+
+#define SOUND_FILES 175
+
+// Posicion en soundDurations del archivo 001 de cada carpeta
+const uint16_t soundFolderIndex[SOUND_FOLDERS + 1] PROGMEM = {
+  0, 7, 13, 21, 34, 40, 81, 87, 128, 169,
+  175
+};
+
+// Duracion de cada archivo (x SOUND_UNIT_MS, 0 = desconocida)
+const uint16_t soundDurations[SOUND_FILES] PROGMEM = {
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0
+};
+
+#endif
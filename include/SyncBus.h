@@ -0,0 +1,241 @@
+/*
+ * SyncBus.h
+ * Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)
+ */
+
+#ifndef SyncBus_h
+#define SyncBus_h
+
+#include <Arduino.h>
+
+#if defined(RULI_TELEMETRY) || defined(RULI_STREAM) || defined(RULI_LATENCY)
+#error "RULI_SYNC utiliza el puerto serie de hardware: sin RULI_TELEMETRY, RULI_STREAM ni RULI_LATENCY"
+#endif
+
+/*
+ * Bus de sincronismo entre varias unidades: puerto serie de hardware
+ * sobre un transceptor RS-485 half-duplex (DE/RE en un pin, ver
+ * main.cpp). Registros con el formato de los de telemetria y stream
+ * (ver Telemetry.h y LightStream.h) y su propio byte de sincronismo:
+ *
+ *   0     SYNC_SYNC
+ *   1     tipo de registro
+ *   2     unidad emisora (1 a SYNC_MAX_UNITS)
+ *   3-6   reloj del master (us, 32 bits): instante de envio (SY_BEACON)
+ *         o instante del evento (SY_EVENT)
+ *   7     tipo de evento (SY_EVENT, SY_REPORT)
+ *   8-10  valor (24 bits)
+ *   11    suma de control: complemento a 2 de la suma de los bytes 1 a 10
+ *
+ * Ver tools/sync/sync_test.cpp y tools/sync_unit.py
+ */
+#define SYNC_SYNC            0xC3
+#define SYNC_RECORD_SIZE     12
+#define SYNC_BAUDS           115200
+
+// Duracion (us) de un registro en la linea (12 x 10 bits a 115200)
+#define SYNC_RECORD_US       1042
+
+/*
+ * Tipos de registro
+ */
+#define SY_BEACON   0x01 // master: reloj de referencia
+#define SY_EVENT    0x02 // master: evento programado para todas las unidades
+#define SY_REPORT   0x03 // unidad: resultado informado al master en su turno
+#define SY_UNIT     0x04 // host: asigna el numero de unidad (conectada sola)
+
+/*
+ * Eventos devueltos por getEvent()
+ */
+#define SE_NONE          0
+#define SE_RACE_START    1 // valor: color elegido por el master (getRaceDue(): largada)
+#define SE_RACE_REPORT   2 // (interno) tiempo de reaccion (us) de una unidad
+#define SE_RACE_RESULT   3 // valor: unidad ganadora (0: ninguna)
+#define SE_UNIT          4 // valor: numero de unidad asignado por el host
+
+#define SYNC_MAX_UNITS   8
+
+/*
+ * Ciclo del bus: el master envia el beacon al comienzo de cada
+ * ciclo (turno 0) y cada unidad transmite solo en su turno
+ * (turno = numero de unidad), sin colisiones
+ */
+#define SYNC_BEACON_US   100000UL
+#define SYNC_SLOT_US     8000UL
+
+/*
+ * Estimacion del desplazamiento del reloj: la demora de cada beacon
+ * (linea + lazo principal) solo puede sumar, se adopta la estimacion
+ * del beacon de menor demora de cada ventana de SYNC_WINDOW beacons
+ */
+#define SYNC_WINDOW      8
+
+/*
+ * Deriva entre relojes (hasta +-0.5% con resonador ceramico, 1%
+ * entre dos unidades): cada ventana corrige la pendiente en
+ * 1/2^SYNC_DRIFT_SHIFT del error observado. Pendiente en 2^-20 us
+ * por us, limitada a SYNC_DRIFT_MAX (1.5%) y aplicada hasta
+ * SYNC_HOLDOVER_US sin beacons. Un error mayor que SYNC_DRIFT_STEP_US
+ * es un salto y solo corrige el desplazamiento
+ */
+#define SYNC_DRIFT_SHIFT    2
+#define SYNC_DRIFT_MAX      16383L
+#define SYNC_DRIFT_STEP_US  20000L
+#define SYNC_HOLDOVER_US    (1UL << 22)
+
+/*
+ * Sin beacon durante SYNC_MASTER_TIMEOUT_MS + unidad x SYNC_ELECTION_STEP_MS
+ * la unidad asume como master: la de numero menor primero. Un master que
+ * escucha el beacon de una unidad menor vuelve a seguirla
+ */
+#define SYNC_MASTER_TIMEOUT_MS  500
+#define SYNC_ELECTION_STEP_MS   150
+
+// Cuadros de frame(): instantes multiplos de SYNC_FRAME_US del reloj del master
+#define SYNC_FRAME_US    120000UL
+#define SYNC_NO_FRAME    0xFFFF
+
+/*
+ * Un cuadro detectado mas de SYNC_FRAME_LATE_US despues de su
+ * comienzo (pasada larga, voz en curso) se omite: el latch tardio
+ * seria visible frente a las demas unidades
+ */
+#define SYNC_FRAME_LATE_US  20000UL
+
+/*
+ * A menos de SYNC_SPIN_US de un instante programado frame()
+ * y reached() esperan activamente: el latch no depende de la
+ * duracion de la pasada del lazo principal
+ */
+#define SYNC_SPIN_US     1500
+
+/*
+ * Carrera de followTheColor(): largada SYNC_RACE_LEAD_MS despues del
+ * anuncio y resultado SYNC_RACE_WINDOW_MS despues de la largada
+ */
+#define SYNC_RACE_LEAD_MS     4000
+#define SYNC_RACE_WINDOW_MS   3000
+
+// Registros en espera de su turno
+#define SYNC_TX_SLOTS    2
+
+
+/*
+ * Varias unidades como un unico show: reloj comun (el del master,
+ * elegido automaticamente), cuadros en paso comun y carreras con
+ * el resultado arbitrado por el master
+ */
+class SyncBus {
+
+  uint8_t dePin;
+  uint8_t unit;
+
+  // Registro en recepcion
+  uint8_t rxBuffer[SYNC_RECORD_SIZE];
+  uint8_t rxCount;
+
+  // Registros en espera del turno de la unidad
+  uint8_t txBuffer[SYNC_TX_SLOTS][SYNC_RECORD_SIZE];
+  uint8_t txCount;
+
+  byte master;
+  uint8_t masterUnit;
+  unsigned long beaconTimestamp;  // millis() del ultimo beacon
+  unsigned long beaconCycle;      // ultimo ciclo con beacon enviado
+
+  /*
+   * Reloj del master: micros() + clockOffset mas la deriva desde
+   * offsetStamp (micros() del ultimo ajuste). windowResidual es la
+   * mayor diferencia beacon - clock() de la ventana en curso
+   */
+  unsigned long clockOffset;
+  unsigned long offsetStamp;
+  long clockDrift;
+  long windowResidual;
+  uint8_t windowCount;
+  byte driftReady;
+  byte locked;
+
+  uint16_t lastFrame;
+
+  // Evento pendiente de getEvent()
+  uint8_t eventType;
+  unsigned long eventValue;
+
+  // Carrera en curso (master: mejor tiempo informado)
+  unsigned long raceDue;
+  byte raceOpen;
+  uint8_t raceUnit;
+  unsigned long raceBest;
+
+  void record(void);
+  void build(uint8_t *buffer, uint8_t type, unsigned long stamp, uint8_t event, unsigned long value);
+  void beacon(void);
+  void queue(uint8_t type, unsigned long stamp, uint8_t event, unsigned long value);
+  void send(void);
+  void deliver(uint8_t type, unsigned long value);
+  void arbitrate(uint8_t sender, unsigned long value);
+  void spinUntil(unsigned long due);
+  long drift(unsigned long elapsed);
+  void rebase(long residual);
+
+public:
+
+  /**
+   * Inicializa el puerto serie y el pin [pdePin] del transceptor
+   * (1: transmision). Sin master conocido, la unidad sigue
+   * escuchando hasta su turno de eleccion
+   */
+  void begin(uint8_t pdePin);
+
+  // Numero de unidad (1 a SYNC_MAX_UNITS), fuera de rango se usa SYNC_MAX_UNITS
+  void setUnit(uint8_t punit);
+  uint8_t getUnit(void);
+
+  /**
+   * Procesa los bytes recibidos, la eleccion de master, los
+   * beacons, el cierre de la carrera y los registros en espera
+   * de turno. Debe invocarse en cada pasada del lazo principal
+   */
+  void update(void);
+
+  // Evento recibido (SE_*), SE_NONE si no hay
+  uint8_t getEvent(void);
+  unsigned long getEventValue(void);
+
+  byte isMaster(void);
+
+  // Reloj comun disponible (master o algun beacon recibido)
+  byte isLocked(void);
+
+  // micros() en la base de tiempo del master
+  unsigned long clock(void);
+
+  /**
+   * Devuelve el numero (16 bits bajos) del cuadro comun que acaba
+   * de comenzar, una unica vez, o SYNC_NO_FRAME (tambien si ya
+   * paso SYNC_FRAME_LATE_US desde su comienzo)
+   */
+  uint16_t frame(void);
+
+  // Ultimo cuadro devuelto por frame()
+  uint16_t getFrame(void);
+
+  // 1 si [due] (reloj del master) ya llego
+  byte reached(unsigned long due);
+
+  /**
+   * Master: anuncia una carrera con el valor [value] elegido y
+   * largada en [leadMs] ms, si no hay otra en curso. Tambien la
+   * recibe la propia unidad
+   */
+  void raceStart(uint8_t value, uint16_t leadMs);
+
+  // Informa el tiempo de reaccion [us] de la unidad en la carrera en curso
+  void raceReport(unsigned long us);
+
+  unsigned long getRaceDue(void);
+
+};
+
+#endif
@@ -0,0 +1,145 @@
+/*
+ * Telemetry.h
+ * Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)
+ */
+
+#ifndef Telemetry_h
+#define Telemetry_h
+
+#include <Arduino.h>
+
+/*
+ * Formato de los registros, todos de TELEMETRY_RECORD_SIZE bytes:
+ *
+ *   0     TELEMETRY_SYNC
+ *   1     tipo de registro
+ *   2     numero de secuencia (permite detectar perdidas)
+ *   3-4   millis() (16 bits menos significativos, little endian)
+ *   5-10  datos (segun el tipo)
+ *   11    suma de control: complemento a 2 de la suma de los bytes 1 a 10
+ *
+ * Ver tools/telemetry_decode.py
+ */
+#define TELEMETRY_SYNC          0xA5
+#define TELEMETRY_RECORD_SIZE   12
+#define TELEMETRY_PAYLOAD_SIZE  6
+#define TELEMETRY_BAUDS         115200
+
+/*
+ * Intervalo (ms) de los registros de estadisticas y del
+ * buffer de leds completo (TM_LEDS_FRAME) con el que el
+ * receptor se resincroniza luego de una perdida
+ */
+#define TELEMETRY_STATS_MS      1000
+
+/*
+ * Tipos de registro
+ */
+#define TM_LEDS_FRAME     0x01 // cuadro de leds completo (6 bytes, ver LedsPanel::getFrame())
+#define TM_LEDS_DIFF      0x02 // mascara de secciones + valores modificados
+#define TM_ENCODER        0x03 // encoder, evento, timestamp (micros())
+#define TM_MP3_COMMAND    0x04 // comando DFPlayer, parametro
+#define TM_MP3_RESPONSE   0x05 // tipo de mensaje DFPlayer, valor
+#define TM_MODE           0x06 // funcionalidad previa/actual y flags
+#define TM_TIMING         0x07 // identificador de medicion, valor (us)
+#define TM_STATS          0x08 // pasadas del lazo/s, registros perdidos, enviados
+#define TM_STREAM         0x09 // cuadros/s presentados, descartados, jitter maximo (us)
+#define TM_OUTCOMES       0x0A // modo, led, contadores de led y led + 1 (ver OutcomeStats.h)
+#define TM_USAGE          0x0B // contador, valor (32 bits), cantidad de contadores (ver Accounting.h)
+#define TM_REACTION       0x0C // mediana de la sesion (100us), demoras minima y maxima del latch (4us), rebote maximo (us)
+
+/*
+ * Identificadores de mediciones TM_TIMING
+ */
+#define TIMING_LOOP_MAX       0 // pasada mas larga del lazo principal
+#define TIMING_LEDS_LATENCY   1 // giro -> latch de leds
+#define TIMING_SOUND_LATENCY  2 // giro -> comando de sonido enviado
+#define TIMING_REACTION       3 // tiempo de reaccion en followTheColor
+#define TIMING_REACTION_BEST  4 // mejor tiempo de reaccion de la sesion
+
+
+/*
+ * Canal de telemetria binaria sobre el puerto serie de hardware.
+ * Los registros se encolan en el buffer de transmision de Serial
+ * (atendido por la interrupcion de TX); si no hay espacio para un
+ * registro completo el mismo se descarta y se cuenta, por lo que
+ * nunca bloquea el lazo principal
+ */
+class Telemetry {
+
+  uint8_t sequence;
+  uint16_t sent;
+  uint16_t dropped;
+
+  // Ultimo buffer de leds enviado (no descartado)
+  uint8_t lastLeds[TELEMETRY_PAYLOAD_SIZE];
+
+  // Acumuladores de pasadas del lazo principal
+  uint16_t loops;
+  unsigned long loopMax;
+  unsigned long statsTimestamp;
+
+  // Devuelve 0 si el registro se descarto por falta de lugar
+  byte record(uint8_t type, const uint8_t *payload);
+
+public:
+
+  void begin(void);
+
+  /**
+   * Informa las secciones del buffer de leds que cambiaron
+   * desde el ultimo registro enviado: si se descarta, las
+   * diferencias siguientes se calculan contra el anterior
+   */
+  void leds(const uint8_t *buffer);
+
+  void encoder(uint8_t encoderNumber, uint8_t event, unsigned long timestamp);
+  void mp3Command(uint8_t command, uint16_t param);
+  void mp3Response(uint8_t type, uint16_t value);
+  void mode(uint8_t prevFunction, uint8_t currentFunction, uint8_t flags);
+  void timing(uint8_t id, unsigned long us);
+
+  // Estadisticas del show recibido por el puerto serie (ver LightStream.h)
+  void stream(uint16_t frames, uint16_t discarded, unsigned long jitter);
+
+  // Contadores de resultados [led] y [led] + 1 del modo [mode]
+  void outcomes(uint8_t mode, uint8_t led, uint16_t count, uint16_t nextCount);
+
+  // Contador [counter] de uso de recursos (ver Accounting.h)
+  void usage(uint8_t counter, unsigned long value);
+
+  /**
+   * Resumen de la sesion de tiempos de reaccion: mediana [median]
+   * (us), demoras minima y maxima (us) entre el latch de los leds
+   * y el inicio de la medicion, y duracion maxima (us) del rebote
+   * del contacto del encoder (ver ReactionTimer.h)
+   */
+  void reaction(unsigned long median, uint16_t latchMin, uint16_t latchMax, uint16_t bounce);
+
+  /**
+   * Devuelve 1 si hay lugar para un registro completo
+   * en el buffer de transmision (no se descartaria)
+   */
+  byte ready(void);
+
+  /**
+   * Registra la duracion de una pasada del lazo principal
+   * y emite periodicamente los registros de estadisticas
+   */
+  void loopPass(unsigned long us);
+
+};
+
+
+/*
+ * Instrumentacion: TELEMETRY(metodo(...)) se compila
+ * solamente si se define RULI_TELEMETRY
+ */
+#ifdef RULI_TELEMETRY
+extern Telemetry telemetry;
+#define TELEMETRY(call) telemetry.call
+#else
+#define TELEMETRY(call)
+#endif
+
+#endif
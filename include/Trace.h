@@ -0,0 +1,54 @@
+/*
+ * Trace.h
+ * Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)
+ */
+
+#ifndef Trace_h
+#define Trace_h
+
+#include <Arduino.h>
+
+/*
+ * Intervalos de la linea de tiempo del simulador (soak --timeline,
+ * ver tools/soak/soak.cpp): TRACE_SPAN(id) registra el inicio al
+ * ejecutarse y el fin al salir del bloque que lo contiene. Solo para
+ * el host: traceBegin() y traceEnd() los implementa el hardware
+ * simulado de tools/soak/mock sobre el reloj virtual
+ */
+#define TRACE_RUN             0 // RuliBrain::run()
+#define TRACE_REFRESH         1 // LedsPanel::refresh()
+#define TRACE_MP3_PLAY        2 // MP3Player::play() / playFolder()
+#define TRACE_MP3_STOP        3 // MP3Player::stop()
+#define TRACE_MP3_VOLUME      4 // MP3Player::outputVolume()
+#define TRACE_MP3_COMMAND     5 // next(), previous(), enableLoop(), disableLoop()
+#define TRACE_MP3_READ        6 // finished() / readType()
+#define TRACE_EEPROM_WRITE    7 // escritura de un byte (registrada por el simulador)
+#define TRACE_SELECTOR        8 // RuliBrain::functionSelector()
+#define TRACE_VOLUME_SETTING  9 // RuliBrain::volumeSetting()
+#define TRACE_SPEAK          10 // RuliBrain::ledSpeakEffect()
+
+// Funcionalidad en ejecucion: TRACE_MODE + funcionalidad (ver RuliBrain.cpp)
+#define TRACE_MODE           16
+
+#define TRACE_IDS            32
+
+
+#ifdef RULI_TRACE
+void traceBegin(uint8_t id);
+void traceEnd(uint8_t id);
+
+struct TraceSpan {
+
+  uint8_t id;
+
+  TraceSpan(uint8_t spanId) : id(spanId) { traceBegin(id); }
+  ~TraceSpan() { traceEnd(id); }
+
+};
+
+#define TRACE_SPAN(id) TraceSpan traceSpan(id)
+#else
+#define TRACE_SPAN(id)
+#endif
+
+#endif
@@ -0,0 +1,165 @@
+/*
+ * Ws2812.h
+ * Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)
+ */
+
+#ifndef Ws2812_h
+#define Ws2812_h
+
+#include <Arduino.h>
+
+#include "FastPin.h"
+
+/*
+ * Salida a leds RGB direccionables WS2812 (800kHz) por un pin resuelto
+ * en tiempo de compilacion. Cada led recibe 24 bits en orden G, R, B,
+ * bit mas significativo primero; el valor del bit lo determina solo la
+ * duracion del pulso en alto:
+ *
+ *   bit 0: WS2812_T0H_CYCLES en alto  (375ns, hoja de datos 250-550ns)
+ *   bit 1: WS2812_T1H_CYCLES en alto  (812ns, hoja de datos 650-950ns)
+ *   periodo WS2812_BIT_CYCLES         (1.25us, hoja de datos 0.65-1.85us)
+ *
+ * Ciclos a 16MHz, exactos en sendPixel(): cada instruccion del lazo
+ * tiene duracion fija y ambos caminos de cada bit duran lo mismo
+ */
+#define WS2812_BIT_CYCLES   20
+#define WS2812_T0H_CYCLES    6
+#define WS2812_T1H_CYCLES   13
+
+// Bytes por led
+#define WS2812_PIXEL_BYTES   3
+
+/*
+ * Los leds presentan el cuadro recibido luego de WS2812_RESET_US en
+ * bajo (WS2812B actuales; los anteriores ya con 50us). refresh() no
+ * comienza un nuevo cuadro antes de ese tiempo
+ */
+#define WS2812_RESET_US     300
+
+/*
+ * Entre led y led se habilitan las interrupciones pendientes (Timer0,
+ * puertos serie): la linea queda en bajo mientras se atienden. Una
+ * espera mayor que WS2812_LATCH_TICKS (x 4us, Timer0) puede haber
+ * presentado un cuadro parcial (por ejemplo la recepcion de una trama
+ * del DFPlayer por SoftwareSerial, ~1ms): el cuadro se reenvia desde
+ * el primer led, hasta WS2812_RESTARTS veces. El margen cubre el
+ * Timer0 del runtime de bare/ (cuenta hasta 249)
+ */
+#define WS2812_LATCH_TICKS  12
+#define WS2812_RESTARTS      2
+
+
+#ifndef __AVR__
+/*
+ * Sin AVR (pruebas en el host) los bytes los recibe el hardware
+ * simulado, ver tools/soak/mock y tools/ws2812/ws2812_test.cpp
+ */
+void ws2812Send(uint8_t pin, const uint8_t *data, uint8_t count);
+#endif
+
+
+template <uint8_t pin>
+struct Ws2812 {
+
+  /**
+   * Envia los WS2812_PIXEL_BYTES bytes de [grb] con las interrupciones
+   * deshabilitadas. Al retornar la linea queda en bajo
+   */
+  static inline void sendPixel(const uint8_t *grb) {
+
+#ifdef __AVR__
+    volatile uint8_t *port = &FastPin<pin>::port();
+    uint8_t hi = *port | FastPin<pin>::mask();
+    uint8_t lo = *port & ~FastPin<pin>::mask();
+    uint8_t value, next;
+    uint8_t bits = 8, count = WS2812_PIXEL_BYTES;
+
+    /*
+     * T: ciclos desde el flanco ascendente del bit (fin del st
+     * de hi). El ultimo bit de cada byte carga el siguiente en
+     * lugar de las esperas, con el mismo periodo
+     */
+    asm volatile(
+      "ld   %[value], %a[grb]+   \n\t"
+      "1:                        \n\t"
+      "st   %a[port], %[hi]      \n\t" // 2    T = 0   flanco ascendente
+      "mov  %[next], %[lo]       \n\t" // 1    T = 1
+      "sbrc %[value], 7          \n\t" // 1/2
+      "mov  %[next], %[hi]       \n\t" // 1    T = 3   next = bit ? hi : lo
+      "lsl  %[value]             \n\t" // 1    T = 4
+      "st   %a[port], %[next]    \n\t" // 2    T = 6   fin de un bit 0
+      "dec  %[bits]              \n\t" // 1    T = 7
+      "breq 2f                   \n\t" // 1/2  T = 8
+      "rjmp .+0                  \n\t" // 2    T = 10
+      "nop                       \n\t" // 1    T = 11
+      "st   %a[port], %[lo]      \n\t" // 2    T = 13  fin de un bit 1
+      "nop                       \n\t" // 1    T = 14
+      "rjmp .+0                  \n\t" // 2    T = 16
+      "rjmp 1b                   \n\t" // 2    T = 18
+      "2:                        \n\t" //      T = 9
+      "ld   %[value], %a[grb]+   \n\t" // 2    T = 11
+      "st   %a[port], %[lo]      \n\t" // 2    T = 13  fin de un bit 1
+      "ldi  %[bits], 8           \n\t" // 1    T = 14
+      "dec  %[count]             \n\t" // 1    T = 15
+      "nop                       \n\t" // 1    T = 16
+      "brne 1b                   \n\t" // 2    T = 18
+      : [value] "=&r" (value), [next] "=&r" (next), [bits] "+d" (bits),
+        [count] "+r" (count), [grb] "+e" (grb)
+      : [port] "e" (port), [hi] "r" (hi), [lo] "r" (lo)
+      : "memory"
+    );
+#else
+    ws2812Send(pin, grb, WS2812_PIXEL_BYTES);
+#endif
+
+  }
+
+  /**
+   * Envia [pixels] leds: el led N toma el color (WS2812_PIXEL_BYTES
+   * bytes) de indice N de [indexes], 4 bits por led (led par en los
+   * bits bajos), en la paleta [palette]
+   */
+  static void sendFrame(const uint8_t *indexes, const uint8_t *palette, uint8_t pixels) {
+
+#ifdef __AVR__
+    uint8_t sreg = SREG;
+    uint8_t restarts = 0;
+    uint8_t mark;
+
+    cli();
+#endif
+
+    for ( uint8_t i = 0 ; i < pixels ; i++ ) {
+
+      uint8_t index = indexes[i >> 1];
+
+      if ( i & 0x01 )
+        index >>= 4;
+
+      sendPixel(&palette[(index & 0x0F) * WS2812_PIXEL_BYTES]);
+
+#ifdef __AVR__
+      // Ventana para las interrupciones pendientes (luego de sei se ejecuta una instruccion mas)
+      if ( sreg & _BV(SREG_I) ) {
+        mark = TCNT0;
+        sei();
+        asm volatile("nop");
+        cli();
+        if ( (uint8_t) (TCNT0 - mark) > WS2812_LATCH_TICKS && restarts < WS2812_RESTARTS ) {
+          restarts++;
+          i = 0xFF;
+        }
+      }
+#endif
+    }
+
+#ifdef __AVR__
+    SREG = sreg;
+#endif
+
+  }
+
+};
+
+#endif
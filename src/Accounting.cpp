@@ -0,0 +1,236 @@
+/*
+ * Accounting.cpp
+ * Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)
+ */
+
+#ifdef RULI_ACCOUNTING
+
+#include <Arduino.h>
+#include <EEPROM.h>
+#include <avr/eeprom.h>
+
+#include "Accounting.h"
+#include "Telemetry.h"
+
+
+#define ACCOUNTING_KEY     'U'
+
+// Incrementos en RAM: recursos y regiones
+#define INCREMENTS         (ACC_KINDS + ACC_REGIONS)
+
+
+void Accounting::begin(uint16_t address) {
+
+  uint16_t sessions;
+
+  baseAddress = address;
+
+  mode = 0;
+  countMode = 0;
+  pendingMode = 0;
+  memset(counts, 0x00, sizeof(counts));
+  memset(pending, 0x00, sizeof(pending));
+  flushTimestamp = millis();
+  flushIndex = INCREMENTS;
+  flushByte = 0;
+  exportIndex = ACC_COUNTERS;
+
+  /*
+   * Region sin formato: se formatea de a un byte por
+   * pasada (con esta sesion), la clave se escribe al final
+   */
+  if ( EEPROM.read(baseAddress) != ACCOUNTING_KEY ) {
+    formatting = 1;
+    cursor = 1;
+    return;
+  }
+
+  formatting = 0;
+
+  sessions = EEPROM.read(baseAddress + 1) | (EEPROM.read(baseAddress + 2) << 8);
+  if ( sessions < 0xFFFF )
+    sessions++;
+
+  write(baseAddress + 1, sessions);
+  write(baseAddress + 2, sessions >> 8);
+
+}
+
+
+void Accounting::setMode(uint8_t pmode) {
+
+  mode = ( pmode < ACC_MODES ) ? pmode : ACC_MODES - 1;
+
+}
+
+
+void Accounting::count(uint8_t kind, unsigned long n) {
+
+  counts[kind] += n;
+
+}
+
+
+void Accounting::countWrites(uint8_t region, unsigned long n) {
+
+  counts[ACC_KINDS + region] += n;
+  counts[ACC_EEPROM_WRITES] += n;
+
+}
+
+
+uint16_t Accounting::counterAddress(uint8_t counter) {
+
+  if ( counter == 0 )
+    return baseAddress + 1;
+
+  return baseAddress + 3 + (counter - 1) * 4;
+
+}
+
+
+// Direccion del contador del incremento [index] de [incrementMode]
+uint16_t Accounting::incrementAddress(uint8_t index, uint8_t incrementMode) {
+
+  if ( index < ACC_KINDS )
+    return counterAddress(1 + ACC_REGIONS + incrementMode * ACC_KINDS + index);
+
+  return counterAddress(1 + index - ACC_KINDS);
+
+}
+
+
+unsigned long Accounting::readCounter(uint16_t address) {
+
+  return EEPROM.read(address) | ((unsigned long) EEPROM.read(address + 1) << 8) |
+    ((unsigned long) EEPROM.read(address + 2) << 16) | ((unsigned long) EEPROM.read(address + 3) << 24);
+
+}
+
+
+// Escritura contada como uso de la propia region
+void Accounting::write(uint16_t address, uint8_t value) {
+
+  if ( EEPROM.read(address) == value )
+    return;
+
+  EEPROM.update(address, value);
+  countWrites(ACC_ACCOUNTING, 1);
+
+}
+
+
+unsigned long Accounting::get(uint8_t counter) {
+
+  uint8_t index, counterMode;
+  uint16_t address = counterAddress(counter);
+  unsigned long value;
+
+  if ( counter == 0 )
+    return formatting ? 1 : EEPROM.read(address) | (EEPROM.read(address + 1) << 8);
+
+  if ( counter <= ACC_REGIONS ) {
+    index = ACC_KINDS + counter - 1;
+    counterMode = pendingMode;
+  }
+  else {
+    index = (counter - 1 - ACC_REGIONS) % ACC_KINDS;
+    counterMode = (counter - 1 - ACC_REGIONS) / ACC_KINDS;
+  }
+
+  // El contador en escritura esta incompleto en EEPROM
+  if ( index == flushIndex && flushByte && counterMode == pendingMode )
+    value = flushValue;
+  else {
+    value = formatting ? 0 : readCounter(address);
+    if ( counterMode == pendingMode )
+      value += pending[index];
+  }
+
+  if ( index >= ACC_KINDS || counterMode == countMode )
+    value += counts[index];
+
+  return value;
+
+}
+
+
+void Accounting::exportAll(void) {
+
+  exportIndex = 0;
+
+}
+
+
+/**
+ * Pasa los incrementos a pending para sumarlos a la EEPROM
+ * y comienza a contar los de la funcionalidad actual
+ */
+void Accounting::startFlush(void) {
+
+  memcpy(pending, counts, sizeof(pending));
+  memset(counts, 0x00, sizeof(counts));
+  pendingMode = countMode;
+  countMode = mode;
+
+  flushIndex = 0;
+  flushByte = 0;
+  flushTimestamp = millis();
+
+}
+
+
+void Accounting::update(void) {
+
+#ifdef RULI_TELEMETRY
+  if ( exportIndex < ACC_COUNTERS && telemetry.ready() ) {
+    telemetry.usage(exportIndex, get(exportIndex));
+    exportIndex++;
+  }
+#endif
+
+  if ( ! eeprom_is_ready() )
+    return;
+
+  if ( formatting ) {
+
+    if ( cursor < ACC_SIZE )
+      write(baseAddress + cursor, cursor == 1 ? 1 : 0);
+    else {
+      write(baseAddress, ACCOUNTING_KEY);
+      formatting = 0;
+    }
+
+    cursor++;
+    return;
+  }
+
+  if ( flushIndex == INCREMENTS && (mode != countMode || millis() - flushTimestamp >= ACC_FLUSH_MS) )
+    startFlush();
+
+  while ( flushIndex < INCREMENTS && pending[flushIndex] == 0 )
+    flushIndex++;
+
+  if ( flushIndex == INCREMENTS )
+    return;
+
+  /*
+   * Cada contador se escribe desde el byte menos significativo:
+   * un corte deja el valor previo mas a lo sumo el incremento
+   */
+  uint16_t address = incrementAddress(flushIndex, pendingMode);
+
+  if ( flushByte == 0 )
+    flushValue = readCounter(address) + pending[flushIndex];
+
+  write(address + flushByte, flushValue >> (8 * flushByte));
+
+  if ( ++flushByte == 4 ) {
+    flushByte = 0;
+    pending[flushIndex] = 0;
+    flushIndex++;
+  }
+
+}
+
+#endif
@@ -0,0 +1,424 @@
+/*
+ * Animation.cpp
+ * Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)
+ */
+
+#include <Arduino.h>
+#include <EEPROM.h>
+#include <avr/eeprom.h>
+
+#include "Animation.h"
+
+
+#define ANIMATION_KEY      'A'
+#define KEYFRAME_SIZE       5
+#define HEADER_SIZE         (1 + KEYFRAME_SIZE)
+
+#define TYPE_MASK          0xC0
+#define VALUE_MASK         0x3F
+#define LONG_DELAY         0x3F
+#define REPEAT_MAX         0x3E
+
+
+void Animation::begin(LedsPanel *pledsPanel, uint16_t address, uint16_t size) {
+
+  ledsPanel = pledsPanel;
+
+  baseAddress = address;
+  endAddress = address + size;
+
+  queueHead = 0;
+  queueCount = 0;
+  recording = 0;
+  playing = 0;
+
+#ifdef RULI_ACCOUNTING
+  writes = 0;
+#endif
+
+}
+
+
+byte Animation::isRecording(void) {
+
+  return recording;
+
+}
+
+
+byte Animation::isPlaying(void) {
+
+  return playing;
+
+}
+
+
+////////////////////////////////////
+//
+//    Escritura diferida en EEPROM
+//
+
+void Animation::put(uint16_t address, uint8_t value) {
+
+  // Con la cola llena se espera la escritura mas antigua
+  if ( queueCount == ANIMATION_QUEUE ) {
+    eeprom_busy_wait();
+    flushOne();
+  }
+
+  Write_t *w = &queue[(queueHead + queueCount) % ANIMATION_QUEUE];
+  w->address = address;
+  w->value = value;
+  queueCount++;
+
+}
+
+
+void Animation::flushOne(void) {
+
+  if ( queueCount == 0 || ! eeprom_is_ready() )
+    return;
+
+#ifdef RULI_ACCOUNTING
+  if ( EEPROM.read(queue[queueHead].address) != queue[queueHead].value )
+    writes++;
+#endif
+  EEPROM.update(queue[queueHead].address, queue[queueHead].value);
+  queueHead = (queueHead + 1) % ANIMATION_QUEUE;
+  queueCount--;
+
+}
+
+
+void Animation::drain(void) {
+
+  while ( queueCount ) {
+    eeprom_busy_wait();
+    flushOne();
+  }
+
+}
+
+#ifdef RULI_ACCOUNTING
+uint16_t Animation::getWrites(void) {
+
+  uint16_t ret = writes;
+
+  writes = 0;
+
+  return ret;
+
+}
+#endif
+
+
+////////////////////////////////////
+//
+//    Grabacion
+//
+
+void Animation::record(uint8_t *leds) {
+
+  stop();
+
+  put(baseAddress, ANIMATION_KEY);
+
+  for ( uint8_t i = 0 ; i < KEYFRAME_SIZE ; i++ ) {
+    lastFrame[i] = leds[BLUE + i];
+    put(baseAddress + 1 + i, lastFrame[i]);
+  }
+
+  writePosition = baseAddress + HEADER_SIZE;
+  put(writePosition, ANIMATION_END);
+
+  lastRecordSize = 0;
+  repeatCount = 0;
+  frameTimestamp = millis();
+  recording = 1;
+
+}
+
+
+/**
+ * Escribe el byte de control con la demora transcurrida desde el
+ * cuadro anterior. Devuelve la cantidad de bytes utilizados
+ */
+uint8_t Animation::encodeDelay(uint8_t *record, uint8_t type) {
+
+  unsigned long now = millis();
+  unsigned long elapsed = now - frameTimestamp;
+  unsigned long units = (elapsed + ANIMATION_UNIT_MS / 2) / ANIMATION_UNIT_MS;
+
+  frameTimestamp = now;
+
+  if ( units < LONG_DELAY ) {
+    record[0] = type | units;
+    return 1;
+  }
+
+  units = (elapsed + ANIMATION_LONG_UNIT_MS / 2) / ANIMATION_LONG_UNIT_MS;
+  record[0] = type | LONG_DELAY;
+  record[1] = units > 0xFF ? 0xFF : units;
+  return 2;
+
+}
+
+
+/**
+ * Agrega un registro al final de la animacion. Un registro igual
+ * al anterior se comprime incrementando un contador de repeticion.
+ * Sin espacio disponible la grabacion finaliza
+ */
+void Animation::append(uint8_t *record, uint8_t size) {
+
+  if ( size == lastRecordSize && memcmp(record, lastRecord, size) == 0 ) {
+
+    if ( repeatCount > 0 && repeatCount < REPEAT_MAX ) {
+      put(repeatPosition, ANIMATION_REPEAT | ++repeatCount);
+      return;
+    }
+
+    if ( writePosition + 2 > endAddress ) {
+      recording = 0;
+      return;
+    }
+
+    repeatPosition = writePosition;
+    repeatCount = 1;
+    put(writePosition++, ANIMATION_REPEAT | repeatCount);
+    put(writePosition, ANIMATION_END);
+    return;
+  }
+
+  if ( writePosition + size + 1 > endAddress ) {
+    recording = 0;
+    return;
+  }
+
+  for ( uint8_t i = 0 ; i < size ; i++ )
+    put(writePosition++, record[i]);
+
+  put(writePosition, ANIMATION_END);
+
+  memcpy(lastRecord, record, size);
+  lastRecordSize = size;
+  repeatCount = 0;
+
+}
+
+
+void Animation::addFrame(uint8_t *leds) {
+
+  uint8_t record[8];
+  uint8_t size, mask, diff;
+
+  if ( ! recording )
+    return;
+
+  mask = 0;
+  for ( uint8_t i = 0 ; i < KEYFRAME_SIZE ; i++ )
+    if ( leds[BLUE + i] != lastFrame[i] )
+      mask |= 0x01 << i;
+
+  if ( mask == 0 )
+    return;
+
+  size = encodeDelay(record, ANIMATION_DELTA);
+  record[size++] = mask;
+
+  for ( uint8_t i = 0 ; i < KEYFRAME_SIZE ; i++ ) {
+    diff = leds[BLUE + i] ^ lastFrame[i];
+    if ( diff ) {
+      record[size++] = diff;
+      lastFrame[i] = leds[BLUE + i];
+    }
+  }
+
+  append(record, size);
+
+}
+
+
+void Animation::addRotation(uint8_t direction, uint8_t *leds) {
+
+  uint8_t record[2];
+
+  if ( ! recording )
+    return;
+
+  append(record, encodeDelay(record, direction == RIGHT ? ANIMATION_RIGHT : ANIMATION_LEFT));
+
+  memcpy(lastFrame, &leds[BLUE], KEYFRAME_SIZE);
+
+}
+
+
+////////////////////////////////////
+//
+//    Reproduccion
+//
+
+uint16_t Animation::readDelay(uint16_t address) {
+
+  uint8_t control = EEPROM.read(address);
+
+  if ( (control & VALUE_MASK) == LONG_DELAY )
+    return EEPROM.read(address + 1) * ANIMATION_LONG_UNIT_MS;
+
+  return (control & VALUE_MASK) * ANIMATION_UNIT_MS;
+
+}
+
+
+uint16_t Animation::recordSize(uint16_t address) {
+
+  uint8_t control = EEPROM.read(address);
+  uint16_t size = ( (control & VALUE_MASK) == LONG_DELAY ) ? 2 : 1;
+  uint8_t mask;
+
+  if ( (control & TYPE_MASK) == ANIMATION_DELTA ) {
+    mask = EEPROM.read(address + size++);
+    for ( ; mask ; mask >>= 1 )
+      size += mask & 0x01;
+  }
+
+  return size;
+
+}
+
+
+/**
+ * Aplica sobre el buffer de leds el registro en [address]
+ * (0: cuadro inicial). No realiza el refresh()
+ */
+void Animation::apply(uint16_t address) {
+
+  uint8_t control, mask;
+
+  if ( address == 0 ) {
+    for ( uint8_t i = 0 ; i < KEYFRAME_SIZE ; i++ )
+      ledsPanel->setValue(BLUE + i, EEPROM.read(baseAddress + 1 + i), 0);
+    return;
+  }
+
+  control = EEPROM.read(address);
+
+  switch ( control & TYPE_MASK ) {
+
+    case ANIMATION_RIGHT: { ledsPanel->rotate(RIGHT, 1, 0); break; }
+
+    case ANIMATION_LEFT: { ledsPanel->rotate(LEFT, 1, 0); break; }
+
+    case ANIMATION_DELTA: {
+
+      address += ( (control & VALUE_MASK) == LONG_DELAY ) ? 2 : 1;
+      mask = EEPROM.read(address++);
+
+      for ( uint8_t i = 0 ; i < KEYFRAME_SIZE ; i++ )
+        if ( mask & (0x01 << i) )
+          ledsPanel->setValue(BLUE + i, ledsPanel->getValue(BLUE + i) ^ EEPROM.read(address++), 0);
+    }
+
+  }
+
+}
+
+
+/**
+ * Decodifica el proximo registro: deja en pendingRecord el
+ * registro a aplicar y en delayMs su demora
+ */
+void Animation::decodeNext(void) {
+
+  uint8_t control;
+
+  if ( repeatLeft ) {
+    repeatLeft--;
+    pendingRecord = lastRecordPosition;
+    delayMs = readDelay(lastRecordPosition);
+    return;
+  }
+
+  control = ( readPosition < endAddress ) ? EEPROM.read(readPosition) : ANIMATION_END;
+
+  // Fin de la animacion (o repeticion sin registro previo): reinicio del ciclo
+  if ( control == ANIMATION_END || ((control & TYPE_MASK) == ANIMATION_REPEAT && lastRecordPosition == 0) ) {
+    readPosition = baseAddress + HEADER_SIZE;
+    lastRecordPosition = 0;
+    pendingRecord = 0;
+    delayMs = ANIMATION_LOOP_MS;
+    return;
+  }
+
+  if ( (control & TYPE_MASK) == ANIMATION_REPEAT ) {
+    readPosition++;
+    repeatLeft = (control & VALUE_MASK) - 1;
+    pendingRecord = lastRecordPosition;
+    delayMs = readDelay(lastRecordPosition);
+    return;
+  }
+
+  pendingRecord = lastRecordPosition = readPosition;
+  delayMs = readDelay(readPosition);
+  readPosition += recordSize(readPosition);
+
+}
+
+
+byte Animation::play(void) {
+
+  stop();
+
+  // La lectura requiere la grabacion completa en EEPROM
+  drain();
+
+  if ( EEPROM.read(baseAddress) != ANIMATION_KEY || EEPROM.read(baseAddress + HEADER_SIZE) == ANIMATION_END )
+    return 0;
+
+  apply(0);
+  ledsPanel->refresh();
+
+  readPosition = baseAddress + HEADER_SIZE;
+  lastRecordPosition = 0;
+  repeatLeft = 0;
+  decodeNext();
+  delayTimestamp = millis();
+  playing = 1;
+
+  return 1;
+
+}
+
+
+/*
+ * Los bytes pendientes se escriben luego, en update(): vaciar
+ * la cola aqui bloqueaba la pasada hasta ~40 ms
+ */
+void Animation::stop(void) {
+
+  recording = 0;
+  playing = 0;
+
+}
+
+
+void Animation::update(void) {
+
+  flushOne();
+
+}
+
+
+void Animation::tick(void) {
+
+  if ( ! playing || millis() - delayTimestamp < delayMs )
+    return;
+
+  delayTimestamp = millis();
+
+  apply(pendingRecord);
+  ledsPanel->refresh();
+
+  decodeNext();
+
+}
@@ -0,0 +1,386 @@
+/*
+ * AudioManager.cpp
+ * Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)
+ */
+
+#include <Arduino.h>
+
+#include "AudioManager.h"
+#include "SoundDurations.h"
+
+
+// Cantidad maxima de respuestas del reproductor leidas por pasada
+#define AUDIO_MAX_RESPONSES  4
+
+
+void AudioManager::begin(MP3Player *pmp3Player) {
+
+  mp3Player = pmp3Player;
+
+  current.soundClass = AUDIO_NONE;
+  playPending = 0;
+  stopPending = 0;
+  volumePending = 0;
+  musicActive = 0;
+  resumePending = 0;
+  finishedMask = 0;
+  musicRestarted = 0;
+  duckLevel = 0;
+  ducking = 0;
+  // MP3Player::begin() acaba de enviar el volumen inicial
+  commandTimestamp = millis();
+#ifdef RULI_WARM_BOOT
+  bootPending = 1;
+#endif
+  playTimestamp = 0;
+  currentDuration = 0;
+  rampTimestamp = 0;
+
+}
+
+
+/**
+ * Clase del sonido que estara sonando una vez
+ * enviados los comandos pendientes
+ */
+uint8_t AudioManager::activeClass(void) {
+
+  if ( playPending )
+    return requested.soundClass;
+
+  if ( stopPending )
+    return AUDIO_NONE;
+
+  return current.soundClass;
+
+}
+
+
+/**
+ * Volumen de salida para [soundClass]: el del usuario, salvo
+ * la musica atenuada (como maximo a la mitad) por el ducking
+ */
+uint8_t AudioManager::targetVolume(uint8_t soundClass) {
+
+  uint8_t volume = mp3Player->getVolume();
+  uint8_t attenuation = duckLevel;
+
+  if ( soundClass != AUDIO_MUSIC )
+    return volume;
+
+  if ( attenuation > volume / 2 )
+    attenuation = volume / 2;
+
+  return volume - attenuation;
+
+}
+
+
+byte AudioManager::play(uint8_t soundClass, uint8_t folder, uint8_t file) {
+
+  uint8_t active = activeClass();
+
+  if ( soundClass == AUDIO_MUSIC ) {
+    music.soundClass = AUDIO_MUSIC;
+    music.folder = folder;
+    music.file = file;
+    musicActive = 1;
+  }
+
+  /*
+   * Con un sonido de mayor prioridad en curso la solicitud se
+   * descarta; la musica queda de fondo hasta que este finalice
+   */
+  if ( active != AUDIO_NONE && soundClass < active )
+    return soundClass == AUDIO_MUSIC;
+
+  requested.soundClass = soundClass;
+  requested.folder = folder;
+  requested.file = file;
+  playPending = 1;
+  stopPending = 0;
+  resumePending = 0;
+
+  return 1;
+
+}
+
+
+byte AudioManager::play(uint8_t soundClass, SoundCue cue) {
+
+  return play(soundClass, cue.folder, cue.file);
+
+}
+
+
+void AudioManager::stop(uint8_t soundClass) {
+
+  if ( soundClass == AUDIO_MUSIC )
+    musicActive = 0;
+
+  if ( activeClass() != soundClass )
+    return;
+
+  // Con musica de fondo, reanudarla reemplaza al comando stop
+  if ( musicActive ) {
+    resumeMusic();
+    return;
+  }
+
+  playPending = 0;
+  resumePending = 0;
+  stopPending = ( current.soundClass != AUDIO_NONE );
+
+}
+
+
+void AudioManager::resumeMusic(void) {
+
+  requested = music;
+  playPending = 1;
+  stopPending = 0;
+  resumePending = 1;
+
+  // La musica reanudada vuelve gradualmente a su volumen
+  duckLevel = AUDIO_DUCK_STEPS;
+  rampTimestamp = millis();
+
+}
+
+
+void AudioManager::setDucking(byte on) {
+
+  if ( on == ducking )
+    return;
+
+  ducking = on;
+
+  if ( ducking )
+    duckLevel = AUDIO_DUCK_STEPS;
+
+  rampTimestamp = millis();
+
+}
+
+
+/**
+ * El sonido actual finalizo (o no pudo reproducirse)
+ */
+void AudioManager::soundEnded(void) {
+
+  finishedMask |= 0x01 << current.soundClass;
+
+  // music() solicita el proximo tema al recibir el fin
+  if ( current.soundClass == AUDIO_MUSIC )
+    musicActive = 0;
+
+  current.soundClass = AUDIO_NONE;
+
+  if ( musicActive && playPending == 0 )
+    resumeMusic();
+
+}
+
+
+/**
+ * Lee las respuestas pendientes del reproductor. Los mensajes de
+ * fin duplicados, o recibidos inmediatamente despues de un comando
+ * de reproduccion, no corresponden al sonido actual y se descartan.
+ * Los errores (archivo inexistente) llegan inmediatamente despues
+ * del comando y finalizan el sonido sin esperar la guarda
+ */
+void AudioManager::readResponses(void) {
+
+  uint8_t type;
+
+  for ( uint8_t i = 0 ; i < AUDIO_MAX_RESPONSES ; i++ ) {
+
+    type = mp3Player->readType();
+
+    if ( type == 0 )
+      break;
+
+    /*
+     * El reproductor se reinicio (caida de tension): el sonido
+     * se interrumpio y el volumen volvio al valor por defecto
+     */
+    if ( type == DFPlayerCardOnline ) {
+#ifdef RULI_WARM_BOOT
+      bootPending = 0;
+#endif
+      volumePending = 1;
+      if ( current.soundClass != AUDIO_NONE )
+        soundEnded();
+      continue;
+    }
+
+    if ( type != DFPlayerPlayFinished && type != DFPlayerError )
+      continue;
+
+    if ( current.soundClass == AUDIO_NONE )
+      continue;
+
+    if ( type == DFPlayerError )
+      soundEnded();
+    else if ( millis() - playTimestamp >= AUDIO_FINISH_GUARD_MS &&
+              millis() - playTimestamp + AUDIO_DURATION_MARGIN_MS >= currentDuration )
+      soundEnded();
+  }
+
+}
+
+
+void AudioManager::update(void) {
+
+  unsigned long now;
+  uint8_t volume;
+
+  finishedMask = 0;
+  musicRestarted = 0;
+
+  readResponses();
+
+  now = millis();
+
+  /*
+   * Fin previsto por la duracion del catalogo: el mensaje del
+   * reproductor llega mas tarde y se descarta (sin sonido en
+   * curso, o por la guarda del siguiente)
+   */
+  if ( current.soundClass != AUDIO_NONE && currentDuration && now - playTimestamp >= currentDuration )
+    soundEnded();
+
+  // Recuperacion gradual del volumen de la musica
+  if ( ducking == 0 && duckLevel && now - rampTimestamp >= AUDIO_RAMP_STEP_MS ) {
+    duckLevel--;
+    rampTimestamp = now;
+  }
+
+#ifdef RULI_WARM_BOOT
+  /*
+   * Las solicitudes se acumulan en el estado deseado y se
+   * envian al terminar la espera, comenzando por el volumen
+   */
+  if ( bootPending ) {
+    if ( now - commandTimestamp < AUDIO_BOOT_MS )
+      return;
+    bootPending = 0;
+    volumePending = 1;
+  }
+#endif
+
+  if ( now - commandTimestamp < AUDIO_COMMAND_GAP_MS )
+    return;
+
+  /*
+   * Un comando por pasada: primero el volumen perdido en un
+   * reinicio del reproductor, luego el volumen que corresponde
+   * al sonido a reproducir, luego la reproduccion o detencion
+   * y por ultimo los ajustes de volumen del sonido en curso
+   * o del nivel configurado (MP3Player::setVolume())
+   */
+  if ( volumePending ) {
+    mp3Player->outputVolume(mp3Player->getOutputVolume());
+    volumePending = 0;
+    commandTimestamp = now;
+  }
+  else if ( playPending ) {
+
+    volume = targetVolume(requested.soundClass);
+
+    if ( mp3Player->getOutputVolume() != volume )
+      mp3Player->outputVolume(volume);
+    else {
+      mp3Player->playFolder(requested.folder, requested.file);
+      current = requested;
+      playPending = 0;
+      playTimestamp = now;
+      currentDuration = getDuration(current.folder, current.file);
+      musicRestarted = resumePending;
+      resumePending = 0;
+    }
+
+    commandTimestamp = now;
+  }
+  else if ( stopPending ) {
+    mp3Player->stop();
+    current.soundClass = AUDIO_NONE;
+    stopPending = 0;
+    commandTimestamp = now;
+  }
+  else {
+
+    volume = targetVolume(current.soundClass);
+
+    if ( mp3Player->getOutputVolume() != volume ) {
+      mp3Player->outputVolume(volume);
+      commandTimestamp = now;
+    }
+  }
+
+}
+
+
+byte AudioManager::finished(uint8_t soundClass) {
+
+  return ( finishedMask & (0x01 << soundClass) ) != 0;
+
+}
+
+
+byte AudioManager::isPlaying(uint8_t soundClass) {
+
+  return activeClass() == soundClass;
+
+}
+
+
+byte AudioManager::isMusicRestarted(void) {
+
+  return musicRestarted;
+
+}
+
+
+unsigned long AudioManager::getDuration(uint8_t folder, uint8_t file) {
+
+  uint16_t index;
+
+  if ( folder == 0 || folder > SOUND_FOLDERS || file == 0 )
+    return 0;
+
+  index = pgm_read_word(&soundFolderIndex[folder - 1]) + file - 1;
+
+  if ( index >= pgm_read_word(&soundFolderIndex[folder]) )
+    return 0;
+
+  return (unsigned long) pgm_read_word(&soundDurations[index]) * SOUND_UNIT_MS;
+
+}
+
+
+unsigned long AudioManager::getRemaining(uint8_t soundClass) {
+
+  unsigned long elapsed = millis() - playTimestamp;
+
+  if ( current.soundClass != soundClass || playPending || currentDuration == 0 || elapsed >= currentDuration )
+    return 0;
+
+  return currentDuration - elapsed;
+
+}
+
+
+uint8_t AudioManager::getProgress(uint8_t soundClass) {
+
+  unsigned long elapsed = millis() - playTimestamp;
+
+  if ( current.soundClass != soundClass || playPending || currentDuration == 0 )
+    return 0;
+
+  if ( elapsed >= currentDuration )
+    return 0xFF;
+
+  return (elapsed << 8) / currentDuration;
+
+}
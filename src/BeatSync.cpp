@@ -0,0 +1,119 @@
+/*
+ * BeatSync.cpp
+ * Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)
+ */
+
+#include <Arduino.h>
+#include <avr/pgmspace.h>
+
+#include "BeatSync.h"
+#include "BeatMaps.h"
+
+
+void BeatSync::begin(void) {
+
+  running = 0;
+  position = 0;
+  end = 0;
+  tempo = 0;
+
+}
+
+
+byte BeatSync::start(uint8_t track) {
+
+  running = 0;
+
+  if ( track >= BEAT_MAP_TRACKS )
+    return 0;
+
+  tempo    = pgm_read_word(&beatMapTempo[track]);
+  position = pgm_read_word(&beatMapIndex[track]);
+  end      = pgm_read_word(&beatMapIndex[track + 1]);
+
+  if ( tempo == 0 )
+    return 0;
+
+  startTimestamp = millis() + BEAT_SYNC_OFFSET_MS;
+  nextEventTime = 0;
+
+  loadNextEvent();
+
+  running = 1;
+
+  return 1;
+
+}
+
+
+void BeatSync::stop(void) {
+
+  running = 0;
+
+}
+
+
+byte BeatSync::isRunning(void) {
+
+  return running;
+
+}
+
+
+/**
+ * Lee desde flash el proximo evento del mapa.
+ * Cada byte contiene el delta (bits 0-6) y el acento (bit 7),
+ * el valor 0x00 solo avanza el tiempo 127 unidades.
+ * Agotado el mapa continua marcando pulsos segun el tempo
+ */
+void BeatSync::loadNextEvent(void) {
+
+  uint8_t value;
+
+  while ( position < end ) {
+
+    value = pgm_read_byte(&beatMapData[position++]);
+
+    if ( value == 0x00 ) {
+      nextEventTime += 127UL * BEAT_MAP_UNIT_MS;
+      continue;
+    }
+
+    nextEventTime += (unsigned long) (value & 0x7F) * BEAT_MAP_UNIT_MS;
+    nextEvent = (value & 0x80) ? ACCENT_BEAT : BEAT;
+
+    return;
+  }
+
+  nextEventTime += tempo;
+  nextEvent = BEAT;
+
+}
+
+
+uint8_t BeatSync::poll(void) {
+
+  uint8_t event = NO_BEAT;
+  unsigned long now;
+
+  if ( ! running )
+    return NO_BEAT;
+
+  now = millis();
+
+  // Aun no comenzo el audio
+  if ( (long) (now - startTimestamp) < 0 )
+    return NO_BEAT;
+
+  /*
+   * Si el lazo principal se demoro se descartan los eventos
+   * vencidos y se informa solamente el ultimo
+   */
+  while ( (now - startTimestamp) >= nextEventTime ) {
+    event = nextEvent;
+    loadNextEvent();
+  }
+
+  return event;
+
+}
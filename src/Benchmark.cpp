@@ -0,0 +1,385 @@
+/*
+ * Benchmark.cpp
+ * Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)
+ *
+ * Microbenchmarks de las funciones criticas, pensados para ejecutarse
+ * bajo un simulador con precision de ciclo (simavr, ver tools/benchmark.py)
+ * o sobre el equipo real. Reemplaza a main.cpp en el entorno "benchmark"
+ * de platformio.ini.
+ *
+ * Cada caso se mide con Timer1 sin prescaler (1 cuenta = 1 ciclo) y con
+ * las interrupciones deshabilitadas, descontando el costo de la medicion.
+ * Los resultados se informan por el puerto serie, un objeto JSON por linea:
+ *
+ *   {"bench":"leds_rotate","calls":64,"min":412,"avg":412,"max":412,"ovf":0}
+ */
+
+#ifdef RULI_BENCHMARK
+
+#include <Arduino.h>
+#include <EEPROM.h>
+#include <avr/sleep.h>
+
+#include "RotaryEncoder.h"
+#include "EncoderBank.h"
+#include "LedsPanel.h"
+#include "RgbLedsPanel.h"
+#include "RuliBrain.h"
+#include "RuliVM.h"
+#include "Animation.h"
+
+
+#define BENCHMARK_SERIAL_BAUDS  115200
+
+// Cantidad de llamadas por caso
+#define BENCHMARK_CALLS         64
+
+// Pines del equipo (ver main.cpp)
+#define MW_CLK_PIN     16
+#define MW_DATA_PIN    15
+#define RS_SWITCH_PIN  19
+#define RS_CLK_PIN     18
+#define RS_DATA_PIN    17
+#define LP_ENABLE_PIN  8
+#define LP_CLOCK_PIN   9
+#define LP_DATA_PIN    12
+
+#define EEPROM_VM_PROGRAM     0x190
+#define EEPROM_ANIMATION      0x210
+#define EEPROM_ANIMATION_SIZE 0x1F0
+
+
+/*
+ * Programas de la maquina virtual (ver tools/ruliasm.py)
+ */
+
+// loop: inc r0 / jmp loop
+const uint8_t vmCountProgram[] PROGMEM = {
+  0x05, 0x00, 0x42, 0x00, 0x00
+};
+
+/*
+ * Giro de la rueda de simpleRoulette():
+ *
+ * loop:   wevt  r0
+ *         cmp   r0, right_turn
+ *         jz    right
+ *         rot   left, 1
+ *         jmp   loop
+ * right:  rot   right, 1
+ *         jmp   loop
+ */
+const uint8_t vmRouletteProgram[] PROGMEM = {
+  0x31, 0x00, 0x40, 0x00, 0x02, 0x43, 0x0E, 0x00, 0x14, 0x01,
+  0x01, 0x42, 0x00, 0x00, 0x14, 0x00, 0x01, 0x42, 0x00, 0x00
+};
+
+
+LedsPanel ledsPanel;
+FastLedsPanel<LP_ENABLE_PIN, LP_CLOCK_PIN, LP_DATA_PIN> fastLedsPanel;
+Ws2812LedsPanel<LP_DATA_PIN> ws2812LedsPanel;
+RotaryEncoder mainWheel;
+FastRotaryEncoder<MW_CLK_PIN, MW_DATA_PIN, 0> fastWheel;
+RotaryEncoder rotarySelector;
+EncoderBank encoderBank;
+RuliBrain ruliBrain;
+RuliVM ruliVM;
+Animation animation;
+
+
+/*
+ * Acceso a los metodos internos de RuliBrain
+ * (ver friend en RuliBrain.h)
+ */
+class Benchmark {
+
+  typedef struct {
+
+    uint16_t calls;
+    uint16_t min;
+    uint16_t max;
+    uint32_t total;
+    uint16_t overflows;
+
+  } Stats_t;
+
+  static uint16_t overhead;
+
+  static void statsBegin(Stats_t *stats);
+  static void report(const __FlashStringHelper *name, Stats_t *stats, uint8_t divisor);
+
+public:
+
+  static void calibrate(void);
+  static void run(void);
+
+};
+
+uint16_t Benchmark::overhead = 0;
+
+// micros() al ingresar a setup(): costo de arranque del runtime
+static unsigned long startupMicros;
+
+
+/*
+ * Medicion de [code] luego de ejecutar [prepare] (no medido),
+ * BENCHMARK_CALLS veces. El indice de la llamada es [i]
+ */
+#define MEASURE(name, divisor, prepare, code) {                   \
+  Stats_t stats;                                                  \
+  uint16_t cycles;                                                \
+  statsBegin(&stats);                                             \
+  Serial.flush();                                                 \
+  for ( uint16_t i = 0 ; i < BENCHMARK_CALLS ; i++ ) {            \
+    prepare;                                                      \
+    cli();                                                        \
+    TIFR1 = _BV(TOV1);                                            \
+    TCNT1 = 0;                                                    \
+    code;                                                         \
+    cycles = TCNT1;                                               \
+    if ( TIFR1 & _BV(TOV1) ) stats.overflows++;                   \
+    sei();                                                        \
+    cycles = cycles > overhead ? cycles - overhead : 0;           \
+    stats.calls++;                                                \
+    stats.total += cycles;                                        \
+    if ( cycles < stats.min ) stats.min = cycles;                 \
+    if ( cycles > stats.max ) stats.max = cycles;                 \
+  }                                                               \
+  report(F(name), &stats, divisor);                               \
+}
+
+
+void Benchmark::statsBegin(Stats_t *stats) {
+
+  stats->calls = 0;
+  stats->min = 0xFFFF;
+  stats->max = 0;
+  stats->total = 0;
+  stats->overflows = 0;
+
+}
+
+
+/**
+ * Informa ciclos por llamada. Con [divisor] > 1 cada llamada
+ * ejecuta [divisor] operaciones y se informa el costo de cada una
+ */
+void Benchmark::report(const __FlashStringHelper *name, Stats_t *stats, uint8_t divisor) {
+
+  Serial.print(F("{\"bench\":\""));
+  Serial.print(name);
+  Serial.print(F("\",\"calls\":"));
+  Serial.print(stats->calls);
+  Serial.print(F(",\"min\":"));
+  Serial.print(stats->min / divisor);
+  Serial.print(F(",\"avg\":"));
+  Serial.print(stats->total / stats->calls / divisor);
+  Serial.print(F(",\"max\":"));
+  Serial.print(stats->max / divisor);
+  Serial.print(F(",\"ovf\":"));
+  Serial.print(stats->overflows);
+  Serial.println(F("}"));
+
+}
+
+
+/**
+ * Costo de la medicion en si (lectura de TCNT1, etc.),
+ * informado en la primera linea de la salida
+ */
+void Benchmark::calibrate(void) {
+
+  uint16_t cycles;
+
+  overhead = 0xFFFF;
+
+  for ( uint8_t i = 0 ; i < 16 ; i++ ) {
+    cli();
+    TIFR1 = _BV(TOV1);
+    TCNT1 = 0;
+    cycles = TCNT1;
+    sei();
+    if ( cycles < overhead )
+      overhead = cycles;
+  }
+
+  Serial.print(F("{\"benchmark\":\"ruli\",\"f_cpu\":"));
+  Serial.print(F_CPU);
+  Serial.print(F(",\"overhead\":"));
+  Serial.print(overhead);
+  Serial.print(F(",\"startup_us\":"));
+  Serial.print(startupMicros);
+  Serial.println(F("}"));
+
+}
+
+
+void Benchmark::run(void) {
+
+  volatile uint8_t sink;
+  uint8_t bankSizes[] = { 2, 4, 8 };
+
+  /*
+   * Panel de leds
+   */
+  MEASURE("leds_refresh", 1, , ledsPanel.refresh());
+  MEASURE("leds_refresh_fast", 1, , fastLedsPanel.refresh());
+
+  // Sin la espera del reset entre cuadros, 24 leds encendidos
+  ws2812LedsPanel.setWheelValues(0x0F, 0xF0, 0x0F, 0xF0, 0x0F);
+  MEASURE("leds_refresh_ws2812", 1, delayMicroseconds(WS2812_RESET_US), ws2812LedsPanel.refresh());
+  MEASURE("leds_rotate", 1, , fastLedsPanel.rotate(RIGHT, 1, 0));
+  MEASURE("leds_set_wheel", 1, , fastLedsPanel.setWheelValues(i % 40, i & 0x01, 0));
+  MEASURE("leds_get_wheel", 1, , sink = fastLedsPanel.getWheelNValue(i % 40));
+
+  // Refresco con las tres capas activas sobre toda la rueda
+  fastLedsPanel.setBlend(LAYER_OVERLAY, BLEND_XOR);
+  fastLedsPanel.setBlend(LAYER_CURSOR, BLEND_OR);
+  fastLedsPanel.setBlend(LAYER_UI, BLEND_COPY);
+  for ( uint8_t layer = 0 ; layer < LEDS_LAYERS ; layer++ )
+    fastLedsPanel.setLayerWheelValues(layer, 0x81, 0x42, 0x24, 0x18, 0xFF);
+  MEASURE("leds_refresh_layers", 1, , fastLedsPanel.refresh());
+  MEASURE("leds_layer_wheel", 1, , fastLedsPanel.setLayerWheelValues(LAYER_CURSOR, i % 40, i & 0x01));
+  for ( uint8_t layer = 0 ; layer < LEDS_LAYERS ; layer++ )
+    fastLedsPanel.clearLayer(layer);
+
+  /*
+   * Pines: digitalWrite()/digitalRead() contra FastPin
+   */
+  MEASURE("pin_write", 1, , digitalWrite(LP_DATA_PIN, i & 0x01));
+  MEASURE("pin_write_fast", 1, , FastPin<LP_DATA_PIN>::write(i & 0x01));
+  MEASURE("pin_read", 1, , sink = digitalRead(MW_CLK_PIN));
+  MEASURE("pin_read_fast", 1, , sink = FastPin<MW_CLK_PIN>::read());
+
+  /*
+   * Servicios del runtime (core de Arduino o runtime minimo, ver
+   * bare/). Entre pasadas de loop() el core invoca serialEventRun()
+   */
+  MEASURE("runtime_millis", 1, , sink = millis());
+  MEASURE("runtime_micros", 1, , sink = micros());
+  MEASURE("runtime_eeprom_read", 1, , sink = EEPROM.read(i));
+#ifdef RULI_BARE
+  MEASURE("runtime_loop_pass", 1, , );
+#else
+  MEASURE("runtime_loop_pass", 1, , if ( serialEventRun ) serialEventRun());
+#endif
+
+  /*
+   * Encoders (camino sin flanco), la rueda sin pulsador: lectura
+   * individual con digitalRead(), con FastPin y a traves del banco
+   * (sin el costo de sample(), ver bank_sample_N). Con pulsador se
+   * suma el reconocimiento de gestos (encoder_event_switch)
+   */
+  MEASURE("encoder_event", 1, , sink = mainWheel.getEvent());
+  MEASURE("encoder_event_fast", 1, , sink = fastWheel.getEvent());
+
+  encoderBank.begin();
+  mainWheel.attach(&encoderBank);
+  rotarySelector.attach(&encoderBank);
+  MEASURE("encoder_event_bank", 1, , sink = mainWheel.getEvent());
+  MEASURE("encoder_event_switch", 1, , sink = rotarySelector.getEvent());
+
+  /*
+   * Banco de encoders con 2, 4 y 8 encoders en los puertos C, B y D
+   * (DATA = CLK - 1). El costo de sample() depende de los puertos
+   */
+  const uint8_t bankPins[] = { 15, 17, 19, 9, 11, 13, 3, 5 };
+
+  for ( uint8_t size = 0 ; size < sizeof(bankSizes) ; size++ ) {
+
+    encoderBank.begin();
+    for ( uint8_t n = 0 ; n < bankSizes[size] ; n++ )
+      encoderBank.add(bankPins[n], bankPins[n] - 1, 0);
+
+    switch ( bankSizes[size] ) {
+      case 2: { MEASURE("bank_sample_2", 1, , encoderBank.sample()); break; }
+      case 4: { MEASURE("bank_sample_4", 1, , encoderBank.sample()); break; }
+      case 8: { MEASURE("bank_sample_8", 1, , encoderBank.sample()); }
+    }
+  }
+
+  /*
+   * Intervalos de RuliBrain (sin vencimiento)
+   */
+  MEASURE("brain_get_interval", 1, , sink = ruliBrain.getInterval(0, 60000, 2));
+
+  /*
+   * Maquina virtual: costo por instruccion con el presupuesto completo
+   * y giro de la rueda de simpleRoulette() interpretado contra nativo
+   */
+  ruliVM.begin(&fastLedsPanel, NULL);
+  ruliVM.load(EEPROM_VM_PROGRAM, vmCountProgram, sizeof(vmCountProgram));
+  MEASURE("vm_instruction", VM_BUDGET, , ruliVM.tick(NONE));
+
+  ruliVM.load(EEPROM_VM_PROGRAM, vmRouletteProgram, sizeof(vmRouletteProgram));
+  ruliVM.tick(NONE);
+  MEASURE("vm_roulette_turn", 1, , ruliVM.tick(i & 0x01 ? LEFT_TURN : RIGHT_TURN));
+  MEASURE("native_roulette_turn", 1, sink = i & 0x01 ? LEFT_TURN : RIGHT_TURN,
+    switch(sink) {
+      case RIGHT_TURN: { fastLedsPanel.rotate(RIGHT); break; }
+      case LEFT_TURN:  { fastLedsPanel.rotate(LEFT); }
+    });
+
+  /*
+   * Animacion de customShape(): grabacion de cuadros sin demora, de
+   * modo que cada tick() de la reproduccion decodifica un cuadro
+   */
+  animation.begin(&fastLedsPanel, EEPROM_ANIMATION, EEPROM_ANIMATION_SIZE);
+  fastLedsPanel.setWheelValues(0x00, 0x00, 0x80, 0x00, 0x00);
+  animation.record(fastLedsPanel.getValue());
+  for ( uint8_t n = 0 ; n < 96 ; n++ ) {
+    if ( n & 0x04 ) {
+      fastLedsPanel.rotate(RIGHT, 1, 0);
+      animation.addRotation(RIGHT, fastLedsPanel.getValue());
+    }
+    else {
+      fastLedsPanel.setWheelValues(n % 40, 1, 0);
+      animation.addFrame(fastLedsPanel.getValue());
+    }
+  }
+  animation.play();
+  MEASURE("animation_frame", 1, , animation.tick());
+  animation.stop();
+
+}
+
+
+void setup() {
+
+  startupMicros = micros();
+
+  Serial.begin(BENCHMARK_SERIAL_BAUDS);
+
+  ledsPanel.begin(LP_ENABLE_PIN, LP_CLOCK_PIN, LP_DATA_PIN);
+  fastLedsPanel.begin();
+  ws2812LedsPanel.begin();
+  mainWheel.begin(MW_CLK_PIN, MW_DATA_PIN);
+  fastWheel.begin();
+  rotarySelector.begin(RS_CLK_PIN, RS_DATA_PIN, RS_SWITCH_PIN);
+
+  /*
+   * Timer1 en modo normal sin prescaler: el core de
+   * Arduino lo deja configurado para PWM
+   */
+  TCCR1A = 0;
+  TCCR1B = _BV(CS10);
+
+  Benchmark::calibrate();
+  Benchmark::run();
+
+  Serial.println(F("{\"done\":1}"));
+  Serial.flush();
+
+  // Fin: simavr termina la simulacion al dormir sin interrupciones
+  cli();
+  set_sleep_mode(SLEEP_MODE_PWR_DOWN);
+  sleep_enable();
+  sleep_cpu();
+
+}
+
+
+void loop() {
+}
+
+#endif
@@ -0,0 +1,162 @@
+/*
+ * EncoderBank.cpp
+ * Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)
+ */
+
+#include <Arduino.h>
+
+#include "RotaryEncoder.h"
+#include "EncoderBank.h"
+
+
+void EncoderBank::begin(void) {
+
+  memset(ports, 0x00, sizeof(ports));
+  memset(encoders, 0x00, sizeof(encoders));
+  portsCount = 0;
+  encodersCount = 0;
+  sampleTimestamp = 0;
+
+}
+
+
+/**
+ * Devuelve la posicion (0 a 7) del bit de una mascara
+ */
+static int8_t bitPosition(uint8_t mask) {
+
+  int8_t position = 0;
+
+  while ( mask > 1 ) {
+    mask >>= 1;
+    position++;
+  }
+
+  return position;
+
+}
+
+
+uint8_t EncoderBank::add(uint8_t clkPin, uint8_t dataPin, uint8_t switchPin) {
+
+  volatile uint8_t *pinRegister;
+  uint8_t clkBit, dataBit, switchBit = 0;
+  int8_t dataShift;
+  uint8_t port;
+
+  if ( encodersCount >= ENCODER_BANK_SIZE )
+    return ENCODER_BANK_FULL;
+
+  pinRegister = portInputRegister(digitalPinToPort(clkPin));
+  clkBit      = digitalPinToBitMask(clkPin);
+  dataBit     = digitalPinToBitMask(dataPin);
+  dataShift   = bitPosition(clkBit) - bitPosition(dataBit);
+
+  // CLK, DATA y SWITCH deben compartir el puerto
+  if ( portInputRegister(digitalPinToPort(dataPin)) != pinRegister )
+    return ENCODER_BANK_FULL;
+
+  if ( switchPin != 0 ) {
+    if ( portInputRegister(digitalPinToPort(switchPin)) != pinRegister )
+      return ENCODER_BANK_FULL;
+    switchBit = digitalPinToBitMask(switchPin);
+  }
+
+  for ( port = 0 ; port < portsCount ; port++ )
+    if ( ports[port].pinRegister == pinRegister )
+      break;
+
+  if ( port == portsCount ) {
+
+    if ( portsCount >= ENCODER_BANK_PORTS )
+      return ENCODER_BANK_FULL;
+
+    ports[port].pinRegister = pinRegister;
+    ports[port].dataShift = dataShift;
+    ports[port].lastLevels = *pinRegister;
+    portsCount++;
+  }
+  else if ( ports[port].dataShift != dataShift )
+    return ENCODER_BANK_FULL;
+
+  ports[port].clkMask |= clkBit;
+  ports[port].switchMask |= switchBit;
+
+  encoders[encodersCount].port = port;
+  encoders[encodersCount].clkBit = clkBit;
+  encoders[encodersCount].switchBit = switchBit;
+
+  return encodersCount++;
+
+}
+
+
+void EncoderBank::sample(void) {
+
+  uint8_t levels, falling, dataLevels;
+
+  for ( uint8_t i = 0 ; i < portsCount ; i++ ) {
+
+    Port_t &port = ports[i];
+
+    levels = *port.pinRegister;
+
+    // Flancos de bajada de CLK de todos los encoders del puerto
+    falling = port.lastLevels & ~levels & port.clkMask;
+
+    if ( falling ) {
+
+      sampleTimestamp = micros();
+
+      /*
+       * Alinea los bits DATA con los bits CLK: DATA en alto
+       * indica giro hacia la izquierda (antihorario)
+       */
+      if ( port.dataShift >= 0 )
+        dataLevels = levels << port.dataShift;
+      else
+        dataLevels = levels >> (-port.dataShift);
+
+      port.leftTurns  |= falling & dataLevels;
+      port.rightTurns |= falling & ~dataLevels;
+    }
+
+    port.lastLevels = levels;
+  }
+
+}
+
+
+uint8_t EncoderBank::getTurn(uint8_t index) {
+
+  Encoder_t &encoder = encoders[index];
+  Port_t &port = ports[encoder.port];
+  uint8_t event = NONE;
+
+  if ( port.leftTurns & encoder.clkBit )
+    event = LEFT_TURN;
+  else if ( port.rightTurns & encoder.clkBit )
+    event = RIGHT_TURN;
+
+  port.leftTurns  &= ~encoder.clkBit;
+  port.rightTurns &= ~encoder.clkBit;
+
+  return event;
+
+}
+
+
+uint8_t EncoderBank::getSwitchLevel(uint8_t index) {
+
+  Encoder_t &encoder = encoders[index];
+
+  return ( ports[encoder.port].lastLevels & encoder.switchBit ) ? 1 : 0;
+
+}
+
+
+unsigned long EncoderBank::getSampleTimestamp(void) {
+
+  return sampleTimestamp;
+
+}
@@ -0,0 +1,128 @@
+/*
+ * LatencyMeter.cpp
+ * Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)
+ */
+
+#include <Arduino.h>
+
+#include "LatencyMeter.h"
+
+
+void LatencyMeter::begin(void) {
+
+  memset(buckets, 0x00, sizeof(buckets));
+  count = 0;
+  minValue = 0xFFFFFFFF;
+  maxValue = 0;
+
+}
+
+
+uint8_t LatencyMeter::bucketOf(unsigned long us) {
+
+  uint8_t exponent = 8, bucket;
+
+  if ( us < 256 )
+    return 0;
+
+  while ( (us >> (exponent + 1)) && exponent < 19 )
+    exponent++;
+
+  /*
+   * Dos rangos por potencia de 2: el bit
+   * siguiente al mas significativo elige la mitad.
+   * El ultimo rango agrupa todas las muestras mayores
+   */
+  bucket = 1 + (exponent - 8) * 2 + ((us >> (exponent - 1)) & 0x01);
+
+  return min(bucket, LATENCY_BUCKETS - 1);
+
+}
+
+
+unsigned long LatencyMeter::bucketLimit(uint8_t bucket) {
+
+  uint8_t exponent;
+
+  if ( bucket == 0 )
+    return 256;
+
+  exponent = 8 + (bucket - 1) / 2;
+
+  if ( (bucket - 1) & 0x01 )
+    return 2UL << exponent;
+
+  return 3UL << (exponent - 1);
+
+}
+
+
+void LatencyMeter::record(unsigned long us) {
+
+  uint8_t bucket = bucketOf(us);
+
+  // Al saturar un contador se reduce todo el histograma a la mitad
+  if ( buckets[bucket] == 0xFFFF )
+    for ( uint8_t i = 0 ; i < LATENCY_BUCKETS ; i++ )
+      buckets[i] >>= 1;
+
+  buckets[bucket]++;
+
+  if ( count < 0xFFFF )
+    count++;
+
+  if ( us < minValue )
+    minValue = us;
+
+  if ( us > maxValue )
+    maxValue = us;
+
+}
+
+
+unsigned long LatencyMeter::percentile(uint8_t percent) {
+
+  unsigned long total = 0, target, accum = 0;
+
+  for ( uint8_t i = 0 ; i < LATENCY_BUCKETS ; i++ )
+    total += buckets[i];
+
+  if ( total == 0 )
+    return 0;
+
+  target = (total * percent + 99) / 100;
+
+  for ( uint8_t i = 0 ; i < LATENCY_BUCKETS ; i++ ) {
+    accum += buckets[i];
+    if ( accum >= target )
+      return ( i == LATENCY_BUCKETS - 1 ) ? maxValue : min(bucketLimit(i), maxValue);
+  }
+
+  return maxValue;
+
+}
+
+
+uint16_t LatencyMeter::getCount(void) {
+  return count;
+}
+
+unsigned long LatencyMeter::getMin(void) {
+  return count ? minValue : 0;
+}
+
+unsigned long LatencyMeter::getMax(void) {
+  return maxValue;
+}
+
+
+void LatencyMeter::report(Print &out) {
+
+  out.print("n=");    out.print((unsigned long) count);
+  out.print(" min="); out.print(getMin());
+  out.print(" p50="); out.print(percentile(50));
+  out.print(" p90="); out.print(percentile(90));
+  out.print(" p99="); out.print(percentile(99));
+  out.print(" max="); out.print(maxValue);
+
+}
@@ -1,360 +1,517 @@
-/*
- * LedsPanel.cpp
- * Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)
- */
-
-#include <Arduino.h>
-
-#include "LedsPanel.h"
-
-
-/*
- * Macros para manejo de salidas correspondientes
- * a los shift registers CD4064
- */
-#define disableOutput() digitalWrite(enablePin, LOW)
-#define enableOutput() digitalWrite(enablePin, HIGH)
-#define clkPulse() digitalWrite(clkPin, LOW); digitalWrite(clkPin, HIGH)
-
-
-/**
- * Inicializa el modo de los pines (output)
- * el buffer en cero (todos leds apagados) e inhabilita
- * la linea de salida de todos los shift registers
- */
-void LedsPanel::begin(int penablePin, int pclkPin, int pdataPin) {
-
-  enablePin = penablePin;
-  clkPin    = pclkPin;
-  dataPin   = pdataPin;
-
-  pinMode(enablePin, OUTPUT);
-  pinMode(clkPin,    OUTPUT);
-  pinMode(dataPin,   OUTPUT);
-
-  disableOutput();
-
-  memset(ledsBuffer, 0x00, sizeof(ledsBuffer));
-
-}
-
-
-/**
- * Establece el estado encendido/apagado de
- * cada led en funcion de su estado logico
- * correspondiente en el buffer
- */
-void LedsPanel::refresh(void) {
-
-  disableOutput();
-
- /*
-  * Recorre el buffer de leds desde el final
-  * hacia el principio, en el siguiente orden:
-  * RED, YELLOW, WHITE, GREEN, BLUE, FUNC_INDICATOR
-  */
-  for ( int i = sizeof(ledsBuffer) - 1 ; i >= 0 ; i-- ) {
-   /*
-    * Por cada elemento (seccion de leds) envia cada
-    * uno de sus bits a la cascada de shift registers
-    * comenzando por el bit mas significativo (MSB)
-    */
-    uint8_t mask = 0x80;
-    while(mask > 0) {
-      digitalWrite(dataPin, ledsBuffer[i] & mask);
-      clkPulse();
-      mask = mask >> 1;
-      mask = mask & B01111111;
-    }
-  }
-
-  enableOutput();
-
-}
-
-
-/**
- * Establece todos los leds apagados.
- * Limpia el buffer e invoca a funcion refresh()
- */
-void LedsPanel::clearAll(void) {
-
-  memset(ledsBuffer, 0x00, sizeof(ledsBuffer));
-
-  refresh();
-
-}
-
-
-/**
- * Establece el valor para una seccion de leds:
- * FUNC_INDICATOR, BLUE, GREEN, WHITE, YELLOW,RED
- */
-void LedsPanel::setValue(uint8_t ledsSection, uint8_t value) {
-  setValue(ledsSection,value, 1);
-}
-
-void LedsPanel::setValue(uint8_t ledsSection, uint8_t value, byte doRefresh) {
-
-  ledsBuffer[ledsSection] = value;
-
-  if ( doRefresh )
-    refresh();
-
-}
-
-
-/**
- * Establece el valor para una seccion de leds:
- * FUNC_INDICATOR, BLUE, GREEN, WHITE, YELLOW,RED
- * aplicando el operador OR de bits
- */
-void LedsPanel::setValueOR(uint8_t ledsSection, uint8_t value) {
-
-  setValueOR(ledsSection, value, 1);
-
-}
-
-void LedsPanel::setValueOR(uint8_t ledsSection, uint8_t value, byte doRefresh) {
-
-  ledsBuffer[ledsSection] |= value;
-
-  if ( doRefresh )
-    refresh();
-
-}
-
-
-/**
- * Establece el valor para una seccion de leds:
- * FUNC_INDICATOR, BLUE, GREEN, WHITE, YELLOW,RED
- * aplicando el operador AND de bits
- */
-void LedsPanel::setValueAND(uint8_t ledsSection, uint8_t value) {
-
-  setValueAND(ledsSection, value, 1);
-
-}
-
-void LedsPanel::setValueAND(uint8_t ledsSection, uint8_t value, byte doRefresh) {
-
-  ledsBuffer[ledsSection] &= value;
-
-  if ( doRefresh )
-    refresh();
-
-}
-
-
-/**
- * Establece el valor para las secciones correspondiente a la rueda:
- * BLUE, GREEN, WHITE, YELLOW,RED
- */
-void LedsPanel::setWheelValues(uint8_t blue, uint8_t green, uint8_t white, uint8_t yellow, uint8_t red) {
-
-  ledsBuffer[BLUE] = blue;
-  ledsBuffer[GREEN] = green;
-  ledsBuffer[WHITE] = white;
-  ledsBuffer[YELLOW] = yellow;
-  ledsBuffer[RED] = red;
-
-  refresh();
-
-}
-
-
-void LedsPanel::setWheelValues(uint8_t ledNumber, byte value) {
-  setWheelValues( ledNumber, value, 1);
-}
-
-
-void LedsPanel::setWheelValues(uint8_t ledNumber, byte value, byte doRefresh) {
-
-  byte mask = 0x80;
-
-  if ( ledNumber < 8 ) {
-    mask >>= ledNumber;
-    if(value)
-      ledsBuffer[WHITE] |= mask;
-    else
-      ledsBuffer[WHITE] &= (~mask);
-  }
-  else if ( ledNumber < 16 ) {
-    mask >>= (ledNumber - 8);
-    if(value)
-      ledsBuffer[GREEN] |= mask;
-    else
-      ledsBuffer[GREEN] &= (~mask);
-  }
-  else if ( ledNumber < 24 ) {
-    mask >>= (ledNumber - 16);
-    if(value)
-      ledsBuffer[BLUE] |= mask;
-    else
-      ledsBuffer[BLUE] &= (~mask);
-  }
-  else if ( ledNumber < 32 ) {
-    mask >>= (ledNumber - 24);
-    if(value)
-      ledsBuffer[RED] |= mask;
-    else
-      ledsBuffer[RED] &= (~mask);
-  }
-  else if ( ledNumber < 40 ) {
-    mask >>= (ledNumber - 32);
-    if(value)
-      ledsBuffer[YELLOW] |= mask;
-    else
-      ledsBuffer[YELLOW] &= (~mask);
-  }
-
-  if ( doRefresh )
-    refresh();
-
-}
-
-
-uint8_t LedsPanel::getWheelNValue(uint8_t ledNumber) {
-
-  byte mask = 0x80;
-  uint8_t retValue;
-
-  if ( ledNumber < 8 ) {
-    mask >>= ledNumber;
-    retValue = ledsBuffer[WHITE] & mask;
-  }
-  else if ( ledNumber < 16 ) {
-    mask >>= (ledNumber - 8);
-    retValue = ledsBuffer[GREEN] & mask;
-  }
-  else if ( ledNumber < 24 ) {
-    mask >>= (ledNumber - 16);
-    retValue = ledsBuffer[BLUE] & mask;
-  }
-  else if ( ledNumber < 32 ) {
-    mask >>= (ledNumber - 24);
-    retValue = ledsBuffer[RED] & mask;
-  }
-  else if ( ledNumber < 40 ) {
-    mask >>= (ledNumber - 32);
-    retValue = ledsBuffer[YELLOW] & mask;
-  }
-
-  if ( retValue )
-    retValue = 1;
-  else
-    retValue = 0;
-
-  return retValue;
-
-}
-
-
-/**
- * Realiza una rotaci�n o desplazamiento en la rueda
- * principal de leds. Los argumetos determinan la direccion
- * (LEFT o RIGHT) y cantidad de posiciones desplazadas
- */
-
-void LedsPanel::rotate(uint8_t direction) {
-  rotate(direction, 1);
-}
-
-void LedsPanel::rotate(uint8_t direction, uint8_t steps) {
-  rotate(direction, steps, 1);
-}
-
-void LedsPanel::rotate(uint8_t direction, uint8_t steps, byte doRefresh) {
-
-  uint8_t bitSaved;
-
-  switch(direction) {
-
-    // Rotacion hacia la derecha
-    case RIGHT: {
-
-     /*
-      * Resguarda el bit menos significativo de la
-      * primera seccion (BLUE) de la rueda
-      */
-      bitSaved = ledsBuffer[BLUE] & B00000001;
-      bitSaved <<= 7;
-
-     /*
-      * Realiza la rotacion a derecha
-      * de todas las secciones de la rueda
-      */
-      for ( uint8_t i = BLUE ; i < RED ; i++ ) {
-        ledsBuffer[i] >>= 1;
-        ledsBuffer[i] &= B01111111;
-        ledsBuffer[i] |= (ledsBuffer[i+1]<<7);
-      }
-
-     /*
-      * Setea el valor resguardado en el bit mas significativo
-      * de la ultima seccion (RED) de la rueda
-      */
-      ledsBuffer[RED] >>= 1;
-      ledsBuffer[RED] &= B01111111;
-      ledsBuffer[RED] |= bitSaved;
-
-      break;
-    }
-
-    // Rotacion hacia la izquierda
-    case LEFT: {
-
-     /*
-      * Resguarda el bit mas significativo de la
-      * ultima seccion (RED) de la rueda
-      */
-      bitSaved = ledsBuffer[RED] & B10000000;
-      bitSaved >>= 7;
-
-     /*
-      * Realiza la rotacion a izquierda
-      * de todas las secciones de la rueda
-      */
-      for ( int i = RED ; i > BLUE ; i-- ) {
-        ledsBuffer[i] <<= 1;
-        ledsBuffer[i] &= B11111110;
-        ledsBuffer[i] |= (ledsBuffer[i-1]>>7);
-      }
-
-     /*
-      * Setea el valor resguardado en el bit menos significativo
-      * de la primera seccion (BLUE) de la rueda
-      */
-      ledsBuffer[BLUE] <<= 1;
-      ledsBuffer[BLUE] &= B11111110;
-      ledsBuffer[BLUE] |= bitSaved;
-
-      break;
-    }
-
-  }
-
-  if ( doRefresh )
-    refresh();
-
-}
-
-
-/**
- * Obtiene el valor de una seccion de leds determinada:
- * FUNC_INDICATOR, BLUE, GREEN, WHITE, YELLOW,RED
- */
-uint8_t LedsPanel::getValue(uint8_t ledsSection) {
-
-  return ledsBuffer[ledsSection];
-}
-
-
-/**
- * Obtiene el valor de todas las secciones de leds.
- * Devuelve el puntero al buffer
- */
-uint8_t * LedsPanel::getValue(void) {
-
-  return ledsBuffer;
-}
+/*
+ * LedsPanel.cpp
+ * Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)
+ */
+
+#include <Arduino.h>
+
+#include "LedsPanel.h"
+#include "Trace.h"
+
+
+/*
+ * Macros para manejo de salidas correspondientes
+ * a los shift registers CD4064
+ */
+#define disableOutput() digitalWrite(enablePin, LOW)
+#define enableOutput() digitalWrite(enablePin, HIGH)
+#define clkPulse() digitalWrite(clkPin, LOW); digitalWrite(clkPin, HIGH)
+
+/*
+ * Seccion de cada grupo de 8 leds de la rueda (led 0: MSB de WHITE)
+ */
+static const uint8_t wheelSections[5] = { WHITE, GREEN, BLUE, RED, YELLOW };
+
+
+/**
+ * Inicializa el modo de los pines (output)
+ * el buffer en cero (todos leds apagados) e inhabilita
+ * la linea de salida de todos los shift registers
+ */
+void LedsPanel::begin(int penablePin, int pclkPin, int pdataPin) {
+
+  enablePin = penablePin;
+  clkPin    = pclkPin;
+  dataPin   = pdataPin;
+
+  pinMode(enablePin, OUTPUT);
+  pinMode(clkPin,    OUTPUT);
+  pinMode(dataPin,   OUTPUT);
+
+  disableOutput();
+
+  beginBuffers();
+
+}
+
+
+/**
+ * Buffer y capas en cero, comun a todas las salidas
+ */
+void LedsPanel::beginBuffers(void) {
+
+  memset(ledsBuffer, 0x00, sizeof(ledsBuffer));
+  memset(frameBuffer, 0x00, sizeof(frameBuffer));
+
+  memset(layerBuffer, 0x00, sizeof(layerBuffer));
+  memset(layerSections, 0x00, sizeof(layerSections));
+  memset(layerBlend, BLEND_NONE, sizeof(layerBlend));
+  layersChanged = 0;
+
+  refreshTimestamp = 0;
+
+#ifdef RULI_ACCOUNTING
+  refreshes = 0;
+#endif
+
+}
+
+
+/**
+ * Establece el estado encendido/apagado de
+ * cada led en funcion de su estado logico
+ * correspondiente en el buffer
+ */
+void LedsPanel::refresh(void) {
+
+  TRACE_SPAN(TRACE_REFRESH);
+
+  flatten(frameBuffer);
+
+  output(frameBuffer);
+
+  refreshTimestamp = micros();
+
+#ifdef RULI_ACCOUNTING
+  refreshes++;
+#endif
+
+}
+
+
+/**
+ * Salida por la cascada de shift registers CD4094
+ */
+void LedsPanel::output(const uint8_t *frame) {
+
+  disableOutput();
+
+ /*
+  * Recorre el buffer de leds desde el final
+  * hacia el principio, en el siguiente orden:
+  * RED, YELLOW, WHITE, GREEN, BLUE, FUNC_INDICATOR
+  */
+  for ( int i = sizeof(ledsBuffer) - 1 ; i >= 0 ; i-- ) {
+   /*
+    * Por cada elemento (seccion de leds) envia cada
+    * uno de sus bits a la cascada de shift registers
+    * comenzando por el bit mas significativo (MSB)
+    */
+    uint8_t mask = 0x80;
+    while(mask > 0) {
+      digitalWrite(dataPin, frame[i] & mask);
+      clkPulse();
+      mask = mask >> 1;
+      mask = mask & B01111111;
+    }
+  }
+
+  enableOutput();
+
+}
+
+
+/**
+ * Copia el buffer en [frame] y aplica sobre cada seccion
+ * las capas activas que la cubren, de la inferior a la superior
+ */
+void LedsPanel::flatten(uint8_t *frame) {
+
+  memcpy(frame, ledsBuffer, sizeof(ledsBuffer));
+
+  layersChanged = 0;
+
+  for ( uint8_t layer = 0 ; layer < LEDS_LAYERS ; layer++ ) {
+
+    uint8_t sections = layerSections[layer];
+    uint8_t *value = layerBuffer[layer];
+
+    if ( sections == 0 || layerBlend[layer] == BLEND_NONE )
+      continue;
+
+    for ( uint8_t i = 0 ; i < sizeof(ledsBuffer) ; i++, sections >>= 1 )
+      if ( sections & 0x01 )
+        switch ( layerBlend[layer] ) {
+          case BLEND_OR   : { frame[i] |= value[i]; break; }
+          case BLEND_AND  : { frame[i] &= value[i]; break; }
+          case BLEND_XOR  : { frame[i] ^= value[i]; break; }
+          case BLEND_MASK : { frame[i] &= ~value[i]; break; }
+          case BLEND_COPY : { frame[i] = value[i]; }
+        }
+  }
+
+}
+
+
+unsigned long LedsPanel::getRefreshTimestamp(void) {
+
+  return refreshTimestamp;
+
+}
+
+
+#ifdef RULI_ACCOUNTING
+uint16_t LedsPanel::getRefreshes(void) {
+
+  uint16_t ret = refreshes;
+
+  refreshes = 0;
+
+  return ret;
+
+}
+
+
+uint16_t LedsPanel::getRefreshPins(void) {
+
+  return LEDS_REFRESH_PINS;
+
+}
+#endif
+
+
+/**
+ * Establece todos los leds apagados.
+ * Limpia el buffer e invoca a funcion refresh()
+ */
+void LedsPanel::clearAll(void) {
+
+  memset(ledsBuffer, 0x00, sizeof(ledsBuffer));
+
+  refresh();
+
+}
+
+
+/**
+ * Establece el valor para una seccion de leds:
+ * FUNC_INDICATOR, BLUE, GREEN, WHITE, YELLOW,RED
+ */
+void LedsPanel::setValue(uint8_t ledsSection, uint8_t value) {
+  setValue(ledsSection,value, 1);
+}
+
+void LedsPanel::setValue(uint8_t ledsSection, uint8_t value, byte doRefresh) {
+
+  ledsBuffer[ledsSection] = value;
+
+  if ( doRefresh )
+    refresh();
+
+}
+
+
+/**
+ * Establece el valor para una seccion de leds:
+ * FUNC_INDICATOR, BLUE, GREEN, WHITE, YELLOW,RED
+ * aplicando el operador OR de bits
+ */
+void LedsPanel::setValueOR(uint8_t ledsSection, uint8_t value) {
+
+  setValueOR(ledsSection, value, 1);
+
+}
+
+void LedsPanel::setValueOR(uint8_t ledsSection, uint8_t value, byte doRefresh) {
+
+  ledsBuffer[ledsSection] |= value;
+
+  if ( doRefresh )
+    refresh();
+
+}
+
+
+/**
+ * Establece el valor para una seccion de leds:
+ * FUNC_INDICATOR, BLUE, GREEN, WHITE, YELLOW,RED
+ * aplicando el operador AND de bits
+ */
+void LedsPanel::setValueAND(uint8_t ledsSection, uint8_t value) {
+
+  setValueAND(ledsSection, value, 1);
+
+}
+
+void LedsPanel::setValueAND(uint8_t ledsSection, uint8_t value, byte doRefresh) {
+
+  ledsBuffer[ledsSection] &= value;
+
+  if ( doRefresh )
+    refresh();
+
+}
+
+
+/**
+ * Establece el valor para las secciones correspondiente a la rueda:
+ * BLUE, GREEN, WHITE, YELLOW,RED
+ */
+void LedsPanel::setWheelValues(uint8_t blue, uint8_t green, uint8_t white, uint8_t yellow, uint8_t red) {
+
+  ledsBuffer[BLUE] = blue;
+  ledsBuffer[GREEN] = green;
+  ledsBuffer[WHITE] = white;
+  ledsBuffer[YELLOW] = yellow;
+  ledsBuffer[RED] = red;
+
+  refresh();
+
+}
+
+
+void LedsPanel::setWheelValues(uint8_t ledNumber, byte value) {
+  setWheelValues( ledNumber, value, 1);
+}
+
+
+void LedsPanel::setWheelValues(uint8_t ledNumber, byte value, byte doRefresh) {
+
+  uint8_t mask;
+  uint8_t section = wheelSection(ledNumber, mask);
+
+  if ( value )
+    ledsBuffer[section] |= mask;
+  else
+    ledsBuffer[section] &= (~mask);
+
+  if ( doRefresh )
+    refresh();
+
+}
+
+
+uint8_t LedsPanel::getWheelNValue(uint8_t ledNumber) {
+
+  uint8_t mask;
+  uint8_t section = wheelSection(ledNumber, mask);
+
+  return ( ledsBuffer[section] & mask ) ? 1 : 0;
+
+}
+
+
+/**
+ * Seccion y mascara del led [ledNumber] de la rueda.
+ * Fuera de rango: mascara nula
+ */
+uint8_t LedsPanel::wheelSection(uint8_t ledNumber, uint8_t &mask) {
+
+  if ( ledNumber >= 40 ) {
+    mask = 0;
+    return WHITE;
+  }
+
+  mask = 0x80 >> (ledNumber & 0x07);
+
+  return wheelSections[ledNumber >> 3];
+
+}
+
+
+/**
+ * Modo de combinacion de la capa [layer] (BLEND_*)
+ * con las inferiores al generar cada cuadro
+ */
+void LedsPanel::setBlend(uint8_t layer, uint8_t blend) {
+
+  if ( layerBlend[layer] != blend && layerSections[layer] )
+    layersChanged = 1;
+
+  layerBlend[layer] = blend;
+
+}
+
+
+void LedsPanel::setLayerValue(uint8_t layer, uint8_t ledsSection, uint8_t value) {
+
+  layerBuffer[layer][ledsSection] = value;
+  layerSections[layer] |= 1 << ledsSection;
+  layersChanged = 1;
+
+}
+
+
+void LedsPanel::setLayerWheelValues(uint8_t layer, uint8_t blue, uint8_t green, uint8_t white, uint8_t yellow, uint8_t red) {
+
+  setLayerValue(layer, BLUE, blue);
+  setLayerValue(layer, GREEN, green);
+  setLayerValue(layer, WHITE, white);
+  setLayerValue(layer, YELLOW, yellow);
+  setLayerValue(layer, RED, red);
+
+}
+
+
+void LedsPanel::setLayerWheelValues(uint8_t layer, uint8_t ledNumber, byte value) {
+
+  uint8_t mask;
+  uint8_t section = wheelSection(ledNumber, mask);
+
+  if ( value )
+    layerBuffer[layer][section] |= mask;
+  else
+    layerBuffer[layer][section] &= (~mask);
+
+  layerSections[layer] |= 1 << section;
+  layersChanged = 1;
+
+}
+
+
+/**
+ * Vacia la capa [layer]: deja de cubrir las secciones,
+ * conserva el modo de combinacion
+ */
+void LedsPanel::clearLayer(uint8_t layer) {
+
+  if ( layerSections[layer] )
+    layersChanged = 1;
+
+  memset(layerBuffer[layer], 0x00, sizeof(layerBuffer[layer]));
+  layerSections[layer] = 0;
+
+}
+
+
+/**
+ * Refresca el panel solo si alguna capa cambio
+ * desde el ultimo cuadro
+ */
+void LedsPanel::update(void) {
+
+  if ( layersChanged )
+    refresh();
+
+}
+
+
+/**
+ * Realiza una rotaci�n o desplazamiento en la rueda
+ * principal de leds. Los argumetos determinan la direccion
+ * (LEFT o RIGHT) y cantidad de posiciones desplazadas
+ */
+
+void LedsPanel::rotate(uint8_t direction) {
+  rotate(direction, 1);
+}
+
+void LedsPanel::rotate(uint8_t direction, uint8_t steps) {
+  rotate(direction, steps, 1);
+}
+
+void LedsPanel::rotate(uint8_t direction, uint8_t steps, byte doRefresh) {
+
+  uint8_t bitSaved;
+
+  // Cada paso desplaza la rueda una posicion
+  for ( ; steps > 0 ; steps-- ) {
+
+    switch(direction) {
+
+      // Rotacion hacia la derecha
+      case RIGHT: {
+
+       /*
+        * Resguarda el bit menos significativo de la
+        * primera seccion (BLUE) de la rueda
+        */
+        bitSaved = ledsBuffer[BLUE] & B00000001;
+        bitSaved <<= 7;
+
+       /*
+        * Realiza la rotacion a derecha
+        * de todas las secciones de la rueda
+        */
+        for ( uint8_t i = BLUE ; i < RED ; i++ ) {
+          ledsBuffer[i] >>= 1;
+          ledsBuffer[i] &= B01111111;
+          ledsBuffer[i] |= (ledsBuffer[i+1]<<7);
+        }
+
+       /*
+        * Setea el valor resguardado en el bit mas significativo
+        * de la ultima seccion (RED) de la rueda
+        */
+        ledsBuffer[RED] >>= 1;
+        ledsBuffer[RED] &= B01111111;
+        ledsBuffer[RED] |= bitSaved;
+
+        break;
+      }
+
+      // Rotacion hacia la izquierda
+      case LEFT: {
+
+       /*
+        * Resguarda el bit mas significativo de la
+        * ultima seccion (RED) de la rueda
+        */
+        bitSaved = ledsBuffer[RED] & B10000000;
+        bitSaved >>= 7;
+
+       /*
+        * Realiza la rotacion a izquierda
+        * de todas las secciones de la rueda
+        */
+        for ( int i = RED ; i > BLUE ; i-- ) {
+          ledsBuffer[i] <<= 1;
+          ledsBuffer[i] &= B11111110;
+          ledsBuffer[i] |= (ledsBuffer[i-1]>>7);
+        }
+
+       /*
+        * Setea el valor resguardado en el bit menos significativo
+        * de la primera seccion (BLUE) de la rueda
+        */
+        ledsBuffer[BLUE] <<= 1;
+        ledsBuffer[BLUE] &= B11111110;
+        ledsBuffer[BLUE] |= bitSaved;
+
+        break;
+      }
+
+    }
+
+  }
+
+  if ( doRefresh )
+    refresh();
+
+}
+
+
+/**
+ * Obtiene el valor de una seccion de leds determinada:
+ * FUNC_INDICATOR, BLUE, GREEN, WHITE, YELLOW,RED
+ */
+uint8_t LedsPanel::getValue(uint8_t ledsSection) {
+
+  return ledsBuffer[ledsSection];
+}
+
+
+/**
+ * Obtiene el valor de todas las secciones de leds.
+ * Devuelve el puntero al buffer
+ */
+uint8_t * LedsPanel::getValue(void) {
+
+  return ledsBuffer;
+}
+
+
+const uint8_t * LedsPanel::getFrame(void) {
+
+  return frameBuffer;
+}
@@ -0,0 +1,279 @@
+/*
+ * LightStream.cpp
+ * Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)
+ */
+
+#include <Arduino.h>
+
+#include "LightStream.h"
+#include "Telemetry.h"
+
+
+void LightStream::begin(LedsPanel *pledsPanel, AudioManager *paudio) {
+
+  ledsPanel = pledsPanel;
+  audio = paudio;
+
+  rxCount = 0;
+  slotHead = 0;
+  slotCount = 0;
+  active = 0;
+
+  frames = 0;
+  dropped = 0;
+  jitterMax = 0;
+
+}
+
+
+byte LightStream::isActive(void) {
+
+  return active;
+
+}
+
+
+uint16_t LightStream::getDropped(void) {
+
+  return dropped;
+
+}
+
+
+void LightStream::flush(void) {
+
+  slotHead = 0;
+  slotCount = 0;
+
+}
+
+
+void LightStream::drop(void) {
+
+  if ( dropped < 0xFFFF )
+    dropped++;
+
+}
+
+
+uint8_t LightStream::receive(void) {
+
+  uint8_t ret = STREAM_IDLE, status, sum, i;
+  int pending;
+
+  /*
+   * Solo se procesan los bytes ya recibidos al comenzar la
+   * pasada, un host rapido no puede retener el lazo principal
+   */
+  pending = Serial.available();
+
+  while ( pending-- > 0 ) {
+
+    rxBuffer[rxCount] = Serial.read();
+
+    if ( rxCount == 0 && rxBuffer[0] != STREAM_SYNC )
+      continue;
+
+    if ( ++rxCount < STREAM_RECORD_SIZE )
+      continue;
+
+    sum = 0;
+    for ( i = 1 ; i < STREAM_RECORD_SIZE ; i++ )
+      sum += rxBuffer[i];
+
+    if ( sum ) {
+
+      /*
+       * Suma de control erronea: se resincroniza a
+       * partir del proximo byte de sincronismo
+       */
+      for ( i = 1 ; i < STREAM_RECORD_SIZE && rxBuffer[i] != STREAM_SYNC ; i++ );
+      rxCount = STREAM_RECORD_SIZE - i;
+      memmove(rxBuffer, &rxBuffer[i], rxCount);
+      continue;
+    }
+
+    rxCount = 0;
+
+    /*
+     * El inicio o fin de un show recibido en la misma
+     * pasada tiene prioridad sobre una solicitud del host
+     */
+    status = record();
+    if ( status == STREAM_EXPORT ? ret == STREAM_IDLE : status != STREAM_IDLE )
+      ret = status;
+  }
+
+  if ( active && (millis() - recordTimestamp) >= STREAM_TIMEOUT_MS ) {
+    active = 0;
+    flush();
+    ret = STREAM_ENDED;
+  }
+
+  return ret;
+
+}
+
+
+/**
+ * Procesa un registro valido recibido en rxBuffer
+ */
+uint8_t LightStream::record(void) {
+
+  uint8_t type = rxBuffer[1], ret = STREAM_IDLE;
+  uint16_t hostMs = rxBuffer[3] | (rxBuffer[4] << 8);
+  unsigned long due;
+
+  // Las solicitudes del host no forman parte del show
+  if ( type == ST_EXPORT )
+    return STREAM_EXPORT;
+
+  recordTimestamp = millis();
+
+  if ( type == ST_END ) {
+    if ( active ) {
+      active = 0;
+      flush();
+      ret = STREAM_ENDED;
+    }
+    return ret;
+  }
+
+  /*
+   * Sin un registro ST_CLOCK previo (host conectado con
+   * el show ya iniciado) se toma como referencia el primero
+   */
+  if ( type == ST_CLOCK || ! active ) {
+
+    if ( ! active )
+      ret = STREAM_STARTED;
+
+    active = 1;
+    startClock(hostMs);
+
+    if ( type == ST_CLOCK )
+      return ret;
+  }
+
+  hostClock += (int16_t) (hostMs - lastHostMs);
+  lastHostMs = hostMs;
+
+  due = hostClock * 1000UL + clockOffset;
+
+  switch ( type ) {
+
+    case ST_FRAME: {
+      // Cuadro que ya no puede mostrarse a tiempo
+      if ( (long) (micros() - due) > STREAM_LATE_MS * 1000L )
+        drop();
+      else
+        enqueue(type, due, &rxBuffer[5]);
+      break;
+    }
+
+    case ST_CUE: {
+      enqueue(type, due, &rxBuffer[5]);
+    }
+  }
+
+  return ret;
+
+}
+
+
+void LightStream::startClock(uint16_t hostMs) {
+
+  hostClock = 0;
+  lastHostMs = hostMs;
+  clockOffset = micros() + STREAM_JITTER_MS * 1000UL;
+
+  flush();
+
+  frames = 0;
+  dropped = 0;
+  jitterMax = 0;
+  statsTimestamp = millis();
+
+}
+
+
+void LightStream::enqueue(uint8_t type, unsigned long due, const uint8_t *data) {
+
+  Slot_t *slot;
+
+  // Cola llena: el host envia por delante de STREAM_JITTER_MS
+  if ( slotCount == STREAM_SLOTS ) {
+    drop();
+    return;
+  }
+
+  slot = &slots[(slotHead + slotCount) % STREAM_SLOTS];
+  slot->type = type;
+  slot->due = due;
+  memcpy(slot->data, data, STREAM_PAYLOAD_SIZE);
+
+  slotCount++;
+
+}
+
+
+byte LightStream::tick(void) {
+
+  unsigned long now = micros();
+  Slot_t *slot, *frame = NULL;
+
+  while ( slotCount ) {
+
+    slot = &slots[slotHead];
+
+    if ( (long) (now - slot->due) < 0 )
+      break;
+
+    if ( slot->type == ST_CUE ) {
+      if ( slot->data[0] <= AUDIO_VOICE ) {
+        if ( slot->data[1] )
+          audio->play(slot->data[0], slot->data[1], slot->data[2]);
+        else
+          audio->stop(slot->data[0]);
+      }
+    }
+    else {
+      // Cuadro vencido reemplazado por otro mas reciente
+      if ( frame )
+        drop();
+      frame = slot;
+    }
+
+    slotHead = (slotHead + 1) % STREAM_SLOTS;
+    slotCount--;
+  }
+
+  /*
+   * El slot liberado no se reutiliza hasta la proxima
+   * llamada a receive(), su contenido sigue siendo valido
+   */
+  if ( frame ) {
+
+    for ( uint8_t i = 0 ; i < STREAM_PAYLOAD_SIZE ; i++ )
+      ledsPanel->setValue(i, frame->data[i], 0);
+    ledsPanel->refresh();
+
+    if ( now - frame->due > jitterMax )
+      jitterMax = now - frame->due;
+
+    frames++;
+  }
+
+  if ( active && millis() - statsTimestamp >= STREAM_STATS_MS ) {
+
+    statsTimestamp = millis();
+
+    TELEMETRY(stream(frames, dropped, jitterMax));
+
+    frames = 0;
+    jitterMax = 0;
+  }
+
+  return frame != NULL;
+
+}
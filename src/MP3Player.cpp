@@ -1,124 +1,234 @@
-/*
- * MP3Player.cpp
- * Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)
- */
-
-#include "SoftwareSerial.h"
-
-/*
- * Header de la biblioteca DFRobotDFPlayerMini
- * que debe ser instalada previamente
- */
-#include <DFRobotDFPlayerMini.h>
-
-#include "MP3Player.h"
-
-/**
- * Inicializa el modo de los pines
- * RX y TX del puerto serie que se utilizara
- * para la comunicacion con el reproductor MP3
- */
-void MP3Player::begin(int rxPin, int txPin) {
-
- /*
-  * Inicializacion del reproductor MP3 con comunicacion
-  * a traves del puerto serie establecido
-  */
-  mp3PlayerSerial = new SoftwareSerial(rxPin, txPin);
-  mp3PlayerSerial->begin(9600);
-  mp3Instance.begin(*mp3PlayerSerial);
-
-  volumeValue = 3;
-  mp3Instance.volume(volumeValue);  //Set volume value. From 0 to 30
-
-}
-
-
-byte MP3Player::finished(void) {
-
-  byte vret = 0;
-
-  if ( mp3Instance.available() )
-    if ( mp3Instance.readType() == DFPlayerPlayFinished )
-      vret = 1;
-
-  return vret;
-
-}
-
-
-uint8_t MP3Player::readType(void) {
-
-  uint8_t vret = 0;
-
-  if ( mp3Instance.available() )
-    vret = mp3Instance.readType();
-
-  return vret;
-
-}
-
-
-
-/**
- * Metodos que simplemente invocan a los
- * propios de la clase DFRobotDFPlayerMini
- * (se puede replantear el codigo utilizando herencia)
- */
-/*** BEGIN ***/
-void MP3Player::play(int track) {
-  mp3Instance.play(track);
-}
-
-void MP3Player::stop(void) {
-  mp3Instance.stop();
-}
-
-void MP3Player::playFolder(uint8_t folderNumber, uint8_t fileNumber) {
-  mp3Instance.playFolder(folderNumber, fileNumber);
-}
-
-void MP3Player::next(void) {
-  mp3Instance.next();
-}
-
-void MP3Player::previous(void) {
-  mp3Instance.previous();
-}
-
-void MP3Player::volume(uint8_t value) {
-  volumeValue = value;
-  mp3Instance.volume(value);
-}
-
-void MP3Player::volumeDown(void) {
-  if ( volumeValue > 2 ) {
-    volumeValue--;
-    mp3Instance.volumeDown();
-  }
-}
-
-void MP3Player::volumeUp(void) {
-  if ( volumeValue < 30 ) {
-    volumeValue++;
-    mp3Instance.volumeUp();
-  }
-}
-
-uint16_t MP3Player::getVolume(void) {
-  return volumeValue;
-}
-
-uint16_t MP3Player::read(void) {
-  return mp3Instance.read();
-}
-
-void MP3Player::enableLoop(void) {
-  mp3Instance.enableLoop();
-}
-
-void MP3Player::disableLoop(void) {
-  mp3Instance.disableLoop();
-}
-
-/*** END ***/
+/*
+ * MP3Player.cpp
+ * Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)
+ */
+
+#include "SoftwareSerial.h"
+
+/*
+ * Header de la biblioteca DFRobotDFPlayerMini
+ * que debe ser instalada previamente
+ */
+#include <DFRobotDFPlayerMini.h>
+
+#include "MP3Player.h"
+#include "Telemetry.h"
+#include "Trace.h"
+
+/*
+ * Codigos de comando del protocolo DFPlayer,
+ * utilizados solamente para telemetria
+ */
+#define DF_NEXT        0x01
+#define DF_PREVIOUS    0x02
+#define DF_PLAY        0x03
+#define DF_VOLUME      0x06
+#define DF_PLAY_FOLDER 0x0F
+#define DF_STOP        0x16
+#define DF_LOOP        0x19
+
+/*
+ * Trama del protocolo DFPlayer: inicio, version, largo, comando,
+ * respuesta, parametro (2), suma (2) y fin
+ */
+#define DF_FRAME_BYTES 10
+
+#ifdef RULI_ACCOUNTING
+#define COUNT_FRAME() serialBytes += DF_FRAME_BYTES
+#else
+#define COUNT_FRAME()
+#endif
+
+/**
+ * Inicializa el modo de los pines
+ * RX y TX del puerto serie que se utilizara
+ * para la comunicacion con el reproductor MP3
+ */
+void MP3Player::begin(int rxPin, int txPin) {
+
+ /*
+  * Inicializacion del reproductor MP3 con comunicacion
+  * a traves del puerto serie establecido
+  */
+  mp3PlayerSerial = new SoftwareSerial(rxPin, txPin);
+  mp3PlayerSerial->begin(9600);
+
+  commandTimestamp = 0;
+
+#ifdef RULI_ACCOUNTING
+  serialBytes = 0;
+#endif
+
+  volumeValue = 3;
+  outputValue = volumeValue;
+
+#ifdef RULI_WARM_BOOT
+ /*
+  * Sin reinicio del modulo: begin() con reinicio espera su respuesta
+  * hasta 2,2 s. AudioManager retiene los comandos hasta que el
+  * reproductor esta listo y entonces envia el volumen
+  */
+  mp3Instance.begin(*mp3PlayerSerial, true, false);
+#else
+  mp3Instance.begin(*mp3PlayerSerial);
+  mp3Instance.volume(volumeValue);  //Set volume value. From 0 to 30
+  COUNT_FRAME();  // reinicio
+  COUNT_FRAME();
+#endif
+
+}
+
+
+byte MP3Player::finished(void) {
+
+  byte vret = 0;
+
+  TRACE_SPAN(TRACE_MP3_READ);
+
+  if ( mp3Instance.available() ) {
+    uint8_t type = mp3Instance.readType();
+    TELEMETRY(mp3Response(type, mp3Instance.read()));
+    if ( type == DFPlayerPlayFinished )
+      vret = 1;
+  }
+
+  return vret;
+
+}
+
+
+uint8_t MP3Player::readType(void) {
+
+  uint8_t vret = 0;
+
+  TRACE_SPAN(TRACE_MP3_READ);
+
+  if ( mp3Instance.available() ) {
+    vret = mp3Instance.readType();
+    TELEMETRY(mp3Response(vret, mp3Instance.read()));
+  }
+
+  return vret;
+
+}
+
+
+
+/**
+ * Metodos que simplemente invocan a los
+ * propios de la clase DFRobotDFPlayerMini
+ * (se puede replantear el codigo utilizando herencia)
+ */
+/*** BEGIN ***/
+void MP3Player::play(int track) {
+  TRACE_SPAN(TRACE_MP3_PLAY);
+  mp3Instance.play(track);
+  COUNT_FRAME();
+  TELEMETRY(mp3Command(DF_PLAY, track));
+}
+
+void MP3Player::stop(void) {
+  TRACE_SPAN(TRACE_MP3_STOP);
+  mp3Instance.stop();
+  COUNT_FRAME();
+  TELEMETRY(mp3Command(DF_STOP, 0));
+}
+
+void MP3Player::playFolder(uint8_t folderNumber, uint8_t fileNumber) {
+  TRACE_SPAN(TRACE_MP3_PLAY);
+  mp3Instance.playFolder(folderNumber, fileNumber);
+  COUNT_FRAME();
+  TELEMETRY(mp3Command(DF_PLAY_FOLDER, (folderNumber << 8) | fileNumber));
+  /*
+   * SoftwareSerial transmite en forma bloqueante, al retornar
+   * el ultimo byte de la trama ya salio por el pin TX
+   */
+  commandTimestamp = micros();
+}
+
+void MP3Player::next(void) {
+  TRACE_SPAN(TRACE_MP3_COMMAND);
+  mp3Instance.next();
+  COUNT_FRAME();
+  TELEMETRY(mp3Command(DF_NEXT, 0));
+}
+
+void MP3Player::previous(void) {
+  TRACE_SPAN(TRACE_MP3_COMMAND);
+  mp3Instance.previous();
+  COUNT_FRAME();
+  TELEMETRY(mp3Command(DF_PREVIOUS, 0));
+}
+
+void MP3Player::volume(uint8_t value) {
+  volumeValue = value;
+  outputVolume(value);
+}
+
+void MP3Player::outputVolume(uint8_t value) {
+  TRACE_SPAN(TRACE_MP3_VOLUME);
+  outputValue = value;
+  mp3Instance.volume(value);
+  COUNT_FRAME();
+  TELEMETRY(mp3Command(DF_VOLUME, value));
+}
+
+/*
+ * Los ajustes del nivel configurado no se envian: AudioManager
+ * envia el volumen absoluto respetando la separacion entre
+ * comandos, con giros rapidos los comandos directos llegaban
+ * con el reproductor ocupado y se perdian
+ */
+void MP3Player::volumeDown(void) {
+  if ( volumeValue > 2 )
+    volumeValue--;
+}
+
+void MP3Player::volumeUp(void) {
+  if ( volumeValue < 30 )
+    volumeValue++;
+}
+
+void MP3Player::setVolume(uint8_t value) {
+  volumeValue = value;
+}
+
+uint16_t MP3Player::getVolume(void) {
+  return volumeValue;
+}
+
+uint8_t MP3Player::getOutputVolume(void) {
+  return outputValue;
+}
+
+unsigned long MP3Player::getCommandTimestamp(void) {
+  return commandTimestamp;
+}
+
+#ifdef RULI_ACCOUNTING
+uint16_t MP3Player::getSerialBytes(void) {
+  uint16_t ret = serialBytes;
+  serialBytes = 0;
+  return ret;
+}
+#endif
+
+uint16_t MP3Player::read(void) {
+  return mp3Instance.read();
+}
+
+void MP3Player::enableLoop(void) {
+  TRACE_SPAN(TRACE_MP3_COMMAND);
+  mp3Instance.enableLoop();
+  COUNT_FRAME();
+  TELEMETRY(mp3Command(DF_LOOP, 0));
+}
+
+void MP3Player::disableLoop(void) {
+  TRACE_SPAN(TRACE_MP3_COMMAND);
+  mp3Instance.disableLoop();
+  COUNT_FRAME();
+  TELEMETRY(mp3Command(DF_LOOP, 1));
+}
+
+/*** END ***/
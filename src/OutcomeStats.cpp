@@ -0,0 +1,330 @@
+/*
+ * OutcomeStats.cpp
+ * Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)
+ */
+
+#include <Arduino.h>
+#include <EEPROM.h>
+#include <avr/eeprom.h>
+
+#include "OutcomeStats.h"
+#include "Telemetry.h"
+
+
+// 'O': formato previo, sin epocas (se vuelve a formatear)
+#define OUTCOME_KEY        'o'
+#define TOTALS_SIZE        (OUTCOME_COUNTERS * 2)
+
+/*
+ * Etapas del mantenimiento de la region. Las tres primeras
+ * se guardan en el byte de estado junto con la epoca
+ */
+#define PHASE_LOGGING   0 // escritura de resultados en el registro
+#define PHASE_FOLD      1 // suma del registro a los totales
+#define PHASE_ERASE     2 // borrado del registro
+#define PHASE_CLEAR     3 // formateo de la region
+
+#define EPOCH           0x80
+
+// Estado y totales, a continuacion de la clave
+#define STATE_OFFSET    1
+#define TOTALS_OFFSET   2
+
+
+void OutcomeStats::begin(uint16_t address, uint16_t size) {
+
+  uint8_t state;
+
+  baseAddress = address;
+  logAddress = address + TOTALS_OFFSET + TOTALS_SIZE;
+
+  // Menos de 128 posiciones: a lo sumo un acarreo por suma (ver foldTotal())
+  logSize = size - TOTALS_OFFSET - TOTALS_SIZE;
+
+  pendingHead = 0;
+  pendingCount = 0;
+  lost = 0;
+  exportIndex = OUTCOME_COUNTERS;
+
+#ifdef RULI_ACCOUNTING
+  writes = 0;
+#endif
+
+  state = EEPROM.read(baseAddress + STATE_OFFSET);
+  phase = state & ~EPOCH;
+  epoch = state & EPOCH;
+  cursor = 0;
+  step = 0;
+
+  /*
+   * Region sin formato: se formatea de a un
+   * byte por pasada, la clave se escribe al final
+   */
+  if ( EEPROM.read(baseAddress) != OUTCOME_KEY || phase > PHASE_ERASE ) {
+    phase = PHASE_CLEAR;
+    epoch = 0;
+    logPosition = 0;
+    return;
+  }
+
+  /*
+   * Corte de energia durante la suma o el borrado: se retoman
+   * desde el inicio, los totales ya sumados tienen la epoca
+   * actual y las posiciones ya borradas no se reescriben
+   */
+  if ( phase != PHASE_LOGGING ) {
+    logPosition = logSize;
+    return;
+  }
+
+  for ( logPosition = 0 ; logPosition < logSize ; logPosition++ )
+    if ( EEPROM.read(logAddress + logPosition) == OUTCOME_EMPTY )
+      break;
+
+}
+
+
+void OutcomeStats::count(uint8_t mode, uint8_t led) {
+
+  if ( pendingCount == OUTCOME_PENDING ) {
+    lost++;
+    return;
+  }
+
+  pending[(pendingHead + pendingCount) % OUTCOME_PENDING] = mode * OUTCOME_LEDS + led;
+  pendingCount++;
+
+}
+
+
+uint16_t OutcomeStats::getLost(void) {
+
+  return lost;
+
+}
+
+
+#ifdef RULI_ACCOUNTING
+uint16_t OutcomeStats::getWrites(void) {
+
+  uint16_t ret = writes;
+
+  writes = 0;
+
+  return ret;
+
+}
+#endif
+
+
+// EEPROM.update(), contando los bytes modificados
+void OutcomeStats::write(uint16_t address, uint8_t value) {
+
+#ifdef RULI_ACCOUNTING
+  if ( EEPROM.read(address) != value )
+    writes++;
+#endif
+
+  EEPROM.update(address, value);
+
+}
+
+
+void OutcomeStats::setState(uint8_t state) {
+
+  write(baseAddress + STATE_OFFSET, state | epoch);
+  phase = state;
+
+}
+
+
+uint16_t OutcomeStats::readTotal(uint8_t counter) {
+
+  uint16_t address = baseAddress + TOTALS_OFFSET + counter * 2;
+
+  return (EEPROM.read(address) & ~EPOCH) | ((EEPROM.read(address + 1) & ~EPOCH) << 7);
+
+}
+
+
+/**
+ * Total del contador [counter] sumado el registro, a partir
+ * de la epoca de cada byte: ya sumado, sin sumar o con solo
+ * el byte bajo escrito. En este ultimo caso el byte alto
+ * aun es el previo y el acarreo se produjo si el nuevo byte
+ * bajo es menor que los resultados del registro
+ */
+uint16_t OutcomeStats::foldTotal(uint8_t counter) {
+
+  uint16_t address = baseAddress + TOTALS_OFFSET + counter * 2;
+  uint8_t low = EEPROM.read(address);
+  uint8_t high = EEPROM.read(address + 1);
+  uint8_t occurrences;
+  unsigned long total;
+
+  if ( (high & EPOCH) == epoch )
+    return readTotal(counter);
+
+  occurrences = logOccurrences(counter);
+
+  if ( (low & EPOCH) == epoch ) {
+    low &= ~EPOCH;
+    high &= ~EPOCH;
+    if ( low < occurrences )
+      high++;
+    return low | (high << 7);
+  }
+
+  total = readTotal(counter) + occurrences;
+
+  return total > OUTCOME_MAX ? OUTCOME_MAX : total;
+
+}
+
+
+uint8_t OutcomeStats::logOccurrences(uint8_t counter) {
+
+  uint8_t n = 0;
+
+  for ( uint8_t i = 0 ; i < logPosition ; i++ )
+    if ( EEPROM.read(logAddress + i) == counter )
+      n++;
+
+  return n;
+
+}
+
+
+uint16_t OutcomeStats::get(uint8_t mode, uint8_t led) {
+
+  uint8_t counter = mode * OUTCOME_LEDS + led;
+  unsigned long total;
+
+  if ( phase == PHASE_CLEAR )
+    return 0;
+
+  if ( phase == PHASE_FOLD )
+    total = foldTotal(counter);
+  else
+    total = readTotal(counter);
+
+  // El registro aun no fue sumado
+  if ( phase == PHASE_LOGGING )
+    total += logOccurrences(counter);
+
+  for ( uint8_t i = 0 ; i < pendingCount ; i++ )
+    if ( pending[(pendingHead + i) % OUTCOME_PENDING] == counter )
+      total++;
+
+  return total > 0xFFFF ? 0xFFFF : total;
+
+}
+
+
+void OutcomeStats::exportAll(void) {
+
+  exportIndex = 0;
+
+}
+
+
+void OutcomeStats::update(void) {
+
+#ifdef RULI_TELEMETRY
+  if ( exportIndex < OUTCOME_COUNTERS && telemetry.ready() ) {
+    telemetry.outcomes(exportIndex / OUTCOME_LEDS, exportIndex % OUTCOME_LEDS,
+      get(exportIndex / OUTCOME_LEDS, exportIndex % OUTCOME_LEDS),
+      get(exportIndex / OUTCOME_LEDS, exportIndex % OUTCOME_LEDS + 1));
+    exportIndex += 2;
+  }
+#endif
+
+  /*
+   * write() no escribe los bytes sin cambios, en ese
+   * caso la EEPROM sigue libre y se avanza en la proxima pasada
+   */
+  if ( ! eeprom_is_ready() )
+    return;
+
+  switch ( phase ) {
+
+    case PHASE_LOGGING: {
+
+      if ( pendingCount == 0 )
+        break;
+
+      // Registro completo: comienza la suma con la nueva epoca
+      if ( logPosition == logSize ) {
+        epoch ^= EPOCH;
+        setState(PHASE_FOLD);
+        cursor = 0;
+        step = 0;
+        break;
+      }
+
+      write(logAddress + logPosition, pending[pendingHead]);
+      logPosition++;
+      pendingHead = (pendingHead + 1) % OUTCOME_PENDING;
+      pendingCount--;
+      break;
+    }
+
+    /*
+     * Cada contador se reescribe con la nueva epoca en dos
+     * pasadas: la parte baja con el nuevo total calculado y
+     * luego la alta. Los ya sumados antes de un corte de
+     * energia no se modifican (update())
+     */
+    case PHASE_FOLD: {
+
+      uint16_t address = baseAddress + TOTALS_OFFSET + cursor * 2;
+
+      if ( cursor == OUTCOME_COUNTERS ) {
+        setState(PHASE_ERASE);
+        cursor = 0;
+      }
+      else if ( step == 0 ) {
+        foldValue = foldTotal(cursor);
+        write(address, (foldValue & 0x7F) | epoch);
+        step = 1;
+      }
+      else {
+        write(address + 1, (foldValue >> 7) | epoch);
+        step = 0;
+        cursor++;
+      }
+
+      break;
+    }
+
+    case PHASE_ERASE: {
+
+      if ( cursor == logSize ) {
+        setState(PHASE_LOGGING);
+        logPosition = 0;
+        break;
+      }
+
+      write(logAddress + cursor, OUTCOME_EMPTY);
+      cursor++;
+      break;
+    }
+
+    case PHASE_CLEAR: {
+
+      // Estado PHASE_LOGGING y totales en 0, ambos de la epoca 0
+      if ( cursor < 1 + TOTALS_SIZE )
+        write(baseAddress + STATE_OFFSET + cursor, 0x00);
+      else if ( cursor < 1 + TOTALS_SIZE + logSize )
+        write(baseAddress + STATE_OFFSET + cursor, OUTCOME_EMPTY);
+      else {
+        write(baseAddress, OUTCOME_KEY);
+        phase = PHASE_LOGGING;
+        break;
+      }
+
+      cursor++;
+    }
+  }
+
+}
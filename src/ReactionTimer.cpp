@@ -0,0 +1,241 @@
+/*
+ * ReactionTimer.cpp
+ * Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)
+ */
+
+#include <Arduino.h>
+#include <avr/interrupt.h>
+
+#include "ReactionTimer.h"
+
+
+/*
+ * Parte alta (desbordes) del contador de Timer1, primer flanco
+ * de la ultima rafaga y ultimo flanco capturado, en ticks
+ */
+static volatile uint16_t timer1Overflows = 0;
+static volatile unsigned long captureTicks = 0;
+static volatile unsigned long edgeTicks = 0;
+
+// Duracion maxima de las rafagas de rebote (ticks)
+static volatile uint16_t bounceTicks = 0;
+
+// Ultimo tiempo de reaccion medido (us)
+static unsigned long lastScore = 0;
+
+
+ISR(TIMER1_OVF_vect) {
+
+  timer1Overflows++;
+
+}
+
+
+ISR(TIMER1_CAPT_vect) {
+
+  uint16_t captured = ICR1;
+  uint16_t overflows = timer1Overflows;
+
+  /*
+   * Si hay un desborde pendiente de atender y la captura
+   * es posterior al mismo, corresponde al siguiente periodo
+   */
+  if ( (TIFR1 & _BV(TOV1)) && captured < 0x8000 )
+    overflows++;
+
+  unsigned long edge = ((unsigned long) overflows << 16) | captured;
+
+  /*
+   * Un flanco cercano al anterior es rebote del mismo paso:
+   * la captura conserva el primero de la rafaga
+   */
+  if ( edge - edgeTicks > REACTION_BOUNCE_US * 2UL )
+    captureTicks = edge;
+  else if ( edge - captureTicks > bounceTicks )
+    bounceTicks = ( edge - captureTicks > 0xFFFF ) ? 0xFFFF : edge - captureTicks;
+
+  edgeTicks = edge;
+
+}
+
+
+void ReactionTimer::begin(uint8_t clkPin) {
+
+  uint8_t oldSREG = SREG;
+
+  latchTicks = 0;
+  turnTicks = 0;
+  latchDelayMin = 0xFFFF;
+  latchDelayMax = 0;
+  bestScore = 0;
+  scoresCount = 0;
+  scoresNext = 0;
+
+  cli();
+
+  /*
+   * Comparador analogico: AIN0 = referencia de 1.1V (ACBG),
+   * AIN1 = canal del ADC del pin CLK (ACME, ADC apagado).
+   * La salida pasa a 1 cuando CLK cae por debajo de 1.1V
+   * y dispara la captura de Timer1 (ACIC)
+   */
+  ADCSRA &= ~_BV(ADEN);
+  ADCSRB |= _BV(ACME);
+  ADMUX = (ADMUX & 0xF0) | ((clkPin - A0) & 0x07);
+  ACSR = _BV(ACBG) | _BV(ACIC);
+
+  /*
+   * Timer1 en modo normal, prescaler 8, captura en flanco
+   * ascendente de la salida del comparador con filtro de ruido
+   */
+  TCCR1A = 0;
+  TCCR1B = _BV(ICNC1) | _BV(ICES1) | _BV(CS11);
+  TCNT1 = 0;
+  TIFR1 = _BV(ICF1) | _BV(TOV1);
+  TIMSK1 = _BV(ICIE1) | _BV(TOIE1);
+
+  timer1Overflows = 0;
+  captureTicks = 0;
+  edgeTicks = 0;
+  bounceTicks = 0;
+
+  SREG = oldSREG;
+
+}
+
+
+unsigned long ReactionTimer::ticks(void) {
+
+  uint8_t oldSREG = SREG;
+  uint16_t low, overflows;
+
+  cli();
+
+  low = TCNT1;
+  overflows = timer1Overflows;
+
+  if ( (TIFR1 & _BV(TOV1)) && low < 0x8000 )
+    overflows++;
+
+  SREG = oldSREG;
+
+  return ((unsigned long) overflows << 16) | low;
+
+}
+
+
+void ReactionTimer::start(unsigned long latchMicros) {
+
+  unsigned long now = ticks();
+  unsigned long delay = micros() - latchMicros;
+
+  if ( delay > 0xFFFF )
+    delay = 0xFFFF;
+
+  if ( delay < latchDelayMin )
+    latchDelayMin = delay;
+
+  if ( delay > latchDelayMax )
+    latchDelayMax = delay;
+
+  latchTicks = now - (delay << 1);
+
+}
+
+
+void ReactionTimer::turn(void) {
+
+  uint8_t oldSREG = SREG;
+
+  cli();
+  turnTicks = captureTicks;
+  SREG = oldSREG;
+
+}
+
+
+uint8_t ReactionTimer::stop(void) {
+
+  uint16_t score;
+  uint8_t rank = 1;
+
+  // Flanco previo al latch: no corresponde a esta medicion
+  if ( (long) (turnTicks - latchTicks) < 0 )
+    return 0;
+
+  lastScore = (turnTicks - latchTicks) >> 1;
+
+  if ( scoresCount == 0 || lastScore < bestScore )
+    bestScore = lastScore;
+
+  score = ( lastScore / 100 > 0xFFFF ) ? 0xFFFF : lastScore / 100;
+
+  scores[scoresNext] = score;
+  scoresNext = (scoresNext + 1) % REACTION_SCORES;
+
+  if ( scoresCount < REACTION_SCORES )
+    scoresCount++;
+
+  // Ranking entre los tiempos conservados de la sesion
+  for ( uint8_t i = 0 ; i < scoresCount ; i++ )
+    if ( scores[i] < score )
+      rank++;
+
+  return rank;
+
+}
+
+
+unsigned long ReactionTimer::getLast(void) {
+  return lastScore;
+}
+
+unsigned long ReactionTimer::getBest(void) {
+  return bestScore;
+}
+
+uint8_t ReactionTimer::getCount(void) {
+  return scoresCount;
+}
+
+uint16_t ReactionTimer::getLatchDelayMin(void) {
+  return latchDelayMin;
+}
+
+uint16_t ReactionTimer::getLatchDelayMax(void) {
+  return latchDelayMax;
+}
+
+uint16_t ReactionTimer::getBounceMax(void) {
+
+  uint8_t oldSREG = SREG;
+  uint16_t bounce;
+
+  cli();
+  bounce = bounceTicks;
+  SREG = oldSREG;
+
+  return bounce >> 1;
+
+}
+
+
+unsigned long ReactionTimer::getMedian(void) {
+
+  uint16_t sorted[REACTION_SCORES], aux;
+
+  if ( scoresCount == 0 )
+    return 0;
+
+  memcpy(sorted, scores, sizeof(sorted));
+
+  for ( uint8_t i = 1 ; i < scoresCount ; i++ )
+    for ( uint8_t j = i ; j > 0 && sorted[j - 1] > sorted[j] ; j-- ) {
+      aux = sorted[j];
+      sorted[j] = sorted[j - 1];
+      sorted[j - 1] = aux;
+    }
+
+  return (unsigned long) sorted[scoresCount / 2] * 100;
+
+}
@@ -0,0 +1,124 @@
+/*
+ * RgbLedsPanel.cpp
+ * Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)
+ */
+
+#include <Arduino.h>
+
+#include "RgbLedsPanel.h"
+
+
+/*
+ * Colores por omision (R, G, B): apagado y los leds de cada
+ * seccion del panel original, FUNC_INDICATOR a RED. Intensidad
+ * reducida: 48 leds a pleno blanco superan los 2A
+ */
+static const uint8_t defaultColors[7][3] PROGMEM = {
+  {  0,  0,  0 }, // RGB_OFF
+  {  0, 48,  0 }, // FUNC_INDICATOR
+  {  0,  0, 64 }, // BLUE
+  {  0, 64,  0 }, // GREEN
+  { 40, 40, 40 }, // WHITE
+  { 56, 40,  0 }, // YELLOW
+  { 64,  0,  0 }  // RED
+};
+
+
+void RgbLedsPanel::begin(void) {
+
+  beginBuffers();
+
+  beginPalette();
+
+}
+
+
+void RgbLedsPanel::beginPalette(void) {
+
+  memset(palette, 0x00, sizeof(palette));
+  memset(pixels, 0x00, sizeof(pixels));
+
+  for ( uint8_t i = 0 ; i < 7 ; i++ )
+    setColor(i, pgm_read_byte(&defaultColors[i][0]), pgm_read_byte(&defaultColors[i][1]),
+      pgm_read_byte(&defaultColors[i][2]));
+
+  for ( uint8_t section = FUNC_INDICATOR ; section <= RED ; section++ )
+    sectionColors[section] = section + 1;
+
+}
+
+
+/**
+ * Indice de color de cada pixel: el de su seccion si el bit
+ * correspondiente esta encendido en [frame], RGB_OFF si no
+ */
+void RgbLedsPanel::render(const uint8_t *frame) {
+
+  uint8_t section, mask, index;
+
+  for ( uint8_t pixel = 0 ; pixel < RGB_PIXELS ; pixel++ ) {
+
+    if ( pixel < RGB_WHEEL_PIXELS )
+      section = wheelSection(pixel, mask);
+    else {
+      section = FUNC_INDICATOR;
+      mask = 0x80 >> (pixel - RGB_WHEEL_PIXELS);
+    }
+
+    index = ( frame[section] & mask ) ? sectionColors[section] : RGB_OFF;
+
+    if ( pixel & 0x01 )
+      pixels[pixel >> 1] = (pixels[pixel >> 1] & 0x0F) | (index << 4);
+    else
+      pixels[pixel >> 1] = (pixels[pixel >> 1] & 0xF0) | index;
+  }
+
+}
+
+
+void RgbLedsPanel::setColor(uint8_t index, uint8_t red, uint8_t green, uint8_t blue) {
+
+  if ( index >= RGB_COLORS )
+    return;
+
+  palette[index][0] = green;
+  palette[index][1] = red;
+  palette[index][2] = blue;
+
+}
+
+
+void RgbLedsPanel::setSectionColor(uint8_t ledsSection, uint8_t index) {
+
+  if ( ledsSection > RED || index >= RGB_COLORS )
+    return;
+
+  sectionColors[ledsSection] = index;
+
+}
+
+
+uint8_t RgbLedsPanel::getPixel(uint8_t pixel) {
+
+  if ( pixel >= RGB_PIXELS )
+    return RGB_OFF;
+
+  return ( pixel & 0x01 ) ? pixels[pixel >> 1] >> 4 : pixels[pixel >> 1] & 0x0F;
+
+}
+
+
+const uint8_t * RgbLedsPanel::getColor(uint8_t index) {
+
+  return palette[index < RGB_COLORS ? index : RGB_OFF];
+
+}
+
+
+#ifdef RULI_ACCOUNTING
+uint16_t RgbLedsPanel::getRefreshPins(void) {
+
+  return RGB_REFRESH_PINS;
+
+}
+#endif
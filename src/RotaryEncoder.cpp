@@ -6,6 +6,17 @@
 #include <Arduino.h>
 
 #include "RotaryEncoder.h"
+#include "EncoderBank.h"
+
+
+/*
+ * Estados del reconocimiento de gestos
+ */
+#define GESTURE_IDLE          0
+#define GESTURE_PRESSED       1 // Presionado, aun sin alcanzar la retencion
+#define GESTURE_HELD          2 // Retenido (SWITCH_HELD ya informado)
+#define GESTURE_RELEASED      3 // Liberado, esperando un segundo click
+#define GESTURE_SECOND_PRESS  4 // Segundo click presionado
 
 
 /**
@@ -27,6 +38,23 @@ void RotaryEncoder::begin(uint8_t pclkPin, uint8_t pdataPin, uint8_t pswitchPin)
   lastClkPinLevel = digitalRead(clkPin);
 
   switchTimestamp = 0;
+  eventTimestamp = 0;
+
+  rawSwitchLevel = 1;
+  switchLevel = 1;
+  rawTimestamp = 0;
+  gestureState = GESTURE_IDLE;
+  gestureTimestamp = 0;
+  repeatPeriod = GESTURE_REPEAT_US;
+  doubleClickWindow = 0;
+  repeatEnabled = 0;
+
+  accelerationCurve = NULL;
+  lastTurn = NONE;
+  turnInterval = ACCELERATION_RESET_MS;
+  turnSteps = 1;
+
+  bank = NULL;
 
   savedEvent = NONE;
 
@@ -40,78 +68,297 @@ void RotaryEncoder::begin(uint8_t pclkPin, uint8_t pdataPin) {
 }
 
 
+void RotaryEncoder::attach(EncoderBank *pbank) {
+
+  bankIndex = pbank->add(clkPin, dataPin, switchPin);
+
+  if ( bankIndex != ENCODER_BANK_FULL )
+    bank = pbank;
+
+}
+
+
 uint8_t RotaryEncoder::getEvent() {
 
+  uint8_t clkPinLevel, switchPinLevel, turn, event;
+
+  // Setea la accion "ninguna" por defecto
+  event = NONE;
+
+  if ( bank ) {
+
+    /*
+     * Asociado a un banco, el giro ya fue decodificado
+     * junto con el resto de los encoders del puerto
+     */
+    turn = bank->getTurn(bankIndex);
+
+    if ( turn != NONE ) {
+      accelerationCheck(turn, bank->getSampleTimestamp());
+      savedEvent = turn;
+    }
+
+    switchPinLevel = bank->getSwitchLevel(bankIndex);
+
+  }
+  else {
+
+    // Lee el nivel del pin CLK
+    clkPinLevel = digitalRead(clkPin);
+
+    // Detecta el flanco de bajada en el pin CLK
+    if ( clkPinLevel == 0 && lastClkPinLevel == 1 )
+      turnCheck(digitalRead(dataPin));
+
+    lastClkPinLevel = clkPinLevel;
+
+    switchPinLevel = ( switchPin != 0 ) ? digitalRead(switchPin) : 1;
+
+  }
+
   /*
-   * Limite de tiempo en milisegundos utilizado
-   * para determinar si el switch es retenido
+   * Mismos pasos que eventCheck(), en linea: el banco es el
+   * camino del firmware y no suma la llamada
    */
-  #define HELDED_LIMIT 700
+  if ( switchPin != 0 )
+    event = gestureCheck(switchPinLevel);
 
   /*
-   * Almacenara el timestamp (milis()) del momento
-   * en que se presiona el switch a fin de determinar
-   * si la accion sera click o retencion
+   * Los giros producidos con el pulsador
+   * presionado se descartan
    */
-  //static unsigned long switchTimestamp = 0;
+  if ( switchLevel == 0 )
+    savedEvent = NONE;
+
+  if ( event == NONE ) {
+    event = savedEvent;
+    savedEvent = NONE;
+  }
+
+  return event;
+
+}
+
+
+void RotaryEncoder::turnCheck(uint8_t dataPinLevel) {
 
   /*
-   * Almacenara la ultima accion sucedida.
-   * Se utiliza para derterminar el evento del switch
-   * ya que el mismo se retorna al liberarlo y podra ser
-   * click o retencion, de acuerdo al tiempo
+   * Si el nivel en el pin DATA es
+   * alto indica que esta girando
+   * hacia la izquierda (antihorario)
+   *
    */
-  //static uint8_t savedEvent = NONE;
+  if ( dataPinLevel == 1 )
+    savedEvent = LEFT_TURN;
+  else // caso contrario es hacia la derecha (horario)
+    savedEvent = RIGHT_TURN;
 
-  //unsigned long currTimestamp;
-  uint8_t clkPinLevel, event;
+  accelerationCheck(savedEvent, micros());
 
-  // Setea la accion "ninguna" por defecto
-  event = NONE;
+}
 
-  // Lee el nivel del pin CLK
-  clkPinLevel = digitalRead(clkPin);
 
-  // Detecta el flanco de bajada en el pin CLK
-  if ( clkPinLevel == 0 && lastClkPinLevel == 1 ) {
-    /*
-     * Si el nivel en el pin DATA es
-     * alto indica que esta girando
-     * hacia la izquierda (antihorario)
-     *
-     */
-    if ( digitalRead(dataPin) == 1 )
-      savedEvent = LEFT_TURN;
-    else // caso contrario es hacia la derecha (horario)
-      savedEvent = RIGHT_TURN;
+/**
+ * Evento a informar a partir del nivel del pulsador: el gesto
+ * tiene prioridad sobre el giro pendiente, que se descarta
+ * con el pulsador presionado (ver FastRotaryEncoder)
+ */
+uint8_t RotaryEncoder::eventCheck(uint8_t switchPinLevel) {
+
+  uint8_t event = NONE;
+
+  if ( switchPin != 0 )
+    event = gestureCheck(switchPinLevel);
+
+  if ( switchLevel == 0 )
+    savedEvent = NONE;
+
+  if ( event == NONE ) {
+    event = savedEvent;
+    savedEvent = NONE;
   }
 
-  lastClkPinLevel = clkPinLevel;
+  return event;
 
-  if ( switchPin != 0 && !digitalRead(switchPin) ) {
+}
 
-    /*
-     * En principio se establece que
-     * la accion sera CLICK
-     */
-    savedEvent = SWITCH_CLICK;
 
-    /*
-     * Luego, si el tiempo de retencion supero
-     * el limite HELDED_LIMIT, se determina
-     * que la accion debera ser retencion
-     *
-     */
-    if ( (millis() - switchTimestamp) > HELDED_LIMIT )
-      savedEvent = SWITCH_HELD;
+/**
+ * Actualiza el timestamp del giro y las posiciones a avanzar.
+ * A partir del tercer detent el intervalo se promedia con el
+ * anterior para suavizar la curva; un cambio de sentido o una
+ * pausa de ACCELERATION_RESET_MS reinician la aceleracion
+ */
+void RotaryEncoder::accelerationCheck(uint8_t turn, unsigned long timestamp) {
 
+  unsigned long elapsed = (timestamp - eventTimestamp) / 1000;
+  uint8_t intervalMs;
+  const Acceleration_t *segment;
+
+  eventTimestamp = timestamp;
+
+  if ( turn != lastTurn || elapsed >= ACCELERATION_RESET_MS )
+    turnInterval = ACCELERATION_RESET_MS;
+  else if ( turnInterval == ACCELERATION_RESET_MS )
+    turnInterval = elapsed;
+  else
+    turnInterval = (turnInterval + elapsed) >> 1;
+
+  lastTurn = turn;
+  turnSteps = 1;
+
+  if ( accelerationCurve == NULL )
+    return;
+
+  for ( segment = accelerationCurve ; (intervalMs = pgm_read_byte(&segment->intervalMs)) != 0 ; segment++ )
+    if ( turnInterval < intervalMs ) {
+      turnSteps = pgm_read_byte(&segment->steps);
+      break;
+    }
+
+}
+
+
+/**
+ * Filtro antirrebote y reconocimiento de gestos a partir del
+ * nivel leido del pulsador. Los tiempos se toman desde el primer
+ * cambio de nivel (no desde que el filtro lo acepta), por lo que
+ * la retencion se informa a GESTURE_HOLD_US de presionar
+ */
+uint8_t RotaryEncoder::gestureCheck(uint8_t level) {
+
+  unsigned long now = micros();
+  uint8_t event = NONE;
+  byte pressed = 0, released = 0;
+
+  if ( level != rawSwitchLevel ) {
+    rawSwitchLevel = level;
+    rawTimestamp = now;
   }
-  else {
-    switchTimestamp = millis();
-    event = savedEvent;
-    savedEvent = NONE;
+
+  if ( rawSwitchLevel != switchLevel && (now - rawTimestamp) >= GESTURE_DEBOUNCE_US ) {
+    switchLevel = rawSwitchLevel;
+    pressed = ( switchLevel == 0 );
+    released = ! pressed;
+  }
+
+  switch ( gestureState ) {
+
+    case GESTURE_IDLE: {
+      if ( pressed ) {
+        switchTimestamp = rawTimestamp;
+        gestureState = GESTURE_PRESSED;
+      }
+      break;
+    }
+
+    case GESTURE_PRESSED:
+    case GESTURE_SECOND_PRESS: {
+
+      if ( released ) {
+
+        if ( gestureState == GESTURE_SECOND_PRESS ) {
+          event = SWITCH_DOUBLE_CLICK;
+          gestureState = GESTURE_IDLE;
+        }
+        else if ( doubleClickWindow ) {
+          gestureTimestamp = rawTimestamp;
+          gestureState = GESTURE_RELEASED;
+        }
+        else {
+          event = SWITCH_CLICK;
+          gestureState = GESTURE_IDLE;
+        }
+
+      }
+      else if ( (now - switchTimestamp) >= GESTURE_HOLD_US ) {
+
+        // La retencion se informa sin esperar la liberacion
+        event = SWITCH_HELD;
+        gestureState = GESTURE_HELD;
+        gestureTimestamp = now;
+        repeatPeriod = GESTURE_REPEAT_US;
+      }
+
+      break;
+    }
+
+    case GESTURE_HELD: {
+
+      if ( released )
+        gestureState = GESTURE_IDLE;
+      else if ( repeatEnabled && (now - gestureTimestamp) >= repeatPeriod ) {
+
+        event = SWITCH_REPEAT;
+        gestureTimestamp += repeatPeriod;
+
+        // Cada repeticion reduce el periodo un 25%
+        repeatPeriod -= repeatPeriod >> 2;
+        if ( repeatPeriod < GESTURE_REPEAT_MIN_US )
+          repeatPeriod = GESTURE_REPEAT_MIN_US;
+      }
+
+      break;
+    }
+
+    case GESTURE_RELEASED: {
+
+      if ( pressed ) {
+        switchTimestamp = rawTimestamp;
+        gestureState = GESTURE_SECOND_PRESS;
+      }
+      else if ( (now - gestureTimestamp) >= doubleClickWindow ) {
+        event = SWITCH_CLICK;
+        gestureState = GESTURE_IDLE;
+      }
+
+      break;
+    }
+
   }
 
   return event;
 
 }
+
+
+void RotaryEncoder::setDoubleClick(uint16_t windowMs) {
+
+  doubleClickWindow = windowMs * 1000UL;
+
+}
+
+
+void RotaryEncoder::setRepeat(byte enabled) {
+
+  repeatEnabled = enabled;
+
+}
+
+
+void RotaryEncoder::setAcceleration(const Acceleration_t *curve) {
+
+  accelerationCurve = curve;
+
+}
+
+
+uint8_t RotaryEncoder::getClkPin(void) {
+
+  return clkPin;
+
+}
+
+
+unsigned long RotaryEncoder::getEventTimestamp(void) {
+
+  return eventTimestamp;
+
+}
+
+
+uint8_t RotaryEncoder::getSteps(void) {
+
+  return turnSteps;
+
+}
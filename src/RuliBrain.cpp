@@ -1,1018 +1,1833 @@
-/*
- * RuliBrain.cpp
- * Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)
- */
-
-#include <Arduino.h>
-#include <EEPROM.h>
-
-#include "RuliBrain.h"
-
-
-///////////////////////////
-//
-//    Funcionalidades
-//
-#define WELCOME           0
-#define SIMPLE_ROULETTE   1
-#define RANDOM_COLOR      2
-#define FOLLOW_THE_COLOR  3
-#define TURN_METER        4
-#define VELOCITY_METER    5
-#define CUSTOM_SHAPE      6
-#define SOUND_SHOOTING    7
-#define MUSIC             8
-#define IDDLE             9
-///////////////////////////
-
-
-///////////////////////////
-//
-//   Intervalos definidos
-//
-#define SELECTOR_BLINK_INTERVAL         0
-#define RANDOM_COLOR_INTERVAL           1
-#define LED_SPEAKER_INTERVAL            2
-#define SPINNING_DURATION_INTERVAL      3
-#define FOLLOW_COLOR_BLINK_INTERVAL     4
-#define VELOCITY_METER_INTERVAL         5
-#define VELOCITY_METER_BLINK_INTERVAL   6
-#define VOLUME_SETTING_INTERVAL         7
-#define VOLUME_SETTING_BLINK_INTERVAL   8
-#define CUSTOM_SHAPE_BLINK_INTERVAL     9
-#define MUSIC_BLINK_INTERVAL           10
-#define MUSIC_VOLUME_INTERVAL          11
-#define WELCOME_INTERVAL               12
-#define IDDLE_INTERVAL                 13
-#define IDDLE_STARS_INTERVAL           14
-#define SOUND_SHOOTING_INTERVAL        15
-//
-#define TOGGLE_STEPS      2
-#define ON                1
-#define OFF               2
-///////////////////////////
-
-
-#define EEPROM_INITIAL_KEY        0
-#define EEPROM_INITIAL_KEY_VALUE  'R'
-#define EEPROM_VOLUME             1
-#define EEPROM_FUNCTION           2
-
-
-/**
- * Metodo de inicializacion
- * simil constructor
- */
-void RuliBrain::begin(RotaryEncoder *pmainWheel, RotaryEncoder *protarySelector, MP3Player *pmp3Player, LedsPanel *pledsPanel) {
-
-  mainWheel      = pmainWheel;
-  rotarySelector = protarySelector;
-  mp3Player      = pmp3Player;
-  ledsPanel      = pledsPanel;
-
-  // Inicializacion parametros por defecto
-  prevFunction    = SIMPLE_ROULETTE;
-  currentFunction = WELCOME;
-  selectedFunction = SIMPLE_ROULETTE;
-  currentStep = 0;
-  spinSound = 2;
-  volume = 5;
-  //
-
-  // Inicializacion de flags
-  initializeFunction = 1;
-  funcSelectorIsActive = 0;
-  volumeSettingIsActive = 0;
-  speaking = 0;
-  spinning = 0;
-  //
-
-
-  /*
-   * Inicializacion en 0x00 de los vectores de intervalos
-   * y de datos de proposito general
-   */
-  memset(intervals, 0x00, sizeof(Interval_t) * INTERVALS);
-  memset(data, 0x00, DATA_SIZE);
-
-  /*
-   * Verificacion/resguardo de parametros
-   * en memoria EEPROM
-   */
-  if ( EEPROM.read(EEPROM_INITIAL_KEY) != EEPROM_INITIAL_KEY_VALUE ) {
-    EEPROM.write(EEPROM_INITIAL_KEY, EEPROM_INITIAL_KEY_VALUE);
-    EEPROM.write(EEPROM_VOLUME, volume);
-    EEPROM.write(EEPROM_FUNCTION, selectedFunction);
-  } else {
-    volume = EEPROM.read(EEPROM_VOLUME);
-    selectedFunction = EEPROM.read(EEPROM_FUNCTION);
-  }
-
-  // Inicializacion de indicador de funcionalidad activa
-  ledsPanel->setValue(FUNC_INDICATOR, (0x01 << (selectedFunction-1)) );
-
-  // Inicializacion volumen de reproductor MP3
-  mp3Player->volume(volume);
-
-}
-
-
-/**
- * Devuelve un valor entre 0 y [steps] incrementando dicho valor
- * siempre y cuando el tiempo sea >= [ms] entre cada invocacion
- * se devera especificar un indicador de intervalo [interval] que
- * puede ser de 0 a INTERVALS
- *
- */
-uint8_t RuliBrain::getInterval(uint8_t interval, unsigned long ms, uint8_t steps) {
-
-  unsigned long tstamp;
-  uint8_t ret;
-
-  tstamp = millis();
-
-  ret = 0;
-
-  if ( ! intervals[interval].timestamp )
-    intervals[interval].timestamp = tstamp;
-
-  if ( (tstamp - intervals[interval].timestamp) >= ms ) {
-
-    intervals[interval].timestamp = tstamp;
-
-    if ( intervals[interval].currentStep < steps )
-      intervals[interval].currentStep++;
-    else
-      intervals[interval].currentStep = 0;
-
-    ret = intervals[interval].currentStep;
-  }
-
-  return ret;
-
-}
-
-
-void RuliBrain::resetInterval(uint8_t interval) {
-
-  intervals[interval].timestamp = millis();
-  intervals[interval].currentStep = 0;
-
-}
-
-
-void RuliBrain::mp3FinishFlush(void) {
-  byte aux = mp3Player->finished();
-}
-
-
-void RuliBrain::run(void) {
-
-  wheelEvent = mainWheel->getEvent();
-  selectorEvent = rotarySelector->getEvent();
-
-  if ( currentFunction != WELCOME ) {
-
-    if ( funcSelectorIsActive && selectorEvent == SWITCH_HELD )
-      volumeSettingIsActive = 1;
-    else if ( selectorEvent == SWITCH_HELD )
-      funcSelectorIsActive = 1;
-
-    if ( funcSelectorIsActive && volumeSettingIsActive == 0 )
-      functionSelector();
-  }
-
-  if ( speaking )
-    ledSpeakEffect();
-  else if ( volumeSettingIsActive )
-    volumeSetting();
-  else {
-
-    switch(currentFunction) {
-      case WELCOME           : { welcome        (); break; }
-      case SIMPLE_ROULETTE   : { simpleRoulette (); break; }
-      case RANDOM_COLOR      : { randomColor    (); break; }
-      case FOLLOW_THE_COLOR  : { followTheColor (); break; }
-      case TURN_METER        : { turnMeter      (); break; }
-      case VELOCITY_METER    : { velocityMeter  (); break; }
-      case CUSTOM_SHAPE      : { customShape    (); break; }
-      case SOUND_SHOOTING    : { soundShooting  (); break; }
-      case MUSIC             : { music          (); break; }
-    }
-
-    if ( currentFunction != MUSIC )
-      iddleCheck();
-
-    //byte aux = mp3Player->finished();
-  }
-
-}
-
-
-void RuliBrain::iddleCheck() {
-
-  if ( wheelEvent != NONE || selectorEvent != NONE ) {
-
-    resetInterval(IDDLE_INTERVAL);
-
-    if ( currentFunction == IDDLE ) {
-      currentFunction = prevFunction;
-      ledsPanel->setValue(FUNC_INDICATOR, (0x01 << (selectedFunction-1)) );
-      initializeFunction = 1;
-    }
-
-  }
-
-  switch ( getInterval(IDDLE_INTERVAL, 60000, 8) ) {
-    case 1: {
-      mp3Player->stop();
-      speak(1, 4);
-      prevFunction = currentFunction;
-      currentFunction = IDDLE;
-      ledsPanel->setValue(FUNC_INDICATOR, 0 );
-      break;
-    }
-    case 2: { mp3Player->stop(); speak(1, 5); break; }
-    case 4: { mp3Player->stop(); speak(1, 6); break; }
-    case 8: { mp3Player->stop(); speak(1, 7); }
-  }
-
-  if ( currentFunction == IDDLE && speaking == 0 && ledsPanel->getValue(YELLOW) )
-    ledsPanel->setValue(YELLOW, 0);
-
-  if ( currentFunction == IDDLE )
-    switch ( getInterval(IDDLE_STARS_INTERVAL, 120, 8) ) {
-      case 1: { ledsPanel->setWheelValues(random(0, 31), 1); break; }
-      case 2: { ledsPanel->setWheelValues(0, 0, 0, 0, 0); break; }
-    }
-
-}
-
-
-void RuliBrain::functionSelector() {
-
-  switch ( getInterval(SELECTOR_BLINK_INTERVAL, 70, TOGGLE_STEPS) ) {
-    case ON: { ledsPanel->setValue(FUNC_INDICATOR, 0xFF); break; }
-    case OFF: { ledsPanel->setValue(FUNC_INDICATOR, (0x01 << (selectedFunction-1)) ^ 0xFF); }
-  }
-
-
-  switch(selectorEvent) {
-
-    case RIGHT_TURN: { if ( selectedFunction < 8 ) selectedFunction++; break; }
-
-    case LEFT_TURN: { if ( selectedFunction > 1 ) selectedFunction--; break; }
-
-    case SWITCH_HELD: { ledsPanel->setValue(FUNC_INDICATOR, 0xFF); break; }
-
-    case SWITCH_CLICK: {
-      speak(selectedFunction + 1, 1);
-      funcSelectorIsActive = 0;
-      initializeFunction = 1;
-      currentFunction = selectedFunction;
-      currentStep = 0;
-      ledsPanel->setValue(FUNC_INDICATOR, (0x01 << (selectedFunction-1)) );
-      EEPROM.write(EEPROM_FUNCTION, selectedFunction);
-      resetInterval(IDDLE_INTERVAL);
-    }
-  }
-
-}
-
-
-void RuliBrain::volumeSetting() {
-
-  if ( selectorEvent == SWITCH_HELD ) {
-    ledsPanel->setValue(FUNC_INDICATOR, (0x01 << (currentFunction-1)) );
-    mp3Player->playFolder(1, 2);
-  }
-
-  switch ( getInterval(VOLUME_SETTING_BLINK_INTERVAL, 70, TOGGLE_STEPS) ) {
-    case ON: { ledsPanel->setValue(YELLOW, 0xFF); break; }
-    case OFF: { ledsPanel->setValue(YELLOW, 0x00); }
-  }
-
-  if ( selectorEvent == RIGHT_TURN || wheelEvent == RIGHT_TURN )
-    mp3Player->volumeUp();
-  else if ( selectorEvent == LEFT_TURN || wheelEvent == LEFT_TURN )
-    mp3Player->volumeDown();
-
-  if ( selectorEvent != NONE || wheelEvent != NONE ) {
-
-    resetInterval(VOLUME_SETTING_INTERVAL);
-
-    for ( uint8_t i =  0 ; i < 32 ; i++ )
-      if ( i <= (mp3Player->getVolume() - 1) )
-        ledsPanel->setWheelValues(i, 1, 0);
-      else
-        ledsPanel->setWheelValues(i, 0, 0);
-  }
-
-  if ( selectorEvent == SWITCH_CLICK || getInterval(VOLUME_SETTING_INTERVAL, 1000, 15) == 15 ) {
-      volumeSettingIsActive = 0;
-      funcSelectorIsActive = 0;
-      initializeFunction = 1;
-      EEPROM.write(EEPROM_VOLUME, mp3Player->getVolume());
-  }
-
-}
-
-
-void RuliBrain::speak(uint8_t folderNumber, uint8_t fileNumber) {
-
-  //byte aux = mp3Player->finished();
-
-  while ( mp3Player->finished() ) ;
-
-  speaking = 1;
-
-  //mp3Player->stop();
-
-  mp3Player->playFolder(folderNumber, fileNumber);
-
-}
-
-
-void RuliBrain::ledSpeakEffect(void) {
-
-  switch ( getInterval(LED_SPEAKER_INTERVAL, 30, 8) ) {
-    case 1: { ledsPanel->setWheelValues(0x00, 0x00, 0x00, 0xFF, 0x00); break; }
-    case 2: { ledsPanel->setWheelValues(0x00, 0x00, 0x00, 0x7E, 0x00); break; }
-    case 3: { ledsPanel->setWheelValues(0x00, 0x00, 0x00, 0x3C, 0x00); break; }
-    case 4: { ledsPanel->setWheelValues(0x00, 0x00, 0x00, 0x18, 0x00); break; }
-    case 5: { ledsPanel->setWheelValues(0x00, 0x00, 0x00, 0x00, 0x00); break; }
-
-    case 6: { ledsPanel->setWheelValues(0x00, 0x00, 0x00, 0x18, 0x00); break; }
-    case 7: { ledsPanel->setWheelValues(0x00, 0x00, 0x00, 0x3C, 0x00); break; }
-    case 8: { ledsPanel->setWheelValues(0x00, 0x00, 0x00, 0x7E, 0x00); break; }
-
-  }
-
-  if ( mp3Player->finished() )
-    speaking = 0;
-
-}
-
-
-void RuliBrain::playSpinSound() {
-
-  if ( wheelEvent == RIGHT_TURN || wheelEvent == LEFT_TURN ) {
-
-    if ( spinning == 0 )
-      mp3Player->playFolder(currentFunction + 1, spinSound);
-
-    spinning = 1;
-
-    resetInterval(SPINNING_DURATION_INTERVAL);
-
-  }
-
-  if ( spinning == 1 && getInterval(SPINNING_DURATION_INTERVAL, 300, 2) == 2 ) {
-    mp3Player->stop();
-    spinning = 0;
-  }
-
-}
-
-
-
-////////////////////////////////////////////////////
-////////////////////////////////////////////////////
-/////                                          /////
-/////        FUNCIONALIDADES DE RULI           /////
-/////                                          /////
-////////////////////////////////////////////////////
-////////////////////////////////////////////////////
-
-void RuliBrain::welcome() {
-
-  #define PREV_STEP 0
-
-  if ( initializeFunction ) {
-
-    data[PREV_STEP] = 99;
-    initializeFunction = 0;
-  }
-
-  uint8_t step = getInterval(WELCOME_INTERVAL, 22, 80);
-
-  if ( step != data[PREV_STEP] ) {
-
-    data[PREV_STEP] = step;
-
-    if ( step == 1 )
-      mp3Player->playFolder(1, 3);
-
-    if ( step < 40 )
-      ledsPanel->setWheelValues(step, 1);
-    else
-      ledsPanel->setWheelValues(step-40, 0);
-
-    if ( step == 79 ) {
-      //mp3FinishFlush();
-      mp3Player->stop();
-      speak(1, 1);
-      currentFunction = selectedFunction;
-      initializeFunction = 1;
-    }
-
-  }
-
-}
-
-
-void RuliBrain::simpleRoulette() {
-
-  if ( initializeFunction ) {
-    ledsPanel->setWheelValues(0xFF, 0x00, 0x00, 0xFF, 0x00);
-    spinSound = 2;
-    currentStep = 0;
-    initializeFunction = 0;
-  }
-
-  playSpinSound();
-
-  switch(wheelEvent) {
-
-    case RIGHT_TURN: {
-
-      ledsPanel->rotate(RIGHT);
-
-      break;
-    }
-
-    case LEFT_TURN:  {
-
-      ledsPanel->rotate(LEFT);
-
-      break;
-    }
-  }
-
-  if ( selectorEvent == SWITCH_CLICK ) {
-
-    if ( currentStep < 4 )
-      currentStep++;
-    else
-      currentStep = 0;
-
-    switch(currentStep) {
-      case 0: { ledsPanel->setWheelValues(0xFF, 0x00, 0x00, 0xFF, 0x00); spinSound = 2; break; }
-      case 1: { ledsPanel->setWheelValues(0x01, 0x04, 0x08, 0x20, 0x00); spinSound = 3; break; }
-      case 2: { ledsPanel->setWheelValues(0xFF, 0xFF, 0xFF, 0x00, 0x00); spinSound = 4; break; }
-      case 3: { ledsPanel->setWheelValues(0x00, 0x00, 0x00, 0x00, 0x03); spinSound = 5; break; }
-      case 4: { ledsPanel->setWheelValues(0x88, 0x88, 0x88, 0x88, 0x88); spinSound = 6; break; }
-    }
-  }
-
-}
-
-
-void RuliBrain::randomColor() {
-
-  if ( initializeFunction ) {
-    ledsPanel->setWheelValues(0x00, 0xff, 0x00, 0x00, 0x00);
-    spinSound = 2;
-    currentStep = 0;
-    initializeFunction = 0;
-  }
-
-  playSpinSound();
-
-  if ( wheelEvent == RIGHT_TURN || wheelEvent == LEFT_TURN ) {
-
-    resetInterval(RANDOM_COLOR_INTERVAL);
-
-    if ( currentStep != 1 ) { //== 2 ) {
-      ledsPanel->setWheelValues(0x00, 0x01, 0x00, 0x00, 0x00);
-      currentStep = 0;
-    }
-
-    if ( currentStep == 0 )
-      currentStep = 1;
-
-  }
-
-  switch(wheelEvent) {
-    case RIGHT_TURN: { ledsPanel->rotate(RIGHT); break; }
-    case LEFT_TURN:  { ledsPanel->rotate(LEFT); break; }
-  }
-
-  if ( getInterval(RANDOM_COLOR_INTERVAL, 1000, 2) == 2 ) {
-
-    if ( currentStep == 1 ) {
-      for ( uint8_t i = BLUE ; i <= RED ; i++ )
-        if ( ledsPanel->getValue(i) ) {
-          ledsPanel->setValue(i, 0xff);
-          mp3Player->playFolder( 3, i + 3 );
-          break;
-        }
-
-      currentStep = 2;
-    }
-
-  }
-
-}
-
-
-void RuliBrain::followTheColor() {
-
-  #define COLOR_SELECTED 0
-  #define SPEACH         1
-
-  if ( initializeFunction ) {
-    data[SPEACH] = 2;
-    currentStep = 0;
-    initializeFunction = 0;
-  }
-
-  switch(currentStep) {
-
-    case 0: {
-
-      data[COLOR_SELECTED] = (byte) random(1, 6);
-
-      speak(4, data[SPEACH]);
-
-      if ( data[SPEACH] < 6 )
-        data[SPEACH]++;
-      else
-        data[SPEACH] = 2;
-
-      currentStep = 1;
-
-      break;
-
-    }
-
-    case 1: {
-
-      if ( speaking == 0 ){
-        speak(4, data[COLOR_SELECTED] + 6);
-        currentStep = 2;
-      }
-
-      break;
-
-    }
-
-    case 2: {
-
-      if ( speaking == 0 ){
-        mp3Player->playFolder( 4, 12 );
-        ledsPanel->setWheelValues(0xf0, 0x0f, 0x00, 0x00, 0x00);
-        currentStep = 3;
-      }
-
-      break;
-
-    }
-
-    case 3: {
-
-      if ( mp3Player->finished() )
-        currentStep = 0;
-
-      if ( ledsPanel->getValue(data[COLOR_SELECTED]) == 0xFF ) {
-
-        mp3Player->stop();
-
-        mp3Player->playFolder( 4, 13 );
-
-        currentStep = 4;
-      }
-
-      break;
-
-    }
-
-    case 4: {
-
-      if ( mp3Player->finished() )
-        currentStep = 0;
-
-      switch ( getInterval(FOLLOW_COLOR_BLINK_INTERVAL, 40, TOGGLE_STEPS) ) {
-        case ON: { ledsPanel->setValue(data[COLOR_SELECTED], 0xFF); break; }
-        case OFF: { ledsPanel->setValue(data[COLOR_SELECTED], 0x00); }
-      }
-
-      break;
-
-    }
-
-  }
-
-
-  if ( currentStep != 4 )
-    switch(wheelEvent) {
-      case RIGHT_TURN: { ledsPanel->rotate(RIGHT); break; }
-      case LEFT_TURN:  { ledsPanel->rotate(LEFT);  break; }
-    }
-
-}
-
-
-void RuliBrain::turnMeter() {
-
-  if ( initializeFunction ) {
-    ledsPanel->setWheelValues(0x00, 0x00, 0x04, 0x00, 0x00);
-    initializeFunction = 0;
-  }
-
-  switch(wheelEvent) {
-    case RIGHT_TURN: {
-      ledsPanel->rotate(RIGHT, 1, 0);
-      ledsPanel->setValueOR(WHITE, 0x04);
-      spinSound = 2;
-      break;
-    }
-    case LEFT_TURN:  {
-      ledsPanel->rotate(LEFT, 1, 0);
-      ledsPanel->setValueAND(WHITE, 0xF7);
-      spinSound = 3;
-      break;
-    }
-  }
-
-  switch ( ledsPanel->getValue(WHITE) ) {
-    case 0xFF: { ledsPanel->setWheelValues(0x00, 0x00, 0x04, 0x00, 0x00); break; }
-    case 0x00: { ledsPanel->setWheelValues(0xFF, 0xFF, 0xFB, 0xFF, 0xFF); break; }
-  }
-
-  playSpinSound();
-
-}
-
-
-void RuliBrain::velocityMeter() {
-
-  #define VELOCITY 0
-  #define PREV_VELOCITY 1
-
-  if ( initializeFunction ) {
-
-    data[VELOCITY] = 0;
-    data[PREV_VELOCITY] = 0;
-
-    ledsPanel->setWheelValues(0x00, 0x00, 0x00, 0x00, 0x00);
-
-    initializeFunction = 0;
-  }
-
-  if ( wheelEvent == RIGHT_TURN ) {
-    data[VELOCITY]++;
-    ledsPanel->setValue(YELLOW, 0, 0);
-  }
-  else if ( wheelEvent == LEFT_TURN )
-    spinning = 1;
-
-  if ( spinning )
-    switch ( getInterval(VELOCITY_METER_BLINK_INTERVAL, 100, 9) ) {
-      case 1: { ledsPanel->setValue(YELLOW, B11111110); break; }
-      case 2: { ledsPanel->setValue(YELLOW, B11111101); break; }
-      case 3: { ledsPanel->setValue(YELLOW, B11111011); break; }
-      case 4: { ledsPanel->setValue(YELLOW, B11110111); break; }
-      case 5: { ledsPanel->setValue(YELLOW, B11101111); break; }
-      case 6: { ledsPanel->setValue(YELLOW, B11011111); break; }
-      case 7: { ledsPanel->setValue(YELLOW, B10111111); break; }
-      case 8: { ledsPanel->setValue(YELLOW, B01111111); break; }
-      case 9: { spinning = 0; }
-    }
-
-  if ( getInterval(VELOCITY_METER_INTERVAL, 150, TOGGLE_STEPS) == ON ) {
-
-    for ( uint8_t i =  0 ; i < 32 ; i++ )
-      if ( i <= data[VELOCITY] )
-        ledsPanel->setWheelValues(i, 1, 0);
-      else
-        ledsPanel->setWheelValues(i, 0, 0);
-
-    if ( data[VELOCITY] != data[PREV_VELOCITY] ){
-      if ( data[VELOCITY] > 0 )
-        mp3Player->playFolder(6, data[VELOCITY] + 1);
-      else
-        mp3Player->stop();
-    }
-
-    data[PREV_VELOCITY] = data[VELOCITY];
-
-    ledsPanel->refresh();
-
-    data[VELOCITY] = 0;
-  }
-
-}
-
-
-void RuliBrain::customShape() {
-
-  #define CURSOR 0
-  #define CURSOR_VALUE 1
-
-  if ( initializeFunction ) {
-    ledsPanel->setWheelValues(0x00, 0x00, 0x80, 0x00, 0x00);
-    data[CURSOR] = 0;
-    data[CURSOR_VALUE] = 1;
-    spinSound = 2;
-    initializeFunction = 0;
-  }
-
-  playSpinSound();
-
-  if ( selectorEvent != NONE || wheelEvent != NONE )
-    ledsPanel->setWheelValues(data[CURSOR], data[CURSOR_VALUE]);
-
-  switch(wheelEvent) {
-
-    case RIGHT_TURN: {
-
-      if ( data[CURSOR] < 39 )
-        data[CURSOR]++;
-      else
-        data[CURSOR] = 0;
-
-      ledsPanel->rotate(RIGHT);
-
-      break;
-
-    }
-
-    case LEFT_TURN: {
-
-      if ( data[CURSOR] > 0 )
-        data[CURSOR]--;
-      else
-        data[CURSOR] = 39;
-
-      ledsPanel->rotate(LEFT);
-
-    }
-
-  }
-
-  switch(selectorEvent) {
-
-    case RIGHT_TURN: {
-
-      if ( data[CURSOR] < 39 )
-        data[CURSOR]++;
-      else
-        data[CURSOR] = 0;
-
-      break;
-    }
-
-    case LEFT_TURN: {
-
-      if ( data[CURSOR] > 0 )
-        data[CURSOR]--;
-      else
-        data[CURSOR] = 39;
-
-      break;
-    }
-
-    case SWITCH_CLICK: {
-
-      if ( data[CURSOR_VALUE] ) {
-        data[CURSOR_VALUE] = 0;
-        ledsPanel->setWheelValues(data[CURSOR], 0);
-      }
-      else {
-        data[CURSOR_VALUE] = 1;
-        ledsPanel->setWheelValues(data[CURSOR], 1);
-      }
-
-      mp3Player->playFolder(7, 3);
-
-    }
-
-  }
-
-  if ( selectorEvent != NONE )
-    data[CURSOR_VALUE] = ledsPanel->getWheelNValue(data[CURSOR]);
-
-  if ( spinning == 0 )
-    switch ( getInterval(CUSTOM_SHAPE_BLINK_INTERVAL, 70, TOGGLE_STEPS) ) {
-      case ON: { ledsPanel->setWheelValues(data[CURSOR], 1); break; }
-      case OFF: { ledsPanel->setWheelValues(data[CURSOR], 0); }
-    }
-
-
-}
-
-
-void RuliBrain::soundShooting() {
-
-  #define SOUND_NUMBER       0
-  #define LEDS_EFFECT_TYPE   1
-  #define LEDS_EFFECT_ACTIVE 2
-
-  if ( initializeFunction ) {
-    ledsPanel->setWheelValues(0x00, 0x00, 0x80, 0x00, 0x00);
-    data[SOUND_NUMBER]       = 0;
-    data[LEDS_EFFECT_TYPE]   = 0;
-    data[LEDS_EFFECT_ACTIVE] = 0;
-    initializeFunction       = 0;
-  }
-
-  switch ( wheelEvent ) {
-    case RIGHT_TURN: { ledsPanel->rotate(RIGHT); break; }
-    case LEFT_TURN:  { ledsPanel->rotate(LEFT);  break; }
-  }
-
-  if ( selectorEvent == SWITCH_CLICK ) {
-
-    byte soundNumber;
-
-    for ( soundNumber = 0 ; soundNumber < 40 ; soundNumber++ )
-      if ( ledsPanel->getWheelNValue(soundNumber) ) {
-        data[SOUND_NUMBER] = soundNumber;
-        break;
-      }
-
-    mp3Player->playFolder(8, data[SOUND_NUMBER] + 2);
-
-    resetInterval(SOUND_SHOOTING_INTERVAL);
-
-    data[LEDS_EFFECT_ACTIVE] = 1;
-
-  }
-
-  if ( data[LEDS_EFFECT_ACTIVE] ) {
-    switch ( data[LEDS_EFFECT_TYPE] ) {
-      case 0: {
-        switch ( getInterval(SOUND_SHOOTING_INTERVAL, 50, 7) ) {
-          case 1: { ledsPanel->setWheelValues(0xff, 0x00, 0x00, 0x00, 0x00); break; }
-          case 2: { ledsPanel->setWheelValues(0x00, 0xff, 0x00, 0x00, 0x00); break; }
-          case 3: { ledsPanel->setWheelValues(0x00, 0x00, 0xff, 0x00, 0x00); break; }
-          case 4: { ledsPanel->setWheelValues(0x00, 0x00, 0x00, 0xff, 0x00); break; }
-          case 5: { ledsPanel->setWheelValues(0x00, 0x00, 0x00, 0x00, 0xff); break; }
-          case 6: { ledsPanel->setWheelValues(0x00, 0x00, 0x00, 0x00, 0x00); break; }
-          case 7: { ledsPanel->setWheelValues(data[SOUND_NUMBER], 1); data[LEDS_EFFECT_ACTIVE] = 0; }
-        }
-        break;
-      }
-      case 1: {
-        switch ( getInterval(SOUND_SHOOTING_INTERVAL, 50, 7) ) {
-          case 1: { ledsPanel->setWheelValues(0x10, 0x10, 0x10, 0x10, 0x10); break; }
-          case 2: { ledsPanel->setWheelValues(0x18, 0x18, 0x18, 0x18, 0x18); break; }
-          case 3: { ledsPanel->setWheelValues(0x3c, 0x3c, 0x3c, 0x3c, 0x3c); break; }
-          case 4: { ledsPanel->setWheelValues(0x7e, 0x7e, 0x7e, 0x7e, 0x7e); break; }
-          case 5: { ledsPanel->setWheelValues(0xff, 0xff, 0xff, 0xff, 0xff); break; }
-          case 6: { ledsPanel->setWheelValues(0x00, 0x00, 0x00, 0x00, 0x00); break; }
-          case 7: { ledsPanel->setWheelValues(data[SOUND_NUMBER], 1); data[LEDS_EFFECT_ACTIVE] = 0; }
-
-        }
-        break;
-      }
-      case 2: {
-        switch ( getInterval(SOUND_SHOOTING_INTERVAL, 50, 7) ) {
-          case 1: { ledsPanel->setWheelValues(0xff, 0xff, 0xff, 0xff, 0xff); break; }
-          case 2: { ledsPanel->setWheelValues(0x00, 0x00, 0x00, 0x00, 0x00); break; }
-          case 3: { ledsPanel->setWheelValues(0xff, 0xff, 0xff, 0xff, 0xff); break; }
-          case 4: { ledsPanel->setWheelValues(0x00, 0x00, 0x00, 0x00, 0x00); break; }
-          case 5: { ledsPanel->setWheelValues(0xff, 0xff, 0xff, 0xff, 0xff); break; }
-          case 6: { ledsPanel->setWheelValues(0x00, 0x00, 0x00, 0x00, 0x00); break; }
-          case 7: { ledsPanel->setWheelValues(data[SOUND_NUMBER], 1); data[LEDS_EFFECT_ACTIVE] = 0; }
-
-        }
-        break;
-      }
-      case 3: {
-        switch ( getInterval(SOUND_SHOOTING_INTERVAL, 10, 22) ) {
-          case 1:  { ledsPanel->setWheelValues(B10000000, B00000001, B00000000, B00000000, B00000000); break; }
-          case 2:  { ledsPanel->setWheelValues(B11000000, B00000011, B00000000, B00000000, B00000000); break; }
-          case 3:  { ledsPanel->setWheelValues(B11100000, B00000111, B00000000, B00000000, B00000000); break; }
-          case 4:  { ledsPanel->setWheelValues(B11110000, B00001111, B00000000, B00000000, B00000000); break; }
-          case 5:  { ledsPanel->setWheelValues(B11111000, B00011111, B00000000, B00000000, B00000000); break; }
-          case 6:  { ledsPanel->setWheelValues(B11111100, B00111111, B00000000, B00000000, B00000000); break; }
-          case 7:  { ledsPanel->setWheelValues(B11111110, B01111111, B00000000, B00000000, B00000000); break; }
-          case 8:  { ledsPanel->setWheelValues(B11111111, B11111111, B00000000, B00000000, B00000000); break; }
-          case 9:  { ledsPanel->setWheelValues(B11111111, B11111111, B00000001, B00000000, B10000000); break; }
-          case 10: { ledsPanel->setWheelValues(B11111111, B11111111, B00000011, B00000000, B11000000); break; }
-          case 11: { ledsPanel->setWheelValues(B11111111, B11111111, B00000111, B00000000, B11100000); break; }
-          case 12: { ledsPanel->setWheelValues(B11111111, B11111111, B00001111, B00000000, B11110000); break; }
-          case 13: { ledsPanel->setWheelValues(B11111111, B11111111, B00011111, B00000000, B11111000); break; }
-          case 14: { ledsPanel->setWheelValues(B11111111, B11111111, B00111111, B00000000, B11111100); break; }
-          case 15: { ledsPanel->setWheelValues(B11111111, B11111111, B01111111, B00000000, B11111110); break; }
-          case 16: { ledsPanel->setWheelValues(B11111111, B11111111, B11111111, B00000000, B11111111); break; }
-          case 17: { ledsPanel->setWheelValues(B11111111, B11111111, B11111111, B10000001, B11111111); break; }
-          case 18: { ledsPanel->setWheelValues(B11111111, B11111111, B11111111, B11000011, B11111111); break; }
-          case 19: { ledsPanel->setWheelValues(B11111111, B11111111, B11111111, B11100111, B11111111); break; }
-          case 20: { ledsPanel->setWheelValues(B11111111, B11111111, B11111111, B11111111, B11111111); break; }
-          case 21: { ledsPanel->setWheelValues(B00000000, B00000000, B00000000, B00000000, B00000000); break; }
-          case 22: { ledsPanel->setWheelValues(data[SOUND_NUMBER], 1); data[LEDS_EFFECT_ACTIVE] = 0; }
-        }
-        break;
-      }
-    }
-
-    if ( data[LEDS_EFFECT_ACTIVE] == 0 )
-      if ( data[LEDS_EFFECT_TYPE] == 3 )
-        data[LEDS_EFFECT_TYPE] = 0;
-      else
-        data[LEDS_EFFECT_TYPE]++;
-
-  }
-
-}
-
-
-void RuliBrain::music() {
-
-  byte aux;
-
-  #define PLAYING_TRACK   0
-  #define TRACK_SELECTOR  1
-  #define NO_PLAYING     99
-
-  #define TRACK_UP    if ( data[TRACK_SELECTOR] < 39 ) data[TRACK_SELECTOR]++; else data[TRACK_SELECTOR] = 0;
-  #define TRACK_DOWN  if ( data[TRACK_SELECTOR] > 0 ) data[TRACK_SELECTOR]--; else data[TRACK_SELECTOR] = 39;
-  #define TRACK_NEXT  if ( data[PLAYING_TRACK] < 39 ) data[PLAYING_TRACK]++; else data[PLAYING_TRACK] = 0;
-
-  #define MP3_FINISH_FLUSH  aux = mp3Player->finished();
-
-
-  if ( initializeFunction ) {
-    ledsPanel->setWheelValues(0x00, 0x00, 0x80, 0x00, 0x00);
-    data[PLAYING_TRACK] = 0; //NO_PLAYING;
-    data[TRACK_SELECTOR] = 0;
-    MP3_FINISH_FLUSH;
-    mp3Player->playFolder(9, data[PLAYING_TRACK] + 2);
-    initializeFunction = 0;
-  }
-
-  if ( mp3Player->finished() ) {
-    ledsPanel->setWheelValues(data[PLAYING_TRACK], 0);
-    TRACK_NEXT;
-    mp3Player->playFolder(9, data[PLAYING_TRACK] + 2);
-  }
-
-  if ( wheelEvent != NONE )
-    ledsPanel->setWheelValues(data[TRACK_SELECTOR], 0);
-
-  switch(wheelEvent) {
-
-    case RIGHT_TURN: { TRACK_UP; break; }
-
-    case LEFT_TURN: { TRACK_DOWN; break; }
-
-  }
-
-  if ( wheelEvent != NONE )
-    ledsPanel->setWheelValues(data[TRACK_SELECTOR], 1);
-
-  if ( funcSelectorIsActive == 0 )
-    switch (selectorEvent) {
-
-      case RIGHT_TURN: { mp3Player->volumeUp(); break; }
-
-      case LEFT_TURN: { mp3Player->volumeDown(); break; }
-
-      case SWITCH_CLICK: {
-
-        if ( data[PLAYING_TRACK] == data[TRACK_SELECTOR] ) {
-          data[PLAYING_TRACK] = NO_PLAYING;
-          mp3Player->stop();
-          ledsPanel->setWheelValues(data[TRACK_SELECTOR], 1);
-        }
-        else {
-          ledsPanel->setWheelValues(data[PLAYING_TRACK], 0);
-          data[PLAYING_TRACK] = data[TRACK_SELECTOR];
-          mp3Player->playFolder(9, data[PLAYING_TRACK] + 2);
-        }
-
-      }
-
-    }
-
-  if ( selectorEvent == RIGHT_TURN || selectorEvent == LEFT_TURN ) {
-
-    uint8_t mask = 0x01;
-    uint8_t vol = mp3Player->getVolume();
-
-    for ( uint8_t i = 0 ; i < vol / 4 ; i++ ) {
-      mask <<= 1;
-      mask |= 0x01;
-    }
-
-    ledsPanel->setValue(FUNC_INDICATOR, mask);
-    resetInterval(MUSIC_VOLUME_INTERVAL);
-
-  }
-
-
-  if ( data[PLAYING_TRACK] != NO_PLAYING )
-    switch ( getInterval(MUSIC_BLINK_INTERVAL, 170, TOGGLE_STEPS) ) {
-      case ON: { ledsPanel->setWheelValues(data[PLAYING_TRACK], 1); break; }
-      case OFF: { ledsPanel->setWheelValues(data[PLAYING_TRACK], 0); }
-    }
-
-  if ( selectorEvent == SWITCH_CLICK || getInterval(MUSIC_VOLUME_INTERVAL, 1000, 5) == 5 ) {
-    ledsPanel->setValue(FUNC_INDICATOR, 0x80);
-    EEPROM.write(EEPROM_VOLUME, mp3Player->getVolume());
-  }
-
-}
+/*
+ * RuliBrain.cpp
+ * Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)
+ */
+
+#include <Arduino.h>
+#include <EEPROM.h>
+
+#include "RuliBrain.h"
+#include "RuliProgram.h"
+#include "Trace.h"
+
+
+///////////////////////////
+//
+//    Funcionalidades
+//
+#define WELCOME           0
+#define SIMPLE_ROULETTE   1
+#define RANDOM_COLOR      2
+#define FOLLOW_THE_COLOR  3
+#define TURN_METER        4
+#define VELOCITY_METER    5
+#define CUSTOM_SHAPE      6
+#define SOUND_SHOOTING    7
+#define MUSIC             8
+#define USER_PROGRAM      9
+#define IDDLE            10
+#define STREAM           11 // show transmitido por el host (no seleccionable)
+///////////////////////////
+
+
+///////////////////////////
+//
+//   Intervalos definidos
+//
+#define SELECTOR_BLINK_INTERVAL         0
+#define RANDOM_COLOR_INTERVAL           1
+#define LED_SPEAKER_INTERVAL            2
+#define SPINNING_DURATION_INTERVAL      3
+#define FOLLOW_COLOR_BLINK_INTERVAL     4
+#define VELOCITY_METER_INTERVAL         5
+#define VELOCITY_METER_BLINK_INTERVAL   6
+#define VOLUME_SETTING_INTERVAL         7
+#define VOLUME_SETTING_BLINK_INTERVAL   8
+#define CUSTOM_SHAPE_BLINK_INTERVAL     9
+#define MUSIC_BLINK_INTERVAL           10
+#define MUSIC_VOLUME_INTERVAL          11
+#define WELCOME_INTERVAL               12
+#define IDDLE_INTERVAL                 13
+#define IDDLE_STARS_INTERVAL           14
+#define SOUND_SHOOTING_INTERVAL        15
+#define MUSIC_BEAT_INTERVAL            16
+#define CUSTOM_SHAPE_PLAY_INTERVAL     17
+#define SNAPSHOT_INTERVAL              18
+#define FOLLOW_RACE_INTERVAL           19
+//
+#define TOGGLE_STEPS      2
+#define ON                1
+#define OFF               2
+///////////////////////////
+
+
+#ifdef RULI_LATENCY
+/*
+ * Velocidad del puerto serie de hardware, intervalo (ms)
+ * del reporte de percentiles de latencia y ventana (us)
+ * luego de un giro en la que una salida se le atribuye
+ */
+#define LATENCY_SERIAL_BAUDS   115200
+#define LATENCY_REPORT_MS      10000
+#define LATENCY_WINDOW_US     100000
+#endif
+
+
+#define EEPROM_INITIAL_KEY        0
+#define EEPROM_INITIAL_KEY_VALUE  'R'
+#define EEPROM_VOLUME             1
+#define EEPROM_FUNCTION           2
+#define EEPROM_SYNC_UNIT          3 // numero de unidad en el bus de sincronismo
+
+/*
+ * Programa de usuario de la maquina virtual: 'V',
+ * longitud y hasta VM_PROGRAM_SIZE bytes de codigo
+ */
+#define EEPROM_VM_PROGRAM     0x190
+
+// Estadisticas de resultados de los modos (ver OutcomeStats.h)
+#define EEPROM_OUTCOMES       0x090
+#define EEPROM_OUTCOMES_SIZE  0x100
+
+// Animacion grabada en customShape() (ver Animation.h)
+#define EEPROM_ANIMATION      0x210
+#ifdef RULI_ACCOUNTING
+/*
+ * Los contadores de uso (ACC_SIZE = 263 bytes) ocupan el final
+ * de la region de la animacion: 224 bytes, unos 70 cuadros
+ */
+#define EEPROM_ANIMATION_SIZE 0x0E0
+#define EEPROM_ACCOUNTING     0x2F0
+#else
+#define EEPROM_ANIMATION_SIZE 0x1F0
+#endif
+
+/*
+ * Resguardo del estado (ver Snapshot.h): funcionalidad en ejecucion
+ * y, de las que se reanudan, buffer de datos y leds de la rueda.
+ * Ocupa SNAPSHOT_SIZE(SNAPSHOT_STATE) = 32 bytes
+ */
+#define EEPROM_SNAPSHOT       0x010
+#define SNAPSHOT_FUNCTION     0
+#define SNAPSHOT_DATA         1
+#define SNAPSHOT_LEDS         (SNAPSHOT_DATA + DATA_SIZE)
+#define SNAPSHOT_STATE        (SNAPSHOT_LEDS + 5)
+
+// Tiempo (ms) sin eventos luego del cual se resguarda el estado
+#define SNAPSHOT_IDLE_MS      1500
+
+#ifdef RULI_ACCOUNTING
+#define ACCOUNTING(call) accounting.call
+#else
+#define ACCOUNTING(call)
+#endif
+
+/*
+ * Curva de aceleracion del cursor de customShape() y del selector
+ * de temas de music(): con detents separados menos de intervalMs
+ * (promedio) cada uno avanza steps posiciones en la rueda
+ */
+static const Acceleration_t cursorAcceleration[] PROGMEM = {
+  {  20, 4 },
+  {  35, 3 },
+  {  60, 2 },
+  {   0, 0 }
+};
+
+
+/**
+ * Metodo de inicializacion
+ * simil constructor
+ */
+void RuliBrain::begin(RotaryEncoder *pmainWheel, RotaryEncoder *protarySelector, MP3Player *pmp3Player, LedsPanel *pledsPanel) {
+
+  uint8_t state[SNAPSHOT_STATE];
+
+  mainWheel      = pmainWheel;
+  rotarySelector = protarySelector;
+  mp3Player      = pmp3Player;
+  ledsPanel      = pledsPanel;
+
+  /*
+   * Manteniendo retenido el selector, las repeticiones
+   * recorren las funcionalidades sin girar la perilla
+   */
+  rotarySelector->setRepeat(1);
+
+  /*
+   * Giros rapidos avanzan varias posiciones por detent (ver
+   * getSteps()); solo lo aplican los modos con cursor
+   */
+  mainWheel->setAcceleration(cursorAcceleration);
+  rotarySelector->setAcceleration(cursorAcceleration);
+
+  // Inicializacion parametros por defecto
+  prevFunction    = SIMPLE_ROULETTE;
+  currentFunction = WELCOME;
+  selectedFunction = SIMPLE_ROULETTE;
+  currentStep = 0;
+  spinSound = 0;
+  volume = 5;
+  //
+
+  // Inicializacion de flags
+  initializeFunction = 1;
+  funcSelectorIsActive = 0;
+  volumeSettingIsActive = 0;
+  speaking = 0;
+  spinning = 0;
+  //
+
+
+  /*
+   * Inicializacion en 0x00 de los vectores de intervalos
+   * y de datos de proposito general
+   */
+  memset(intervals, 0x00, sizeof(Interval_t) * INTERVALS);
+  memset(data, 0x00, DATA_SIZE);
+
+  beatSync.begin();
+  audio.begin(mp3Player);
+  ruliVM.begin(ledsPanel, &audio);
+  animation.begin(ledsPanel, EEPROM_ANIMATION, EEPROM_ANIMATION_SIZE);
+  outcomes.begin(EEPROM_OUTCOMES, EEPROM_OUTCOMES_SIZE);
+  snapshot.begin(EEPROM_SNAPSHOT, SNAPSHOT_STATE);
+
+#ifdef RULI_TELEMETRY
+  telemetry.begin();
+  reportedFunction = 0xFF;
+#endif
+
+#ifdef RULI_STREAM
+  lightStream.begin(ledsPanel, &audio);
+#if !defined(RULI_TELEMETRY) && !defined(RULI_LATENCY)
+  Serial.begin(STREAM_BAUDS);
+#endif
+#endif
+
+#ifdef RULI_ACCOUNTING
+  accounting.begin(EEPROM_ACCOUNTING);
+#endif
+
+#ifdef RULI_LATENCY
+  ledsLatency.begin();
+  soundLatency.begin();
+  ledsLatencyPending = 0;
+  soundLatencyPending = 0;
+  reportTimestamp = millis();
+#ifndef RULI_TELEMETRY
+  Serial.begin(LATENCY_SERIAL_BAUDS);
+#endif
+#endif
+
+  /*
+   * Verificacion/resguardo de parametros
+   * en memoria EEPROM
+   */
+  if ( EEPROM.read(EEPROM_INITIAL_KEY) != EEPROM_INITIAL_KEY_VALUE ) {
+    EEPROM.write(EEPROM_INITIAL_KEY, EEPROM_INITIAL_KEY_VALUE);
+    EEPROM.write(EEPROM_VOLUME, volume);
+    EEPROM.write(EEPROM_FUNCTION, selectedFunction);
+    ACCOUNTING(countWrites(ACC_PARAMS, 3));
+  } else {
+    volume = EEPROM.read(EEPROM_VOLUME);
+    selectedFunction = EEPROM.read(EEPROM_FUNCTION);
+  }
+
+  // Valores fuera de rango (EEPROM alterada) vuelven al valor por defecto
+  if ( volume > 30 )
+    volume = 5;
+  if ( selectedFunction < SIMPLE_ROULETTE || selectedFunction > USER_PROGRAM )
+    selectedFunction = SIMPLE_ROULETTE;
+
+  /*
+   * Con un resguardo valido la funcionalidad que se ejecutaba
+   * retoma su estado al inicializarse (ver resuming())
+   */
+  resumeFunction = WELCOME;
+
+  if ( snapshot.restore(state) &&
+       state[SNAPSHOT_FUNCTION] >= SIMPLE_ROULETTE && state[SNAPSHOT_FUNCTION] <= USER_PROGRAM ) {
+
+    resumeFunction = state[SNAPSHOT_FUNCTION];
+
+#ifdef RULI_WARM_BOOT
+    // Arranque en caliente: sin welcome(), directo a la funcionalidad
+    selectedFunction = resumeFunction;
+    currentFunction = resumeFunction;
+#endif
+  }
+
+  /*
+   * Selector, ajuste de volumen y voz se dibujan en la capa
+   * LAYER_UI: reemplazan las secciones que cubren sin pisar
+   * lo dibujado por la funcionalidad
+   */
+  ledsPanel->setBlend(LAYER_UI, BLEND_COPY);
+
+  // Inicializacion de indicador de funcionalidad activa
+  ledsPanel->setValue(FUNC_INDICATOR, functionIndicator(selectedFunction) );
+
+  // Volumen del reproductor MP3, enviado por AudioManager
+  mp3Player->setVolume(volume);
+
+}
+
+
+/**
+ * Devuelve un valor entre 0 y [steps] incrementando dicho valor
+ * siempre y cuando el tiempo sea >= [ms] entre cada invocacion
+ * se devera especificar un indicador de intervalo [interval] que
+ * puede ser de 0 a INTERVALS
+ *
+ */
+uint8_t RuliBrain::getInterval(uint8_t interval, unsigned long ms, uint8_t steps) {
+
+  unsigned long tstamp;
+  uint8_t ret;
+
+  tstamp = millis();
+
+  ret = 0;
+
+  if ( ! intervals[interval].timestamp )
+    intervals[interval].timestamp = tstamp;
+
+  if ( (tstamp - intervals[interval].timestamp) >= ms ) {
+
+    intervals[interval].timestamp = tstamp;
+
+    if ( intervals[interval].currentStep < steps )
+      intervals[interval].currentStep++;
+    else
+      intervals[interval].currentStep = 0;
+
+    ret = intervals[interval].currentStep;
+  }
+
+  return ret;
+
+}
+
+
+void RuliBrain::resetInterval(uint8_t interval) {
+
+  intervals[interval].timestamp = millis();
+  intervals[interval].currentStep = 0;
+
+}
+
+
+uint8_t RuliBrain::wheelStep(uint8_t position, uint8_t turn, uint8_t steps) {
+
+  if ( turn == RIGHT_TURN )
+    return (position + steps) % WHEEL_LEDS;
+
+  if ( turn == LEFT_TURN )
+    return (position + WHEEL_LEDS - steps) % WHEEL_LEDS;
+
+  return position;
+
+}
+
+
+void RuliBrain::mp3FinishFlush(void) {
+  byte aux = mp3Player->finished();
+}
+
+
+void RuliBrain::run(void) {
+
+  TRACE_SPAN(TRACE_RUN);
+
+#ifdef RULI_TELEMETRY
+  unsigned long loopStart = micros();
+#endif
+
+  wheelEvent = mainWheel->getEvent();
+  selectorEvent = rotarySelector->getEvent();
+
+  // Flanco capturado del giro, antes de que lo reemplace el siguiente
+  if ( currentFunction == FOLLOW_THE_COLOR && (wheelEvent == RIGHT_TURN || wheelEvent == LEFT_TURN) )
+    reactionTimer.turn();
+
+#ifdef RULI_STREAM
+  streamCheck();
+#endif
+
+#ifdef RULI_SYNC
+  syncCheck();
+#endif
+
+  if ( currentFunction != WELCOME ) {
+
+    if ( funcSelectorIsActive && selectorEvent == SWITCH_HELD )
+      volumeSettingIsActive = 1;
+    else if ( selectorEvent == SWITCH_HELD )
+      funcSelectorIsActive = 1;
+
+    if ( funcSelectorIsActive && volumeSettingIsActive == 0 )
+      functionSelector();
+  }
+
+  if ( speaking )
+    ledSpeakEffect();
+  else if ( volumeSettingIsActive )
+    volumeSetting();
+  else {
+
+    // Las capas de la funcionalidad anterior se descartan
+    if ( initializeFunction ) {
+      ledsPanel->clearLayer(LAYER_OVERLAY);
+      ledsPanel->clearLayer(LAYER_CURSOR);
+    }
+
+    // Intervalo de la funcionalidad, incluido el control de inactividad
+    TRACE_SPAN(TRACE_MODE + currentFunction);
+
+    switch(currentFunction) {
+      case WELCOME           : { welcome        (); break; }
+      case SIMPLE_ROULETTE   : { simpleRoulette (); break; }
+      case RANDOM_COLOR      : { randomColor    (); break; }
+      case FOLLOW_THE_COLOR  : { followTheColor (); break; }
+      case TURN_METER        : { turnMeter      (); break; }
+      case VELOCITY_METER    : { velocityMeter  (); break; }
+      case CUSTOM_SHAPE      : { customShape    (); break; }
+      case SOUND_SHOOTING    : { soundShooting  (); break; }
+      case MUSIC             : { music          (); break; }
+      case USER_PROGRAM      : { userProgram    (); break; }
+#ifdef RULI_STREAM
+      case STREAM            : { streamShow     (); break; }
+#endif
+    }
+
+    if ( currentFunction != MUSIC && currentFunction != STREAM )
+      iddleCheck();
+
+    //byte aux = mp3Player->finished();
+  }
+
+  // Musica atenuada mientras se navega el selector de funcionalidades
+  audio.setDucking(funcSelectorIsActive);
+  audio.update();
+
+  animation.update();
+  outcomes.update();
+  snapshotCheck();
+
+  // Un unico refresco por pasada para los cambios en las capas
+  ledsPanel->update();
+
+  // La reanudacion solo aplica a la primera funcionalidad inicializada
+  if ( currentFunction != WELCOME && initializeFunction == 0 )
+    resumeFunction = WELCOME;
+
+#ifdef RULI_ACCOUNTING
+  accountingCheck();
+#endif
+
+#ifdef RULI_LATENCY
+  latencyCheck();
+#endif
+
+#ifdef RULI_TELEMETRY
+  telemetryCheck(loopStart);
+#endif
+
+}
+
+
+#ifdef RULI_TELEMETRY
+/**
+ * Informa por telemetria los eventos de los encoders,
+ * los cambios de funcionalidad, las diferencias en el
+ * buffer de leds y la duracion de la pasada del lazo
+ */
+void RuliBrain::telemetryCheck(unsigned long loopStart) {
+
+  if ( wheelEvent != NONE )
+    telemetry.encoder(0, wheelEvent, mainWheel->getEventTimestamp());
+
+  if ( selectorEvent != NONE )
+    telemetry.encoder(1, selectorEvent, rotarySelector->getEventTimestamp());
+
+  if ( currentFunction != reportedFunction ) {
+    telemetry.mode(reportedFunction, currentFunction,
+      funcSelectorIsActive | (volumeSettingIsActive << 1) | (speaking << 2) | (spinning << 3));
+    reportedFunction = currentFunction;
+  }
+
+  telemetry.leds(ledsPanel->getFrame());
+
+  telemetry.loopPass(micros() - loopStart);
+
+}
+#endif
+
+
+#ifdef RULI_ACCOUNTING
+/**
+ * Atribuye a la funcionalidad en ejecucion los recursos usados
+ * en la pasada. Las escrituras de pines se derivan: cada refresco
+ * escribe getRefreshPins() pines y cada byte al DFPlayer 10 bits
+ * por el pin TX de SoftwareSerial
+ */
+void RuliBrain::accountingCheck(void) {
+
+  uint16_t refreshes = ledsPanel->getRefreshes();
+  uint16_t bytes = mp3Player->getSerialBytes();
+
+  if ( wheelEvent != NONE )
+    accounting.count(ACC_ENCODER_EVENTS, 1);
+  if ( selectorEvent != NONE )
+    accounting.count(ACC_ENCODER_EVENTS, 1);
+
+  accounting.count(ACC_REFRESHES, refreshes);
+  accounting.count(ACC_MP3_BYTES, bytes);
+  accounting.count(ACC_PIN_WRITES, (unsigned long) refreshes * ledsPanel->getRefreshPins() + bytes * 10UL);
+
+  accounting.countWrites(ACC_SNAPSHOT, snapshot.getWrites());
+  accounting.countWrites(ACC_OUTCOMES, outcomes.getWrites());
+  accounting.countWrites(ACC_ANIMATION, animation.getWrites());
+
+  accounting.setMode(currentFunction);
+  accounting.update();
+
+}
+#endif
+
+
+#ifdef RULI_LATENCY
+/**
+ * Registra la latencia del ultimo giro detectado en cuanto
+ * los leds se actualizan y en cuanto se envia un sonido,
+ * si ocurre dentro de LATENCY_WINDOW_US. Los giros que no
+ * producen salida en la ventana no generan muestra: la
+ * salida siguiente (un parpadeo, el tema siguiente) no
+ * corresponde al giro
+ */
+void RuliBrain::latencyCheck(void) {
+
+  RotaryEncoder *encoder = NULL;
+  unsigned long elapsed;
+
+  if ( wheelEvent == RIGHT_TURN || wheelEvent == LEFT_TURN )
+    encoder = mainWheel;
+  else if ( selectorEvent == RIGHT_TURN || selectorEvent == LEFT_TURN )
+    encoder = rotarySelector;
+
+  if ( encoder ) {
+    inputTimestamp = encoder->getEventTimestamp();
+    ledsLatencyPending = 1;
+    soundLatencyPending = 1;
+  }
+
+  elapsed = ledsPanel->getRefreshTimestamp() - inputTimestamp;
+  if ( ledsLatencyPending && (long) elapsed >= 0 && elapsed <= LATENCY_WINDOW_US ) {
+    ledsLatency.record(elapsed);
+    TELEMETRY(timing(TIMING_LEDS_LATENCY, elapsed));
+    ledsLatencyPending = 0;
+  }
+
+  elapsed = mp3Player->getCommandTimestamp() - inputTimestamp;
+  if ( soundLatencyPending && (long) elapsed >= 0 && elapsed <= LATENCY_WINDOW_US ) {
+    soundLatency.record(elapsed);
+    TELEMETRY(timing(TIMING_SOUND_LATENCY, elapsed));
+    soundLatencyPending = 0;
+  }
+
+  // Vencida la ventana el giro queda sin muestra
+  if ( micros() - inputTimestamp > LATENCY_WINDOW_US ) {
+    ledsLatencyPending = 0;
+    soundLatencyPending = 0;
+  }
+
+#ifndef RULI_TELEMETRY
+  // Con telemetria activa las muestras viajan como registros TM_TIMING
+  if ( millis() - reportTimestamp >= LATENCY_REPORT_MS ) {
+    reportTimestamp = millis();
+    Serial.print("LAT leds ");
+    ledsLatency.report(Serial);
+    Serial.print(" | sound ");
+    soundLatency.report(Serial);
+    Serial.println();
+  }
+#endif
+
+}
+#endif
+
+
+#ifdef RULI_STREAM
+/**
+ * Toma el control al comenzar un show transmitido por el
+ * host y retorna a la funcionalidad previa al terminar
+ */
+void RuliBrain::streamCheck() {
+
+  switch ( lightStream.receive() ) {
+
+    case STREAM_STARTED: {
+      if ( currentFunction != IDDLE )
+        prevFunction = ( currentFunction == WELCOME ) ? selectedFunction : currentFunction;
+      animation.stop();
+      audio.stop(AUDIO_MUSIC);
+      funcSelectorIsActive = 0;
+      volumeSettingIsActive = 0;
+      ledsPanel->clearLayer(LAYER_UI);
+      currentFunction = STREAM;
+      initializeFunction = 1;
+      break;
+    }
+
+    case STREAM_ENDED: {
+      if ( currentFunction == STREAM ) {
+        currentFunction = prevFunction;
+        initializeFunction = 1;
+        ledsPanel->setValue(FUNC_INDICATOR, functionIndicator(currentFunction) );
+        resetInterval(IDDLE_INTERVAL);
+      }
+      break;
+    }
+
+    case STREAM_EXPORT: {
+      outcomes.exportAll();
+      ACCOUNTING(exportAll());
+    }
+  }
+
+}
+#endif
+
+
+#ifdef RULI_SYNC
+void RuliBrain::attach(SyncBus *psyncBus) {
+
+  syncBus = psyncBus;
+  syncBus->setUnit(EEPROM.read(EEPROM_SYNC_UNIT));
+
+  syncEvent = SE_NONE;
+
+}
+
+
+/**
+ * Atiende el bus de sincronismo y toma su evento de la pasada.
+ * El numero de unidad asignado por el host queda en EEPROM
+ */
+void RuliBrain::syncCheck() {
+
+  syncBus->update();
+
+  syncEvent = syncBus->getEvent();
+
+  if ( syncEvent == SE_UNIT ) {
+    EEPROM.update(EEPROM_SYNC_UNIT, syncBus->getUnit());
+    ACCOUNTING(countWrites(ACC_PARAMS, 1));
+  }
+
+}
+#endif
+
+
+void RuliBrain::iddleCheck() {
+
+  if ( wheelEvent != NONE || selectorEvent != NONE ) {
+
+    resetInterval(IDDLE_INTERVAL);
+
+    if ( currentFunction == IDDLE ) {
+      currentFunction = prevFunction;
+      ledsPanel->clearLayer(LAYER_OVERLAY);
+      ledsPanel->setValue(FUNC_INDICATOR, functionIndicator(selectedFunction) );
+      initializeFunction = 1;
+    }
+
+  }
+
+  switch ( getInterval(IDDLE_INTERVAL, 60000, 8) ) {
+    case 1: {
+      animation.stop();
+      speak(CUE_IDDLE.at(0));
+      prevFunction = currentFunction;
+      currentFunction = IDDLE;
+
+      // Las estrellas ocultan por completo el dibujo de la funcionalidad
+      ledsPanel->clearLayer(LAYER_CURSOR);
+      ledsPanel->setBlend(LAYER_OVERLAY, BLEND_COPY);
+      ledsPanel->setLayerValue(LAYER_OVERLAY, FUNC_INDICATOR, 0);
+      ledsPanel->setLayerWheelValues(LAYER_OVERLAY, 0, 0, 0, 0, 0);
+      break;
+    }
+    case 2: { speak(CUE_IDDLE.at(1)); break; }
+    case 4: { speak(CUE_IDDLE.at(2)); break; }
+    case 8: { speak(CUE_IDDLE.at(3)); }
+  }
+
+#ifdef RULI_SYNC
+  /*
+   * Con reloj comun las estrellas siguen los cuadros del bus: la
+   * misma secuencia (funcion del numero de cuadro) y el mismo
+   * instante de latch en todas las unidades
+   */
+  if ( currentFunction == IDDLE && syncBus->isLocked() ) {
+    uint16_t frame = syncBus->frame();
+    if ( frame != SYNC_NO_FRAME ) {
+      switch ( frame % 9 ) {
+        case 1: { ledsPanel->setLayerWheelValues(LAYER_OVERLAY, ((uint16_t) (frame * 40503U) >> 8) % 31, 1); break; }
+        case 2: { ledsPanel->setLayerWheelValues(LAYER_OVERLAY, 0, 0, 0, 0, 0); break; }
+      }
+
+      // Latch en el instante del cuadro, sin esperar al fin de la pasada
+      ledsPanel->update();
+    }
+  }
+  else
+#endif
+  if ( currentFunction == IDDLE )
+    switch ( getInterval(IDDLE_STARS_INTERVAL, 120, 8) ) {
+      case 1: { ledsPanel->setLayerWheelValues(LAYER_OVERLAY, random(0, 31), 1); break; }
+      case 2: { ledsPanel->setLayerWheelValues(LAYER_OVERLAY, 0, 0, 0, 0, 0); break; }
+    }
+
+}
+
+
+/**
+ * Las funcionalidades 1 a 8 encienden su led en el indicador,
+ * USER_PROGRAM (que no tiene led propio) lo enciende completo
+ */
+uint8_t RuliBrain::functionIndicator(uint8_t function) {
+
+  if ( function >= SIMPLE_ROULETTE && function <= MUSIC )
+    return 0x01 << (function-1);
+
+  return 0xFF;
+
+}
+
+
+void RuliBrain::functionSelector() {
+
+  TRACE_SPAN(TRACE_SELECTOR);
+
+  switch ( getInterval(SELECTOR_BLINK_INTERVAL, 70, TOGGLE_STEPS) ) {
+    case ON: { ledsPanel->setLayerValue(LAYER_UI, FUNC_INDICATOR, 0xFF); break; }
+    case OFF: { ledsPanel->setLayerValue(LAYER_UI, FUNC_INDICATOR, functionIndicator(selectedFunction) ^ 0xFF); }
+  }
+
+
+  switch(selectorEvent) {
+
+    case RIGHT_TURN: { if ( selectedFunction < USER_PROGRAM ) selectedFunction++; break; }
+
+    case LEFT_TURN: { if ( selectedFunction > 1 ) selectedFunction--; break; }
+
+    case SWITCH_HELD: { ledsPanel->setLayerValue(LAYER_UI, FUNC_INDICATOR, 0xFF); break; }
+
+    case SWITCH_REPEAT: {
+      if ( selectedFunction < USER_PROGRAM )
+        selectedFunction++;
+      else
+        selectedFunction = SIMPLE_ROULETTE;
+      break;
+    }
+
+    case SWITCH_CLICK: {
+      animation.stop();
+      audio.stop(AUDIO_MUSIC);
+      speak(CUE_FUNCTION_NAME.inFolder(soundFolder(selectedFunction)));
+      funcSelectorIsActive = 0;
+      initializeFunction = 1;
+      currentFunction = selectedFunction;
+      currentStep = 0;
+      ledsPanel->clearLayer(LAYER_UI);
+      ledsPanel->setValue(FUNC_INDICATOR, functionIndicator(selectedFunction) );
+      EEPROM.write(EEPROM_FUNCTION, selectedFunction);
+      ACCOUNTING(countWrites(ACC_PARAMS, 1));
+      resetInterval(IDDLE_INTERVAL);
+    }
+  }
+
+}
+
+
+void RuliBrain::volumeSetting() {
+
+  TRACE_SPAN(TRACE_VOLUME_SETTING);
+
+  if ( selectorEvent == SWITCH_HELD ) {
+    ledsPanel->setLayerValue(LAYER_UI, FUNC_INDICATOR, functionIndicator(currentFunction) );
+    audio.play(AUDIO_EFFECT, CUE_VOLUME);
+  }
+
+  switch ( getInterval(VOLUME_SETTING_BLINK_INTERVAL, 70, TOGGLE_STEPS) ) {
+    case ON: { ledsPanel->setLayerValue(LAYER_UI, YELLOW, 0xFF); break; }
+    case OFF: { ledsPanel->setLayerValue(LAYER_UI, YELLOW, 0x00); }
+  }
+
+  if ( selectorEvent == RIGHT_TURN || wheelEvent == RIGHT_TURN )
+    mp3Player->volumeUp();
+  else if ( selectorEvent == LEFT_TURN || wheelEvent == LEFT_TURN )
+    mp3Player->volumeDown();
+
+  if ( selectorEvent != NONE || wheelEvent != NONE ) {
+
+    resetInterval(VOLUME_SETTING_INTERVAL);
+
+    for ( uint8_t i =  0 ; i < 32 ; i++ )
+      if ( i <= (mp3Player->getVolume() - 1) )
+        ledsPanel->setLayerWheelValues(LAYER_UI, i, 1);
+      else
+        ledsPanel->setLayerWheelValues(LAYER_UI, i, 0);
+  }
+
+  // Al salir reaparece intacto lo dibujado por la funcionalidad
+  if ( selectorEvent == SWITCH_CLICK || getInterval(VOLUME_SETTING_INTERVAL, 1000, 15) == 15 ) {
+      volumeSettingIsActive = 0;
+      funcSelectorIsActive = 0;
+      ledsPanel->clearLayer(LAYER_UI);
+      EEPROM.write(EEPROM_VOLUME, mp3Player->getVolume());
+      ACCOUNTING(countWrites(ACC_PARAMS, 1));
+  }
+
+}
+
+
+void RuliBrain::speak(SoundCue cue) {
+
+  /*
+   * La voz interrumpe cualquier otro sonido, sin
+   * necesidad de detenerlo previamente
+   */
+  audio.play(AUDIO_VOICE, cue);
+
+  speaking = 1;
+
+}
+
+
+void RuliBrain::ledSpeakEffect(void) {
+
+  TRACE_SPAN(TRACE_SPEAK);
+
+  switch ( getInterval(LED_SPEAKER_INTERVAL, 30, 8) ) {
+    case 1: { ledsPanel->setLayerWheelValues(LAYER_UI, 0x00, 0x00, 0x00, 0xFF, 0x00); break; }
+    case 2: { ledsPanel->setLayerWheelValues(LAYER_UI, 0x00, 0x00, 0x00, 0x7E, 0x00); break; }
+    case 3: { ledsPanel->setLayerWheelValues(LAYER_UI, 0x00, 0x00, 0x00, 0x3C, 0x00); break; }
+    case 4: { ledsPanel->setLayerWheelValues(LAYER_UI, 0x00, 0x00, 0x00, 0x18, 0x00); break; }
+    case 5: { ledsPanel->setLayerWheelValues(LAYER_UI, 0x00, 0x00, 0x00, 0x00, 0x00); break; }
+
+    case 6: { ledsPanel->setLayerWheelValues(LAYER_UI, 0x00, 0x00, 0x00, 0x18, 0x00); break; }
+    case 7: { ledsPanel->setLayerWheelValues(LAYER_UI, 0x00, 0x00, 0x00, 0x3C, 0x00); break; }
+    case 8: { ledsPanel->setLayerWheelValues(LAYER_UI, 0x00, 0x00, 0x00, 0x7E, 0x00); break; }
+
+  }
+
+  if ( audio.isPlaying(AUDIO_VOICE) == 0 ) {
+    speaking = 0;
+    ledsPanel->clearLayer(LAYER_UI);
+  }
+
+}
+
+
+void RuliBrain::playSpinSound() {
+
+  if ( wheelEvent == RIGHT_TURN || wheelEvent == LEFT_TURN ) {
+
+    if ( spinning == 0 )
+      audio.play(AUDIO_SPIN, CUE_SPIN.inFolder(soundFolder(currentFunction)).at(spinSound));
+
+    spinning = 1;
+
+    resetInterval(SPINNING_DURATION_INTERVAL);
+
+  }
+
+  if ( spinning == 1 && getInterval(SPINNING_DURATION_INTERVAL, 300, 2) == 2 ) {
+    audio.stop(AUDIO_SPIN);
+    spinning = 0;
+  }
+
+}
+
+
+
+////////////////////////////////////////////////////
+////////////////////////////////////////////////////
+/////                                          /////
+/////        FUNCIONALIDADES DE RULI           /////
+/////                                          /////
+////////////////////////////////////////////////////
+////////////////////////////////////////////////////
+
+void RuliBrain::welcome() {
+
+  #define PREV_STEP 0
+
+  /*
+   * Duracion de cada paso del barrido: el saludo (paso 79) comienza
+   * al terminar el efecto (paso 1) si este dura mas que el barrido
+   */
+  #define WELCOME_STEP_MS  ( CUE_WELCOME.duration / 78 > 22 ? CUE_WELCOME.duration / 78 : 22 )
+
+  if ( initializeFunction ) {
+
+    data[PREV_STEP] = 99;
+    initializeFunction = 0;
+  }
+
+  uint8_t step = getInterval(WELCOME_INTERVAL, WELCOME_STEP_MS, 80);
+
+  if ( step != data[PREV_STEP] ) {
+
+    data[PREV_STEP] = step;
+
+    if ( step == 1 )
+      audio.play(AUDIO_EFFECT, CUE_WELCOME);
+
+    if ( step < 40 )
+      ledsPanel->setWheelValues(step, 1);
+    else
+      ledsPanel->setWheelValues(step-40, 0);
+
+    if ( step == 79 ) {
+      speak(CUE_GREETING);
+      currentFunction = selectedFunction;
+      initializeFunction = 1;
+    }
+
+  }
+
+}
+
+
+void RuliBrain::simpleRoulette() {
+
+  // Patron (currentStep) en el resguardo del estado
+  #define ROULETTE_STEP  0
+
+  if ( initializeFunction ) {
+    // Reanudada, continua con el patron resguardado y su sonido
+    if ( resuming() ) {
+      currentStep = data[ROULETTE_STEP] % 5;
+      ledsPanel->refresh();
+    }
+    else {
+      currentStep = 0;
+      ledsPanel->setWheelValues(0xFF, 0x00, 0x00, 0xFF, 0x00);
+    }
+    spinSound = currentStep;
+    initializeFunction = 0;
+  }
+
+  playSpinSound();
+
+  switch(wheelEvent) {
+
+    case RIGHT_TURN: {
+
+      ledsPanel->rotate(RIGHT);
+
+      break;
+    }
+
+    case LEFT_TURN:  {
+
+      ledsPanel->rotate(LEFT);
+
+      break;
+    }
+  }
+
+  if ( selectorEvent == SWITCH_CLICK ) {
+
+    if ( currentStep < 4 )
+      currentStep++;
+    else
+      currentStep = 0;
+
+    switch(currentStep) {
+      case 0: { ledsPanel->setWheelValues(0xFF, 0x00, 0x00, 0xFF, 0x00); spinSound = 0; break; }
+      case 1: { ledsPanel->setWheelValues(0x01, 0x04, 0x08, 0x20, 0x00); spinSound = 1; break; }
+      case 2: { ledsPanel->setWheelValues(0xFF, 0xFF, 0xFF, 0x00, 0x00); spinSound = 2; break; }
+      case 3: { ledsPanel->setWheelValues(0x00, 0x00, 0x00, 0x00, 0x03); spinSound = 3; break; }
+      case 4: { ledsPanel->setWheelValues(0x88, 0x88, 0x88, 0x88, 0x88); spinSound = 4; break; }
+    }
+  }
+
+}
+
+
+void RuliBrain::randomColor() {
+
+  if ( initializeFunction ) {
+    ledsPanel->setWheelValues(0x00, 0xff, 0x00, 0x00, 0x00);
+    spinSound = 0;
+    currentStep = 0;
+    initializeFunction = 0;
+  }
+
+  playSpinSound();
+
+  if ( wheelEvent == RIGHT_TURN || wheelEvent == LEFT_TURN ) {
+
+    resetInterval(RANDOM_COLOR_INTERVAL);
+
+    if ( currentStep != 1 ) { //== 2 ) {
+      ledsPanel->setWheelValues(0x00, 0x01, 0x00, 0x00, 0x00);
+      currentStep = 0;
+    }
+
+    if ( currentStep == 0 )
+      currentStep = 1;
+
+  }
+
+  switch(wheelEvent) {
+    case RIGHT_TURN: { ledsPanel->rotate(RIGHT); break; }
+    case LEFT_TURN:  { ledsPanel->rotate(LEFT); break; }
+  }
+
+  if ( getInterval(RANDOM_COLOR_INTERVAL, 1000, 2) == 2 ) {
+
+    if ( currentStep == 1 ) {
+      for ( uint8_t i = BLUE ; i <= RED ; i++ )
+        if ( ledsPanel->getValue(i) ) {
+
+          for ( uint8_t led = 0 ; led < OUTCOME_LEDS ; led++ )
+            if ( ledsPanel->getWheelNValue(led) ) {
+              outcomes.count(OUTCOME_RANDOM_COLOR, led);
+              break;
+            }
+
+          ledsPanel->setValue(i, 0xff);
+          audio.play(AUDIO_EFFECT, CUE_COLOR_SECTION.at(i - BLUE));
+          break;
+        }
+
+      currentStep = 2;
+    }
+
+  }
+
+}
+
+
+void RuliBrain::followTheColor() {
+
+  #define COLOR_SELECTED 0
+  #define SPEACH         1
+  #define REACTION_RANK  2
+  #define SYNC_RACE      3
+
+  // Estados de la carrera compartida (SYNC_RACE)
+  #define RACE_LOCAL     0
+  #define RACE_WAITING   1
+  #define RACE_STARTED   2
+
+  if ( initializeFunction ) {
+    data[SPEACH] = 0;
+    data[SYNC_RACE] = RACE_LOCAL;
+    currentStep = 0;
+    reactionTimer.begin(mainWheel->getClkPin());
+    initializeFunction = 0;
+  }
+
+  switch(currentStep) {
+
+    case 0: {
+
+      ledsPanel->setValue(FUNC_INDICATOR, functionIndicator(selectedFunction) );
+
+      data[COLOR_SELECTED] = (byte) random(1, 6);
+
+#ifdef RULI_SYNC
+      if ( syncBus->isLocked() ) {
+        data[SYNC_RACE] = RACE_WAITING;
+        resetInterval(FOLLOW_RACE_INTERVAL);
+      }
+      else
+        data[SYNC_RACE] = RACE_LOCAL;
+#endif
+
+      speak(CUE_FOLLOW_SPEECH.at(data[SPEACH]));
+
+      if ( data[SPEACH] < CUE_FOLLOW_SPEECH.count - 1 )
+        data[SPEACH]++;
+      else
+        data[SPEACH] = 0;
+
+      currentStep = 1;
+
+      break;
+
+    }
+
+    case 1: {
+
+#ifdef RULI_SYNC
+      /*
+       * El master anuncia la carrera en cuanto cierra la anterior.
+       * Sin anuncio (master en otra funcionalidad) sigue local
+       */
+      if ( data[SYNC_RACE] == RACE_WAITING ) {
+        if ( syncBus->isMaster() )
+          syncBus->raceStart((byte) random(1, 6), SYNC_RACE_LEAD_MS);
+        if ( getInterval(FOLLOW_RACE_INTERVAL, 2UL * (SYNC_RACE_LEAD_MS + SYNC_RACE_WINDOW_MS), 1) )
+          data[SYNC_RACE] = RACE_LOCAL;
+      }
+#endif
+
+      if ( speaking == 0 && data[SYNC_RACE] != RACE_WAITING ){
+        speak(CUE_FOLLOW_COLOR.at(data[COLOR_SELECTED] - BLUE));
+        currentStep = 2;
+      }
+
+      break;
+
+    }
+
+    case 2: {
+
+#ifdef RULI_SYNC
+      // Largada comun: la rueda se enciende en el mismo instante en todas las unidades
+      if ( speaking == 0 && data[SYNC_RACE] == RACE_STARTED && ! syncBus->reached(syncBus->getRaceDue()) )
+        break;
+#endif
+
+      if ( speaking == 0 ){
+        audio.play(AUDIO_EFFECT, CUE_FOLLOW_START);
+        ledsPanel->setWheelValues(0xf0, 0x0f, 0x00, 0x00, 0x00);
+        reactionTimer.start(ledsPanel->getRefreshTimestamp());
+        currentStep = 3;
+      }
+
+      break;
+
+    }
+
+    case 3: {
+
+      if ( audio.finished(AUDIO_EFFECT) )
+        currentStep = 0;
+
+      break;
+
+    }
+
+    case 4: {
+
+      if ( audio.finished(AUDIO_EFFECT) )
+        currentStep = 0;
+
+      switch ( getInterval(FOLLOW_COLOR_BLINK_INTERVAL, 40, TOGGLE_STEPS) ) {
+        case ON: { ledsPanel->setValue(data[COLOR_SELECTED], 0xFF); break; }
+        case OFF: { ledsPanel->setValue(data[COLOR_SELECTED], 0x00); }
+      }
+
+      break;
+
+    }
+
+  }
+
+
+#ifdef RULI_SYNC
+  /*
+   * Carrera compartida: el master elige el color y la largada, cada
+   * unidad informa su tiempo y el master anuncia la ganadora en la
+   * columna indicadora. Una unidad atrasada se incorpora salteando
+   * la presentacion
+   */
+  switch ( syncEvent ) {
+
+    case SE_RACE_START: {
+      data[COLOR_SELECTED] = (byte) syncBus->getEventValue();
+      data[SYNC_RACE] = RACE_STARTED;
+      if ( currentStep > 1 ) {
+        ledsPanel->setValue(FUNC_INDICATOR, functionIndicator(selectedFunction) );
+        currentStep = 1;
+      }
+      break;
+    }
+
+    case SE_RACE_RESULT: {
+      if ( data[SYNC_RACE] == RACE_STARTED && currentStep >= 3 )
+        ledsPanel->setValue(FUNC_INDICATOR, syncBus->getEventValue() == syncBus->getUnit() ? 0xFF : 0x00);
+    }
+  }
+#endif
+
+  if ( currentStep != 4 )
+    switch(wheelEvent) {
+      case RIGHT_TURN: { ledsPanel->rotate(RIGHT); break; }
+      case LEFT_TURN:  { ledsPanel->rotate(LEFT);  break; }
+    }
+
+  /*
+   * Acierto en la misma pasada del giro que completo el color:
+   * tiempo desde el latch de los leds hasta el flanco de ese giro
+   * (capturado por hardware). El ranking dentro de la sesion se
+   * muestra en la columna indicadora. Un flanco anterior al latch
+   * no se mide y la columna queda apagada
+   */
+  if ( currentStep == 3 && (wheelEvent == RIGHT_TURN || wheelEvent == LEFT_TURN) &&
+       ledsPanel->getValue(data[COLOR_SELECTED]) == 0xFF ) {
+
+    data[REACTION_RANK] = reactionTimer.stop();
+
+    if ( data[REACTION_RANK] ) {
+      TELEMETRY(timing(TIMING_REACTION, reactionTimer.getLast()));
+      TELEMETRY(timing(TIMING_REACTION_BEST, reactionTimer.getBest()));
+      TELEMETRY(reaction(reactionTimer.getMedian(), reactionTimer.getLatchDelayMin(),
+        reactionTimer.getLatchDelayMax(), reactionTimer.getBounceMax()));
+      ledsPanel->setValue(FUNC_INDICATOR, 0xFF >> (data[REACTION_RANK] - 1), 0);
+
+#ifdef RULI_SYNC
+      if ( data[SYNC_RACE] == RACE_STARTED )
+        syncBus->raceReport(reactionTimer.getLast());
+#endif
+    }
+    else
+      ledsPanel->setValue(FUNC_INDICATOR, 0x00, 0);
+
+    audio.play(AUDIO_EFFECT, CUE_FOLLOW_HIT);
+
+    currentStep = 4;
+  }
+
+}
+
+
+void RuliBrain::turnMeter() {
+
+  if ( initializeFunction ) {
+    ledsPanel->setWheelValues(0x00, 0x00, 0x04, 0x00, 0x00);
+    initializeFunction = 0;
+  }
+
+  switch(wheelEvent) {
+    case RIGHT_TURN: {
+      ledsPanel->rotate(RIGHT, 1, 0);
+      ledsPanel->setValueOR(WHITE, 0x04);
+      spinSound = 0;
+      break;
+    }
+    case LEFT_TURN:  {
+      ledsPanel->rotate(LEFT, 1, 0);
+      ledsPanel->setValueAND(WHITE, 0xF7);
+      spinSound = 1;
+      break;
+    }
+  }
+
+  switch ( ledsPanel->getValue(WHITE) ) {
+    case 0xFF: { ledsPanel->setWheelValues(0x00, 0x00, 0x04, 0x00, 0x00); break; }
+    case 0x00: { ledsPanel->setWheelValues(0xFF, 0xFF, 0xFB, 0xFF, 0xFF); break; }
+  }
+
+  playSpinSound();
+
+}
+
+
+void RuliBrain::velocityMeter() {
+
+  #define VELOCITY 0
+  #define PREV_VELOCITY 1
+
+  if ( initializeFunction ) {
+
+    data[VELOCITY] = 0;
+    data[PREV_VELOCITY] = 0;
+
+    ledsPanel->setWheelValues(0x00, 0x00, 0x00, 0x00, 0x00);
+
+    initializeFunction = 0;
+  }
+
+  if ( wheelEvent == RIGHT_TURN ) {
+    data[VELOCITY]++;
+    ledsPanel->setValue(YELLOW, 0, 0);
+  }
+  else if ( wheelEvent == LEFT_TURN )
+    spinning = 1;
+
+  if ( spinning )
+    switch ( getInterval(VELOCITY_METER_BLINK_INTERVAL, 100, 9) ) {
+      case 1: { ledsPanel->setValue(YELLOW, B11111110); break; }
+      case 2: { ledsPanel->setValue(YELLOW, B11111101); break; }
+      case 3: { ledsPanel->setValue(YELLOW, B11111011); break; }
+      case 4: { ledsPanel->setValue(YELLOW, B11110111); break; }
+      case 5: { ledsPanel->setValue(YELLOW, B11101111); break; }
+      case 6: { ledsPanel->setValue(YELLOW, B11011111); break; }
+      case 7: { ledsPanel->setValue(YELLOW, B10111111); break; }
+      case 8: { ledsPanel->setValue(YELLOW, B01111111); break; }
+      case 9: { spinning = 0; }
+    }
+
+  if ( getInterval(VELOCITY_METER_INTERVAL, 150, TOGGLE_STEPS) == ON ) {
+
+    for ( uint8_t i =  0 ; i < 32 ; i++ )
+      if ( i <= data[VELOCITY] )
+        ledsPanel->setWheelValues(i, 1, 0);
+      else
+        ledsPanel->setWheelValues(i, 0, 0);
+
+    if ( data[VELOCITY] != data[PREV_VELOCITY] ){
+      if ( data[VELOCITY] > 0 )
+        audio.play(AUDIO_SPIN, CUE_VELOCITY.at(data[VELOCITY] - 1));
+      else
+        audio.stop(AUDIO_SPIN);
+    }
+
+    data[PREV_VELOCITY] = data[VELOCITY];
+
+    ledsPanel->refresh();
+
+    data[VELOCITY] = 0;
+  }
+
+}
+
+
+void RuliBrain::customShape() {
+
+  #define CURSOR 0
+
+  /*
+   * El cursor se dibuja en la capa LAYER_CURSOR: el parpadeo
+   * lo enciende (BLEND_OR) o lo apaga (BLEND_MASK) sin alterar
+   * el dibujo, que se muestra tal cual (BLEND_NONE) al girar
+   * la rueda y durante la reproduccion
+   */
+  #define CURSOR_PLACE  ledsPanel->clearLayer(LAYER_CURSOR); ledsPanel->setLayerWheelValues(LAYER_CURSOR, data[CURSOR], 1);
+
+  /*
+   * Tiempo (ms) sin eventos luego del cual se
+   * reproduce en ciclo la animacion grabada
+   */
+  #define ANIMATION_IDLE_MS 4000
+
+  uint8_t steps, direction;
+
+  if ( initializeFunction ) {
+    spinSound = 0;
+    initializeFunction = 0;
+
+    // Dibujo reanudado: se continua desde el cursor resguardado
+    if ( resuming() ) {
+      data[CURSOR] %= WHEEL_LEDS;
+      CURSOR_PLACE;
+      ledsPanel->setBlend(LAYER_CURSOR, BLEND_OR);
+      ledsPanel->refresh();
+    }
+    else {
+      data[CURSOR] = 0;
+      CURSOR_PLACE;
+      ledsPanel->setBlend(LAYER_CURSOR, BLEND_NONE);
+      ledsPanel->setWheelValues(0x00, 0x00, 0x80, 0x00, 0x00);
+
+      // Reproduccion de la ultima animacion grabada
+      animation.play();
+    }
+  }
+
+  animation.tick();
+
+  /*
+   * Durante la reproduccion un evento la detiene y el
+   * dibujo continua a partir del cuadro visualizado
+   */
+  if ( animation.isPlaying() ) {
+
+    if ( selectorEvent != NONE || wheelEvent != NONE ) {
+      animation.stop();
+      resetInterval(CUSTOM_SHAPE_PLAY_INTERVAL);
+    }
+
+    return;
+  }
+
+  playSpinSound();
+
+  if ( selectorEvent != NONE || wheelEvent != NONE ) {
+
+    resetInterval(CUSTOM_SHAPE_PLAY_INTERVAL);
+
+    // El primer cambio del dibujo inicia una nueva grabacion
+    if ( animation.isRecording() == 0 &&
+         (wheelEvent == RIGHT_TURN || wheelEvent == LEFT_TURN || selectorEvent == SWITCH_CLICK) )
+      animation.record(ledsPanel->getValue());
+  }
+
+  /*
+   * Un giro rapido avanza varias posiciones: la rueda rota
+   * todas juntas con un unico refresco de los leds
+   */
+  switch(wheelEvent) {
+
+    case RIGHT_TURN:
+    case LEFT_TURN: {
+
+      steps = mainWheel->getSteps();
+      direction = ( wheelEvent == RIGHT_TURN ) ? RIGHT : LEFT;
+
+      data[CURSOR] = wheelStep(data[CURSOR], wheelEvent, steps);
+
+      // El dibujo rota bajo el cursor, visible mientras gira
+      CURSOR_PLACE;
+      ledsPanel->setBlend(LAYER_CURSOR, BLEND_NONE);
+
+      ledsPanel->rotate(direction, steps);
+      for ( uint8_t i = 0 ; i < steps ; i++ )
+        animation.addRotation(direction, ledsPanel->getValue());
+
+    }
+
+  }
+
+  switch(selectorEvent) {
+
+    case RIGHT_TURN:
+    case LEFT_TURN: {
+
+      data[CURSOR] = wheelStep(data[CURSOR], selectorEvent, rotarySelector->getSteps());
+      CURSOR_PLACE;
+
+      break;
+    }
+
+    case SWITCH_CLICK: {
+
+      ledsPanel->setWheelValues(data[CURSOR], ! ledsPanel->getWheelNValue(data[CURSOR]));
+
+      animation.addFrame(ledsPanel->getValue());
+
+      audio.play(AUDIO_EFFECT, CUE_SHAPE_DRAW);
+
+    }
+
+  }
+
+  if ( spinning == 0 )
+    switch ( getInterval(CUSTOM_SHAPE_BLINK_INTERVAL, 70, TOGGLE_STEPS) ) {
+      case ON: { ledsPanel->setBlend(LAYER_CURSOR, BLEND_OR); break; }
+      case OFF: { ledsPanel->setBlend(LAYER_CURSOR, BLEND_MASK); }
+    }
+
+  // Sin eventos por ANIMATION_IDLE_MS se reproduce lo grabado
+  if ( animation.isRecording() && getInterval(CUSTOM_SHAPE_PLAY_INTERVAL, ANIMATION_IDLE_MS, 1) == 1 ) {
+    ledsPanel->setBlend(LAYER_CURSOR, BLEND_NONE);
+    animation.play();
+  }
+
+
+}
+
+
+void RuliBrain::soundShooting() {
+
+  #define SOUND_NUMBER       0
+  #define LEDS_EFFECT_TYPE   1
+  #define LEDS_EFFECT_ACTIVE 2
+
+  if ( initializeFunction ) {
+    ledsPanel->setWheelValues(0x00, 0x00, 0x80, 0x00, 0x00);
+    data[SOUND_NUMBER]       = 0;
+    data[LEDS_EFFECT_TYPE]   = 0;
+    data[LEDS_EFFECT_ACTIVE] = 0;
+    initializeFunction       = 0;
+  }
+
+  switch ( wheelEvent ) {
+    case RIGHT_TURN: { ledsPanel->rotate(RIGHT); break; }
+    case LEFT_TURN:  { ledsPanel->rotate(LEFT);  break; }
+  }
+
+  if ( selectorEvent == SWITCH_CLICK ) {
+
+    byte soundNumber;
+
+    for ( soundNumber = 0 ; soundNumber < 40 ; soundNumber++ )
+      if ( ledsPanel->getWheelNValue(soundNumber) ) {
+        data[SOUND_NUMBER] = soundNumber;
+        break;
+      }
+
+    audio.play(AUDIO_EFFECT, CUE_SHOOTING.at(data[SOUND_NUMBER]));
+
+    // Durante el efecto los leds no indican el disparo
+    if ( data[LEDS_EFFECT_ACTIVE] == 0 )
+      outcomes.count(OUTCOME_SOUND_SHOOTING, data[SOUND_NUMBER]);
+
+    resetInterval(SOUND_SHOOTING_INTERVAL);
+
+    data[LEDS_EFFECT_ACTIVE] = 1;
+
+  }
+
+  if ( data[LEDS_EFFECT_ACTIVE] ) {
+    switch ( data[LEDS_EFFECT_TYPE] ) {
+      case 0: {
+        switch ( getInterval(SOUND_SHOOTING_INTERVAL, 50, 7) ) {
+          case 1: { ledsPanel->setWheelValues(0xff, 0x00, 0x00, 0x00, 0x00); break; }
+          case 2: { ledsPanel->setWheelValues(0x00, 0xff, 0x00, 0x00, 0x00); break; }
+          case 3: { ledsPanel->setWheelValues(0x00, 0x00, 0xff, 0x00, 0x00); break; }
+          case 4: { ledsPanel->setWheelValues(0x00, 0x00, 0x00, 0xff, 0x00); break; }
+          case 5: { ledsPanel->setWheelValues(0x00, 0x00, 0x00, 0x00, 0xff); break; }
+          case 6: { ledsPanel->setWheelValues(0x00, 0x00, 0x00, 0x00, 0x00); break; }
+          case 7: { ledsPanel->setWheelValues(data[SOUND_NUMBER], 1); data[LEDS_EFFECT_ACTIVE] = 0; }
+        }
+        break;
+      }
+      case 1: {
+        switch ( getInterval(SOUND_SHOOTING_INTERVAL, 50, 7) ) {
+          case 1: { ledsPanel->setWheelValues(0x10, 0x10, 0x10, 0x10, 0x10); break; }
+          case 2: { ledsPanel->setWheelValues(0x18, 0x18, 0x18, 0x18, 0x18); break; }
+          case 3: { ledsPanel->setWheelValues(0x3c, 0x3c, 0x3c, 0x3c, 0x3c); break; }
+          case 4: { ledsPanel->setWheelValues(0x7e, 0x7e, 0x7e, 0x7e, 0x7e); break; }
+          case 5: { ledsPanel->setWheelValues(0xff, 0xff, 0xff, 0xff, 0xff); break; }
+          case 6: { ledsPanel->setWheelValues(0x00, 0x00, 0x00, 0x00, 0x00); break; }
+          case 7: { ledsPanel->setWheelValues(data[SOUND_NUMBER], 1); data[LEDS_EFFECT_ACTIVE] = 0; }
+
+        }
+        break;
+      }
+      case 2: {
+        switch ( getInterval(SOUND_SHOOTING_INTERVAL, 50, 7) ) {
+          case 1: { ledsPanel->setWheelValues(0xff, 0xff, 0xff, 0xff, 0xff); break; }
+          case 2: { ledsPanel->setWheelValues(0x00, 0x00, 0x00, 0x00, 0x00); break; }
+          case 3: { ledsPanel->setWheelValues(0xff, 0xff, 0xff, 0xff, 0xff); break; }
+          case 4: { ledsPanel->setWheelValues(0x00, 0x00, 0x00, 0x00, 0x00); break; }
+          case 5: { ledsPanel->setWheelValues(0xff, 0xff, 0xff, 0xff, 0xff); break; }
+          case 6: { ledsPanel->setWheelValues(0x00, 0x00, 0x00, 0x00, 0x00); break; }
+          case 7: { ledsPanel->setWheelValues(data[SOUND_NUMBER], 1); data[LEDS_EFFECT_ACTIVE] = 0; }
+
+        }
+        break;
+      }
+      case 3: {
+        switch ( getInterval(SOUND_SHOOTING_INTERVAL, 10, 22) ) {
+          case 1:  { ledsPanel->setWheelValues(B10000000, B00000001, B00000000, B00000000, B00000000); break; }
+          case 2:  { ledsPanel->setWheelValues(B11000000, B00000011, B00000000, B00000000, B00000000); break; }
+          case 3:  { ledsPanel->setWheelValues(B11100000, B00000111, B00000000, B00000000, B00000000); break; }
+          case 4:  { ledsPanel->setWheelValues(B11110000, B00001111, B00000000, B00000000, B00000000); break; }
+          case 5:  { ledsPanel->setWheelValues(B11111000, B00011111, B00000000, B00000000, B00000000); break; }
+          case 6:  { ledsPanel->setWheelValues(B11111100, B00111111, B00000000, B00000000, B00000000); break; }
+          case 7:  { ledsPanel->setWheelValues(B11111110, B01111111, B00000000, B00000000, B00000000); break; }
+          case 8:  { ledsPanel->setWheelValues(B11111111, B11111111, B00000000, B00000000, B00000000); break; }
+          case 9:  { ledsPanel->setWheelValues(B11111111, B11111111, B00000001, B00000000, B10000000); break; }
+          case 10: { ledsPanel->setWheelValues(B11111111, B11111111, B00000011, B00000000, B11000000); break; }
+          case 11: { ledsPanel->setWheelValues(B11111111, B11111111, B00000111, B00000000, B11100000); break; }
+          case 12: { ledsPanel->setWheelValues(B11111111, B11111111, B00001111, B00000000, B11110000); break; }
+          case 13: { ledsPanel->setWheelValues(B11111111, B11111111, B00011111, B00000000, B11111000); break; }
+          case 14: { ledsPanel->setWheelValues(B11111111, B11111111, B00111111, B00000000, B11111100); break; }
+          case 15: { ledsPanel->setWheelValues(B11111111, B11111111, B01111111, B00000000, B11111110); break; }
+          case 16: { ledsPanel->setWheelValues(B11111111, B11111111, B11111111, B00000000, B11111111); break; }
+          case 17: { ledsPanel->setWheelValues(B11111111, B11111111, B11111111, B10000001, B11111111); break; }
+          case 18: { ledsPanel->setWheelValues(B11111111, B11111111, B11111111, B11000011, B11111111); break; }
+          case 19: { ledsPanel->setWheelValues(B11111111, B11111111, B11111111, B11100111, B11111111); break; }
+          case 20: { ledsPanel->setWheelValues(B11111111, B11111111, B11111111, B11111111, B11111111); break; }
+          case 21: { ledsPanel->setWheelValues(B00000000, B00000000, B00000000, B00000000, B00000000); break; }
+          case 22: { ledsPanel->setWheelValues(data[SOUND_NUMBER], 1); data[LEDS_EFFECT_ACTIVE] = 0; }
+        }
+        break;
+      }
+    }
+
+    if ( data[LEDS_EFFECT_ACTIVE] == 0 )
+      if ( data[LEDS_EFFECT_TYPE] == 3 )
+        data[LEDS_EFFECT_TYPE] = 0;
+      else
+        data[LEDS_EFFECT_TYPE]++;
+
+  }
+
+}
+
+
+void RuliBrain::music() {
+
+  #define PLAYING_TRACK   0
+  #define TRACK_SELECTOR  1
+  #define BEAT_LED        2
+  #define VOLUME_SHOWN    3
+  #define NO_PLAYING     99
+
+  /*
+   * Duracion (ms) del encendido de leds
+   * en cada pulso del tema
+   */
+  #define BEAT_LED_MS    60
+
+  #define TRACK_NEXT  if ( data[PLAYING_TRACK] < 39 ) data[PLAYING_TRACK]++; else data[PLAYING_TRACK] = 0;
+
+  /*
+   * Columna indicadora en reposo: el led de la funcionalidad y el
+   * progreso del tema en los 7 restantes (duracion del catalogo de
+   * sonidos, sin consultar al reproductor). Sin duracion, solo el led
+   */
+  uint8_t indicator = 0xFF << (7 - (audio.getProgress(AUDIO_MUSIC) >> 5));
+
+
+  if ( initializeFunction ) {
+
+    // Reanudada, continua el tema y la posicion del selector resguardados
+    if ( resuming() ) {
+      if ( data[PLAYING_TRACK] >= WHEEL_LEDS )
+        data[PLAYING_TRACK] = NO_PLAYING;
+      data[TRACK_SELECTOR] %= WHEEL_LEDS;
+    }
+    else {
+      data[PLAYING_TRACK] = 0; //NO_PLAYING;
+      data[TRACK_SELECTOR] = 0;
+    }
+
+    data[BEAT_LED] = 0;
+    data[VOLUME_SHOWN] = 0;
+
+    /*
+     * El led del tema en reproduccion se dibuja en LAYER_OVERLAY:
+     * sobre el led del selector lo invierte sin borrarlo
+     */
+    ledsPanel->setBlend(LAYER_OVERLAY, BLEND_XOR);
+    ledsPanel->setWheelValues(0x00, 0x00, 0x00, 0x00, 0x00);
+    ledsPanel->setWheelValues(data[TRACK_SELECTOR], 1);
+
+    if ( data[PLAYING_TRACK] != NO_PLAYING ) {
+      audio.play(AUDIO_MUSIC, CUE_MUSIC_TRACK.at(data[PLAYING_TRACK]));
+      beatSync.start(data[PLAYING_TRACK]);
+    }
+
+    initializeFunction = 0;
+  }
+
+  if ( audio.finished(AUDIO_MUSIC) ) {
+    ledsPanel->clearLayer(LAYER_OVERLAY);
+    TRACK_NEXT;
+    audio.play(AUDIO_MUSIC, CUE_MUSIC_TRACK.at(data[PLAYING_TRACK]));
+    beatSync.start(data[PLAYING_TRACK]);
+  }
+
+  // Tema reanudado desde el principio luego de otro sonido
+  if ( audio.isMusicRestarted() && data[PLAYING_TRACK] != NO_PLAYING )
+    beatSync.start(data[PLAYING_TRACK]);
+
+  /*
+   * El selector salta las posiciones del giro (acelerado) y
+   * los leds se actualizan con un unico refresco
+   */
+  if ( wheelEvent == RIGHT_TURN || wheelEvent == LEFT_TURN ) {
+    ledsPanel->setWheelValues(data[TRACK_SELECTOR], 0, 0);
+    data[TRACK_SELECTOR] = wheelStep(data[TRACK_SELECTOR], wheelEvent, mainWheel->getSteps());
+    ledsPanel->setWheelValues(data[TRACK_SELECTOR], 1);
+  }
+
+  if ( funcSelectorIsActive == 0 )
+    switch (selectorEvent) {
+
+      case RIGHT_TURN: { mp3Player->volumeUp(); break; }
+
+      case LEFT_TURN: { mp3Player->volumeDown(); break; }
+
+      case SWITCH_CLICK: {
+
+        if ( data[PLAYING_TRACK] == data[TRACK_SELECTOR] ) {
+          data[PLAYING_TRACK] = NO_PLAYING;
+          audio.stop(AUDIO_MUSIC);
+          beatSync.stop();
+          ledsPanel->clearLayer(LAYER_OVERLAY);
+        }
+        else {
+          ledsPanel->clearLayer(LAYER_OVERLAY);
+          data[PLAYING_TRACK] = data[TRACK_SELECTOR];
+          audio.play(AUDIO_MUSIC, CUE_MUSIC_TRACK.at(data[PLAYING_TRACK]));
+          beatSync.start(data[PLAYING_TRACK]);
+        }
+
+      }
+
+    }
+
+  if ( selectorEvent == RIGHT_TURN || selectorEvent == LEFT_TURN ) {
+
+    uint8_t mask = 0x01;
+    uint8_t vol = mp3Player->getVolume();
+
+    for ( uint8_t i = 0 ; i < vol / 4 ; i++ ) {
+      mask <<= 1;
+      mask |= 0x01;
+    }
+
+    ledsPanel->setValue(FUNC_INDICATOR, mask);
+    data[VOLUME_SHOWN] = 1;
+    resetInterval(MUSIC_VOLUME_INTERVAL);
+
+  }
+
+
+  /*
+   * Con mapa de pulsos el led del tema en reproduccion se enciende
+   * en cada pulso y los pulsos acentuados encienden ademas la
+   * columna indicadora. Sin mapa se mantiene el parpadeo fijo
+   */
+  if ( data[PLAYING_TRACK] != NO_PLAYING && beatSync.isRunning() ) {
+
+    switch ( beatSync.poll() ) {
+      case ACCENT_BEAT: {
+        if ( data[VOLUME_SHOWN] == 0 )
+          ledsPanel->setValue(FUNC_INDICATOR, 0xFF, 0);
+        // continua en BEAT
+      }
+      case BEAT: {
+        ledsPanel->setLayerWheelValues(LAYER_OVERLAY, data[PLAYING_TRACK], 1);
+        resetInterval(MUSIC_BEAT_INTERVAL);
+        data[BEAT_LED] = 1;
+      }
+    }
+
+    if ( data[BEAT_LED] && getInterval(MUSIC_BEAT_INTERVAL, BEAT_LED_MS, 1) == 1 ) {
+      if ( data[VOLUME_SHOWN] == 0 )
+        ledsPanel->setValue(FUNC_INDICATOR, indicator, 0);
+      ledsPanel->setLayerWheelValues(LAYER_OVERLAY, data[PLAYING_TRACK], 0);
+      data[BEAT_LED] = 0;
+    }
+
+  }
+  else if ( data[PLAYING_TRACK] != NO_PLAYING )
+    switch ( getInterval(MUSIC_BLINK_INTERVAL, 170, TOGGLE_STEPS) ) {
+      case ON: { ledsPanel->setLayerWheelValues(LAYER_OVERLAY, data[PLAYING_TRACK], 1); break; }
+      case OFF: { ledsPanel->setLayerWheelValues(LAYER_OVERLAY, data[PLAYING_TRACK], 0); }
+    }
+
+  if ( selectorEvent == SWITCH_CLICK || getInterval(MUSIC_VOLUME_INTERVAL, 1000, 5) == 5 ) {
+    ledsPanel->setValue(FUNC_INDICATOR, indicator);
+    data[VOLUME_SHOWN] = 0;
+    EEPROM.write(EEPROM_VOLUME, mp3Player->getVolume());
+    ACCOUNTING(countWrites(ACC_PARAMS, 1));
+  }
+
+  // El progreso avanza un led cada 1/8 del tema: un refresco por led
+  if ( data[VOLUME_SHOWN] == 0 && data[BEAT_LED] == 0 && ledsPanel->getValue(FUNC_INDICATOR) != indicator )
+    ledsPanel->setValue(FUNC_INDICATOR, indicator);
+
+}
+
+
+void RuliBrain::userProgram() {
+
+  uint8_t events;
+
+  if ( initializeFunction ) {
+    ledsPanel->setWheelValues(0x00, 0x00, 0x00, 0x00, 0x00);
+    ruliVM.load(EEPROM_VM_PROGRAM, ruliProgram, RULI_PROGRAM_SIZE);
+    initializeFunction = 0;
+  }
+
+  /*
+   * Mientras el selector de funcionalidades esta activo
+   * sus eventos no se entregan al programa
+   */
+  events = wheelEvent;
+
+  if ( funcSelectorIsActive == 0 )
+    events |= selectorEvent << 4;
+
+  if ( audio.finished(AUDIO_EFFECT) )
+    events |= VM_EVENT_FINISHED;
+
+  ruliVM.tick(events);
+
+}
+
+
+/**
+ * Resguarda el estado luego de SNAPSHOT_IDLE_MS sin eventos, fuera
+ * del selector, del ajuste de volumen y de welcome(), IDDLE y STREAM.
+ * Los leds se resguardan sin las capas (cursor, parpadeos) para
+ * no reescribir la EEPROM en cada resguardo
+ */
+void RuliBrain::snapshotCheck(void) {
+
+  uint8_t state[SNAPSHOT_STATE];
+
+  snapshot.update();
+
+  if ( wheelEvent != NONE || selectorEvent != NONE )
+    resetInterval(SNAPSHOT_INTERVAL);
+
+  if ( currentFunction < SIMPLE_ROULETTE || currentFunction > USER_PROGRAM ||
+       initializeFunction || funcSelectorIsActive || volumeSettingIsActive || speaking || spinning )
+    return;
+
+  if ( getInterval(SNAPSHOT_INTERVAL, SNAPSHOT_IDLE_MS, 1) != 1 )
+    return;
+
+  memset(state, 0x00, SNAPSHOT_STATE);
+  state[SNAPSHOT_FUNCTION] = currentFunction;
+
+  switch ( currentFunction ) {
+
+    case SIMPLE_ROULETTE: {
+      state[SNAPSHOT_DATA + ROULETTE_STEP] = currentStep;
+      memcpy(&state[SNAPSHOT_LEDS], &ledsPanel->getValue()[BLUE], 5);
+      break;
+    }
+
+    case CUSTOM_SHAPE: {
+
+      // Durante la reproduccion los leds muestran la animacion
+      if ( animation.isPlaying() )
+        return;
+
+      state[SNAPSHOT_DATA + CURSOR] = data[CURSOR];
+      memcpy(&state[SNAPSHOT_LEDS], &ledsPanel->getValue()[BLUE], 5);
+      break;
+    }
+
+    case MUSIC: {
+      state[SNAPSHOT_DATA + PLAYING_TRACK] = data[PLAYING_TRACK];
+      state[SNAPSHOT_DATA + TRACK_SELECTOR] = data[TRACK_SELECTOR];
+    }
+  }
+
+  snapshot.save(state);
+
+}
+
+
+byte RuliBrain::resuming(void) {
+
+  uint8_t state[SNAPSHOT_STATE];
+
+  if ( currentFunction != resumeFunction || ! snapshot.restore(state) )
+    return 0;
+
+  resumeFunction = WELCOME;
+
+  memcpy(data, &state[SNAPSHOT_DATA], DATA_SIZE);
+
+  for ( uint8_t i = 0 ; i < 5 ; i++ )
+    ledsPanel->setValue(BLUE + i, state[SNAPSHOT_LEDS + i], 0);
+
+  return 1;
+
+}
+
+
+#ifdef RULI_STREAM
+void RuliBrain::streamShow() {
+
+  if ( initializeFunction ) {
+    ledsPanel->clearAll();
+    initializeFunction = 0;
+  }
+
+  // El indicador del selector queda en LAYER_UI, sobre los cuadros
+  lightStream.tick();
+
+}
+#endif
@@ -0,0 +1,246 @@
+/*
+ * RuliVM.cpp
+ * Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)
+ */
+
+#include <Arduino.h>
+#include <EEPROM.h>
+#include <avr/pgmspace.h>
+
+#include "RuliVM.h"
+
+
+#define VM_PROGRAM_KEY  'V'
+
+
+void RuliVM::begin(LedsPanel *pledsPanel, AudioManager *paudio) {
+
+  ledsPanel = pledsPanel;
+  audio = paudio;
+
+  flashProgram = NULL;
+  programSize = 0;
+
+  reset();
+
+}
+
+
+void RuliVM::load(uint16_t address, const uint8_t *fallback, uint8_t size) {
+
+  uint8_t length = EEPROM.read(address + 1);
+
+  if ( EEPROM.read(address) == VM_PROGRAM_KEY && length > 0 && length <= VM_PROGRAM_SIZE ) {
+    flashProgram = NULL;
+    eepromAddress = address + 2;
+    programSize = length;
+  }
+  else {
+    flashProgram = fallback;
+    programSize = size;
+  }
+
+  reset();
+
+}
+
+
+void RuliVM::reset(void) {
+
+  memset(registers, 0x00, sizeof(registers));
+  pc = 0;
+  zeroFlag = 0;
+  dirty = 0;
+  state = programSize ? VM_RUNNING : VM_HALTED;
+
+}
+
+
+uint8_t RuliVM::getState(void) {
+
+  return state;
+
+}
+
+
+/**
+ * Lee el proximo byte del programa. Fuera de rango
+ * detiene la ejecucion con estado VM_FAULT
+ */
+uint8_t RuliVM::fetch(void) {
+
+  if ( pc >= programSize ) {
+    state = VM_FAULT;
+    return OP_HALT;
+  }
+
+  if ( flashProgram )
+    return pgm_read_byte(&flashProgram[pc++]);
+
+  return EEPROM.read(eepromAddress + pc++);
+
+}
+
+
+/**
+ * Salto a [address]. Un destino fuera del programa
+ * detiene la ejecucion con estado VM_FAULT
+ */
+void RuliVM::jump(uint16_t address) {
+
+  if ( address < programSize )
+    pc = address;
+  else
+    state = VM_FAULT;
+
+}
+
+
+void RuliVM::tick(uint8_t events) {
+
+  uint8_t budget = VM_BUDGET;
+  uint8_t op, a, b;
+  uint16_t address;
+
+  // Atencion de las esperas pendientes
+  switch ( state ) {
+
+    case VM_WAIT_TIME: {
+      if ( millis() - waitTimestamp < waitMs )
+        return;
+      state = VM_RUNNING;
+      break;
+    }
+
+    case VM_WAIT_EVENT: {
+      if ( events == 0 )
+        return;
+      registers[waitRegister] = events;
+      state = VM_RUNNING;
+      break;
+    }
+
+    case VM_HALTED:
+    case VM_FAULT:
+      return;
+  }
+
+  while ( state == VM_RUNNING && budget-- ) {
+
+    op = fetch();
+
+    switch ( op ) {
+
+      case OP_HALT: { if ( state == VM_RUNNING ) state = VM_HALTED; break; }
+
+      case OP_LDI:  { a = fetch(); registers[a & 0x07] = fetch(); break; }
+      case OP_MOV:  { a = fetch(); b = fetch(); registers[a & 0x07]  = registers[b & 0x07]; break; }
+      case OP_ADD:  { a = fetch(); b = fetch(); registers[a & 0x07] += registers[b & 0x07]; break; }
+      case OP_SUB:  { a = fetch(); b = fetch(); registers[a & 0x07] -= registers[b & 0x07]; break; }
+      case OP_AND:  { a = fetch(); b = fetch(); registers[a & 0x07] &= registers[b & 0x07]; break; }
+      case OP_OR:   { a = fetch(); b = fetch(); registers[a & 0x07] |= registers[b & 0x07]; break; }
+      case OP_XOR:  { a = fetch(); b = fetch(); registers[a & 0x07] ^= registers[b & 0x07]; break; }
+      case OP_INC:  { registers[fetch() & 0x07]++; break; }
+      case OP_DEC:  { registers[fetch() & 0x07]--; break; }
+      case OP_NOT:  { a = fetch() & 0x07; registers[a] = ~registers[a]; break; }
+      case OP_SHL:  { registers[fetch() & 0x07] <<= 1; break; }
+      case OP_SHR:  { registers[fetch() & 0x07] >>= 1; break; }
+      case OP_ANDI: { a = fetch(); registers[a & 0x07] &= fetch(); break; }
+      case OP_RND:  { a = fetch(); b = fetch(); registers[a & 0x07] = (uint8_t) random(0, b); break; }
+
+      case OP_SETS: {
+        a = fetch(); b = fetch();
+        if ( a <= RED ) {
+          ledsPanel->setValue(a, registers[b & 0x07], 0);
+          dirty = 1;
+        }
+        break;
+      }
+
+      case OP_GETS: {
+        a = fetch(); b = fetch();
+        registers[a & 0x07] = ( b <= RED ) ? ledsPanel->getValue(b) : 0;
+        break;
+      }
+
+      case OP_LED: {
+        a = fetch(); b = fetch();
+        ledsPanel->setWheelValues(registers[a & 0x07], registers[b & 0x07], 0);
+        dirty = 1;
+        break;
+      }
+
+      case OP_GLED: {
+        a = fetch(); b = fetch();
+        registers[a & 0x07] = ledsPanel->getWheelNValue(registers[b & 0x07] % 40);
+        break;
+      }
+
+      case OP_ROT: {
+        a = fetch(); b = fetch();
+        ledsPanel->rotate(a ? LEFT : RIGHT, b, 0);
+        dirty = 1;
+        break;
+      }
+
+      case OP_SHOW: {
+        ledsPanel->refresh();
+        dirty = 0;
+        break;
+      }
+
+      case OP_PLAY: { a = fetch(); b = fetch(); audio->play(AUDIO_EFFECT, a, registers[b & 0x07]); break; }
+      case OP_STOP: { audio->stop(AUDIO_EFFECT); break; }
+
+      case OP_WAIT: {
+        a = fetch(); b = fetch();
+        waitMs = a | (b << 8);
+        waitTimestamp = millis();
+        state = VM_WAIT_TIME;
+        break;
+      }
+
+      case OP_WEVT: {
+        waitRegister = fetch() & 0x07;
+        state = VM_WAIT_EVENT;
+        break;
+      }
+
+      case OP_CMP:  { a = fetch(); b = fetch(); zeroFlag = ( registers[a & 0x07] == b ); break; }
+      case OP_CMPR: { a = fetch(); b = fetch(); zeroFlag = ( registers[a & 0x07] == registers[b & 0x07] ); break; }
+
+      case OP_JMP:
+      case OP_JZ:
+      case OP_JNZ: {
+        address = fetch();
+        address |= fetch() << 8;
+        if ( op == OP_JMP || (op == OP_JZ && zeroFlag) || (op == OP_JNZ && !zeroFlag) )
+          jump(address);
+        break;
+      }
+
+      case OP_DJNZ: {
+        a = fetch() & 0x07;
+        address = fetch();
+        address |= fetch() << 8;
+        if ( --registers[a] )
+          jump(address);
+        break;
+      }
+
+      default: { state = VM_FAULT; }
+
+    }
+
+  }
+
+  /*
+   * Los cambios en los leds se muestran una sola vez por tick
+   * (o antes, con OP_SHOW) y siempre antes de una espera
+   */
+  if ( dirty ) {
+    ledsPanel->refresh();
+    dirty = 0;
+  }
+
+}
@@ -0,0 +1,171 @@
+/*
+ * Snapshot.cpp
+ * Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)
+ */
+
+#include <Arduino.h>
+#include <EEPROM.h>
+#include <avr/eeprom.h>
+
+#include "Snapshot.h"
+
+
+#define SNAPSHOT_IDLE   (SNAPSHOT_MAX_STATE + 2)
+
+// Polinomio del CRC-8 (x^8 + x^2 + x + 1)
+#define CRC8_POLY       0x07
+
+
+void Snapshot::begin(uint16_t address, uint8_t size) {
+
+  uint8_t other[SNAPSHOT_MAX_STATE + 2];
+  byte otherValid;
+
+  baseAddress = address;
+  stateSize = size > SNAPSHOT_MAX_STATE ? SNAPSHOT_MAX_STATE : size;
+  cursor = SNAPSHOT_IDLE;
+
+#ifdef RULI_ACCOUNTING
+  writes = 0;
+#endif
+
+  valid = readSlot(0, image);
+  otherValid = readSlot(1, other);
+  lastSlot = 0;
+
+  /*
+   * Con ambos slots validos el mas reciente es el de
+   * secuencia mayor (en aritmetica modulo 256)
+   */
+  if ( otherValid && ( ! valid || (int8_t) (other[0] - image[0]) > 0 ) ) {
+    memcpy(image, other, SNAPSHOT_SLOT_SIZE(stateSize));
+    valid = 1;
+    lastSlot = 1;
+  }
+
+  if ( ! valid )
+    memset(image, 0x00, sizeof(image));
+
+  writeSlot = lastSlot;
+
+}
+
+
+uint16_t Snapshot::slotAddress(uint8_t slot) {
+
+  return baseAddress + slot * SNAPSHOT_SLOT_SIZE(stateSize);
+
+}
+
+
+uint8_t Snapshot::crc(const uint8_t *buffer, uint8_t size) {
+
+  uint8_t value = 0;
+
+  for ( uint8_t i = 0 ; i < size ; i++ ) {
+
+    value ^= buffer[i];
+
+    for ( uint8_t bit = 0 ; bit < 8 ; bit++ )
+      value = ( value & 0x80 ) ? (value << 1) ^ CRC8_POLY : value << 1;
+  }
+
+  return value;
+
+}
+
+
+/**
+ * Lee el slot [slot] en [buffer] y verifica su CRC. Una
+ * EEPROM en blanco (0xFF) nunca resulta valida
+ */
+byte Snapshot::readSlot(uint8_t slot, uint8_t *buffer) {
+
+  uint16_t address = slotAddress(slot);
+  byte blank = 1;
+
+  for ( uint8_t i = 0 ; i < SNAPSHOT_SLOT_SIZE(stateSize) ; i++ ) {
+    buffer[i] = EEPROM.read(address + i);
+    if ( buffer[i] != 0xFF )
+      blank = 0;
+  }
+
+  return ! blank && crc(buffer, stateSize + 1) == buffer[stateSize + 1];
+
+}
+
+
+byte Snapshot::restore(uint8_t *state) {
+
+  if ( ! valid )
+    return 0;
+
+  memcpy(state, &image[1], stateSize);
+
+  return 1;
+
+}
+
+
+void Snapshot::save(const uint8_t *state) {
+
+  if ( valid && memcmp(state, &image[1], stateSize) == 0 )
+    return;
+
+  /*
+   * Un resguardo en escritura se reemplaza en el mismo slot: el
+   * otro conserva el ultimo completo. La secuencia solo avanza
+   * respecto del ultimo completo
+   */
+  if ( cursor == SNAPSHOT_IDLE ) {
+    writeSlot = valid ? lastSlot ^ 1 : 0;
+    image[0]++;
+  }
+
+  memcpy(&image[1], state, stateSize);
+  image[stateSize + 1] = crc(image, stateSize + 1);
+  valid = 1;
+
+  cursor = 0;
+
+}
+
+
+byte Snapshot::isWriting(void) {
+
+  return cursor != SNAPSHOT_IDLE;
+
+}
+
+
+void Snapshot::update(void) {
+
+  if ( cursor == SNAPSHOT_IDLE || ! eeprom_is_ready() )
+    return;
+
+  // EEPROM.update() no escribe los bytes sin cambios
+#ifdef RULI_ACCOUNTING
+  if ( EEPROM.read(slotAddress(writeSlot) + cursor) != image[cursor] )
+    writes++;
+#endif
+  EEPROM.update(slotAddress(writeSlot) + cursor, image[cursor]);
+
+  if ( ++cursor == SNAPSHOT_SLOT_SIZE(stateSize) ) {
+    lastSlot = writeSlot;
+    cursor = SNAPSHOT_IDLE;
+  }
+
+}
+
+
+#ifdef RULI_ACCOUNTING
+uint16_t Snapshot::getWrites(void) {
+
+  uint16_t ret = writes;
+
+  writes = 0;
+
+  return ret;
+
+}
+#endif
@@ -0,0 +1,495 @@
+/*
+ * SyncBus.cpp
+ * Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)
+ */
+
+#ifdef RULI_SYNC
+
+#include <Arduino.h>
+
+#include "SyncBus.h"
+
+
+// Mayor que cualquier tiempo de 24 bits
+#define RACE_NO_TIME     0x1000000UL
+
+
+void SyncBus::begin(uint8_t pdePin) {
+
+  dePin = pdePin;
+
+  // Receptor habilitado salvo al transmitir
+  pinMode(dePin, OUTPUT);
+  digitalWrite(dePin, LOW);
+
+  Serial.begin(SYNC_BAUDS);
+
+  unit = SYNC_MAX_UNITS;
+
+  rxCount = 0;
+  txCount = 0;
+
+  master = 0;
+  masterUnit = 0;
+  beaconTimestamp = millis();
+  beaconCycle = 0;
+
+  clockOffset = 0;
+  offsetStamp = 0;
+  clockDrift = 0;
+  windowCount = 0;
+  locked = 0;
+
+  lastFrame = SYNC_NO_FRAME;
+
+  eventType = SE_NONE;
+  raceOpen = 0;
+
+}
+
+
+void SyncBus::setUnit(uint8_t punit) {
+
+  unit = ( punit >= 1 && punit <= SYNC_MAX_UNITS ) ? punit : SYNC_MAX_UNITS;
+
+}
+
+
+uint8_t SyncBus::getUnit(void) {
+
+  return unit;
+
+}
+
+
+byte SyncBus::isMaster(void) {
+
+  return master;
+
+}
+
+
+byte SyncBus::isLocked(void) {
+
+  return master || locked;
+
+}
+
+
+unsigned long SyncBus::clock(void) {
+
+  unsigned long now = micros();
+
+  return now + clockOffset + drift(now - offsetStamp);
+
+}
+
+
+/**
+ * Correccion (us) por deriva luego de [elapsed] us desde el
+ * ultimo ajuste, sin desbordar 32 bits
+ */
+long SyncBus::drift(unsigned long elapsed) {
+
+  if ( elapsed > SYNC_HOLDOVER_US )
+    elapsed = SYNC_HOLDOVER_US;
+
+  return ((long) (elapsed >> 6) * clockDrift) >> 14;
+
+}
+
+
+/**
+ * Incorpora la deriva acumulada y el error [residual] (us)
+ * al desplazamiento y reinicia la cuenta de la deriva
+ */
+void SyncBus::rebase(long residual) {
+
+  unsigned long now = micros();
+
+  clockOffset += drift(now - offsetStamp) + residual;
+  offsetStamp = now;
+
+}
+
+
+uint8_t SyncBus::getEvent(void) {
+
+  uint8_t ret = eventType;
+
+  eventType = SE_NONE;
+
+  return ret;
+
+}
+
+
+unsigned long SyncBus::getEventValue(void) {
+
+  return eventValue;
+
+}
+
+
+unsigned long SyncBus::getRaceDue(void) {
+
+  return raceDue;
+
+}
+
+
+uint16_t SyncBus::getFrame(void) {
+
+  return lastFrame;
+
+}
+
+
+void SyncBus::deliver(uint8_t type, unsigned long value) {
+
+  eventType = type;
+  eventValue = value;
+
+}
+
+
+void SyncBus::update(void) {
+
+  uint8_t sum, i;
+  unsigned long now, phase;
+  int pending;
+
+  /*
+   * Solo se procesan los bytes ya recibidos al comenzar la
+   * pasada (ver LightStream::receive())
+   */
+  pending = Serial.available();
+
+  while ( pending-- > 0 ) {
+
+    rxBuffer[rxCount] = Serial.read();
+
+    if ( rxCount == 0 && rxBuffer[0] != SYNC_SYNC )
+      continue;
+
+    if ( ++rxCount < SYNC_RECORD_SIZE )
+      continue;
+
+    sum = 0;
+    for ( i = 1 ; i < SYNC_RECORD_SIZE ; i++ )
+      sum += rxBuffer[i];
+
+    if ( sum ) {
+      for ( i = 1 ; i < SYNC_RECORD_SIZE && rxBuffer[i] != SYNC_SYNC ; i++ );
+      rxCount = SYNC_RECORD_SIZE - i;
+      memmove(rxBuffer, &rxBuffer[i], rxCount);
+      continue;
+    }
+
+    rxCount = 0;
+
+    record();
+  }
+
+  /*
+   * Eleccion: el reloj comun sigue corriendo con el ultimo
+   * desplazamiento, el nuevo master lo continua sin saltos
+   */
+  if ( ! master &&
+       millis() - beaconTimestamp >= SYNC_MASTER_TIMEOUT_MS + unit * (unsigned long) SYNC_ELECTION_STEP_MS ) {
+    master = 1;
+    masterUnit = unit;
+    rebase(0);
+    clockDrift = 0;
+    beaconCycle = clock() / SYNC_BEACON_US;
+  }
+
+  now = clock();
+  phase = now % SYNC_BEACON_US;
+
+  if ( master ) {
+
+    // Cierre de la carrera: resultado para todas las unidades
+    if ( raceOpen && (long) (now - raceDue) >= SYNC_RACE_WINDOW_MS * 1000L ) {
+      raceOpen = 0;
+      queue(SY_EVENT, now, SE_RACE_RESULT, raceUnit);
+      deliver(SE_RACE_RESULT, raceUnit);
+    }
+
+    // Beacon y eventos en el turno 0, una vez por ciclo
+    if ( now / SYNC_BEACON_US != beaconCycle &&
+         phase < SYNC_SLOT_US - (SYNC_TX_SLOTS + 1) * SYNC_RECORD_US ) {
+      beaconCycle = now / SYNC_BEACON_US;
+      beacon();
+    }
+  }
+  else if ( locked && txCount &&
+            phase >= unit * SYNC_SLOT_US &&
+            phase < (unit + 1) * SYNC_SLOT_US - SYNC_TX_SLOTS * SYNC_RECORD_US )
+    send();
+
+}
+
+
+/**
+ * Procesa un registro valido recibido en rxBuffer
+ */
+void SyncBus::record(void) {
+
+  uint8_t type = rxBuffer[1], sender = rxBuffer[2], event = rxBuffer[7];
+  unsigned long stamp, value, elapsed;
+  long residual;
+
+  stamp = rxBuffer[3] | ((unsigned long) rxBuffer[4] << 8) |
+    ((unsigned long) rxBuffer[5] << 16) | ((unsigned long) rxBuffer[6] << 24);
+  value = rxBuffer[8] | ((unsigned long) rxBuffer[9] << 8) | ((unsigned long) rxBuffer[10] << 16);
+
+  switch ( type ) {
+
+    case SY_BEACON: {
+
+      // Un master solo cede ante una unidad de numero menor
+      if ( master ) {
+        if ( sender >= unit )
+          break;
+        master = 0;
+        raceOpen = 0;
+      }
+
+      /*
+       * Error del reloj con la demora de este beacon: el registro
+       * termino de llegar SYNC_RECORD_US despues de su envio, mas
+       * la espera hasta esta pasada del lazo principal
+       */
+      residual = (long) (stamp + SYNC_RECORD_US - clock());
+
+      // Nuevo master: ajuste inmediato, deriva desconocida
+      if ( sender != masterUnit || ! locked ) {
+        masterUnit = sender;
+        rebase(residual);
+        residual = 0;
+        clockDrift = 0;
+        driftReady = 0;
+        windowCount = 0;
+      }
+
+      if ( windowCount == 0 || residual > windowResidual )
+        windowResidual = residual;
+
+      if ( ++windowCount == SYNC_WINDOW ) {
+
+        elapsed = micros() - offsetStamp;
+        rebase(windowResidual);
+
+        /*
+         * El error de la ventana acumula la pendiente mal estimada
+         * desde el ajuste anterior (no en la primera: viene de un
+         * unico beacon)
+         */
+        if ( driftReady && windowResidual > -SYNC_DRIFT_STEP_US && windowResidual < SYNC_DRIFT_STEP_US ) {
+          clockDrift += ((windowResidual << 14) / (long) (elapsed >> 6)) >> SYNC_DRIFT_SHIFT;
+          clockDrift = constrain(clockDrift, -SYNC_DRIFT_MAX, SYNC_DRIFT_MAX);
+        }
+
+        driftReady = 1;
+        windowCount = 0;
+      }
+
+      locked = 1;
+      beaconTimestamp = millis();
+      break;
+    }
+
+    case SY_EVENT: {
+
+      if ( master || sender != masterUnit )
+        break;
+
+      if ( event == SE_RACE_START )
+        raceDue = stamp;
+
+      deliver(event, value);
+      break;
+    }
+
+    case SY_REPORT: {
+
+      if ( master && event == SE_RACE_REPORT )
+        arbitrate(sender, value);
+      break;
+    }
+
+    case SY_UNIT: {
+      setUnit(value);
+      deliver(SE_UNIT, unit);
+    }
+  }
+
+}
+
+
+void SyncBus::build(uint8_t *buffer, uint8_t type, unsigned long stamp, uint8_t event, unsigned long value) {
+
+  uint8_t sum = 0;
+
+  buffer[0] = SYNC_SYNC;
+  buffer[1] = type;
+  buffer[2] = unit;
+  buffer[3] = stamp;
+  buffer[4] = stamp >> 8;
+  buffer[5] = stamp >> 16;
+  buffer[6] = stamp >> 24;
+  buffer[7] = event;
+  buffer[8] = value;
+  buffer[9] = value >> 8;
+  buffer[10] = value >> 16;
+
+  for ( uint8_t i = 1 ; i < SYNC_RECORD_SIZE - 1 ; i++ )
+    sum += buffer[i];
+
+  buffer[SYNC_RECORD_SIZE - 1] = -sum;
+
+}
+
+
+void SyncBus::queue(uint8_t type, unsigned long stamp, uint8_t event, unsigned long value) {
+
+  // Sin lugar: el registro se descarta
+  if ( txCount == SYNC_TX_SLOTS )
+    return;
+
+  build(txBuffer[txCount++], type, stamp, event, value);
+
+}
+
+
+/**
+ * Transmite los registros en espera con el transceptor
+ * habilitado hasta que sale el ultimo bit
+ */
+void SyncBus::send(void) {
+
+  digitalWrite(dePin, HIGH);
+
+  for ( uint8_t i = 0 ; i < txCount ; i++ )
+    Serial.write(txBuffer[i], SYNC_RECORD_SIZE);
+
+  txCount = 0;
+
+  Serial.flush();
+  digitalWrite(dePin, LOW);
+
+}
+
+
+/**
+ * El instante del beacon se toma inmediatamente antes
+ * de su primer byte, seguido de los eventos en espera
+ */
+void SyncBus::beacon(void) {
+
+  uint8_t buffer[SYNC_RECORD_SIZE];
+
+  digitalWrite(dePin, HIGH);
+
+  build(buffer, SY_BEACON, clock(), SE_NONE, 0);
+  Serial.write(buffer, SYNC_RECORD_SIZE);
+
+  for ( uint8_t i = 0 ; i < txCount ; i++ )
+    Serial.write(txBuffer[i], SYNC_RECORD_SIZE);
+
+  txCount = 0;
+
+  Serial.flush();
+  digitalWrite(dePin, LOW);
+
+}
+
+
+void SyncBus::spinUntil(unsigned long due) {
+
+  while ( (long) (clock() - due) < 0 ) ;
+
+}
+
+
+uint16_t SyncBus::frame(void) {
+
+  unsigned long now = clock();
+  unsigned long remaining = SYNC_FRAME_US - now % SYNC_FRAME_US;
+  uint16_t current;
+
+  if ( remaining <= SYNC_SPIN_US ) {
+    now += remaining;
+    spinUntil(now);
+  }
+
+  /*
+   * Un ajuste del reloj hacia atras puede repetir un cuadro:
+   * su contenido depende solo de su numero
+   */
+  current = now / SYNC_FRAME_US;
+  if ( current == lastFrame || now % SYNC_FRAME_US > SYNC_FRAME_LATE_US )
+    return SYNC_NO_FRAME;
+
+  lastFrame = current;
+
+  return current;
+
+}
+
+
+byte SyncBus::reached(unsigned long due) {
+
+  long remaining = (long) (due - clock());
+
+  if ( remaining > SYNC_SPIN_US )
+    return 0;
+
+  if ( remaining > 0 )
+    spinUntil(due);
+
+  return 1;
+
+}
+
+
+void SyncBus::raceStart(uint8_t value, uint16_t leadMs) {
+
+  if ( ! master || raceOpen )
+    return;
+
+  raceDue = clock() + leadMs * 1000UL;
+  raceOpen = 1;
+  raceUnit = 0;
+  raceBest = RACE_NO_TIME;
+
+  queue(SY_EVENT, raceDue, SE_RACE_START, value);
+  deliver(SE_RACE_START, value);
+
+}
+
+
+void SyncBus::raceReport(unsigned long us) {
+
+  if ( us >= RACE_NO_TIME )
+    us = RACE_NO_TIME - 1;
+
+  if ( master )
+    arbitrate(unit, us);
+  else if ( locked )
+    queue(SY_REPORT, clock(), SE_RACE_REPORT, us);
+
+}
+
+
+void SyncBus::arbitrate(uint8_t sender, unsigned long value) {
+
+  if ( raceOpen && value < raceBest ) {
+    raceBest = value;
+    raceUnit = sender;
+  }
+
+}
+
+#endif
@@ -0,0 +1,250 @@
+/*
+ * Telemetry.cpp
+ * Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)
+ */
+
+#include <Arduino.h>
+
+#include "Telemetry.h"
+#include "Accounting.h"
+
+
+#ifdef RULI_TELEMETRY
+Telemetry telemetry;
+#endif
+
+
+void Telemetry::begin(void) {
+
+  sequence = 0;
+  sent = 0;
+  dropped = 0;
+  loops = 0;
+  loopMax = 0;
+  statsTimestamp = millis();
+
+  memset(lastLeds, 0x00, sizeof(lastLeds));
+
+  Serial.begin(TELEMETRY_BAUDS);
+
+}
+
+
+byte Telemetry::record(uint8_t type, const uint8_t *payload) {
+
+  uint8_t frame[TELEMETRY_RECORD_SIZE];
+  uint16_t now;
+  uint8_t sum;
+
+  // Sin lugar para el registro completo: se descarta
+  if ( Serial.availableForWrite() < TELEMETRY_RECORD_SIZE ) {
+    if ( dropped < 0xFFFF )
+      dropped++;
+    sequence++;
+    return 0;
+  }
+
+  now = (uint16_t) millis();
+
+  frame[0] = TELEMETRY_SYNC;
+  frame[1] = type;
+  frame[2] = sequence++;
+  frame[3] = now & 0xFF;
+  frame[4] = now >> 8;
+  memcpy(&frame[5], payload, TELEMETRY_PAYLOAD_SIZE);
+
+  sum = 0;
+  for ( uint8_t i = 1 ; i < TELEMETRY_RECORD_SIZE - 1 ; i++ )
+    sum += frame[i];
+  frame[TELEMETRY_RECORD_SIZE - 1] = -sum;
+
+  Serial.write(frame, TELEMETRY_RECORD_SIZE);
+
+  sent++;
+
+  return 1;
+
+}
+
+
+void Telemetry::leds(const uint8_t *buffer) {
+
+  uint8_t payload[TELEMETRY_PAYLOAD_SIZE];
+  uint8_t mask = 0, changes = 0;
+  byte recorded;
+
+  for ( uint8_t i = 0 ; i < TELEMETRY_PAYLOAD_SIZE ; i++ )
+    if ( buffer[i] != lastLeds[i] ) {
+      mask |= 0x01 << i;
+      changes++;
+    }
+
+  if ( changes == 0 )
+    return;
+
+  /*
+   * Hasta 5 secciones modificadas entran en un registro de
+   * diferencias (mascara + valores), caso contrario se envia
+   * el buffer completo
+   */
+  if ( changes == TELEMETRY_PAYLOAD_SIZE )
+    recorded = record(TM_LEDS_FRAME, buffer);
+  else {
+    memset(payload, 0x00, sizeof(payload));
+    payload[0] = mask;
+    changes = 1;
+    for ( uint8_t i = 0 ; i < TELEMETRY_PAYLOAD_SIZE ; i++ )
+      if ( mask & (0x01 << i) )
+        payload[changes++] = buffer[i];
+    recorded = record(TM_LEDS_DIFF, payload);
+  }
+
+  if ( recorded )
+    memcpy(lastLeds, buffer, sizeof(lastLeds));
+
+}
+
+
+void Telemetry::encoder(uint8_t encoderNumber, uint8_t event, unsigned long timestamp) {
+
+  uint8_t payload[TELEMETRY_PAYLOAD_SIZE] = { encoderNumber, event,
+    (uint8_t) timestamp, (uint8_t) (timestamp >> 8),
+    (uint8_t) (timestamp >> 16), (uint8_t) (timestamp >> 24) };
+
+  record(TM_ENCODER, payload);
+
+}
+
+
+void Telemetry::mp3Command(uint8_t command, uint16_t param) {
+
+  uint8_t payload[TELEMETRY_PAYLOAD_SIZE] = { command,
+    (uint8_t) param, (uint8_t) (param >> 8), 0, 0, 0 };
+
+  record(TM_MP3_COMMAND, payload);
+
+}
+
+
+void Telemetry::mp3Response(uint8_t type, uint16_t value) {
+
+  uint8_t payload[TELEMETRY_PAYLOAD_SIZE] = { type,
+    (uint8_t) value, (uint8_t) (value >> 8), 0, 0, 0 };
+
+  record(TM_MP3_RESPONSE, payload);
+
+}
+
+
+void Telemetry::mode(uint8_t prevFunction, uint8_t currentFunction, uint8_t flags) {
+
+  uint8_t payload[TELEMETRY_PAYLOAD_SIZE] = { prevFunction, currentFunction, flags, 0, 0, 0 };
+
+  record(TM_MODE, payload);
+
+}
+
+
+void Telemetry::timing(uint8_t id, unsigned long us) {
+
+  uint8_t payload[TELEMETRY_PAYLOAD_SIZE] = { id,
+    (uint8_t) us, (uint8_t) (us >> 8),
+    (uint8_t) (us >> 16), (uint8_t) (us >> 24), 0 };
+
+  record(TM_TIMING, payload);
+
+}
+
+
+void Telemetry::stream(uint16_t frames, uint16_t discarded, unsigned long jitter) {
+
+  if ( jitter > 0xFFFF )
+    jitter = 0xFFFF;
+
+  uint8_t payload[TELEMETRY_PAYLOAD_SIZE] = {
+    (uint8_t) frames, (uint8_t) (frames >> 8),
+    (uint8_t) discarded, (uint8_t) (discarded >> 8),
+    (uint8_t) jitter, (uint8_t) (jitter >> 8) };
+
+  record(TM_STREAM, payload);
+
+}
+
+
+void Telemetry::outcomes(uint8_t mode, uint8_t led, uint16_t count, uint16_t nextCount) {
+
+  uint8_t payload[TELEMETRY_PAYLOAD_SIZE] = { mode, led,
+    (uint8_t) count, (uint8_t) (count >> 8),
+    (uint8_t) nextCount, (uint8_t) (nextCount >> 8) };
+
+  record(TM_OUTCOMES, payload);
+
+}
+
+
+void Telemetry::usage(uint8_t counter, unsigned long value) {
+
+  uint8_t payload[TELEMETRY_PAYLOAD_SIZE] = { counter,
+    (uint8_t) value, (uint8_t) (value >> 8), (uint8_t) (value >> 16), (uint8_t) (value >> 24),
+    ACC_COUNTERS };
+
+  record(TM_USAGE, payload);
+
+}
+
+
+void Telemetry::reaction(unsigned long median, uint16_t latchMin, uint16_t latchMax, uint16_t bounce) {
+
+  median /= 100;
+  if ( median > 0xFFFF )
+    median = 0xFFFF;
+
+  // Demoras del latch en la resolucion de micros() (4us)
+  latchMin = ( latchMin > 1020 ) ? 255 : latchMin >> 2;
+  latchMax = ( latchMax > 1020 ) ? 255 : latchMax >> 2;
+
+  uint8_t payload[TELEMETRY_PAYLOAD_SIZE] = {
+    (uint8_t) median, (uint8_t) (median >> 8),
+    (uint8_t) latchMin, (uint8_t) latchMax,
+    (uint8_t) bounce, (uint8_t) (bounce >> 8) };
+
+  record(TM_REACTION, payload);
+
+}
+
+
+byte Telemetry::ready(void) {
+
+  return Serial.availableForWrite() >= TELEMETRY_RECORD_SIZE;
+
+}
+
+
+void Telemetry::loopPass(unsigned long us) {
+
+  loops++;
+
+  if ( us > loopMax )
+    loopMax = us;
+
+  if ( millis() - statsTimestamp >= TELEMETRY_STATS_MS ) {
+
+    statsTimestamp = millis();
+
+    timing(TIMING_LOOP_MAX, loopMax);
+
+    uint8_t payload[TELEMETRY_PAYLOAD_SIZE] = {
+      (uint8_t) loops, (uint8_t) (loops >> 8),
+      (uint8_t) dropped, (uint8_t) (dropped >> 8),
+      (uint8_t) sent, (uint8_t) (sent >> 8) };
+
+    record(TM_STATS, payload);
+
+    // Resincroniza al receptor que perdio registros de leds
+    record(TM_LEDS_FRAME, lastLeds);
+
+    loops = 0;
+    loopMax = 0;
+  }
+
+}
@@ -6,9 +6,16 @@
 #include <Arduino.h>
 
 #include "RotaryEncoder.h"
+#include "EncoderBank.h"
 #include "MP3Player.h"
 #include "LedsPanel.h"
+#ifdef RULI_WS2812
+#include "RgbLedsPanel.h"
+#endif
 #include "RuliBrain.h"
+#ifdef RULI_SYNC
+#include "SyncBus.h"
+#endif
 
 
 ///////////////////////////
@@ -39,22 +46,40 @@
 ///////////////////////////
 //
 //       LEDS PANEL
+//   (con RULI_WS2812 solo LP_DATA_PIN,
+//    entrada de datos de la cadena de leds)
 //
 #define LP_ENABLE_PIN  8
 #define LP_CLOCK_PIN   9
 #define LP_DATA_PIN    12
 ///////////////////////////
 
+///////////////////////////
+//
+//   BUS DE SINCRONISMO
+//   (RS-485, DE y /RE)
+//
+#define SB_DE_PIN      2
+///////////////////////////
+
 
 
 /*
  * Objetos globales
  */
+EncoderBank encoderBank;
 RotaryEncoder mainWheel;
 RotaryEncoder rotarySelector;
 MP3Player mp3Player;
-LedsPanel ledsPanel;
+#ifdef RULI_WS2812
+Ws2812LedsPanel<LP_DATA_PIN> ledsPanel;
+#else
+FastLedsPanel<LP_ENABLE_PIN, LP_CLOCK_PIN, LP_DATA_PIN> ledsPanel;
+#endif
 RuliBrain ruliBrain;
+#ifdef RULI_SYNC
+SyncBus syncBus;
+#endif
 
 
 // Setup function
@@ -65,16 +90,32 @@ void setup() {
    */
   mainWheel.begin(MW_CLK_PIN, MW_DATA_PIN);
   rotarySelector.begin(RS_CLK_PIN, RS_DATA_PIN, RS_SWITCH_PIN);
+
+  /*
+   * Ambos encoders estan en el puerto C con DATA = CLK - 1,
+   * se decodifican juntos con una unica lectura de PINC
+   */
+  encoderBank.begin();
+  mainWheel.attach(&encoderBank);
+  rotarySelector.attach(&encoderBank);
+
   mp3Player.begin(MP_RX, MP_TX);
-  ledsPanel.begin(LP_ENABLE_PIN, LP_CLOCK_PIN, LP_DATA_PIN);
+  ledsPanel.begin();
   ruliBrain.begin(&mainWheel, &rotarySelector, &mp3Player, &ledsPanel);
 
+#ifdef RULI_SYNC
+  syncBus.begin(SB_DE_PIN);
+  ruliBrain.attach(&syncBus);
+#endif
+
 }
 
 
 // Main loop
 void loop() {
 
+  encoderBank.sample();
+
   ruliBrain.run();
 
 }
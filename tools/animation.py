@@ -0,0 +1,232 @@
+#!/usr/bin/env python3
+#
+# animation.py
+# Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)
+#
+# Herramienta para las animaciones grabadas en customShape() (ver Animation.h).
+# Decodifica la animacion a partir de una lectura de la EEPROM en formato
+# Intel HEX, lista los cuadros y calcula la relacion de compresion respecto
+# de almacenar cada cuadro completo (5 bytes + 1 byte de demora).
+#
+# Uso:
+#   avrdude -p m328p -c arduino -P /dev/ttyUSB0 -U eeprom:r:eeprom.hex:i
+#   python3 tools/animation.py eeprom.hex [-l]
+#
+# Con --simulate se genera en cambio una sesion de dibujo sintetica
+# (clicks y giros de la rueda con tiempos humanos) codificada igual que
+# en el firmware, util para evaluar cambios en el formato.
+#
+
+import argparse
+import random
+import sys
+
+
+EEPROM_ANIMATION      = 0x210   # Ver RuliBrain.cpp
+EEPROM_ANIMATION_SIZE = 0x1F0
+
+DELTA, RIGHT, LEFT, REPEAT, END = 0x00, 0x40, 0x80, 0xC0, 0xFF
+UNIT_MS, LONG_UNIT_MS, LONG_DELAY, REPEAT_MAX = 20, 250, 0x3F, 0x3E
+RAW_FRAME = 6
+
+
+def read_hex(path):
+    memory = bytearray([0xFF]) * 1024
+    with open(path) as f:
+        for line in f:
+            line = line.strip()
+            if not line.startswith(':'):
+                continue
+            raw = bytes.fromhex(line[1:])
+            if raw[3] == 0x00:
+                at = raw[1] << 8 | raw[2]
+                memory[at:at + raw[0]] = raw[4:4 + raw[0]]
+    return memory
+
+
+def rotate(frame, direction):
+    """Rotacion de la rueda igual a LedsPanel::rotate (secciones BLUE a RED)."""
+    bits = int.from_bytes(bytes(reversed(frame)), 'big')
+    if direction == RIGHT:
+        bits = (bits >> 1) | ((bits & 1) << 39)
+    else:
+        bits = ((bits << 1) & ((1 << 40) - 1)) | (bits >> 39)
+    return list(reversed(bits.to_bytes(5, 'big')))
+
+
+def decode(memory, base=EEPROM_ANIMATION, size=EEPROM_ANIMATION_SIZE):
+    """Devuelve (cuadro inicial, [(demora_ms, cuadro)], bytes utilizados)."""
+    if memory[base] != ord('A'):
+        raise ValueError('no hay una animacion grabada')
+    frame = list(memory[base + 1:base + 6])
+    keyframe = list(frame)
+    frames = []
+    pos, end = base + 6, base + size
+    last = None
+    while pos < end and memory[pos] != END:
+        control = memory[pos]
+        if control & 0xC0 == REPEAT:
+            if last is None:
+                break
+            count = control & 0x3F
+            pos += 1
+        else:
+            start = pos
+            pos += 1
+            delay = (control & 0x3F) * UNIT_MS
+            if control & 0x3F == LONG_DELAY:
+                delay = memory[pos] * LONG_UNIT_MS
+                pos += 1
+            change = None
+            if control & 0xC0 == DELTA:
+                mask = memory[pos]
+                pos += 1
+                change = []
+                for i in range(5):
+                    if mask & (1 << i):
+                        change.append((i, memory[pos]))
+                        pos += 1
+            last = (control & 0xC0, delay, change)
+            count = 1
+        for _ in range(count):
+            kind, delay, change = last
+            if kind == DELTA:
+                for i, x in change:
+                    frame[i] ^= x
+            else:
+                frame = rotate(frame, kind)
+            frames.append((delay, list(frame)))
+    return keyframe, frames, pos - base + 1
+
+
+class Encoder:
+    """Port del grabador de Animation.cpp (sin la escritura diferida)."""
+
+    def __init__(self, keyframe, size=EEPROM_ANIMATION_SIZE):
+        self.data = bytearray([ord('A')] + list(keyframe))
+        self.size = size
+        self.frame = list(keyframe)
+        self.last = None
+        self.repeat_at = None
+        self.repeat = 0
+        self.full = False
+        self.frames = 0
+
+    def control(self, kind, elapsed_ms):
+        units = (elapsed_ms + UNIT_MS // 2) // UNIT_MS
+        if units < LONG_DELAY:
+            return [kind | units]
+        return [kind | LONG_DELAY, min(255, (elapsed_ms + LONG_UNIT_MS // 2) // LONG_UNIT_MS)]
+
+    def append(self, record):
+        if self.full:
+            return
+        if record == self.last:
+            if 0 < self.repeat < REPEAT_MAX:
+                self.repeat += 1
+                self.data[self.repeat_at] = REPEAT | self.repeat
+                self.frames += 1
+                return
+            if len(self.data) + 2 > self.size:
+                self.full = True
+                return
+            self.repeat_at = len(self.data)
+            self.repeat = 1
+            self.data.append(REPEAT | 1)
+            self.frames += 1
+            return
+        if len(self.data) + len(record) + 1 > self.size:
+            self.full = True
+            return
+        self.data += bytes(record)
+        self.last = record
+        self.repeat = 0
+        self.frames += 1
+
+    def add_frame(self, frame, elapsed_ms):
+        mask, diffs = 0, []
+        for i in range(5):
+            if frame[i] != self.frame[i]:
+                mask |= 1 << i
+                diffs.append(frame[i] ^ self.frame[i])
+        if mask:
+            self.append(self.control(DELTA, elapsed_ms) + [mask] + diffs)
+            self.frame = list(frame)
+
+    def add_rotation(self, direction, elapsed_ms):
+        self.append(self.control(direction, elapsed_ms))
+        self.frame = rotate(self.frame, direction)
+
+    def image(self):
+        return bytes(self.data) + bytes([END])
+
+
+def simulate(seed):
+    """Sesion sintetica: se dibuja con el selector y se gira la rueda."""
+    rng = random.Random(seed)
+    frame = [0x00, 0x00, 0x80, 0x00, 0x00]
+    encoder = Encoder(frame)
+    cursor = 0
+    while not encoder.full:
+        if rng.random() < 0.5:
+            # Trazo: el cursor avanza unos leds y se enciende cada uno
+            for _ in range(rng.randint(1, 6)):
+                cursor = (cursor + 1) % 40
+                byte, bit = divmod(cursor, 8)
+                frame[byte] ^= 0x80 >> bit
+                encoder.add_frame(frame, rng.randint(150, 700))
+        else:
+            # Giro de la rueda a velocidad casi constante
+            direction = rng.choice((RIGHT, LEFT))
+            period = rng.choice((40, 60, 80))
+            for _ in range(rng.randint(5, 40)):
+                frame = rotate(frame, direction)
+                encoder.add_rotation(direction, period + rng.choice((0, 0, 0, 10)))
+        if encoder.frames > 2000:
+            break
+    return encoder
+
+
+def report(frames, used):
+    raw = 5 + len(frames) * RAW_FRAME
+    print('cuadros        %d' % len(frames))
+    print('bytes          %d de %d' % (used, EEPROM_ANIMATION_SIZE))
+    print('sin comprimir  %d bytes (%d cuadros entrarian)'
+          % (raw, (EEPROM_ANIMATION_SIZE - 6) // RAW_FRAME))
+    print('compresion     %.2f:1 (%.2f bytes por cuadro)'
+          % (raw / used, (used - 7) / max(len(frames), 1)))
+    print('duracion       %.1f s' % (sum(d for d, _ in frames) / 1000.0))
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Animaciones de customShape()')
+    parser.add_argument('dump', nargs='?', help='lectura de la EEPROM en formato Intel HEX')
+    parser.add_argument('-l', '--list', action='store_true', help='listar los cuadros')
+    parser.add_argument('--simulate', type=int, metavar='SEED',
+                        help='codificar una sesion sintetica en lugar de leer la EEPROM')
+    args = parser.parse_args()
+
+    if args.simulate is not None:
+        memory = bytearray([0xFF]) * 1024
+        image = simulate(args.simulate).image()
+        memory[EEPROM_ANIMATION:EEPROM_ANIMATION + len(image)] = image
+    elif args.dump:
+        memory = read_hex(args.dump)
+    else:
+        parser.error('se requiere la lectura de la EEPROM o --simulate')
+
+    try:
+        keyframe, frames, used = decode(memory)
+    except ValueError as err:
+        print(err, file=sys.stderr)
+        sys.exit(1)
+
+    if args.list:
+        print('inicio  %s' % ' '.join('%02X' % b for b in keyframe))
+        for delay, frame in frames:
+            print('%6dms %s' % (delay, ' '.join('%02X' % b for b in frame)))
+    report(frames, used)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,213 @@
+#!/usr/bin/env python3
+#
+# beatmap.py
+# Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)
+#
+# Generador offline de mapas de pulsos (beat maps) para la funcionalidad
+# music() de Ruli. Decodifica los temas de la carpeta 09 de la tarjeta SD,
+# detecta onsets y tempo, y genera include/BeatMaps.h con una tabla compacta
+# en memoria flash (PROGMEM) que consume la clase BeatSync.
+#
+# Uso:
+#   python3 tools/beatmap.py <carpeta_sd>/09 -o include/BeatMaps.h
+#
+# Requiere numpy y ffmpeg (para decodificar mp3/wav a PCM).
+#
+# Formato de la tabla por tema (ver BeatSync.h):
+#   cada byte es un evento; bits 0-6 = delta de tiempo respecto del evento
+#   anterior en unidades de BEAT_MAP_UNIT_MS, bit 7 = pulso acentuado.
+#   El valor 0x00 indica avanzar 127 unidades sin generar evento.
+#
+
+import argparse
+import multiprocessing
+import os
+import re
+import subprocess
+import sys
+
+import numpy as np
+
+
+SAMPLE_RATE   = 11025
+FRAME_SIZE    = 1024
+HOP_SIZE      = 128
+UNIT_MS       = 20      # Debe coincidir con BEAT_MAP_UNIT_MS de BeatSync.h
+MIN_GAP_MS    = 120     # Distancia minima entre dos eventos consecutivos
+TRACKS        = 40      # Temas 002..041 de la carpeta 09
+FIRST_FILE    = 2
+
+
+def decode(path):
+    """Decodifica el archivo a PCM mono de 16 bits mediante ffmpeg."""
+    cmd = ['ffmpeg', '-v', 'quiet', '-i', path, '-f', 's16le',
+           '-ac', '1', '-ar', str(SAMPLE_RATE), '-']
+    raw = subprocess.run(cmd, stdout=subprocess.PIPE, check=True).stdout
+    return np.frombuffer(raw, dtype=np.int16).astype(np.float32) / 32768.0
+
+
+def onset_envelope(samples):
+    """Flujo espectral con compresion logaritmica (rectificado de media onda)."""
+    if len(samples) < FRAME_SIZE:
+        return np.zeros(0, dtype=np.float32)
+    frames = 1 + (len(samples) - FRAME_SIZE) // HOP_SIZE
+    window = np.hanning(FRAME_SIZE).astype(np.float32)
+    idx = np.arange(FRAME_SIZE)[None, :] + HOP_SIZE * np.arange(frames)[:, None]
+    spectrum = np.abs(np.fft.rfft(samples[idx] * window, axis=1))
+    spectrum = np.log1p(100.0 * spectrum)
+    flux = np.maximum(spectrum[1:] - spectrum[:-1], 0.0).sum(axis=1)
+    flux = np.concatenate(([0.0], flux))
+    if flux.max() > 0:
+        flux /= flux.max()
+    return flux
+
+
+def estimate_tempo(envelope):
+    """Tempo (ms por pulso) por autocorrelacion de la envolvente, 60..180 BPM."""
+    frame_ms = 1000.0 * HOP_SIZE / SAMPLE_RATE
+    env = envelope - envelope.mean()
+    corr = np.correlate(env, env, mode='full')[len(env) - 1:]
+    min_lag = int(60000.0 / 180 / frame_ms)
+    max_lag = int(60000.0 / 60 / frame_ms)
+    if len(corr) <= max_lag:
+        return 500
+    lags = np.arange(min_lag, max_lag + 1)
+    # Ponderacion suave alrededor de 120 BPM para evitar octavas
+    weight = np.exp(-0.5 * (np.log2(lags * frame_ms / 500.0) / 1.0) ** 2)
+    best = lags[np.argmax(corr[min_lag:max_lag + 1] * weight)]
+    return int(round(best * frame_ms))
+
+
+def pick_onsets(envelope):
+    """Seleccion de picos con umbral adaptativo (mediana movil)."""
+    frame_ms = 1000.0 * HOP_SIZE / SAMPLE_RATE
+    half = max(1, int(150 / frame_ms))
+    min_gap = int(MIN_GAP_MS / frame_ms)
+    padded = np.pad(envelope, half, mode='edge')
+    windows = np.lib.stride_tricks.sliding_window_view(padded, 2 * half + 1)
+    threshold = np.median(windows, axis=1) + 0.05
+
+    onsets = []
+    last = -min_gap
+    for i in range(1, len(envelope) - 1):
+        v = envelope[i]
+        if v > threshold[i] and v >= envelope[i - 1] and v > envelope[i + 1]:
+            if i - last >= min_gap:
+                # Se toma el final de la ventana: es donde entra el ataque
+                onsets.append(((i * HOP_SIZE + FRAME_SIZE) * 1000.0 / SAMPLE_RATE, float(v)))
+                last = i
+    return onsets
+
+
+def encode(onsets, max_bytes):
+    """Empaqueta los eventos en el formato de bytes de BeatSync."""
+    if not onsets:
+        return b''
+    strengths = np.array([s for _, s in onsets])
+    accent_level = np.percentile(strengths, 80)
+
+    # Si excede el presupuesto se conservan los eventos mas fuertes
+    while True:
+        out = bytearray()
+        prev_unit = 0
+        for t, s in onsets:
+            unit = int(round(t / UNIT_MS))
+            delta = unit - prev_unit
+            if delta <= 0:
+                continue
+            while delta > 127:
+                out.append(0x00)
+                delta -= 127
+            out.append(delta | (0x80 if s >= accent_level else 0x00))
+            prev_unit = unit
+        if len(out) <= max_bytes:
+            return bytes(out)
+        cut = np.percentile([s for _, s in onsets], 25)
+        onsets = [o for o in onsets if o[1] > cut]
+
+
+def analyse(job):
+    """Trabajo por archivo, ejecutado en paralelo por el pool de procesos."""
+    track, path, max_bytes = job
+    try:
+        envelope = onset_envelope(decode(path))
+        return track, estimate_tempo(envelope), encode(pick_onsets(envelope), max_bytes), None
+    except (OSError, subprocess.CalledProcessError) as err:
+        return track, 0, b'', str(err)
+
+
+def find_tracks(folder):
+    """Asocia los archivos NNN*.mp3 de la carpeta a los indices de tema."""
+    files = {}
+    for name in sorted(os.listdir(folder)):
+        m = re.match(r'^(\d{3})', name)
+        if m and name.lower().endswith(('.mp3', '.wav')):
+            track = int(m.group(1)) - FIRST_FILE
+            if 0 <= track < TRACKS:
+                files[track] = os.path.join(folder, name)
+    return files
+
+
+def write_header(path, results):
+    data = bytearray()
+    index = []
+    tempo = []
+    for track in range(TRACKS):
+        t, blob = results.get(track, (0, b''))
+        index.append(len(data))
+        tempo.append(t)
+        data += blob
+    index.append(len(data))
+    if not data:
+        data = bytearray([0x00])
+
+    def rows(values, fmt, per_row):
+        items = [fmt % v for v in values]
+        return ',\n'.join('  ' + ', '.join(items[i:i + per_row])
+                          for i in range(0, len(items), per_row))
+
+    with open(path, 'w', newline='\r\n') as f:
+        f.write('/*\n * BeatMaps.h\n * Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)\n *\n')
+        f.write(' * ARCHIVO GENERADO por tools/beatmap.py, no editar a mano.\n')
+        f.write(' * Solo debe ser incluido por BeatSync.cpp\n */\n\n')
+        f.write('#ifndef BeatMaps_h\n#define BeatMaps_h\n\n')
+        f.write('#define BEAT_MAP_TRACKS %d\n\n' % TRACKS)
+        f.write('// Tempo estimado de cada tema (ms por pulso, 0 = sin mapa)\n')
+        f.write('const uint16_t beatMapTempo[BEAT_MAP_TRACKS] PROGMEM = {\n%s\n};\n\n'
+                % rows(tempo, '%d', 10))
+        f.write('// Desplazamiento de cada tema dentro de beatMapData\n')
+        f.write('const uint16_t beatMapIndex[BEAT_MAP_TRACKS + 1] PROGMEM = {\n%s\n};\n\n'
+                % rows(index, '%d', 10))
+        f.write('const uint8_t beatMapData[] PROGMEM = {\n%s\n};\n\n'
+                % rows(data, '0x%02X', 12))
+        f.write('#endif\n')
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Generador de beat maps para music()')
+    parser.add_argument('folder', help='carpeta 09 de la tarjeta SD')
+    parser.add_argument('-o', '--output', default='include/BeatMaps.h')
+    parser.add_argument('-b', '--max-bytes', type=int, default=160,
+                        help='presupuesto de flash por tema (bytes)')
+    parser.add_argument('-j', '--jobs', type=int, default=os.cpu_count())
+    args = parser.parse_args()
+
+    files = find_tracks(args.folder)
+    jobs = [(track, path, args.max_bytes) for track, path in files.items()]
+
+    results = {}
+    with multiprocessing.Pool(args.jobs) as pool:
+        for track, tempo, blob, error in pool.imap_unordered(analyse, jobs):
+            if error:
+                print('tema %02d: %s' % (track, error), file=sys.stderr)
+                continue
+            results[track] = (tempo, blob)
+            print('tema %02d: %3d BPM, %4d bytes' % (track, 60000 // max(tempo, 1), len(blob)))
+
+    write_header(args.output, results)
+    total = sum(len(b) for _, b in results.values())
+    print('%d temas, %d bytes de flash -> %s' % (len(results), total, args.output))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,227 @@
+#!/usr/bin/env python3
+#
+# benchmark.py
+# Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)
+#
+# Ejecuta los microbenchmarks de src/Benchmark.cpp (entorno "benchmark" de
+# platformio.ini) bajo simavr, con precision de ciclo, y genera un reporte
+# JSON con los ciclos por llamada de cada caso y la ocupacion de flash/RAM
+# del firmware. Con --baseline compara contra un reporte anterior y termina
+# con error si algun caso empeora mas que la tolerancia indicada.
+#
+# Los casos tambien se ejecutan sobre el runtime minimo de bare/ (entornos
+# "benchmark_bare" y "bare"): el reporte incluye sus resultados, el tiempo
+# de arranque hasta setup() de cada runtime y la ocupacion de ambos
+# firmwares. --runtimes imprime la comparacion entre ambos y la RAM que
+# cada firmware deja libre para la pila y el heap (2 KB del ATmega328P).
+# Con --bare-only (sin el framework de Arduino instalado) solo se compilan
+# y ejecutan los entornos del runtime minimo.
+#
+# Uso:
+#   python3 tools/benchmark.py -o bench.json
+#   python3 tools/benchmark.py --baseline bench.json --tolerance 2
+#   python3 tools/benchmark.py --runtimes
+#   python3 tools/benchmark.py --runtimes --bare-only
+#   python3 tools/benchmark.py --bare-only --baseline tools/benchmark_baseline.json
+#
+# tools/benchmark_baseline.json es el reporte de referencia del runtime
+# minimo (generado con --bare-only): regenerarlo con -o al cambiar a
+# proposito el costo de algun caso.
+#
+# Requiere platformio y simavr. Los resultados son deterministicos: el
+# simulador no depende del equipo host y los casos no utilizan random().
+#
+
+import argparse
+import json
+import os
+import re
+import shutil
+import subprocess
+import sys
+
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+BENCH_ENV = 'benchmark'
+FIRMWARE_ENV = 'nanoatmega328'
+BARE_BENCH_ENV = 'benchmark_bare'
+BARE_FIRMWARE_ENV = 'bare'
+MCU = 'atmega328p'
+F_CPU = 16000000
+SRAM = 2048
+ANSI = re.compile(r'\x1b\[[0-9;]*m')
+
+
+def elf_path(env):
+    return os.path.join(ROOT, '.pio', 'build', env, 'firmware.elf')
+
+
+def require(tools):
+    """Termina con un mensaje si falta alguna de las herramientas externas."""
+    missing = [t for t in tools if not shutil.which(t)]
+    if missing:
+        sys.exit('benchmark.py: no se encontro %s en el PATH (requiere platformio y simavr)'
+                 % ', '.join(missing))
+
+
+def build(env):
+    subprocess.run(['pio', 'run', '-e', env], cwd=ROOT, check=True,
+                   stdout=subprocess.DEVNULL)
+
+
+def size_tool():
+    tool = shutil.which('avr-size')
+    if tool:
+        return tool
+    bundled = os.path.expanduser('~/.platformio/packages/toolchain-atmelavr/bin/avr-size')
+    return bundled if os.path.exists(bundled) else None
+
+
+def footprint(elf):
+    """Flash (text + data) y RAM estatica (data + bss) en bytes."""
+    tool = size_tool()
+    if not tool or not os.path.exists(elf):
+        return None
+    out = subprocess.run([tool, '-A', elf], check=True, stdout=subprocess.PIPE,
+                         universal_newlines=True).stdout
+    sections = {}
+    for line in out.splitlines():
+        parts = line.split()
+        if len(parts) >= 2 and parts[0].startswith('.') and parts[1].isdigit():
+            sections[parts[0]] = int(parts[1])
+    text, data, bss = (sections.get(s, 0) for s in ('.text', '.data', '.bss'))
+    return {'flash': text + data, 'ram': data + bss}
+
+
+def simulate(elf, timeout):
+    """Ejecuta el firmware en simavr y devuelve los objetos JSON emitidos."""
+    cmd = ['simavr', '-m', MCU, '-f', str(F_CPU), elf]
+    proc = subprocess.run(cmd, stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+                          universal_newlines=True, timeout=timeout)
+    header, results = None, []
+    for line in ANSI.sub('', proc.stdout).splitlines():
+        start = line.find('{')
+        if start < 0:
+            continue
+        try:
+            record = json.loads(line[start:])
+        except ValueError:
+            continue
+        if 'bench' in record:
+            results.append(record)
+        elif 'benchmark' in record:
+            header = record
+        elif record.get('done'):
+            return header, results
+    raise RuntimeError('la simulacion termino sin completar los casos:\n' + proc.stdout[-2000:])
+
+
+def compare(report, baseline, tolerance):
+    """Devuelve las lineas de diferencias y la cantidad de regresiones."""
+    lines, regressions = [], 0
+    runs = (('', report['results'], baseline['results']),
+            ('bare/', report['bare']['results'], baseline.get('bare', {}).get('results', [])))
+    for prefix, results, before in runs:
+        old = {r['bench']: r for r in before}
+        for r in results:
+            name = prefix + r['bench']
+            base = old.get(r['bench'])
+            if not base:
+                lines.append('%-28s %8d  (nuevo)' % (name, r['avg']))
+                continue
+            delta = r['avg'] - base['avg']
+            pct = 100.0 * delta / base['avg'] if base['avg'] else 0.0
+            mark = ''
+            if pct > tolerance:
+                mark = '  REGRESION'
+                regressions += 1
+            lines.append('%-28s %8d %8d %+7.1f%%%s' % (name, base['avg'], r['avg'], pct, mark))
+    for key in ('benchmark', 'firmware', 'benchmark_bare', 'bare'):
+        now, before = report.get('footprint', {}).get(key), baseline.get('footprint', {}).get(key)
+        if now and before:
+            lines.append('%-28s flash %+d bytes, ram %+d bytes'
+                         % ('footprint ' + key, now['flash'] - before['flash'],
+                            now['ram'] - before['ram']))
+    return lines, regressions
+
+
+def compare_runtimes(report):
+    """Lineas con el core de Arduino contra el runtime minimo."""
+    arduino = {r['bench']: r for r in report['results']}
+    startup = report.get('startup_us')
+    lines = ['%-24s %8s %8s' % ('', 'arduino', 'bare'),
+             '%-24s %8s %8s' % ('startup_us', '-' if startup is None else startup,
+                                report['bare'].get('startup_us'))]
+    for r in report['bare']['results']:
+        other = arduino.get(r['bench'])
+        lines.append('%-24s %8s %8d' % (r['bench'], other['avg'] if other else '-', r['avg']))
+    footprint = report['footprint']
+    for key, base in (('firmware', FIRMWARE_ENV), ('bare', BARE_FIRMWARE_ENV)):
+        if footprint.get(key):
+            ram = footprint[key]['ram']
+            lines.append('%-24s flash %6d bytes, ram %5d bytes, libre (pila y heap) %5d bytes'
+                         % ('footprint ' + base, footprint[key]['flash'], ram, SRAM - ram))
+    return lines
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Microbenchmarks de Ruli bajo simavr')
+    parser.add_argument('-o', '--output', help='guardar el reporte JSON')
+    parser.add_argument('--baseline', help='reporte anterior para comparar')
+    parser.add_argument('--tolerance', type=float, default=1.0,
+                        help='empeoramiento admitido (%%) antes de informar regresion')
+    parser.add_argument('--runtimes', action='store_true',
+                        help='comparar el core de Arduino contra el runtime minimo')
+    parser.add_argument('--bare-only', action='store_true',
+                        help='solo los entornos del runtime minimo (sin el core de Arduino)')
+    parser.add_argument('--no-build', action='store_true', help='no compilar los entornos')
+    parser.add_argument('--timeout', type=float, default=120)
+    args = parser.parse_args()
+
+    require(['simavr'] + ([] if args.no_build else ['pio']))
+
+    arduino_envs = () if args.bare_only else (BENCH_ENV, FIRMWARE_ENV)
+
+    if not args.no_build:
+        for env in arduino_envs + (BARE_BENCH_ENV, BARE_FIRMWARE_ENV):
+            build(env)
+
+    header, results = None, []
+    if not args.bare_only:
+        header, results = simulate(elf_path(BENCH_ENV), args.timeout)
+    bare_header, bare_results = simulate(elf_path(BARE_BENCH_ENV), args.timeout)
+    report = {
+        'mcu': MCU,
+        'f_cpu': header.get('f_cpu', F_CPU) if header else F_CPU,
+        'overhead': header.get('overhead') if header else None,
+        'startup_us': header.get('startup_us') if header else None,
+        'results': results,
+        'bare': {'overhead': bare_header.get('overhead') if bare_header else None,
+                 'startup_us': bare_header.get('startup_us') if bare_header else None,
+                 'results': bare_results},
+        'footprint': {'benchmark': None if args.bare_only else footprint(elf_path(BENCH_ENV)),
+                      'firmware': None if args.bare_only else footprint(elf_path(FIRMWARE_ENV)),
+                      'benchmark_bare': footprint(elf_path(BARE_BENCH_ENV)),
+                      'bare': footprint(elf_path(BARE_FIRMWARE_ENV))},
+    }
+
+    text = json.dumps(report, indent=2)
+    if args.output:
+        with open(args.output, 'w') as f:
+            f.write(text + '\n')
+    else:
+        print(text)
+
+    if args.runtimes:
+        print('\n'.join(compare_runtimes(report)), file=sys.stderr)
+
+    if args.baseline:
+        with open(args.baseline) as f:
+            lines, regressions = compare(report, json.load(f), args.tolerance)
+        print('\n'.join(lines), file=sys.stderr)
+        if regressions:
+            sys.exit(1)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,298 @@
+#!/usr/bin/env python3
+#
+# dfplayer_emu.py
+# Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)
+#
+# Emulador del reproductor DFPlayer Mini para pruebas y mediciones sin
+# hardware. Atiende el protocolo serie real (tramas de 10 bytes con checksum)
+# sobre una pseudo terminal (pty) que puede abrirse desde cualquier programa
+# como si fuera el puerto serie conectado al reproductor.
+#
+# Modela:
+#   - la estructura de carpetas/archivos de la tarjeta SD (carpetas 01..10
+#     tal como las usan speak() y playFolder()) con la duracion de cada tema
+#   - el tiempo de ocupado (busy) de cada comando
+#   - los mensajes de fin de reproduccion duplicados del modulo real
+#   - errores: archivo inexistente, checksum invalido, comando durante busy
+#
+# Uso:
+#   python3 tools/dfplayer_emu.py [--layout sd.json] [--link /tmp/dfplayer]
+#   python3 tools/dfplayer_emu.py --port /dev/ttyUSB0
+#
+# Con --port se atiende en cambio un puerto serie real (por ejemplo un
+# adaptador USB-TTL conectado a los pines 10/11 en lugar del reproductor).
+#
+# El archivo de layout es un objeto JSON {"carpeta": {"archivo": duracion_ms}},
+# generado desde la tarjeta SD por tools/soundcatalog.py --json.
+# Sin layout se utiliza uno por defecto acorde a RuliBrain.cpp.
+#
+
+import argparse
+import heapq
+import json
+import os
+import pty
+import random
+import select
+import sys
+import termios
+import time
+import tty
+
+
+# Comandos
+CMD_NEXT        = 0x01
+CMD_PREVIOUS    = 0x02
+CMD_PLAY        = 0x03
+CMD_VOLUME_UP   = 0x04
+CMD_VOLUME_DOWN = 0x05
+CMD_VOLUME      = 0x06
+CMD_LOOP        = 0x08
+CMD_RESET       = 0x0C
+CMD_START       = 0x0D
+CMD_PAUSE       = 0x0E
+CMD_PLAY_FOLDER = 0x0F
+CMD_ENABLE_LOOP = 0x19
+CMD_STOP        = 0x16
+CMD_QUERY_VOL   = 0x43
+CMD_QUERY_STATE = 0x42
+
+# Respuestas
+RSP_FINISHED    = 0x3D
+RSP_ONLINE      = 0x3F
+RSP_ERROR       = 0x40
+RSP_ACK         = 0x41
+
+# Codigos de error (igual que DFRobotDFPlayerMini)
+ERR_BUSY        = 0x01
+ERR_CHECKSUM    = 0x04
+ERR_FILE_OUT    = 0x05
+ERR_FILE_MISS   = 0x06
+
+FRAME_SIZE      = 10
+
+
+def checksum(body):
+    return (-sum(body)) & 0xFFFF
+
+
+def frame(cmd, param=0, feedback=0):
+    body = [0xFF, 0x06, cmd, feedback, (param >> 8) & 0xFF, param & 0xFF]
+    chk = checksum(body)
+    return bytes([0x7E] + body + [chk >> 8, chk & 0xFF, 0xEF])
+
+
+def default_layout():
+    """Estructura de la SD segun los playFolder()/speak() de RuliBrain.cpp."""
+    layout = {}
+    for folder in range(1, 11):
+        layout[folder] = {f: 1500 for f in range(1, 14)}
+    layout[6] = {f: 400 for f in range(1, 34)}        # velocityMeter
+    layout[8] = {f: 900 for f in range(2, 42)}        # soundShooting
+    layout[9] = {f: 180000 for f in range(2, 42)}     # music
+    layout[1][3] = 2000                               # welcome
+    return layout
+
+
+class Emulator:
+
+    def __init__(self, fd, layout, args):
+        self.fd = fd
+        self.layout = layout
+        self.args = args
+        self.rx = bytearray()
+        self.timers = []          # (tiempo, secuencia, accion)
+        self.seq = 0
+        self.busy_until = 0.0
+        self.playing = None       # (carpeta, archivo)
+        self.play_token = 0
+        self.volume = 20
+        self.stats = {'frames': 0, 'bytes_in': 0, 'bytes_out': 0, 'bad_checksum': 0,
+                      'busy_rejects': 0, 'missing': 0, 'finished': 0, 'commands': {}}
+
+    def now(self):
+        return time.monotonic()
+
+    def schedule(self, delay_ms, action):
+        self.seq += 1
+        heapq.heappush(self.timers, (self.now() + delay_ms / 1000.0, self.seq, action))
+
+    def send(self, data):
+        os.write(self.fd, data)
+        self.stats['bytes_out'] += len(data)
+
+    def reply(self, cmd, param=0, delay_ms=0):
+        self.schedule(delay_ms, lambda: self.send(frame(cmd, param)))
+
+    def log(self, text):
+        if self.args.verbose:
+            print('%10.3f %s' % (self.now() - self.started, text))
+
+    def start_track(self, folder, number):
+        duration = self.layout.get(folder, {}).get(number)
+        if duration is None:
+            self.stats['missing'] += 1
+            self.reply(RSP_ERROR, ERR_FILE_MISS, self.args.busy_ms)
+            self.log('archivo inexistente %02d/%03d' % (folder, number))
+            return
+        self.play_token += 1
+        token = self.play_token
+        self.playing = (folder, number)
+        self.log('play %02d/%03d (%d ms)' % (folder, number, duration))
+
+        def finish():
+            if token != self.play_token:
+                return
+            self.playing = None
+            self.stats['finished'] += 1
+            param = number
+            self.send(frame(RSP_FINISHED, param))
+            # El modulo real suele repetir el mensaje de fin
+            if random.random() < self.args.duplicate:
+                self.reply(RSP_FINISHED, param, self.args.duplicate_gap_ms)
+
+        self.schedule(self.args.start_ms + duration * self.args.speed, finish)
+
+    def handle(self, cmd, feedback, param):
+        name = '0x%02X' % cmd
+        self.stats['commands'][name] = self.stats['commands'].get(name, 0) + 1
+
+        if self.now() < self.busy_until and cmd != CMD_RESET:
+            self.stats['busy_rejects'] += 1
+            self.reply(RSP_ERROR, ERR_BUSY)
+            return
+        self.busy_until = self.now() + self.args.busy_ms / 1000.0
+
+        if feedback:
+            self.reply(RSP_ACK, 0, 1)
+
+        if cmd == CMD_RESET:
+            self.play_token += 1
+            self.playing = None
+            self.reply(RSP_ONLINE, 0x02, self.args.reset_ms)
+            self.busy_until = self.now() + self.args.reset_ms / 1000.0
+        elif cmd == CMD_PLAY_FOLDER:
+            self.start_track(param >> 8, param & 0xFF)
+        elif cmd == CMD_PLAY:
+            self.start_track(1, param)
+        elif cmd == CMD_STOP or cmd == CMD_PAUSE:
+            self.play_token += 1
+            self.playing = None
+            self.log('stop')
+        elif cmd == CMD_VOLUME:
+            self.volume = min(param, 30)
+        elif cmd == CMD_VOLUME_UP:
+            self.volume = min(self.volume + 1, 30)
+        elif cmd == CMD_VOLUME_DOWN:
+            self.volume = max(self.volume - 1, 0)
+        elif cmd == CMD_QUERY_VOL:
+            self.reply(CMD_QUERY_VOL, self.volume, self.args.busy_ms)
+        elif cmd == CMD_QUERY_STATE:
+            self.reply(CMD_QUERY_STATE, 1 if self.playing else 0, self.args.busy_ms)
+        elif cmd in (CMD_NEXT, CMD_PREVIOUS, CMD_START, CMD_LOOP, CMD_ENABLE_LOOP):
+            pass
+        else:
+            self.reply(RSP_ERROR, ERR_FILE_OUT, self.args.busy_ms)
+
+    def parse(self):
+        while len(self.rx) >= FRAME_SIZE:
+            if self.rx[0] != 0x7E:
+                del self.rx[0]
+                continue
+            raw = self.rx[:FRAME_SIZE]
+            if raw[9] != 0xEF:
+                del self.rx[0]
+                continue
+            del self.rx[:FRAME_SIZE]
+            self.stats['frames'] += 1
+            if checksum(raw[1:7]) != (raw[7] << 8 | raw[8]):
+                self.stats['bad_checksum'] += 1
+                self.reply(RSP_ERROR, ERR_CHECKSUM)
+                continue
+            self.handle(raw[3], raw[4], raw[5] << 8 | raw[6])
+
+    def run(self, duration):
+        self.started = self.now()
+        end = self.started + duration if duration else None
+        while end is None or self.now() < end:
+            timeout = 0.05
+            if self.timers:
+                timeout = max(0.0, min(timeout, self.timers[0][0] - self.now()))
+            ready, _, _ = select.select([self.fd], [], [], timeout)
+            if ready:
+                try:
+                    data = os.read(self.fd, 256)
+                except OSError:
+                    data = b''
+                self.stats['bytes_in'] += len(data)
+                self.rx += data
+                self.parse()
+            while self.timers and self.timers[0][0] <= self.now():
+                heapq.heappop(self.timers)[2]()
+
+
+def load_layout(path):
+    with open(path) as f:
+        raw = json.load(f)
+    return {int(folder): {int(n): int(ms) for n, ms in files.items()}
+            for folder, files in raw.items()}
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Emulador de DFPlayer Mini sobre pty')
+    parser.add_argument('--layout', help='estructura de la SD en JSON')
+    parser.add_argument('--link', help='crear un enlace simbolico al pty')
+    parser.add_argument('--port', help='atender un puerto serie real en lugar de un pty')
+    parser.add_argument('--busy-ms', type=float, default=30,
+                        help='tiempo de ocupado por comando')
+    parser.add_argument('--start-ms', type=float, default=80,
+                        help='demora desde el comando hasta el inicio del audio')
+    parser.add_argument('--reset-ms', type=float, default=1500)
+    parser.add_argument('--duplicate', type=float, default=0.5,
+                        help='probabilidad de fin de reproduccion duplicado')
+    parser.add_argument('--duplicate-gap-ms', type=float, default=20)
+    parser.add_argument('--speed', type=float, default=1.0,
+                        help='factor de escala de la duracion de los temas')
+    parser.add_argument('--duration', type=float, default=0,
+                        help='segundos de ejecucion (0 = indefinido)')
+    parser.add_argument('--seed', type=int)
+    parser.add_argument('-v', '--verbose', action='store_true')
+    args = parser.parse_args()
+
+    if args.seed is not None:
+        random.seed(args.seed)
+
+    layout = load_layout(args.layout) if args.layout else default_layout()
+
+    if args.port:
+        master = slave = os.open(args.port, os.O_RDWR | os.O_NOCTTY)
+        name = args.port
+    else:
+        master, slave = pty.openpty()
+        name = os.ttyname(slave)
+    tty.setraw(slave)
+    attrs = termios.tcgetattr(slave)
+    attrs[4] = attrs[5] = termios.B9600
+    termios.tcsetattr(slave, termios.TCSANOW, attrs)
+    if args.link and not args.port:
+        if os.path.islink(args.link):
+            os.unlink(args.link)
+        os.symlink(name, args.link)
+        name = '%s -> %s' % (args.link, name)
+    print('DFPlayer emulado en %s' % name, flush=True)
+
+    emulator = Emulator(master, layout, args)
+    try:
+        emulator.run(args.duration)
+    except KeyboardInterrupt:
+        pass
+    finally:
+        if args.link and not args.port and os.path.islink(args.link):
+            os.unlink(args.link)
+
+    json.dump(emulator.stats, sys.stdout, indent=2)
+    print()
+
+
+if __name__ == '__main__':
+    main()
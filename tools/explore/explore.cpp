@@ -0,0 +1,982 @@
+/*
+ * explore.cpp
+ * Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)
+ *
+ * Exploracion exhaustiva de los estados de RuliBrain en el host. Ejecuta
+ * el firmware (src/, sin modificar) sobre el hardware simulado de
+ * tools/soak/mock y recorre en anchura (BFS) todos los estados alcanzables
+ * bajo eventos abstractos:
+ *
+ *   WHEEL_LEFT/RIGHT, SEL_LEFT/RIGHT   un paso de cada encoder
+ *   CLICK, HOLD                        click y retencion del selector
+ *   FINISH, ERROR                      fin o error del tema en curso (solo
+ *                                      con el reproductor simulado en
+ *                                      reproduccion: nunca llega un fin
+ *                                      sin tema). El fin llega como minimo
+ *                                      EXPLORE_TRACK_US luego del inicio
+ *   TICK, MINUTE                       300 ms de ejecucion, salto de 60 s
+ *
+ * Cada evento se aplica sobre la imagen de memoria del estado de origen
+ * y se ejecuta el lazo principal hasta EXPLORE_SETTLE_US despues. El
+ * estado abstracto (ver Key: funcionalidades, flags del selector, voz y
+ * giro, currentStep, data[], volumen, sonidos en curso y reproductor)
+ * se identifica por un hash de 64 bits: dos estados concretos con el
+ * mismo estado abstracto se exploran una sola vez, desde el primero
+ * encontrado. Los nodos de cada nivel del BFS se reparten entre los
+ * hilos (-j) y el resultado no depende de su cantidad (ver expand()); las
+ * imagenes de la frontera se guardan como diferencias con el arranque.
+ *
+ * Informa:
+ *
+ *   INVARIANT  estados que violan los invariantes (funcionalidades y
+ *              volumen en rango, ajuste de volumen sin selector, voz sin
+ *              sonido de voz en curso, pasada colgada)
+ *   DEADLOCK   estados de los que ningun evento sale
+ *   TRAP       estados desde los que no se puede volver a la interfaz en
+ *              reposo (sin voz, selector ni ajuste de volumen), por
+ *              ejemplo esperando un fin de tema que nunca llega
+ *   MODES      funcionalidades nunca alcanzadas
+ *
+ * con el camino mas corto desde el arranque hasta el primer estado de
+ * cada tipo, y los estados explorados por segundo. El hash puede unir
+ * estados distintos (probabilidad ~ estados^2 / 2^65) y el estado
+ * abstracto omite los tiempos: el resultado es una aproximacion, los
+ * caminos informados se reproducen con soak si hace falta. Con -d o
+ * --max-states la exploracion se acota; los estados sin explorar se
+ * suponen capaces de volver a la interfaz en reposo.
+ *
+ * Compilacion: pio run -e explore (ver platformio.ini), o bien
+ *
+ *   g++ -O2 -std=gnu++17 -pthread -D RULI_EXPLORE -I tools/soak/mock -I include \
+ *     tools/explore/explore.cpp tools/soak/mock/mock.cpp src/[A-Z]*.cpp -o explore
+ *
+ * Uso:
+ *
+ *   explore [-j hilos] [-d profundidad] [--max-states n] [-v]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <algorithm>
+
+#include <Arduino.h>
+
+#include "RotaryEncoder.h"
+#include "EncoderBank.h"
+#include "MP3Player.h"
+#include "LedsPanel.h"
+#include "RuliBrain.h"
+#include <DFRobotDFPlayerMini.h>
+
+
+// Pines del equipo (ver main.cpp)
+#define MW_CLK_PIN     16
+#define MW_DATA_PIN    15
+#define RS_SWITCH_PIN  19
+#define RS_CLK_PIN     18
+#define RS_DATA_PIN    17
+#define MP_RX          10
+#define MP_TX          11
+#define LP_ENABLE_PIN  8
+#define LP_CLOCK_PIN   9
+#define LP_DATA_PIN    12
+
+// Funcionalidades y limites (ver RuliBrain.cpp)
+#define EXPLORE_USER_PROGRAM    9
+#define EXPLORE_IDDLE          10
+#define EXPLORE_MODES          11
+#define EXPLORE_MAX_VOLUME     30
+
+/*
+ * Tiempos (us simulados): pasada del lazo, ejecucion luego de
+ * cada evento, duracion del click y de la retencion (mayor que
+ * GESTURE_HOLD_US, menor que la primera repeticion)
+ */
+#define EXPLORE_PASS_US        1000
+#define EXPLORE_SETTLE_US     50000
+#define EXPLORE_CLICK_US     100000
+#define EXPLORE_HOLD_US      800000
+#define EXPLORE_TICK_US      300000
+#define EXPLORE_MINUTE_US  60000000ULL
+#define EXPLORE_HANG_US     2000000ULL
+
+// Duracion minima de un archivo de la tarjeta (ver trackLength() en soak.cpp)
+#define EXPLORE_TRACK_US     400000
+
+// Limite por defecto de estados explorados
+#define EXPLORE_MAX_STATES  1000000
+
+// Volumen inicial en las configuraciones guardadas
+#define EXPLORE_VOLUME           15
+
+/*
+ * Eventos abstractos
+ */
+#define EV_WHEEL_LEFT    0
+#define EV_WHEEL_RIGHT   1
+#define EV_SEL_LEFT      2
+#define EV_SEL_RIGHT     3
+#define EV_CLICK         4
+#define EV_HOLD          5
+#define EV_FINISH        6
+#define EV_ERROR         7
+#define EV_TICK          8
+#define EV_MINUTE        9
+#define EV_COUNT        10
+
+static const char *eventNames[EV_COUNT] = {
+  "WHEEL_LEFT", "WHEEL_RIGHT", "SEL_LEFT", "SEL_RIGHT", "CLICK", "HOLD",
+  "FINISH", "ERROR", "TICK", "MINUTE"
+};
+
+// Tipos de hallazgo
+#define FIND_RANGE      0
+#define FIND_FLAGS      1
+#define FIND_VOICE      2
+#define FIND_HANG       3
+#define FIND_DEADLOCK   4
+#define FIND_TRAP       5
+#define FIND_COUNT      6
+
+static const char *findNames[FIND_COUNT] = {
+  "INVARIANT range", "INVARIANT flags", "INVARIANT voice", "INVARIANT hang", "DEADLOCK", "TRAP"
+};
+
+static const char *modeNames[EXPLORE_MODES] = {
+  "welcome", "simpleRoulette", "randomColor", "followTheColor", "turnMeter", "velocityMeter",
+  "customShape", "soundShooting", "music", "userProgram", "iddle"
+};
+
+
+/*
+ * Estado abstracto: solo bytes, sin relleno, para el hash
+ */
+struct Key {
+  uint8_t currentFunction;
+  uint8_t prevFunction;
+  uint8_t selectedFunction;
+  uint8_t resumeFunction;
+  uint8_t initializeFunction;
+  uint8_t funcSelectorIsActive;
+  uint8_t volumeSettingIsActive;
+  uint8_t speaking;
+  uint8_t spinning;
+  uint8_t currentStep;
+  uint8_t data[DATA_SIZE];
+  uint8_t volume;
+  uint8_t audio;      // bit por clase de AudioManager con sonido en curso o pendiente
+  uint8_t playing;    // reproductor simulado
+  uint8_t responses;  // mensajes del reproductor pendientes de lectura
+};
+
+static uint64_t hashKey(const Key &key) {
+
+  const uint8_t *bytes = (const uint8_t *) &key;
+  uint64_t h = 14695981039346656037ULL;
+
+  for ( size_t i = 0 ; i < sizeof(Key) ; i++ ) {
+    h ^= bytes[i];
+    h *= 1099511628211ULL;
+  }
+
+  // Mezcla final: el FNV-1a solo no distribuye bien los bits altos
+  h ^= h >> 31;
+  h *= 0x9E3779B97F4A7C15ULL;
+  return h ^ (h >> 29);
+
+}
+
+
+////////////////////////////////////
+//
+//    Equipo simulado
+//
+
+struct Model {
+
+  SoakBoard board;
+
+  EncoderBank encoderBank;
+  RotaryEncoder mainWheel;
+  RotaryEncoder rotarySelector;
+  MP3Player mp3Player;
+  FastLedsPanel<LP_ENABLE_PIN, LP_CLOCK_PIN, LP_DATA_PIN> ledsPanel;
+  RuliBrain ruliBrain;
+
+  // Inicio del tema en curso en el reproductor simulado
+  uint32_t lastStarted;
+  uint64_t trackStart;
+
+  void boot(int function);
+  void pass(void);
+  void settle(uint64_t us);
+  void turn(uint8_t clkBit, uint8_t dataBit, bool left);
+  bool apply(uint8_t event);
+
+};
+
+
+/*
+ * Arranque igual que setup() de main.cpp, con la EEPROM en blanco
+ * ([function] 0) o con la configuracion guardada de [function]
+ */
+void Model::boot(int function) {
+
+  soakBoard = &board;
+
+  memset(&board, 0x00, sizeof(board));
+  board.hangLimit = EXPLORE_HANG_US;
+  board.rng = 1;
+  memset(board.eeprom, 0xFF, SOAK_EEPROM_SIZE);
+
+  if ( function ) {
+    board.eeprom[0] = 'R';
+    board.eeprom[1] = EXPLORE_VOLUME;
+    board.eeprom[2] = function;
+  }
+
+  // Entradas con pull-up en reposo
+  PINB = 0xFF;
+  PINC = 0xFF;
+  PIND = 0xFF;
+
+  mainWheel.begin(MW_CLK_PIN, MW_DATA_PIN);
+  rotarySelector.begin(RS_CLK_PIN, RS_DATA_PIN, RS_SWITCH_PIN);
+  encoderBank.begin();
+  mainWheel.attach(&encoderBank);
+  rotarySelector.attach(&encoderBank);
+  mp3Player.begin(MP_RX, MP_TX);
+  ledsPanel.begin();
+  ruliBrain.begin(&mainWheel, &rotarySelector, &mp3Player, &ledsPanel);
+
+  lastStarted = 0;
+  trackStart = 0;
+
+  settle(EXPLORE_SETTLE_US);
+
+}
+
+
+void Model::pass(void) {
+
+  board.passStart = board.now;
+
+  encoderBank.sample();
+  ruliBrain.run();
+
+  board.now += EXPLORE_PASS_US;
+
+  if ( board.started != lastStarted ) {
+    lastStarted = board.started;
+    trackStart = board.now;
+  }
+
+}
+
+
+void Model::settle(uint64_t us) {
+
+  uint64_t target = board.now + us;
+
+  do
+    pass();
+  while ( board.now < target );
+
+}
+
+
+// Los giros dejan CLK en bajo durante una pasada (DATA en alto: izquierda)
+void Model::turn(uint8_t clkBit, uint8_t dataBit, bool left) {
+
+  if ( left )
+    PINC |= dataBit;
+  else
+    PINC &= ~dataBit;
+
+  PINC &= ~clkBit;
+  pass();
+  PINC |= clkBit | dataBit;
+
+}
+
+
+/**
+ * Aplica [event] y ejecuta hasta que se estabiliza. Devuelve
+ * false si el evento no esta habilitado en el estado actual
+ */
+bool Model::apply(uint8_t event) {
+
+  switch ( event ) {
+
+    case EV_WHEEL_LEFT:  { turn(1 << 2, 1 << 1, true); break; }
+    case EV_WHEEL_RIGHT: { turn(1 << 2, 1 << 1, false); break; }
+    case EV_SEL_LEFT:    { turn(1 << 4, 1 << 3, true); break; }
+    case EV_SEL_RIGHT:   { turn(1 << 4, 1 << 3, false); break; }
+
+    case EV_CLICK:
+    case EV_HOLD: {
+      PINC &= ~(1 << 5);
+      settle(event == EV_CLICK ? EXPLORE_CLICK_US : EXPLORE_HOLD_US);
+      PINC |= 1 << 5;
+      break;
+    }
+
+    case EV_FINISH: {
+      if ( board.playing == 0 )
+        return false;
+      if ( board.now - trackStart < EXPLORE_TRACK_US )
+        settle(EXPLORE_TRACK_US - (board.now - trackStart));
+      if ( board.playing == 0 )
+        return false;
+      board.playing = 0;
+      board.respond(DFPlayerPlayFinished, board.file);
+      break;
+    }
+
+    case EV_ERROR: {
+      if ( board.playing == 0 )
+        return false;
+      board.playing = 0;
+      board.respond(DFPlayerError, FileMismatch);
+      break;
+    }
+
+    case EV_TICK: { settle(EXPLORE_TICK_US); break; }
+
+    // Sin entradas durante un minuto: los intervalos vencen en la proxima pasada
+    case EV_MINUTE: { board.now += EXPLORE_MINUTE_US; break; }
+  }
+
+  settle(EXPLORE_SETTLE_US);
+
+  return true;
+
+}
+
+
+////////////////////////////////////
+//
+//    Acceso al estado interno
+//
+
+class Explorer {
+
+public:
+
+  static void key(Model &model, Key &key) {
+
+    RuliBrain &brain = model.ruliBrain;
+
+    memset(&key, 0x00, sizeof(key));
+    key.currentFunction = brain.currentFunction;
+    key.prevFunction = brain.prevFunction;
+    key.selectedFunction = brain.selectedFunction;
+    key.resumeFunction = brain.resumeFunction;
+    key.initializeFunction = brain.initializeFunction;
+    key.funcSelectorIsActive = brain.funcSelectorIsActive;
+    key.volumeSettingIsActive = brain.volumeSettingIsActive;
+    key.speaking = brain.speaking;
+    key.spinning = brain.spinning;
+    key.currentStep = brain.currentStep;
+    memcpy(key.data, brain.data, DATA_SIZE);
+    key.volume = model.mp3Player.getVolume();
+
+    for ( uint8_t c = AUDIO_MUSIC ; c <= AUDIO_VOICE ; c++ )
+      if ( brain.audio.isPlaying(c) )
+        key.audio |= 1 << c;
+
+    key.playing = model.board.playing;
+    key.responses = model.board.responseCount;
+
+  }
+
+  // Invariantes del estado [key]: devuelve el tipo de hallazgo o FIND_COUNT
+  static uint8_t check(const Key &key) {
+
+    if ( key.selectedFunction < 1 || key.selectedFunction > EXPLORE_USER_PROGRAM ||
+         key.currentFunction > EXPLORE_IDDLE || key.prevFunction > EXPLORE_IDDLE ||
+         key.volume > EXPLORE_MAX_VOLUME )
+      return FIND_RANGE;
+
+    // El ajuste de volumen se activa desde el selector y ambos terminan juntos
+    if ( key.volumeSettingIsActive && ! key.funcSelectorIsActive )
+      return FIND_FLAGS;
+
+    // ledSpeakEffect() libera la voz en cuanto termina el sonido
+    if ( key.speaking && (key.audio & (1 << AUDIO_VOICE)) == 0 )
+      return FIND_VOICE;
+
+    return FIND_COUNT;
+
+  }
+
+  // Interfaz en reposo: acepta el selector de funcionalidades
+  static bool ready(const Key &key) {
+
+    return ! key.speaking && ! key.funcSelectorIsActive && ! key.volumeSettingIsActive;
+
+  }
+
+  static void print(const Key &key) {
+
+    printf("    function %u (prev %u, selected %u, resume %u) step %u%s%s%s%s%s | data",
+      key.currentFunction, key.prevFunction, key.selectedFunction, key.resumeFunction, key.currentStep,
+      key.initializeFunction ? " INIT" : "", key.funcSelectorIsActive ? " SELECTOR" : "",
+      key.volumeSettingIsActive ? " VOLUME" : "", key.speaking ? " SPEAKING" : "",
+      key.spinning ? " SPINNING" : "");
+    for ( uint8_t i = 0 ; i < DATA_SIZE ; i++ )
+      printf(" %02X", key.data[i]);
+    printf(" | vol %u audio %X player %s responses %u\n", key.volume, key.audio,
+      key.playing ? "playing" : "stopped", key.responses);
+
+  }
+
+};
+
+
+////////////////////////////////////
+//
+//    Imagenes de memoria
+//
+
+/*
+ * Las imagenes se copian sobre el Model de cada hilo: los punteros
+ * internos (objetos apuntados por RuliBrain, los encoders y el panel)
+ * se guardan relativos al inicio. Se detectan arrancando dos Model
+ * en direcciones distintas: las palabras que difieren exactamente
+ * en la distancia entre ambos son punteros internos
+ */
+static std::vector<size_t> pointerOffsets;
+
+// Imagen del arranque en blanco, base de las diferencias de la frontera
+static std::vector<uint8_t> reference;
+
+static void findPointers(void) {
+
+  Model *a = new Model();
+  Model *b = new Model();
+  uintptr_t baseA = (uintptr_t) a, baseB = (uintptr_t) b;
+
+  a->boot(0);
+  b->boot(0);
+
+  for ( size_t offset = 0 ; offset + sizeof(uintptr_t) <= sizeof(Model) ; offset += sizeof(uintptr_t) ) {
+
+    uintptr_t wordA, wordB;
+    memcpy(&wordA, (uint8_t *) a + offset, sizeof(wordA));
+    memcpy(&wordB, (uint8_t *) b + offset, sizeof(wordB));
+
+    if ( wordA >= baseA && wordA < baseA + sizeof(Model) && wordB - wordA == baseB - baseA )
+      pointerOffsets.push_back(offset);
+  }
+
+  // Los objetos de a y b en el heap (puerto serie del reproductor, sin estado) se conservan
+  delete b;
+
+  reference.resize(sizeof(Model));
+  memcpy(reference.data(), (void *) a, sizeof(Model));
+  for ( size_t offset : pointerOffsets ) {
+    uintptr_t word;
+    memcpy(&word, &reference[offset], sizeof(word));
+    word -= baseA;
+    memcpy(&reference[offset], &word, sizeof(word));
+  }
+
+}
+
+
+/*
+ * Imagen de [model]: diferencia con la de referencia, en tramos
+ * de (bytes iguales, bytes distintos, bytes distintos) con largos
+ * de 16 bits
+ */
+static void save(Model &model, std::vector<uint8_t> &image) {
+
+  uint8_t raw[sizeof(Model)];
+  uintptr_t base = (uintptr_t) &model;
+
+  memcpy(raw, (void *) &model, sizeof(Model));
+  for ( size_t offset : pointerOffsets ) {
+    uintptr_t word;
+    memcpy(&word, &raw[offset], sizeof(word));
+    word -= base;
+    memcpy(&raw[offset], &word, sizeof(word));
+  }
+
+  image.clear();
+
+  size_t i = 0;
+  while ( i < sizeof(Model) ) {
+
+    size_t same = i;
+    while ( same < sizeof(Model) && same - i < 0xFFFF && raw[same] == reference[same] )
+      same++;
+
+    size_t diff = same;
+    while ( diff < sizeof(Model) && diff - same < 0xFFFF && raw[diff] != reference[diff] )
+      diff++;
+
+    uint16_t lengths[2] = { (uint16_t) (same - i), (uint16_t) (diff - same) };
+    image.insert(image.end(), (uint8_t *) lengths, (uint8_t *) lengths + sizeof(lengths));
+    image.insert(image.end(), raw + same, raw + diff);
+    i = diff;
+  }
+
+}
+
+
+static void restore(Model &model, const std::vector<uint8_t> &image) {
+
+  uint8_t raw[sizeof(Model)];
+  uintptr_t base = (uintptr_t) &model;
+  size_t i = 0, at = 0;
+
+  memcpy(raw, reference.data(), sizeof(Model));
+
+  while ( at < image.size() ) {
+    uint16_t lengths[2];
+    memcpy(lengths, &image[at], sizeof(lengths));
+    at += sizeof(lengths);
+    i += lengths[0];
+    memcpy(raw + i, &image[at], lengths[1]);
+    i += lengths[1];
+    at += lengths[1];
+  }
+
+  for ( size_t offset : pointerOffsets ) {
+    uintptr_t word;
+    memcpy(&word, &raw[offset], sizeof(word));
+    word += base;
+    memcpy(&raw[offset], &word, sizeof(word));
+  }
+
+  memcpy((void *) &model, raw, sizeof(Model));
+  soakBoard = &model.board;
+
+}
+
+
+////////////////////////////////////
+//
+//    Exploracion
+//
+
+// Estado visitado: como se alcanzo (camino mas corto) y su estado abstracto
+struct State {
+  uint32_t parent;
+  uint8_t event;
+  uint8_t root;       // configuracion de arranque (0: EEPROM en blanco)
+  uint8_t expanded;   // con todos sus sucesores registrados
+  uint8_t exits;      // eventos que llevan a otro estado
+  uint16_t depth;
+  Key key;
+};
+
+// Estado de la frontera con su imagen de memoria
+struct Node {
+  uint32_t id;
+  std::vector<uint8_t> image;
+};
+
+// Sucesor de un nodo de la frontera por [event]
+struct Candidate {
+  uint8_t event;
+  uint8_t kind;
+  uint64_t hash;
+  Key key;
+};
+
+// Estado nuevo a agregar a la proxima frontera
+struct Pending {
+  uint32_t id;
+  uint32_t node;
+  uint8_t event;
+};
+
+struct Edge {
+  uint32_t from;
+  uint32_t to;
+};
+
+#define NO_STATE 0xFFFFFFFF
+
+static std::vector<State> states;
+static uint32_t stateCount;
+static bool bounded;
+static uint32_t maxStates = EXPLORE_MAX_STATES;
+
+// Estados visitados por hash del estado abstracto
+static std::unordered_map<uint64_t, uint32_t> visited;
+
+// Primer estado (menor profundidad) de cada tipo de hallazgo y cantidad
+static uint32_t findFirst[FIND_COUNT];
+static uint64_t findCount[FIND_COUNT];
+
+
+static void found(uint8_t kind, uint32_t id) {
+
+  findCount[kind]++;
+  if ( findFirst[kind] == NO_STATE || states[id].depth < states[findFirst[kind]].depth )
+    findFirst[kind] = id;
+
+}
+
+
+/**
+ * Registra el estado [key] alcanzado desde [parent] con [event].
+ * Devuelve su numero, NO_STATE si se alcanzo el limite
+ */
+static uint32_t add(const Key &key, uint64_t hash, uint32_t parent, uint8_t event, uint8_t root, uint16_t depth) {
+
+  if ( stateCount >= maxStates ) {
+    bounded = true;
+    return NO_STATE;
+  }
+
+  uint32_t id = stateCount++;
+  State &state = states[id];
+
+  state.parent = parent;
+  state.event = event;
+  state.root = root;
+  state.expanded = 0;
+  state.exits = 0;
+  state.depth = depth;
+  state.key = key;
+  visited.emplace(hash, id);
+
+  return id;
+
+}
+
+
+/*
+ * Cada nivel del BFS en tres fases para que el resultado no dependa
+ * del reparto entre los hilos: los hilos calculan los sucesores de
+ * los nodos de la frontera (sin modificar los visitados), luego se
+ * registran en orden de frontera y evento, y por ultimo los hilos
+ * recalculan la imagen de los nuevos (el firmware es determinista)
+ */
+static void successors(const std::vector<Node> *frontier, std::atomic<size_t> *cursor,
+                       std::vector<std::vector<Candidate>> *candidates) {
+
+  Model *model = new Model();
+  size_t index;
+
+  while ( (index = (*cursor)++) < frontier->size() ) {
+
+    std::vector<Candidate> &list = (*candidates)[index];
+
+    for ( uint8_t event = 0 ; event < EV_COUNT ; event++ ) {
+
+      Candidate candidate;
+      candidate.event = event;
+      candidate.kind = FIND_COUNT;
+
+      restore(*model, (*frontier)[index].image);
+
+      try {
+        if ( ! model->apply(event) )
+          continue;
+      } catch ( SoakHang &hang ) {
+        candidate.kind = FIND_HANG;
+      }
+
+      Explorer::key(*model, candidate.key);
+      if ( candidate.kind == FIND_COUNT )
+        candidate.kind = Explorer::check(candidate.key);
+      candidate.hash = hashKey(candidate.key);
+
+      // Los visitados no cambian en esta fase
+      auto it = visited.find(candidate.hash);
+      if ( it == visited.end() || it->second != (*frontier)[index].id )
+        list.push_back(candidate);
+    }
+  }
+
+  delete model;
+
+}
+
+
+static void images(const std::vector<Node> *frontier, const std::vector<Pending> *pending,
+                   std::atomic<size_t> *cursor, std::vector<Node> *next) {
+
+  Model *model = new Model();
+  size_t index;
+
+  while ( (index = (*cursor)++) < pending->size() ) {
+
+    const Pending &state = (*pending)[index];
+
+    restore(*model, (*frontier)[state.node].image);
+    model->apply(state.event);
+
+    (*next)[index].id = state.id;
+    save(*model, (*next)[index].image);
+  }
+
+  delete model;
+
+}
+
+
+/*
+ * Expande un nivel: deja en [frontier] los estados nuevos
+ * (sin los invalidos) y agrega sus transiciones a [edges]
+ */
+static void expand(std::vector<Node> &frontier, std::vector<Edge> &edges, unsigned threads) {
+
+  std::vector<std::vector<Candidate>> candidates(frontier.size());
+  std::vector<Pending> pending;
+  std::vector<std::thread> pool;
+  std::atomic<size_t> cursor(0);
+
+  for ( unsigned t = 0 ; t < threads ; t++ )
+    pool.emplace_back(successors, &frontier, &cursor, &candidates);
+  for ( std::thread &thread : pool )
+    thread.join();
+
+  for ( size_t index = 0 ; index < frontier.size() ; index++ ) {
+
+    State &from = states[frontier[index].id];
+    bool complete = true;
+
+    for ( const Candidate &candidate : candidates[index] ) {
+
+      uint32_t id;
+      auto it = visited.find(candidate.hash);
+
+      if ( it != visited.end() )
+        id = it->second;
+      else {
+        id = add(candidate.key, candidate.hash, frontier[index].id, candidate.event, from.root, from.depth + 1);
+        if ( id == NO_STATE ) {
+          complete = false;
+          continue;
+        }
+
+        if ( candidate.kind != FIND_COUNT )
+          found(candidate.kind, id);
+        else
+          pending.push_back({ id, (uint32_t) index, candidate.event });
+      }
+
+      if ( id != frontier[index].id ) {
+        edges.push_back({ frontier[index].id, id });
+        from.exits++;
+      }
+    }
+
+    // Con sucesores descartados por el limite no se sabe si sale
+    from.expanded = complete;
+    if ( complete && from.exits == 0 )
+      found(FIND_DEADLOCK, frontier[index].id);
+  }
+
+  std::vector<Node> next(pending.size());
+
+  pool.clear();
+  cursor = 0;
+  for ( unsigned t = 0 ; t < threads ; t++ )
+    pool.emplace_back(images, &frontier, &pending, &cursor, &next);
+  for ( std::thread &thread : pool )
+    thread.join();
+
+  frontier.swap(next);
+
+}
+
+
+/*
+ * Estados desde los que no se alcanza la interfaz en reposo:
+ * recorrido hacia atras desde los estados en reposo y desde los
+ * no expandidos (limite alcanzado o invalidos, supuestos capaces)
+ */
+static void findTraps(const std::vector<Edge> &edges) {
+
+  uint32_t count = stateCount;
+  std::vector<uint32_t> start(count + 1, 0), from(edges.size());
+  std::vector<uint8_t> reaches(count, 0);
+  std::vector<uint32_t> queue;
+
+  for ( const Edge &edge : edges )
+    start[edge.to + 1]++;
+  for ( uint32_t i = 0 ; i < count ; i++ )
+    start[i + 1] += start[i];
+
+  std::vector<uint32_t> fill(start.begin(), start.end() - 1);
+  for ( const Edge &edge : edges )
+    from[fill[edge.to]++] = edge.from;
+
+  for ( uint32_t i = 0 ; i < count ; i++ )
+    if ( Explorer::ready(states[i].key) || ! states[i].expanded ) {
+      reaches[i] = 1;
+      queue.push_back(i);
+    }
+
+  for ( size_t q = 0 ; q < queue.size() ; q++ )
+    for ( uint32_t e = start[queue[q]] ; e < start[queue[q] + 1] ; e++ )
+      if ( ! reaches[from[e]] ) {
+        reaches[from[e]] = 1;
+        queue.push_back(from[e]);
+      }
+
+  for ( uint32_t i = 0 ; i < count ; i++ )
+    if ( ! reaches[i] )
+      found(FIND_TRAP, i);
+
+}
+
+
+// Camino desde el arranque hasta [id]
+static void printPath(uint32_t id, bool verbose) {
+
+  std::vector<uint32_t> path;
+
+  for ( uint32_t s = id ; s != NO_STATE ; s = states[s].parent )
+    path.push_back(s);
+  std::reverse(path.begin(), path.end());
+
+  if ( states[id].root )
+    printf("  boot with function %u saved", states[id].root);
+  else
+    printf("  boot with blank EEPROM");
+
+  for ( size_t i = 1 ; i < path.size() ; i++ )
+    printf(", %s", eventNames[states[path[i]].event]);
+  printf("\n");
+
+  if ( verbose )
+    for ( uint32_t s : path )
+      Explorer::print(states[s].key);
+  else
+    Explorer::print(states[id].key);
+
+}
+
+
+static void usage(void) {
+
+  fprintf(stderr, "usage: explore [-j threads] [-d max depth] [--max-states n] [-v]\n");
+  exit(1);
+
+}
+
+
+int main(int argc, char **argv) {
+
+  unsigned threads = std::thread::hardware_concurrency();
+  unsigned maxDepth = 0;
+  bool verbose = false;
+
+  for ( int i = 1 ; i < argc ; i++ ) {
+    std::string arg = argv[i];
+    if ( arg == "-v" ) { verbose = true; continue; }
+    if ( i + 1 >= argc ) usage();
+    if ( arg == "-j" ) threads = strtoul(argv[++i], NULL, 0);
+    else if ( arg == "-d" ) maxDepth = strtoul(argv[++i], NULL, 0);
+    else if ( arg == "--max-states" ) maxStates = strtoul(argv[++i], NULL, 0);
+    else usage();
+  }
+
+  if ( threads == 0 )
+    threads = 1;
+
+  states.resize(maxStates);
+  for ( uint8_t k = 0 ; k < FIND_COUNT ; k++ )
+    findFirst[k] = NO_STATE;
+
+  findPointers();
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<Node> frontier;
+  std::vector<Edge> edges;
+  Model *model = new Model();
+
+  // Arranques: EEPROM en blanco y cada funcionalidad guardada
+  for ( int function = 0 ; function <= EXPLORE_USER_PROGRAM ; function++ ) {
+
+    Key key;
+
+    model->boot(function);
+    Explorer::key(*model, key);
+
+    uint64_t hash = hashKey(key);
+    if ( visited.count(hash) )
+      continue;
+
+    uint32_t id = add(key, hash, NO_STATE, 0, function, 0);
+
+    if ( Explorer::check(key) != FIND_COUNT )
+      found(Explorer::check(key), id);
+    else {
+      frontier.push_back({ id, std::vector<uint8_t>() });
+      save(*model, frontier.back().image);
+    }
+  }
+
+  delete model;
+
+  printf("%6s %10s %10s %12s\n", "depth", "frontier", "states", "states/s");
+
+  // Con el limite alcanzado un nivel mas solo descartaria sucesores
+  for ( unsigned depth = 0 ; ! frontier.empty() && (maxDepth == 0 || depth < maxDepth) && stateCount < maxStates ; depth++ ) {
+
+    expand(frontier, edges, threads);
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("%6u %10zu %10u %12.0f\n", depth + 1, frontier.size(), stateCount, stateCount / seconds);
+    fflush(stdout);
+  }
+
+  if ( ! frontier.empty() )
+    bounded = true;
+
+  findTraps(edges);
+
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  unsigned failures = 0;
+
+  printf("\n%u states, %zu transitions, %u threads, %.1f s: %.0f states/s%s\n",
+    stateCount, edges.size(), threads, seconds, stateCount / seconds,
+    bounded ? " (bounded: -d or --max-states reached)" : "");
+
+  bool reached[EXPLORE_MODES] = { false };
+  for ( uint32_t i = 0 ; i < stateCount ; i++ )
+    if ( states[i].key.currentFunction < EXPLORE_MODES )
+      reached[states[i].key.currentFunction] = true;
+
+  std::string unreachable;
+  for ( uint8_t m = 0 ; m < EXPLORE_MODES ; m++ )
+    if ( ! reached[m] )
+      unreachable += std::string(" ") + modeNames[m];
+
+  if ( unreachable.empty() )
+    printf("all modes reached\n");
+  else {
+    printf("MODES unreachable:%s\n", unreachable.c_str());
+    failures++;
+  }
+
+  for ( uint8_t k = 0 ; k < FIND_COUNT ; k++ ) {
+
+    if ( findCount[k] == 0 )
+      continue;
+
+    printf("\n%s: %llu states, shortest path:\n", findNames[k], (unsigned long long) findCount[k]);
+    printPath(findFirst[k], verbose);
+    failures++;
+  }
+
+  return failures ? 1 : 0;
+
+}
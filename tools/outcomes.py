@@ -0,0 +1,164 @@
+#!/usr/bin/env python3
+#
+# outcomes.py
+# Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)
+#
+# Exportacion de las estadisticas de resultados de Ruli (ver OutcomeStats.h):
+# en que led se detuvo randomColor() y desde que led disparo soundShooting().
+# Solicita los contadores por el puerto serie, o los lee de un volcado de la
+# EEPROM en formato Intel HEX, e imprime el histograma por led y por seccion
+# junto con una prueba de uniformidad (chi cuadrado).
+#
+# Uso:
+#   python3 tools/outcomes.py /dev/ttyUSB0
+#   python3 tools/outcomes.py --eeprom eeprom.hex
+#   python3 tools/outcomes.py /dev/ttyUSB0 --csv > resultados.csv
+#
+# El volcado se obtiene por ejemplo con:
+#   avrdude -p m328p -c arduino -P /dev/ttyUSB0 -U eeprom:r:eeprom.hex:i
+#
+
+import argparse
+import os
+import select
+import sys
+import time
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import stream_send        # noqa: E402
+import telemetry_decode   # noqa: E402
+
+
+MODES       = telemetry_decode.OUTCOME_MODES
+LEDS        = 40
+ADDRESS     = 0x090     # EEPROM_OUTCOMES de RuliBrain.cpp
+SIZE        = 0x100
+KEY         = ord('o')
+EMPTY       = 0xFF
+EPOCH       = 0x80
+LOGGING, FOLD, ERASE = 0, 1, 2
+ST_EXPORT   = 0x05
+
+# Seccion de cada grupo de 8 leds (ver LedsPanel::getWheelNValue())
+SECTIONS = ['WHITE', 'GREEN', 'BLUE', 'RED', 'YELLOW']
+
+
+def from_serial(port, timeout, boot_wait):
+    fd = stream_send.open_port(port)
+    decoder = telemetry_decode.Decoder(quiet=True)
+    time.sleep(boot_wait)
+    os.write(fd, stream_send.record(ST_EXPORT, 0, 0))
+    end = time.monotonic() + timeout
+    try:
+        while time.monotonic() < end and len(decoder.outcomes) < len(MODES) * LEDS:
+            ready, _, _ = select.select([fd], [], [], 0.1)
+            if ready:
+                decoder.feed(os.read(fd, 4096))
+    finally:
+        os.close(fd)
+    if len(decoder.outcomes) < len(MODES) * LEDS:
+        sys.exit('exportacion incompleta: %d de %d contadores'
+                 % (len(decoder.outcomes), len(MODES) * LEDS))
+    return [[decoder.outcomes[(mode, led)] for led in range(LEDS)]
+            for mode in range(len(MODES))]
+
+
+def read_hex(path):
+    memory = {}
+    with open(path) as f:
+        for line in f:
+            line = line.strip()
+            if not line.startswith(':'):
+                continue
+            raw = bytes.fromhex(line[1:])
+            count, address, rtype = raw[0], raw[1] << 8 | raw[2], raw[3]
+            if rtype == 0:
+                for i in range(count):
+                    memory[address + i] = raw[4 + i]
+    return memory
+
+
+def from_eeprom(path):
+    memory = read_hex(path)
+    if memory.get(ADDRESS) != KEY:
+        sys.exit('la region de estadisticas no tiene formato')
+    state = memory.get(ADDRESS + 1, 0)
+    phase, epoch = state & ~EPOCH, state & EPOCH
+    counters = len(MODES) * LEDS
+    log_address = ADDRESS + 2 + counters * 2
+    log = [memory.get(address, EMPTY) for address in range(log_address, ADDRESS + SIZE)]
+    if phase == LOGGING:
+        log = log[:log.index(EMPTY)] if EMPTY in log else log
+    counts = []
+    for counter in range(counters):
+        address = ADDRESS + 2 + counter * 2
+        low, high = memory.get(address, 0), memory.get(address + 1, 0)
+        total = (low & ~EPOCH) | (high & ~EPOCH) << 7
+        occurrences = log.count(counter)
+        # Volcado durante la suma (ver OutcomeStats.h): bytes con la epoca actual ya sumados
+        if phase == FOLD and (high & EPOCH) != epoch:
+            if (low & EPOCH) == epoch:
+                total = (low & ~EPOCH) | ((high & ~EPOCH) + ((low & ~EPOCH) < occurrences)) << 7
+            else:
+                total = min(total + occurrences, 0x3FFF)
+        elif phase == LOGGING:
+            total += occurrences
+        counts.append(total)
+    return [counts[mode * LEDS:(mode + 1) * LEDS] for mode in range(len(MODES))]
+
+
+def chi_square(values):
+    total = sum(values)
+    if not total:
+        return 0.0
+    expected = total / len(values)
+    return sum((v - expected) ** 2 / expected for v in values)
+
+
+def report(histograms):
+    for mode, counts in zip(MODES, histograms):
+        total = sum(counts)
+        print('%s: %d resultados' % (mode, total))
+        if not total:
+            continue
+        top = max(counts)
+        for led, count in enumerate(counts):
+            bar = '#' * int(round(40.0 * count / top)) if top else ''
+            print('  led %2d %-6s %6d %5.1f%% %s' % (led, SECTIONS[led // 8], count,
+                                                    100.0 * count / total, bar))
+        sections = [sum(counts[i * 8:(i + 1) * 8]) for i in range(len(SECTIONS))]
+        print('  secciones: %s' % ', '.join('%s=%d' % s for s in zip(SECTIONS, sections)))
+        # 39 grados de libertad: valor critico 54.6 para p = 0.05
+        chi = chi_square(counts)
+        print('  chi cuadrado (uniforme por led) = %.1f%s'
+              % (chi, ' (desvio significativo)' if chi > 54.6 else ''))
+        print()
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Estadisticas de resultados de Ruli')
+    parser.add_argument('port', nargs='?', help='puerto serie del equipo')
+    parser.add_argument('--eeprom', help='volcado de la EEPROM (Intel HEX)')
+    parser.add_argument('--csv', action='store_true', help='salida modo,led,cantidad')
+    parser.add_argument('--timeout', type=float, default=5)
+    parser.add_argument('--boot-wait', type=float, default=2.0)
+    args = parser.parse_args()
+
+    if args.eeprom:
+        histograms = from_eeprom(args.eeprom)
+    elif args.port:
+        histograms = from_serial(args.port, args.timeout, args.boot_wait)
+    else:
+        parser.error('se requiere un puerto serie o --eeprom')
+
+    if args.csv:
+        print('modo,led,cantidad')
+        for mode, counts in zip(MODES, histograms):
+            for led, count in enumerate(counts):
+                print('%s,%d,%d' % (mode, led, count))
+    else:
+        report(histograms)
+
+
+if __name__ == '__main__':
+    main()
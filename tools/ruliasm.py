@@ -0,0 +1,207 @@
+#!/usr/bin/env python3
+#
+# ruliasm.py
+# Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)
+#
+# Ensamblador de programas para la maquina virtual de Ruli (ver RuliVM.h).
+# Genera, a partir de un archivo fuente, la imagen para la memoria EEPROM
+# en formato Intel HEX (grabable con avrdude) y/o un header C con el
+# programa en memoria flash (PROGMEM) para utilizar como programa por defecto.
+#
+# Uso:
+#   python3 tools/ruliasm.py tools/programs/demo.ruli --hex programa.hex
+#   avrdude -p m328p -c arduino -P /dev/ttyUSB0 -U eeprom:w:programa.hex:i
+#   python3 tools/ruliasm.py tools/programs/demo.ruli --header include/RuliProgram.h
+#
+# Sintaxis:
+#   ; comentario
+#   etiqueta:  instruccion operando, operando
+#   Registros r0..r7, numeros decimales, 0x.. o nombres de constantes
+#   (secciones de leds, direcciones de giro y eventos).
+#
+
+import argparse
+import sys
+
+
+# Direccion del programa en EEPROM (ver EEPROM_VM_PROGRAM en RuliBrain.cpp)
+EEPROM_ADDRESS = 0x190
+PROGRAM_KEY    = ord('V')
+PROGRAM_SIZE   = 126     # Debe coincidir con VM_PROGRAM_SIZE de RuliVM.h
+
+# Mnemonico: (codigo, operandos). r = registro, i = byte, w = 16 bits, a = direccion
+OPCODES = {
+    'halt': (0x00, ''),   'ldi':  (0x01, 'ri'), 'mov':  (0x02, 'rr'), 'add':  (0x03, 'rr'),
+    'sub':  (0x04, 'rr'), 'inc':  (0x05, 'r'),  'dec':  (0x06, 'r'),  'and':  (0x07, 'rr'),
+    'or':   (0x08, 'rr'), 'xor':  (0x09, 'rr'), 'not':  (0x0A, 'r'),  'shl':  (0x0B, 'r'),
+    'shr':  (0x0C, 'r'),  'rnd':  (0x0D, 'ri'), 'andi': (0x0E, 'ri'),
+    'sets': (0x10, 'ir'), 'gets': (0x11, 'ri'), 'led':  (0x12, 'rr'), 'gled': (0x13, 'rr'),
+    'rot':  (0x14, 'ii'), 'show': (0x15, ''),
+    'play': (0x20, 'ir'), 'stop': (0x21, ''),
+    'wait': (0x30, 'w'),  'wevt': (0x31, 'r'),
+    'cmp':  (0x40, 'ri'), 'cmpr': (0x41, 'rr'), 'jmp':  (0x42, 'a'),  'jz':   (0x43, 'a'),
+    'jnz':  (0x44, 'a'),  'djnz': (0x45, 'ra'),
+}
+
+SIZES = {'r': 1, 'i': 1, 'w': 2, 'a': 2}
+
+CONSTANTS = {
+    # Secciones de leds (LedsPanel.h)
+    'func_indicator': 0, 'blue': 1, 'green': 2, 'white': 3, 'yellow': 4, 'red': 5,
+    # Direcciones de giro
+    'right': 0, 'left': 1,
+    # Eventos (RotaryEncoder.h), del selector desplazados 4 bits (ver OP_WEVT)
+    'none': 0, 'left_turn': 1, 'right_turn': 2, 'switch_click': 3, 'switch_held': 4,
+    'switch_double_click': 5, 'switch_repeat': 6,
+    'finished': 0x80,
+}
+
+
+class AsmError(Exception):
+    pass
+
+
+def parse_number(text, labels=None):
+    key = text.lower()
+    if labels is not None and key in labels:
+        return labels[key]
+    if key in CONSTANTS:
+        return CONSTANTS[key]
+    if key.startswith("'") and key.endswith("'") and len(key) == 3:
+        return ord(text[1])
+    try:
+        return int(text, 0)
+    except ValueError:
+        raise AsmError('valor invalido "%s"' % text)
+
+
+def tokenize(source):
+    """Devuelve [(linea, etiqueta, mnemonico, operandos)]."""
+    lines = []
+    for number, raw in enumerate(source.splitlines(), 1):
+        text = raw.split(';', 1)[0].strip()
+        label = None
+        if ':' in text:
+            label, text = text.split(':', 1)
+            label, text = label.strip().lower(), text.strip()
+        mnemonic, operands = None, []
+        if text:
+            parts = text.split(None, 1)
+            mnemonic = parts[0].lower()
+            if len(parts) > 1:
+                operands = [o.strip() for o in parts[1].split(',')]
+        lines.append((number, label, mnemonic, operands))
+    return lines
+
+
+def assemble(source):
+    lines = tokenize(source)
+
+    # Primera pasada: direcciones de las etiquetas
+    labels = {}
+    address = 0
+    for number, label, mnemonic, operands in lines:
+        if label:
+            if label in labels:
+                raise AsmError('linea %d: etiqueta repetida "%s"' % (number, label))
+            labels[label] = address
+        if mnemonic:
+            if mnemonic not in OPCODES:
+                raise AsmError('linea %d: instruccion desconocida "%s"' % (number, mnemonic))
+            address += 1 + sum(SIZES[k] for k in OPCODES[mnemonic][1])
+
+    # Segunda pasada: codigo
+    code = bytearray()
+    listing = []
+    for number, label, mnemonic, operands in lines:
+        if not mnemonic:
+            continue
+        opcode, kinds = OPCODES[mnemonic]
+        if len(operands) != len(kinds):
+            raise AsmError('linea %d: %s requiere %d operandos' % (number, mnemonic, len(kinds)))
+        start = len(code)
+        code.append(opcode)
+        for kind, operand in zip(kinds, operands):
+            try:
+                if kind == 'r':
+                    if not (operand.lower().startswith('r') and operand[1:].isdigit()
+                            and int(operand[1:]) < 8):
+                        raise AsmError('registro invalido "%s"' % operand)
+                    code.append(int(operand[1:]))
+                elif kind == 'i':
+                    value = parse_number(operand)
+                    if not -128 <= value <= 255:
+                        raise AsmError('valor fuera de rango "%s"' % operand)
+                    code.append(value & 0xFF)
+                else:
+                    value = parse_number(operand, labels if kind == 'a' else None)
+                    if not 0 <= value <= 0xFFFF:
+                        raise AsmError('valor fuera de rango "%s"' % operand)
+                    code += bytes([value & 0xFF, value >> 8])
+            except AsmError as err:
+                raise AsmError('linea %d: %s' % (number, err))
+        listing.append((start, code[start:], mnemonic, operands))
+
+    if len(code) > PROGRAM_SIZE:
+        raise AsmError('el programa ocupa %d bytes (maximo %d)' % (len(code), PROGRAM_SIZE))
+    return bytes(code), listing
+
+
+def intel_hex(data, address):
+    """Registros Intel HEX de 16 bytes y registro de fin de archivo."""
+    out = []
+    for offset in range(0, len(data), 16):
+        chunk = data[offset:offset + 16]
+        at = address + offset
+        record = bytes([len(chunk), at >> 8, at & 0xFF, 0x00]) + chunk
+        out.append(':%s%02X' % (record.hex().upper(), (-sum(record)) & 0xFF))
+    out.append(':00000001FF')
+    return '\n'.join(out) + '\n'
+
+
+def write_header(path, code, source_name):
+    rows = ',\n'.join('  ' + ', '.join('0x%02X' % b for b in code[i:i + 12])
+                      for i in range(0, len(code), 12))
+    with open(path, 'w', newline='\r\n') as f:
+        f.write('/*\n * RuliProgram.h\n * Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)\n *\n')
+        f.write(' * ARCHIVO GENERADO por tools/ruliasm.py a partir de %s,\n' % source_name)
+        f.write(' * no editar a mano. Programa por defecto del modo USER_PROGRAM\n')
+        f.write(' * (utilizado cuando no hay un programa valido en EEPROM)\n */\n\n')
+        f.write('#ifndef RuliProgram_h\n#define RuliProgram_h\n\n')
+        f.write('#define RULI_PROGRAM_SIZE %d\n\n' % len(code))
+        f.write('const uint8_t ruliProgram[RULI_PROGRAM_SIZE] PROGMEM = {\n%s\n};\n\n' % rows)
+        f.write('#endif\n')
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Ensamblador de la maquina virtual de Ruli')
+    parser.add_argument('source', help='programa fuente')
+    parser.add_argument('--hex', help='imagen EEPROM en formato Intel HEX')
+    parser.add_argument('--header', help='header C con el programa en flash')
+    parser.add_argument('-l', '--list', action='store_true', help='imprimir el listado')
+    args = parser.parse_args()
+
+    with open(args.source) as f:
+        source = f.read()
+    try:
+        code, listing = assemble(source)
+    except AsmError as err:
+        print('%s: %s' % (args.source, err), file=sys.stderr)
+        sys.exit(1)
+
+    if args.list:
+        for address, raw, mnemonic, operands in listing:
+            print('%04X  %-14s %s %s' % (address, raw.hex(' '), mnemonic, ', '.join(operands)))
+
+    if args.hex:
+        image = bytes([PROGRAM_KEY, len(code)]) + code
+        with open(args.hex, 'w') as f:
+            f.write(intel_hex(image, EEPROM_ADDRESS))
+    if args.header:
+        write_header(args.header, code, args.source)
+
+    print('%d bytes de programa (maximo %d)' % (len(code), PROGRAM_SIZE))
+
+
+if __name__ == '__main__':
+    main()
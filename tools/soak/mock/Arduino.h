@@ -0,0 +1,166 @@
+/*
+ * Arduino.h (simulado)
+ * Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)
+ *
+ * Subconjunto del core de Arduino utilizado por el firmware,
+ * implementado sobre SoakBoard (ver tools/soak/mock/mock.cpp)
+ */
+
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "SoakBoard.h"
+#include "binary.h"
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH            1
+#define LOW             0
+#define INPUT           0
+#define OUTPUT          1
+#define INPUT_PULLUP    2
+
+#define A0             14
+#define F_CPU   16000000UL
+
+#define PROGMEM
+#define pgm_read_byte(p)  (*(const uint8_t *) (p))
+#define pgm_read_word(p)  (*(const uint16_t *) (p))
+#define pgm_read_dword(p) (*(const uint32_t *) (p))
+
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper *> (s))
+
+#define ISR(vector) extern "C" void vector(void)
+#define cli()
+#define sei()
+#define noInterrupts()
+#define interrupts()
+
+#define _BV(b) (1 << (b))
+#define bit(b) (1UL << (b))
+
+#ifndef min
+#define min(a, b) ((a) < (b) ? (a) : (b))
+#define max(a, b) ((a) > (b) ? (a) : (b))
+#endif
+#define constrain(a, l, h) ((a) < (l) ? (l) : ((a) > (h) ? (h) : (a)))
+
+/*
+ * Registros: campos de la instancia en ejecucion
+ */
+#define PINB    (soakBoard->PINB)
+#define PINC    (soakBoard->PINC)
+#define PIND    (soakBoard->PIND)
+#define PORTB   (soakBoard->PORTB)
+#define PORTC   (soakBoard->PORTC)
+#define PORTD   (soakBoard->PORTD)
+#define DDRB    (soakBoard->DDRB)
+#define DDRC    (soakBoard->DDRC)
+#define DDRD    (soakBoard->DDRD)
+#define SREG    (soakBoard->SREG)
+#define TCCR1A  (soakBoard->TCCR1A)
+#define TCCR1B  (soakBoard->TCCR1B)
+#define TIMSK1  (soakBoard->TIMSK1)
+#define TIFR1   (soakBoard->TIFR1)
+#define ADCSRA  (soakBoard->ADCSRA)
+#define ADCSRB  (soakBoard->ADCSRB)
+#define ADMUX   (soakBoard->ADMUX)
+#define ACSR    (soakBoard->ACSR)
+#define TCNT1   (soakBoard->TCNT1)
+#define ICR1    (soakBoard->ICR1)
+
+#define ADEN    7
+#define ACME    6
+#define ACBG    6
+#define ACIC    2
+#define ICNC1   7
+#define ICES1   6
+#define CS10    0
+#define CS11    1
+#define ICF1    5
+#define TOV1    0
+#define ICIE1   5
+#define TOIE1   0
+
+// Numeracion de puertos del core: 2 = B, 3 = C, 4 = D
+#define digitalPinToPort(p)     ((p) < 8 ? 4 : ((p) < 14 ? 2 : 3))
+#define digitalPinToBitMask(p)  (1 << ((p) < 8 ? (p) : ((p) < 14 ? (p) - 8 : (p) - 14)))
+#define portInputRegister(p)    ((p) == 2 ? &PINB : ((p) == 3 ? &PINC : &PIND))
+#define portOutputRegister(p)   ((p) == 2 ? &PORTB : ((p) == 3 ? &PORTC : &PORTD))
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+
+unsigned long millis(void);
+unsigned long micros(void);
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+long random(long howBig);
+long random(long howSmall, long howBig);
+void randomSeed(unsigned long seed);
+
+
+class Print {
+
+public:
+
+  virtual size_t write(uint8_t value);
+  size_t write(const uint8_t *buffer, size_t size);
+
+  size_t print(const char *text);
+  size_t print(const __FlashStringHelper *text);
+  size_t print(int value);
+  size_t print(unsigned int value);
+  size_t print(long value);
+  size_t print(unsigned long value, int base = 10);
+  size_t println(const char *text);
+  size_t println(const __FlashStringHelper *text);
+  size_t println(unsigned long value, int base = 10);
+  size_t println(void);
+
+};
+
+
+class Stream : public Print {
+
+public:
+
+  virtual int available(void);
+  virtual int read(void);
+  virtual int peek(void);
+
+};
+
+
+/*
+ * Puerto serie de hardware: sobre el pty de SoakBoard::serialFd
+ * (ver tools/sync/sync_test.cpp) o, sin conectar, descarta lo
+ * transmitido y nunca recibe
+ */
+class HardwareSerial : public Stream {
+
+public:
+
+  void begin(unsigned long bauds);
+  int available(void);
+  int read(void);
+  int peek(void);
+  size_t write(uint8_t value);
+  using Print::write;
+  int availableForWrite(void);
+  void flush(void);
+
+};
+
+extern HardwareSerial Serial;
+
+#endif
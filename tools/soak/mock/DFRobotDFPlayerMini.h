@@ -0,0 +1,59 @@
+/*
+ * DFRobotDFPlayerMini.h (simulado)
+ * Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)
+ *
+ * Reproductor sobre el modelo de SoakBoard: cada comando bloquea
+ * SOAK_MP3_COMMAND_US (transmision por SoftwareSerial) y los
+ * mensajes del reproductor los inyecta el arnes (ver soak.cpp)
+ */
+
+#ifndef DFRobotDFPlayerMini_h
+#define DFRobotDFPlayerMini_h
+
+#include <Arduino.h>
+
+// Tipos de mensaje (igual que la biblioteca original)
+#define TimeOut                 0
+#define WrongStack              1
+#define DFPlayerCardInserted    2
+#define DFPlayerCardRemoved     3
+#define DFPlayerCardOnline      4
+#define DFPlayerPlayFinished    5
+#define DFPlayerError           6
+#define DFPlayerUSBInserted     7
+#define DFPlayerUSBRemoved      8
+#define DFPlayerUSBOnline       9
+#define DFPlayerCardUSBOnline  10
+#define DFPlayerFeedBack       11
+
+// Codigos de error
+#define Busy                    1
+#define FileMismatch            6
+
+
+class DFRobotDFPlayerMini {
+
+  // Envia un comando, devuelve false si el reproductor lo descarta
+  bool command(void);
+
+public:
+
+  bool begin(Stream &stream, bool isACK = true, bool doReset = true);
+  bool available(void);
+  uint8_t readType(void);
+  uint16_t read(void);
+
+  void play(int fileNumber);
+  void playFolder(uint8_t folderNumber, uint8_t fileNumber);
+  void stop(void);
+  void next(void);
+  void previous(void);
+  void volume(uint8_t volume);
+  void volumeUp(void);
+  void volumeDown(void);
+  void enableLoop(void);
+  void disableLoop(void);
+
+};
+
+#endif
@@ -0,0 +1,40 @@
+/*
+ * EEPROM.h (simulado)
+ * Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)
+ *
+ * Cada escritura ocupa la EEPROM SOAK_EEPROM_WRITE_US; una
+ * escritura con la EEPROM ocupada espera (como en el equipo real)
+ */
+
+#ifndef EEPROM_h
+#define EEPROM_h
+
+#include <Arduino.h>
+
+
+class EEPROMClass {
+
+public:
+
+  uint8_t read(int address);
+  void write(int address, uint8_t value);
+  void update(int address, uint8_t value);
+  uint16_t length(void);
+
+  template <typename T> T &get(int address, T &value) {
+    for ( size_t i = 0 ; i < sizeof(T) ; i++ )
+      ((uint8_t *) &value)[i] = read(address + i);
+    return value;
+  }
+
+  template <typename T> const T &put(int address, const T &value) {
+    for ( size_t i = 0 ; i < sizeof(T) ; i++ )
+      update(address + i, ((const uint8_t *) &value)[i]);
+    return value;
+  }
+
+};
+
+extern EEPROMClass EEPROM;
+
+#endif
@@ -0,0 +1,149 @@
+/*
+ * SoakBoard.h
+ * Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)
+ *
+ * Hardware simulado de una instancia del arnes de pruebas de larga
+ * duracion (ver tools/soak/soak.cpp). Cada hilo del arnes ejecuta una
+ * instancia a la vez y la apunta con soakBoard; las funciones de
+ * Arduino, los registros de los puertos, la EEPROM y el DFPlayer de
+ * los headers de esta carpeta operan sobre ella.
+ */
+
+#ifndef SoakBoard_h
+#define SoakBoard_h
+
+#include <stdint.h>
+
+#define SOAK_EEPROM_SIZE     1024
+#define SOAK_RESPONSES          8
+#define SOAK_SERIAL_BUFFER     64
+
+/*
+ * Costo (us) de las operaciones bloqueantes del equipo real
+ */
+#define SOAK_PIN_US             4 // digitalRead() / digitalWrite()
+#define SOAK_CLOCK_US           2 // millis() / micros()
+#define SOAK_EEPROM_WRITE_US 3300 // escritura de un byte en EEPROM
+#define SOAK_MP3_COMMAND_US 10400 // trama de 10 bytes por SoftwareSerial a 9600
+#define SOAK_WS2812_BYTE_US    10 // byte a leds WS2812 (8 bits a 800kHz)
+
+/*
+ * Leds WS2812: bytes capturados por cuadro y tiempo en bajo que
+ * separa un cuadro del siguiente (minimo de la hoja de datos)
+ */
+#define SOAK_WS2812_BYTES     144
+#define SOAK_WS2812_LATCH_US   50
+
+// Volumen del reproductor al encender o luego de un reinicio
+#define SOAK_DEFAULT_VOLUME    15
+
+
+struct SoakTimeline;
+
+// Excepcion lanzada al superar el limite de tiempo de una pasada
+struct SoakHang {
+  uint64_t elapsed;
+};
+
+
+struct SoakBoard {
+
+  // Reloj simulado (us) e inicio de la pasada en curso
+  uint64_t now;
+  uint64_t passStart;
+  uint64_t hangLimit;
+
+  // Generador de random() del firmware
+  uint32_t rng;
+
+  // EEPROM, fin de la escritura en curso y su direccion
+  uint8_t eeprom[SOAK_EEPROM_SIZE];
+  uint64_t eepromReady;
+  uint16_t eepromLast;
+  uint32_t eepromWrites;
+
+  // Escrituras de cada byte de la EEPROM (ver soak --usage)
+  uint32_t eepromCellWrites[SOAK_EEPROM_SIZE];
+
+  // Registros de los puertos
+  volatile uint8_t PINB, PINC, PIND;
+  volatile uint8_t PORTB, PORTC, PORTD;
+  volatile uint8_t DDRB, DDRC, DDRD;
+
+  // Registros utilizados por ReactionTimer (sin efecto)
+  volatile uint8_t SREG, TCCR1A, TCCR1B, TIMSK1, TIFR1;
+  volatile uint8_t ADCSRA, ADCSRB, ADMUX, ACSR;
+  volatile uint16_t TCNT1, ICR1;
+
+  /*
+   * Modelo del DFPlayer: tema en reproduccion (started cuenta los
+   * comandos aceptados), ultimo comando, comandos descartados por
+   * estar ocupado y mensajes pendientes de lectura
+   */
+  uint8_t playing;
+  uint8_t folder;
+  uint8_t file;
+  uint8_t volume;
+  uint32_t started;
+  uint64_t lastCommand;
+  uint32_t commands;
+  uint32_t busyRejects;
+
+  struct Response {
+    uint8_t type;
+    uint16_t value;
+  } responses[SOAK_RESPONSES], current;
+  uint8_t responseCount;
+
+  /*
+   * Puerto serie de hardware sobre un pty (serialFd 0: sin conectar,
+   * descarta lo transmitido y nunca recibe). serialTxStart es el
+   * reloj al comenzar la ultima rafaga en la linea y serialTxCount
+   * sus bytes: el receptor calcula desde ellos el fin de cada byte
+   */
+  int serialFd;
+  uint32_t serialByteUs;
+  uint64_t serialTxStart;
+  uint32_t serialTxCount;
+  uint8_t serialRx[SOAK_SERIAL_BUFFER];
+  uint8_t serialCount;
+
+  // Bytes transmitidos y leidos del pty desde el arranque
+  uint64_t serialTxBytes;
+  uint64_t serialRxBytes;
+
+  /*
+   * Leds WS2812 (ver Ws2812.h): bytes del cuadro en curso en orden
+   * de envio, pin, fin del ultimo byte y cuadros recibidos
+   */
+  uint8_t ws2812Data[SOAK_WS2812_BYTES];
+  uint16_t ws2812Count;
+  uint8_t ws2812Pin;
+  uint64_t ws2812End;
+  uint32_t ws2812Frames;
+
+  // Linea de tiempo de la instancia (NULL: sin registrar, ver SoakTimeline.h)
+  SoakTimeline *timeline;
+
+  // Tiempo consumido por la operacion [us], controla el limite de la pasada
+  void spend(uint64_t us) {
+    now += us;
+    if ( now - passStart > hangLimit ) {
+      SoakHang hang = { now - passStart };
+      throw hang;
+    }
+  }
+
+  void respond(uint8_t type, uint16_t value) {
+    if ( responseCount < SOAK_RESPONSES ) {
+      responses[responseCount].type = type;
+      responses[responseCount].value = value;
+      responseCount++;
+    }
+  }
+
+};
+
+extern thread_local SoakBoard *soakBoard;
+
+#endif
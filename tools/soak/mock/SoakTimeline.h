@@ -0,0 +1,220 @@
+/*
+ * SoakTimeline.h
+ * Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)
+ *
+ * Linea de tiempo de una instancia del arnes (soak --timeline) en el
+ * formato de eventos de Chrome (chrome://tracing, ui.perfetto.dev),
+ * con el reloj virtual como base de tiempo (us). Por instancia
+ * (pid = semilla) tres pistas:
+ *
+ *   firmware  intervalos de TRACE_SPAN() (ver Trace.h), anidados
+ *   eeprom    programacion de cada byte escrito (SOAK_EEPROM_WRITE_US)
+ *   dfplayer  tema en reproduccion en el modelo del reproductor
+ *
+ * Para cubrir horas de uso simulado los intervalos del firmware se
+ * registran en una pila fija y solo se escriben los que duran al
+ * menos minUs, junto con los que los contienen (--timeline-min): una
+ * pasada del lazo sin operaciones bloqueantes no genera eventos. El
+ * texto se acumula por instancia y se escribe en bloques de
+ * TIMELINE_FLUSH bytes bajo el lock del archivo compartido.
+ */
+
+#ifndef SoakTimeline_h
+#define SoakTimeline_h
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include <mutex>
+#include <string>
+
+#include "SoakBoard.h"
+#include "Trace.h"
+
+#define TIMELINE_DEPTH         16
+#define TIMELINE_FLUSH    (1 << 20)
+
+// Pistas (tid) de cada instancia
+#define TIMELINE_FIRMWARE       1
+#define TIMELINE_EEPROM         2
+#define TIMELINE_PLAYER         3
+
+
+static const char *timelineNames[TRACE_IDS] = {
+  "run", "refresh", "mp3 play", "mp3 stop", "mp3 volume", "mp3 command", "mp3 read",
+  "eeprom write", "functionSelector", "volumeSetting", "ledSpeakEffect",
+  0, 0, 0, 0, 0,
+  "welcome", "simpleRoulette", "randomColor", "followTheColor", "turnMeter",
+  "velocityMeter", "customShape", "soundShooting", "music", "userProgram",
+  "iddle", "stream"
+};
+
+
+struct SoakTimeline {
+
+  FILE *file;
+  std::mutex *lock;
+  uint32_t pid;
+  uint64_t minUs;
+
+  // Intervalos abiertos del firmware; keep: contiene uno ya escrito
+  struct Open {
+    uint8_t id;
+    uint8_t keep;
+    uint64_t start;
+  } stack[TIMELINE_DEPTH];
+  uint8_t depth;
+
+  // Tema en reproduccion informado en la pista del reproductor
+  uint8_t playing;
+  uint32_t started;
+  uint8_t folder;
+  uint8_t track;
+  uint64_t playStart;
+
+  uint64_t spans;
+  uint64_t events;
+  std::string text;
+
+  /**
+   * Metodo de inicializacion: instancia [pid] sobre [file],
+   * compartido entre hilos mediante [fileLock]
+   */
+  void begin(FILE *timelineFile, std::mutex *fileLock, uint32_t instance, uint64_t minimum) {
+
+    file = timelineFile;
+    lock = fileLock;
+    pid = instance;
+    minUs = minimum;
+    depth = 0;
+    playing = 0;
+    started = 0;
+    spans = 0;
+    events = 0;
+    text.clear();
+
+    char line[128];
+    snprintf(line, sizeof(line), "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%u,\"args\":{\"name\":\"seed %u\"}},\n",
+      pid, pid);
+    text += line;
+    threadName(TIMELINE_FIRMWARE, "firmware");
+    threadName(TIMELINE_EEPROM, "eeprom");
+    threadName(TIMELINE_PLAYER, "dfplayer");
+
+  }
+
+  void threadName(uint8_t tid, const char *name) {
+
+    char line[128];
+    snprintf(line, sizeof(line), "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%u,\"tid\":%u,\"args\":{\"name\":\"%s\"}},\n",
+      pid, tid, name);
+    text += line;
+
+  }
+
+  // Evento completo (ph X) de [dur] us desde [ts]
+  void event(const char *name, uint8_t tid, uint64_t ts, uint64_t dur) {
+
+    char line[160];
+    snprintf(line, sizeof(line), "{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%llu,\"dur\":%llu,\"pid\":%u,\"tid\":%u},\n",
+      name, (unsigned long long) ts, (unsigned long long) dur, pid, tid);
+    text += line;
+    events++;
+
+    if ( text.size() >= TIMELINE_FLUSH )
+      flush();
+
+  }
+
+  void spanBegin(uint8_t id, uint64_t now) {
+
+    if ( depth < TIMELINE_DEPTH ) {
+      stack[depth].id = id;
+      stack[depth].keep = 0;
+      stack[depth].start = now;
+    }
+    depth++;
+    spans++;
+
+  }
+
+  void spanEnd(uint8_t id, uint64_t now) {
+
+    if ( depth == 0 )
+      return;
+
+    depth--;
+    if ( depth >= TIMELINE_DEPTH )
+      return;
+
+    Open &open = stack[depth];
+    const char *name = id < TRACE_IDS && timelineNames[id] ? timelineNames[id] : "?";
+
+    if ( open.keep || now - open.start >= minUs ) {
+      event(name, TIMELINE_FIRMWARE, open.start, now - open.start);
+      if ( depth )
+        stack[depth - 1].keep = 1;
+    }
+
+  }
+
+  void eepromWrite(uint16_t address, uint64_t now) {
+
+    char name[16];
+    snprintf(name, sizeof(name), "0x%03X", address);
+    event(name, TIMELINE_EEPROM, now, SOAK_EEPROM_WRITE_US);
+
+  }
+
+  /**
+   * Refleja en la pista del reproductor el estado de [board]:
+   * se invoca donde el modelo inicia o detiene un tema
+   */
+  void player(const SoakBoard &board) {
+
+    bool changed = board.started != started;
+
+    if ( playing && (board.playing == 0 || changed) )
+      playerEnd(board.now);
+
+    if ( board.playing && (playing == 0 || changed) ) {
+      playing = 1;
+      folder = board.folder;
+      track = board.file;
+      playStart = board.now;
+    }
+
+    started = board.started;
+
+  }
+
+  void playerEnd(uint64_t now) {
+
+    char name[16];
+    snprintf(name, sizeof(name), "%02u/%03u", folder, track);
+    event(name, TIMELINE_PLAYER, playStart, now - playStart);
+    playing = 0;
+
+  }
+
+  void flush(void) {
+
+    std::lock_guard<std::mutex> guard(*lock);
+    fwrite(text.data(), 1, text.size(), file);
+    text.clear();
+
+  }
+
+  // Cierra el tema en curso y escribe lo pendiente
+  void end(const SoakBoard &board) {
+
+    if ( playing )
+      playerEnd(board.now);
+
+    flush();
+
+  }
+
+};
+
+#endif
@@ -0,0 +1,22 @@
+/*
+ * SoftwareSerial.h (simulado)
+ * Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)
+ */
+
+#ifndef SoftwareSerial_h
+#define SoftwareSerial_h
+
+#include <Arduino.h>
+
+
+class SoftwareSerial : public Stream {
+
+public:
+
+  SoftwareSerial(uint8_t rxPin, uint8_t txPin) { }
+
+  void begin(long bauds) { }
+
+};
+
+#endif
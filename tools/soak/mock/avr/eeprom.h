@@ -0,0 +1,14 @@
+/*
+ * avr/eeprom.h (simulado)
+ * Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)
+ */
+
+#ifndef avr_eeprom_h
+#define avr_eeprom_h
+
+#include <Arduino.h>
+
+int eeprom_is_ready(void);
+void eeprom_busy_wait(void);
+
+#endif
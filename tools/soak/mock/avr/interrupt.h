@@ -0,0 +1,6 @@
+/*
+ * avr/interrupt.h (simulado)
+ * Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)
+ */
+
+#include <Arduino.h>
@@ -0,0 +1,534 @@
+/*
+ * mock.cpp
+ * Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)
+ *
+ * Implementacion del core de Arduino, EEPROM, DFPlayer y leds
+ * WS2812 simulados sobre la instancia apuntada por soakBoard, y
+ * registro de su linea de tiempo (ver SoakTimeline.h)
+ */
+
+#include <unistd.h>
+
+// Antes que Arduino.h: los macros min() y max() afectan a <mutex>
+#include "SoakTimeline.h"
+
+#include <Arduino.h>
+#include <EEPROM.h>
+#include <avr/eeprom.h>
+#include <DFRobotDFPlayerMini.h>
+
+#include "Ws2812.h"
+
+
+thread_local SoakBoard *soakBoard = NULL;
+
+HardwareSerial Serial;
+EEPROMClass EEPROM;
+
+
+////////////////////////////////////
+//
+//    Pines
+//
+
+static volatile uint8_t &portRegister(uint8_t pin, uint8_t kind) {
+
+  if ( pin < 8 )
+    return kind == 0 ? PIND : ( kind == 1 ? PORTD : DDRD );
+  if ( pin < 14 )
+    return kind == 0 ? PINB : ( kind == 1 ? PORTB : DDRB );
+  return kind == 0 ? PINC : ( kind == 1 ? PORTC : DDRC );
+
+}
+
+
+void pinMode(uint8_t pin, uint8_t mode) {
+
+  uint8_t mask = digitalPinToBitMask(pin);
+
+  if ( mode == OUTPUT )
+    portRegister(pin, 2) |= mask;
+  else {
+    portRegister(pin, 2) &= ~mask;
+    if ( mode == INPUT_PULLUP )
+      portRegister(pin, 1) |= mask;
+  }
+
+}
+
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+
+  soakBoard->spend(SOAK_PIN_US);
+
+  if ( value )
+    portRegister(pin, 1) |= digitalPinToBitMask(pin);
+  else
+    portRegister(pin, 1) &= ~digitalPinToBitMask(pin);
+
+}
+
+
+int digitalRead(uint8_t pin) {
+
+  soakBoard->spend(SOAK_PIN_US);
+
+  return ( portRegister(pin, 0) & digitalPinToBitMask(pin) ) ? HIGH : LOW;
+
+}
+
+
+/**
+ * Salida a leds WS2812: un envio luego de SOAK_WS2812_LATCH_US
+ * en bajo comienza un nuevo cuadro
+ */
+void ws2812Send(uint8_t pin, const uint8_t *data, uint8_t count) {
+
+  if ( soakBoard->ws2812Count == 0 || soakBoard->now - soakBoard->ws2812End >= SOAK_WS2812_LATCH_US ) {
+    soakBoard->ws2812Count = 0;
+    soakBoard->ws2812Frames++;
+  }
+
+  soakBoard->ws2812Pin = pin;
+
+  for ( uint8_t i = 0 ; i < count ; i++ )
+    if ( soakBoard->ws2812Count < SOAK_WS2812_BYTES )
+      soakBoard->ws2812Data[soakBoard->ws2812Count++] = data[i];
+
+  soakBoard->spend(count * SOAK_WS2812_BYTE_US);
+  soakBoard->ws2812End = soakBoard->now;
+
+}
+
+
+////////////////////////////////////
+//
+//    Linea de tiempo
+//
+
+#ifdef RULI_TRACE
+void traceBegin(uint8_t id) {
+
+  if ( soakBoard->timeline )
+    soakBoard->timeline->spanBegin(id, soakBoard->now);
+
+}
+
+
+void traceEnd(uint8_t id) {
+
+  if ( soakBoard->timeline )
+    soakBoard->timeline->spanEnd(id, soakBoard->now);
+
+}
+#endif
+
+
+// Tema en curso del modelo del reproductor, luego de cada cambio
+static void timelinePlayer(void) {
+
+  if ( soakBoard->timeline )
+    soakBoard->timeline->player(*soakBoard);
+
+}
+
+
+////////////////////////////////////
+//
+//    Tiempo y numeros aleatorios
+//
+
+unsigned long millis(void) {
+
+  soakBoard->spend(SOAK_CLOCK_US);
+
+  return (unsigned long) (soakBoard->now / 1000);
+
+}
+
+
+unsigned long micros(void) {
+
+  soakBoard->spend(SOAK_CLOCK_US);
+
+  return (unsigned long) soakBoard->now;
+
+}
+
+
+void delay(unsigned long ms) {
+
+  soakBoard->spend(ms * 1000ULL);
+
+}
+
+
+void delayMicroseconds(unsigned int us) {
+
+  soakBoard->spend(us);
+
+}
+
+
+long random(long howBig) {
+
+  uint32_t x = soakBoard->rng;
+
+  // xorshift32
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  soakBoard->rng = x;
+
+  return howBig > 0 ? (long) (x % (uint32_t) howBig) : 0;
+
+}
+
+
+long random(long howSmall, long howBig) {
+
+  if ( howSmall >= howBig )
+    return howSmall;
+
+  return howSmall + random(howBig - howSmall);
+
+}
+
+
+void randomSeed(unsigned long seed) {
+
+  if ( seed )
+    soakBoard->rng = seed;
+
+}
+
+
+////////////////////////////////////
+//
+//    Puertos serie
+//
+
+size_t Print::write(uint8_t value) { return 1; }
+
+
+size_t Print::write(const uint8_t *buffer, size_t size) {
+
+  for ( size_t i = 0 ; i < size ; i++ )
+    write(buffer[i]);
+
+  return size;
+
+}
+
+
+size_t Print::print(const char *text) { return strlen(text); }
+size_t Print::print(const __FlashStringHelper *text) { return strlen((const char *) text); }
+size_t Print::print(int value) { return 1; }
+size_t Print::print(unsigned int value) { return 1; }
+size_t Print::print(long value) { return 1; }
+size_t Print::print(unsigned long value, int base) { return 1; }
+size_t Print::println(const char *text) { return strlen(text) + 2; }
+size_t Print::println(const __FlashStringHelper *text) { return strlen((const char *) text) + 2; }
+size_t Print::println(unsigned long value, int base) { return 3; }
+size_t Print::println(void) { return 2; }
+
+int Stream::available(void) { return 0; }
+int Stream::read(void) { return -1; }
+int Stream::peek(void) { return -1; }
+
+void HardwareSerial::begin(unsigned long bauds) {
+
+  // 10 bits por byte
+  soakBoard->serialByteUs = (10000000UL + bauds / 2) / bauds;
+  soakBoard->serialCount = 0;
+
+}
+
+
+int HardwareSerial::available(void) {
+
+  SoakBoard *board = soakBoard;
+  ssize_t received;
+
+  if ( board->serialFd <= 0 )
+    return 0;
+
+  if ( board->serialCount < SOAK_SERIAL_BUFFER ) {
+    received = ::read(board->serialFd, board->serialRx + board->serialCount,
+      SOAK_SERIAL_BUFFER - board->serialCount);
+    if ( received > 0 ) {
+      board->serialCount += received;
+      board->serialRxBytes += received;
+    }
+  }
+
+  return board->serialCount;
+
+}
+
+
+int HardwareSerial::peek(void) {
+
+  if ( available() == 0 )
+    return -1;
+
+  return soakBoard->serialRx[0];
+
+}
+
+
+int HardwareSerial::read(void) {
+
+  SoakBoard *board = soakBoard;
+  uint8_t value;
+
+  if ( available() == 0 )
+    return -1;
+
+  value = board->serialRx[0];
+  board->serialCount--;
+  memmove(board->serialRx, board->serialRx + 1, board->serialCount);
+
+  return value;
+
+}
+
+
+/*
+ * Con la linea libre el byte comienza una nueva rafaga; si no,
+ * sale a continuacion del anterior (buffer de transmision)
+ */
+size_t HardwareSerial::write(uint8_t value) {
+
+  SoakBoard *board = soakBoard;
+
+  if ( board->serialFd <= 0 )
+    return 1;
+
+  if ( board->now >= board->serialTxStart + board->serialTxCount * (uint64_t) board->serialByteUs ) {
+    board->serialTxStart = board->now;
+    board->serialTxCount = 0;
+  }
+
+  board->serialTxCount++;
+  board->serialTxBytes++;
+
+  return ::write(board->serialFd, &value, 1) == 1 ? 1 : 0;
+
+}
+
+
+int HardwareSerial::availableForWrite(void) { return 63; }
+
+
+// Espera el fin del ultimo byte en la linea
+void HardwareSerial::flush(void) {
+
+  SoakBoard *board = soakBoard;
+  uint64_t end = board->serialTxStart + board->serialTxCount * (uint64_t) board->serialByteUs;
+
+  if ( board->serialFd > 0 && board->now < end )
+    board->spend(end - board->now);
+
+}
+
+
+////////////////////////////////////
+//
+//    EEPROM
+//
+
+int eeprom_is_ready(void) {
+
+  return soakBoard->now >= soakBoard->eepromReady;
+
+}
+
+
+void eeprom_busy_wait(void) {
+
+  if ( soakBoard->now < soakBoard->eepromReady )
+    soakBoard->spend(soakBoard->eepromReady - soakBoard->now);
+
+}
+
+
+uint8_t EEPROMClass::read(int address) {
+
+  return soakBoard->eeprom[address % SOAK_EEPROM_SIZE];
+
+}
+
+
+/*
+ * En la linea de tiempo: la espera de la escritura anterior en
+ * la pista del firmware y la programacion en la de la EEPROM
+ */
+void EEPROMClass::write(int address, uint8_t value) {
+
+  if ( soakBoard->timeline )
+    soakBoard->timeline->spanBegin(TRACE_EEPROM_WRITE, soakBoard->now);
+
+  eeprom_busy_wait();
+
+  if ( soakBoard->timeline ) {
+    soakBoard->timeline->spanEnd(TRACE_EEPROM_WRITE, soakBoard->now);
+    soakBoard->timeline->eepromWrite(address % SOAK_EEPROM_SIZE, soakBoard->now);
+  }
+
+  soakBoard->eeprom[address % SOAK_EEPROM_SIZE] = value;
+  soakBoard->eepromReady = soakBoard->now + SOAK_EEPROM_WRITE_US;
+  soakBoard->eepromLast = address % SOAK_EEPROM_SIZE;
+  soakBoard->eepromWrites++;
+  soakBoard->eepromCellWrites[address % SOAK_EEPROM_SIZE]++;
+
+}
+
+
+void EEPROMClass::update(int address, uint8_t value) {
+
+  if ( read(address) != value )
+    write(address, value);
+
+}
+
+
+uint16_t EEPROMClass::length(void) {
+
+  return SOAK_EEPROM_SIZE;
+
+}
+
+
+////////////////////////////////////
+//
+//    DFPlayer
+//
+
+/*
+ * El modulo real descarta en silencio los comandos recibidos
+ * mientras procesa el anterior. AudioManager los separa
+ * AUDIO_COMMAND_GAP_MS (30 ms, medidos con millis(): hasta
+ * 1 ms menos); el modelo exige 25 ms
+ */
+#define MP3_BUSY_US   25000
+
+bool DFRobotDFPlayerMini::command(void) {
+
+  uint64_t sent = soakBoard->now;
+  bool accepted;
+
+  soakBoard->spend(SOAK_MP3_COMMAND_US);
+  soakBoard->commands++;
+
+  accepted = soakBoard->commands == 1 || sent - soakBoard->lastCommand >= MP3_BUSY_US;
+  if ( ! accepted )
+    soakBoard->busyRejects++;
+
+  soakBoard->lastCommand = sent;
+
+  return accepted;
+
+}
+
+
+bool DFRobotDFPlayerMini::begin(Stream &stream, bool isACK, bool doReset) {
+
+  soakBoard->playing = 0;
+  soakBoard->volume = SOAK_DEFAULT_VOLUME;
+  soakBoard->responseCount = 0;
+
+  timelinePlayer();
+
+  return true;
+
+}
+
+
+bool DFRobotDFPlayerMini::available(void) {
+
+  if ( soakBoard->responseCount == 0 )
+    return false;
+
+  soakBoard->current = soakBoard->responses[0];
+  soakBoard->responseCount--;
+  memmove(soakBoard->responses, soakBoard->responses + 1,
+    soakBoard->responseCount * sizeof(SoakBoard::Response));
+
+  return true;
+
+}
+
+
+uint8_t DFRobotDFPlayerMini::readType(void) {
+
+  return soakBoard->current.type;
+
+}
+
+
+uint16_t DFRobotDFPlayerMini::read(void) {
+
+  return soakBoard->current.value;
+
+}
+
+
+void DFRobotDFPlayerMini::playFolder(uint8_t folderNumber, uint8_t fileNumber) {
+
+  if ( command() ) {
+    soakBoard->playing = 1;
+    soakBoard->folder = folderNumber;
+    soakBoard->file = fileNumber;
+    soakBoard->started++;
+    timelinePlayer();
+  }
+
+}
+
+
+void DFRobotDFPlayerMini::play(int fileNumber) {
+
+  playFolder(1, fileNumber);
+
+}
+
+
+void DFRobotDFPlayerMini::stop(void) {
+
+  if ( command() ) {
+    soakBoard->playing = 0;
+    timelinePlayer();
+  }
+
+}
+
+
+void DFRobotDFPlayerMini::volume(uint8_t volume) {
+
+  if ( command() )
+    soakBoard->volume = volume;
+
+}
+
+
+void DFRobotDFPlayerMini::volumeUp(void) {
+
+  if ( command() && soakBoard->volume < 30 )
+    soakBoard->volume++;
+
+}
+
+
+void DFRobotDFPlayerMini::volumeDown(void) {
+
+  if ( command() && soakBoard->volume > 0 )
+    soakBoard->volume--;
+
+}
+
+
+void DFRobotDFPlayerMini::next(void) { command(); }
+void DFRobotDFPlayerMini::previous(void) { command(); }
+void DFRobotDFPlayerMini::enableLoop(void) { command(); }
+void DFRobotDFPlayerMini::disableLoop(void) { command(); }
@@ -0,0 +1,1420 @@
+/*
+ * soak.cpp
+ * Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)
+ *
+ * Arnes de pruebas de larga duracion en el host. Ejecuta miles de
+ * instancias del firmware (src/, sin modificar) sobre el hardware
+ * simulado de tools/soak/mock con reloj virtual, cada una con una
+ * EEPROM inicial aleatoria (en blanco, valida o con basura) y una
+ * secuencia de entradas generada a partir de una semilla: rafagas de
+ * giros, clicks, retenciones, periodos de inactividad, mensajes del
+ * reproductor (fines duplicados, errores y reinicios del modulo) y
+ * cortes de energia (nuevo arranque sobre la misma EEPROM, con la
+ * escritura en curso interrumpida).
+ *
+ * En cada pasada del lazo principal se verifican:
+ *
+ *   HANG   pasada que no termina (SOAK_HANG_US de reloj simulado)
+ *   BUDGET pasada que supera el presupuesto de tiempo (-b, us)
+ *   RANGE  variables de estado fuera de rango, volumen del reproductor
+ *          distinto del que el firmware cree haber establecido
+ *   STUCK  estados que no se liberan: voz sin sonido en curso,
+ *          ajuste de volumen sin actividad
+ *
+ * Cada falla se reduce (truncado en la pasada que fallo y luego
+ * delta debugging sobre las entradas) y se guarda en
+ * soak-failures/<tipo>-<semilla>.trace, reproducible con --replay.
+ *
+ * Con --usage (firmware con RULI_ACCOUNTING) informa ademas el uso de
+ * recursos acumulado por los contadores del firmware, con el formato de
+ * tools/usage.py, y las escrituras medidas en cada byte de la EEPROM
+ * simulada: soak -n 24 -m 60 --usage equivale a un dia de uso, repartido
+ * entre los hilos.
+ *
+ * Con --latency (firmware con RULI_LATENCY) informa los percentiles de
+ * latencia giro->leds y giro->sonido medidos por el firmware (ver
+ * LatencyMeter.h) sobre el reloj virtual, con los histogramas de todas
+ * las instancias acumulados, incluidos los previos a cada corte.
+ *
+ * Con --timeline escribe la linea de tiempo de cada instancia en el
+ * formato de eventos de Chrome (ver tools/soak/mock/SoakTimeline.h),
+ * con el reloj virtual como base: los intervalos TRACE_SPAN() del
+ * firmware (RULI_TRACE, ver Trace.h), la programacion de la EEPROM,
+ * el tema en reproduccion y las entradas aplicadas. --timeline-min
+ * (us, por defecto SOAK_TIMELINE_MIN_US) descarta los intervalos mas
+ * cortos que no contienen otros registrados: soak -n 1 -m 240
+ * --timeline ruli.json cubre cuatro horas en pocos MB. Con 0 se
+ * registran todos (cerca de 1 GB por minuto simulado: para tramos
+ * cortos). Tambien con --replay, para ver una falla reducida.
+ *
+ * Compilacion: pio run -e soak (ver platformio.ini), o bien
+ *
+ *   g++ -O2 -std=gnu++17 -pthread -D RULI_SOAK -D RULI_STREAM -D RULI_WARM_BOOT -D RULI_ACCOUNTING -D RULI_TRACE \
+ *     -D RULI_LATENCY -I tools/soak/mock -I include tools/soak/soak.cpp \
+ *     tools/soak/mock/mock.cpp src/[A-Z]*.cpp -o soak
+ *
+ * Uso:
+ *
+ *   soak [-n instancias] [-m minutos simulados] [-j hilos] [-s semilla] [-b us] [--usage]
+ *        [--latency] [--timeline archivo.json] [--timeline-min us]
+ *   soak --replay soak-failures/STUCK-1234.trace [-v] [--timeline archivo.json] [--timeline-min us]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+#include <Arduino.h>
+
+#include "RotaryEncoder.h"
+#include "EncoderBank.h"
+#include "MP3Player.h"
+#include "LedsPanel.h"
+#include "RuliBrain.h"
+#include "LatencyMeter.h"
+#include <DFRobotDFPlayerMini.h>
+#include <SoakTimeline.h>
+
+
+// Pines del equipo (ver main.cpp)
+#define MW_CLK_PIN     16
+#define MW_DATA_PIN    15
+#define RS_SWITCH_PIN  19
+#define RS_CLK_PIN     18
+#define RS_DATA_PIN    17
+#define MP_RX          10
+#define MP_TX          11
+#define LP_ENABLE_PIN  8
+#define LP_CLOCK_PIN   9
+#define LP_DATA_PIN    12
+
+// Funcionalidades y limites (ver RuliBrain.cpp)
+#define SOAK_USER_PROGRAM    9
+#define SOAK_IDDLE          10
+#define SOAK_STREAM         11
+#define SOAK_MAX_VOLUME     30
+
+/*
+ * Limites de los detectores
+ */
+#define SOAK_HANG_US          2000000ULL // pasada colgada (reloj simulado)
+#define SOAK_BUDGET_US          30000UL  // presupuesto por defecto de una pasada
+#define SOAK_SILENT_VOICE_US  5000000ULL // voz activa sin sonido en el reproductor
+#define SOAK_VOLUME_IDLE_US  20000000ULL // ajuste de volumen sin entradas
+#define SOAK_VOLUME_SYNC_US   1000000ULL // volumen del reproductor distinto del esperado
+#define SOAK_WALL_HANG_S           10    // instancia sin progreso (reloj real)
+
+// Tiempo maximo (s, reloj real) de la reduccion de una falla
+#define SOAK_REDUCE_S              60
+
+// Ciclos de escritura garantizados por byte de la EEPROM del ATmega328
+#define SOAK_EEPROM_ENDURANCE  100000.0
+
+// Direcciones de EEPROM mas escritas en el informe de --usage
+#define SOAK_USAGE_TOP             8
+
+// Recorridos medidos por el firmware en el informe de --latency
+#define SOAK_LATENCY_PATHS         2
+
+// Duracion minima (us) de los intervalos de --timeline
+#define SOAK_TIMELINE_MIN_US    1000
+
+// Pista de las entradas aplicadas en --timeline
+#define TIMELINE_INPUT             4
+
+/*
+ * Entradas de la secuencia
+ */
+#define ACT_NOP            0
+#define ACT_WHEEL_LEFT     1
+#define ACT_WHEEL_RIGHT    2
+#define ACT_SEL_LEFT       3
+#define ACT_SEL_RIGHT      4
+#define ACT_SEL_PRESS      5
+#define ACT_SEL_RELEASE    6
+#define ACT_PLAYER_DUP     7 // mensaje de fin repetido
+#define ACT_PLAYER_ERROR   8 // el proximo tema falla (archivo inexistente)
+#define ACT_PLAYER_RESET   9 // reinicio del modulo (caida de tension)
+#define ACT_POWER_CYCLE   10 // corte de energia de todo el equipo
+#define ACT_COUNT         11
+
+static const char *actionNames[ACT_COUNT] = {
+  "NOP", "WHEEL_LEFT", "WHEEL_RIGHT", "SEL_LEFT", "SEL_RIGHT",
+  "SEL_PRESS", "SEL_RELEASE", "PLAYER_DUP", "PLAYER_ERROR", "PLAYER_RESET",
+  "POWER_CYCLE"
+};
+
+// Tipos de falla
+#define FAIL_NONE     0
+#define FAIL_HANG     1
+#define FAIL_BUDGET   2
+#define FAIL_RANGE    3
+#define FAIL_STUCK    4
+#define FAIL_WALL     5
+
+static const char *failNames[] = { "NONE", "HANG", "BUDGET", "RANGE", "STUCK", "WALL" };
+
+
+// Entrada aplicada luego de [dt] us de ejecucion libre
+struct Step {
+  uint32_t dt;
+  uint8_t action;
+};
+
+struct Failure {
+  uint8_t kind;
+  size_t step;       // entrada en curso al fallar
+  uint64_t time;     // reloj simulado (us)
+  std::string detail;
+};
+
+static unsigned long passBudget = SOAK_BUDGET_US;
+
+
+/*
+ * Generador pseudoaleatorio del arnes (independiente del random()
+ * del firmware, que usa el de SoakBoard)
+ */
+struct Rng {
+
+  uint64_t state;
+
+  uint32_t next(void) {
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    return (uint32_t) (state >> 33);
+  }
+
+  uint32_t range(uint32_t low, uint32_t high) {
+    return low + next() % (high - low + 1);
+  }
+
+  bool chance(uint32_t percent) {
+    return next() % 100 < percent;
+  }
+
+};
+
+
+////////////////////////////////////
+//
+//    Acceso al estado interno
+//
+
+/*
+ * Histograma de latencias acumulado de varias sesiones del
+ * firmware, con los rangos de LatencyMeter sin saturar
+ */
+struct LatencySum {
+
+  uint64_t buckets[LATENCY_BUCKETS];
+  uint64_t count;
+  unsigned long minValue;
+  unsigned long maxValue;
+
+};
+
+
+class Soak {
+
+public:
+
+  /**
+   * Verifica los invariantes de [brain] y devuelve el tipo
+   * de falla (FAIL_NONE si todo esta en orden)
+   */
+  static uint8_t check(RuliBrain &brain, MP3Player &player, SoakBoard &board,
+                       uint64_t &silentSince, uint64_t &driftSince, uint64_t &inputTime,
+                       std::string &detail) {
+
+    char text[96];
+
+    if ( brain.selectedFunction < 1 || brain.selectedFunction > SOAK_USER_PROGRAM ) {
+      snprintf(text, sizeof(text), "selectedFunction = %u", brain.selectedFunction);
+      detail = text;
+      return FAIL_RANGE;
+    }
+
+    if ( brain.currentFunction > SOAK_STREAM || brain.prevFunction > SOAK_STREAM ) {
+      snprintf(text, sizeof(text), "currentFunction = %u, prevFunction = %u",
+        brain.currentFunction, brain.prevFunction);
+      detail = text;
+      return FAIL_RANGE;
+    }
+
+    if ( player.getVolume() > SOAK_MAX_VOLUME || board.volume > SOAK_MAX_VOLUME ) {
+      snprintf(text, sizeof(text), "volume = %u, player volume = %u",
+        player.getVolume(), board.volume);
+      detail = text;
+      return FAIL_RANGE;
+    }
+
+    if ( board.volume != player.getOutputVolume() ) {
+      if ( driftSince == 0 )
+        driftSince = board.now;
+      else if ( board.now - driftSince > SOAK_VOLUME_SYNC_US ) {
+        snprintf(text, sizeof(text), "player volume = %u, expected %u",
+          board.volume, player.getOutputVolume());
+        detail = text;
+        return FAIL_RANGE;
+      }
+    }
+    else
+      driftSince = 0;
+
+    // La voz debe liberarse poco despues de que el reproductor se detiene
+    if ( brain.speaking && board.playing == 0 ) {
+      if ( silentSince == 0 )
+        silentSince = board.now;
+      else if ( board.now - silentSince > SOAK_SILENT_VOICE_US ) {
+        snprintf(text, sizeof(text), "speaking with the player stopped for %llu ms",
+          (unsigned long long) (board.now - silentSince) / 1000);
+        detail = text;
+        return FAIL_STUCK;
+      }
+    }
+    else
+      silentSince = 0;
+
+    if ( brain.volumeSettingIsActive && board.now - inputTime > SOAK_VOLUME_IDLE_US ) {
+      detail = "volume setting active without input";
+      return FAIL_STUCK;
+    }
+
+    return FAIL_NONE;
+
+  }
+
+#ifdef RULI_ACCOUNTING
+  // Contador [counter] de la contabilidad de uso (ver Accounting.h)
+  static unsigned long usage(RuliBrain &brain, uint8_t counter) {
+
+    return brain.accounting.get(counter);
+
+  }
+#endif
+
+#ifdef RULI_LATENCY
+  // Suma los histogramas giro->leds y giro->sonido de [brain] a [sums]
+  static void latency(RuliBrain &brain, LatencySum *sums) {
+
+    add(sums[0], brain.ledsLatency);
+    add(sums[1], brain.soundLatency);
+
+  }
+
+  static void add(LatencySum &sum, LatencyMeter &meter) {
+
+    for ( uint8_t i = 0 ; i < LATENCY_BUCKETS ; i++ )
+      sum.buckets[i] += meter.buckets[i];
+
+    if ( meter.count == 0 )
+      return;
+
+    sum.minValue = sum.count ? (std::min)(sum.minValue, meter.minValue) : meter.minValue;
+    sum.maxValue = (std::max)(sum.maxValue, meter.maxValue);
+    sum.count += meter.count;
+
+  }
+
+  // Percentil [percent] de [sum], como LatencyMeter::percentile()
+  static unsigned long percentile(LatencySum &sum, uint8_t percent) {
+
+    uint64_t total = 0, target, accum = 0;
+
+    for ( uint8_t i = 0 ; i < LATENCY_BUCKETS ; i++ )
+      total += sum.buckets[i];
+
+    if ( total == 0 )
+      return 0;
+
+    target = (total * percent + 99) / 100;
+
+    for ( uint8_t i = 0 ; i < LATENCY_BUCKETS ; i++ ) {
+      accum += sum.buckets[i];
+      if ( accum >= target )
+        return ( i == LATENCY_BUCKETS - 1 ) ? sum.maxValue : (std::min)(LatencyMeter::bucketLimit(i), sum.maxValue);
+    }
+
+    return sum.maxValue;
+
+  }
+#endif
+
+  static void print(RuliBrain &brain, SoakBoard &board) {
+
+    uint8_t *leds = brain.ledsPanel->getValue();
+
+    printf("  function %2u (prev %2u, selected %u) step %u%s%s%s%s | player %s %u/%u vol %u"
+      " | leds %02X %02X%02X%02X%02X%02X\n",
+      brain.currentFunction, brain.prevFunction, brain.selectedFunction, brain.currentStep,
+      brain.funcSelectorIsActive ? " SELECTOR" : "", brain.volumeSettingIsActive ? " VOLUME" : "",
+      brain.speaking ? " SPEAKING" : "", brain.spinning ? " SPINNING" : "",
+      board.playing ? "playing" : "stopped", board.folder, board.file, board.volume,
+      leds[0], leds[1], leds[2], leds[3], leds[4], leds[5]);
+
+  }
+
+};
+
+
+////////////////////////////////////
+//
+//    Instancia simulada
+//
+
+struct Instance {
+
+  SoakBoard board;
+
+  EncoderBank encoderBank;
+  RotaryEncoder mainWheel;
+  RotaryEncoder rotarySelector;
+  MP3Player mp3Player;
+  FastLedsPanel<LP_ENABLE_PIN, LP_CLOCK_PIN, LP_DATA_PIN> ledsPanel;
+  RuliBrain ruliBrain;
+
+  // Fin programado del tema en curso y proximo tema fallido
+  uint64_t finishAt;
+  uint8_t failNext;
+  uint32_t lastStarted;
+
+  uint64_t silentSince;
+  uint64_t driftSince;
+  uint64_t inputTime;
+  uint64_t passes;
+
+#ifdef RULI_ACCOUNTING
+  // Contadores de uso al arrancar: la EEPROM inicial puede traer valores
+  unsigned long usageStart[ACC_COUNTERS];
+#endif
+
+#ifdef RULI_LATENCY
+  // Latencias de las sesiones anteriores a cada corte de energia
+  LatencySum latency[SOAK_LATENCY_PATHS];
+#endif
+
+  std::atomic<uint64_t> *heartbeat;
+
+  // Linea de tiempo (NULL: sin registrar), inicializada por quien crea la instancia
+  SoakTimeline *timeline;
+
+  void begin(uint32_t seed);
+  void setup(void);
+  void powerCycle(void);
+  void pass(void);
+  void apply(uint8_t action);
+  void playerModel(void);
+  Failure run(const std::vector<Step> &steps, bool verbose);
+
+};
+
+
+/*
+ * Contenido inicial de la EEPROM: en blanco, con la configuracion
+ * valida o con basura en la configuracion y en las regiones del
+ * programa, la animacion y las estadisticas
+ */
+static void eepromImage(SoakBoard &board, Rng &rng) {
+
+  memset(board.eeprom, 0xFF, SOAK_EEPROM_SIZE);
+
+  switch ( rng.range(0, 2) ) {
+
+    case 1: {
+      board.eeprom[0] = 'R';
+      board.eeprom[1] = rng.range(2, 30);
+      board.eeprom[2] = rng.range(1, SOAK_USER_PROGRAM);
+      break;
+    }
+
+    case 2: {
+      board.eeprom[0] = 'R';
+      board.eeprom[1] = rng.next();
+      board.eeprom[2] = rng.next();
+
+      for ( int i = 3 ; i < SOAK_EEPROM_SIZE ; i++ )
+        if ( rng.chance(50) )
+          board.eeprom[i] = rng.next();
+
+      // Claves validas con contenido arbitrario
+      if ( rng.chance(50) ) board.eeprom[0x090] = 'O';
+      if ( rng.chance(50) ) board.eeprom[0x190] = 'V';
+      if ( rng.chance(50) ) board.eeprom[0x210] = 'A';
+      if ( rng.chance(50) ) board.eeprom[0x2F0] = 'U';
+    }
+  }
+
+}
+
+
+void Instance::begin(uint32_t seed) {
+
+  Rng rng = { seed * 0x9E3779B97F4A7C15ULL + 1 };
+
+  soakBoard = &board;
+
+  memset(&board, 0x00, sizeof(board));
+  board.hangLimit = SOAK_HANG_US;
+  board.timeline = timeline;
+  board.rng = seed | 1;
+  eepromImage(board, rng);
+
+  // Entradas con pull-up en reposo
+  PINB = 0xFF;
+  PINC = 0xFF;
+  PIND = 0xFF;
+
+  passes = 0;
+
+#ifdef RULI_LATENCY
+  memset(latency, 0x00, sizeof(latency));
+#endif
+
+  setup();
+
+#ifdef RULI_ACCOUNTING
+  for ( uint8_t c = 0 ; c < ACC_COUNTERS ; c++ )
+    usageStart[c] = Soak::usage(ruliBrain, c);
+#endif
+
+}
+
+
+/**
+ * Arranque del equipo: igual que setup() de main.cpp
+ */
+void Instance::setup(void) {
+
+  finishAt = 0;
+  failNext = 0;
+  lastStarted = 0;
+  silentSince = 0;
+  driftSince = 0;
+  inputTime = board.now;
+
+  mainWheel.begin(MW_CLK_PIN, MW_DATA_PIN);
+  rotarySelector.begin(RS_CLK_PIN, RS_DATA_PIN, RS_SWITCH_PIN);
+  encoderBank.begin();
+  mainWheel.attach(&encoderBank);
+  rotarySelector.attach(&encoderBank);
+  mp3Player.begin(MP_RX, MP_TX);
+  ledsPanel.begin();
+  ruliBrain.begin(&mainWheel, &rotarySelector, &mp3Player, &ledsPanel);
+
+#ifdef RULI_WARM_BOOT
+  // Sin reinicio desde el firmware el modulo informa al estar listo
+  board.respond(DFPlayerCardOnline, 0);
+#endif
+
+}
+
+
+/*
+ * Corte de energia: el byte de EEPROM en escritura queda con un
+ * valor arbitrario, el reproductor se apaga junto con la placa y
+ * los pulsadores se liberan
+ */
+void Instance::powerCycle(void) {
+
+  if ( board.now < board.eepromReady ) {
+    board.eeprom[board.eepromLast] = (uint8_t) (board.now * 2654435761U >> 11);
+    board.eepromReady = board.now;
+  }
+
+  PINB = 0xFF;
+  PINC = 0xFF;
+  PIND = 0xFF;
+
+  board.playing = 0;
+  board.volume = SOAK_DEFAULT_VOLUME;
+
+#ifdef RULI_LATENCY
+  // El arranque reinicia las mediciones del firmware
+  Soak::latency(ruliBrain, latency);
+#endif
+
+  setup();
+
+}
+
+
+/*
+ * Duracion simulada de cada archivo: temas de music()
+ * (carpeta 9 desde el archivo 2) de minutos, el resto
+ * (efectos y voces) de segundos
+ */
+static uint64_t trackLength(uint8_t folder, uint8_t file) {
+
+  uint32_t h = (folder * 31 + file) * 2654435761U;
+
+  if ( folder == 9 && file >= 2 )
+    return 60000000ULL + (h % 180) * 1000000ULL;
+
+  return 400000ULL + (h % 3600) * 1000ULL;
+
+}
+
+
+/*
+ * Modelo del reproductor: detecta los temas nuevos, los
+ * falla si corresponde y envia el mensaje de fin
+ */
+void Instance::playerModel(void) {
+
+  if ( board.started != lastStarted ) {
+
+    lastStarted = board.started;
+
+    if ( failNext ) {
+      failNext = 0;
+      board.playing = 0;
+      board.respond(DFPlayerError, FileMismatch);
+    }
+    else
+      finishAt = board.now + trackLength(board.folder, board.file);
+  }
+
+  if ( board.playing && board.now >= finishAt ) {
+    board.playing = 0;
+    board.respond(DFPlayerPlayFinished, board.file);
+  }
+
+}
+
+
+void Instance::pass(void) {
+
+  board.passStart = board.now;
+
+  encoderBank.sample();
+  ruliBrain.run();
+
+  // Pasada minima: el lazo nunca es instantaneo
+  board.now += 50;
+
+  playerModel();
+
+  if ( timeline )
+    timeline->player(board);
+
+  // Mantener retenido el pulsador tambien es actividad
+  if ( (PINC & (1 << 5)) == 0 )
+    inputTime = board.now;
+
+  passes++;
+  if ( heartbeat )
+    heartbeat->store(passes, std::memory_order_relaxed);
+
+}
+
+
+/*
+ * Los giros dejan CLK en bajo durante una pasada
+ * (DATA en alto: giro hacia la izquierda)
+ */
+static void turn(Instance &instance, uint8_t clkBit, uint8_t dataBit, bool left) {
+
+  if ( left )
+    PINC |= dataBit;
+  else
+    PINC &= ~dataBit;
+
+  PINC &= ~clkBit;
+  instance.pass();
+  PINC |= clkBit | dataBit;
+
+}
+
+
+void Instance::apply(uint8_t action) {
+
+  if ( action >= ACT_WHEEL_LEFT && action <= ACT_SEL_RELEASE )
+    inputTime = board.now;
+
+  switch ( action ) {
+
+    case ACT_WHEEL_LEFT:  { turn(*this, 1 << 2, 1 << 1, true); break; }
+    case ACT_WHEEL_RIGHT: { turn(*this, 1 << 2, 1 << 1, false); break; }
+    case ACT_SEL_LEFT:    { turn(*this, 1 << 4, 1 << 3, true); break; }
+    case ACT_SEL_RIGHT:   { turn(*this, 1 << 4, 1 << 3, false); break; }
+    case ACT_SEL_PRESS:   { PINC &= ~(1 << 5); break; }
+    case ACT_SEL_RELEASE: { PINC |= 1 << 5; break; }
+
+    case ACT_PLAYER_DUP: {
+      board.respond(DFPlayerPlayFinished, board.file);
+      break;
+    }
+
+    case ACT_PLAYER_ERROR: { failNext = 1; break; }
+
+    case ACT_PLAYER_RESET: {
+      board.playing = 0;
+      board.volume = SOAK_DEFAULT_VOLUME;
+      board.respond(DFPlayerCardOnline, 0);
+      break;
+    }
+
+    case ACT_POWER_CYCLE: { powerCycle(); break; }
+  }
+
+  if ( timeline && action != ACT_NOP ) {
+    timeline->event(actionNames[action], TIMELINE_INPUT, board.now, 0);
+    timeline->player(board);
+  }
+
+}
+
+
+/**
+ * Ejecuta [steps] desde el arranque. Devuelve la primera falla
+ */
+Failure Instance::run(const std::vector<Step> &steps, bool verbose) {
+
+  Failure failure = { FAIL_NONE, 0, 0, "" };
+  size_t i = 0;
+
+  try {
+
+    for ( i = 0 ; i < steps.size() ; i++ ) {
+
+      uint64_t target = board.now + steps[i].dt;
+
+      do {
+        pass();
+
+        if ( board.now - board.passStart > passBudget ) {
+          char text[64];
+          snprintf(text, sizeof(text), "pass took %llu us",
+            (unsigned long long) (board.now - board.passStart));
+          failure = { FAIL_BUDGET, i, board.now, text };
+          break;
+        }
+
+        failure.kind = Soak::check(ruliBrain, mp3Player, board,
+          silentSince, driftSince, inputTime, failure.detail);
+        if ( failure.kind != FAIL_NONE ) {
+          failure.step = i;
+          failure.time = board.now;
+          break;
+        }
+      } while ( board.now < target );
+
+      if ( failure.kind != FAIL_NONE )
+        break;
+
+      apply(steps[i].action);
+
+      if ( verbose ) {
+        printf("%10.3f s  %-12s", board.now / 1e6, actionNames[steps[i].action]);
+        Soak::print(ruliBrain, board);
+      }
+    }
+
+  } catch ( SoakHang &hang ) {
+    char text[64];
+    snprintf(text, sizeof(text), "pass did not finish after %llu us",
+      (unsigned long long) hang.elapsed);
+    failure = { FAIL_HANG, i, board.now, text };
+  }
+
+  return failure;
+
+}
+
+
+////////////////////////////////////
+//
+//    Generacion de entradas
+//
+
+static void add(std::vector<Step> &steps, uint32_t dt, uint8_t action) {
+
+  steps.push_back({ dt, action });
+
+}
+
+
+/*
+ * Secuencia de uso con rafagas y pausas similares a las de
+ * una persona, hasta completar [duration] us simulados
+ */
+static std::vector<Step> generate(uint32_t seed, uint64_t duration) {
+
+  Rng rng = { seed * 0xD1B54A32D192ED03ULL + 7 };
+  std::vector<Step> steps;
+  uint64_t elapsed = 0;
+
+  while ( elapsed < duration ) {
+
+    size_t first = steps.size();
+    uint32_t kind = rng.range(0, 99);
+
+    if ( kind < 30 ) {
+      // Giro de la rueda: pulsos cada vez mas espaciados
+      uint8_t action = rng.chance(70) ? ACT_WHEEL_RIGHT : ACT_WHEEL_LEFT;
+      uint32_t gap = rng.range(2000, 8000);
+      for ( uint32_t n = rng.range(3, 60) ; n ; n-- ) {
+        add(steps, gap, action);
+        gap += gap / rng.range(6, 20);
+      }
+    }
+    else if ( kind < 45 ) {
+      uint8_t action = rng.chance(50) ? ACT_SEL_RIGHT : ACT_SEL_LEFT;
+      for ( uint32_t n = rng.range(1, 6) ; n ; n-- )
+        add(steps, rng.range(60000, 300000), action);
+    }
+    else if ( kind < 60 ) {
+      // Click
+      add(steps, rng.range(100000, 800000), ACT_SEL_PRESS);
+      add(steps, rng.range(40000, 250000), ACT_SEL_RELEASE);
+    }
+    else if ( kind < 70 ) {
+      // Retencion, con repeticiones si se prolonga
+      add(steps, rng.range(100000, 800000), ACT_SEL_PRESS);
+      add(steps, rng.range(750000, 3000000), ACT_SEL_RELEASE);
+    }
+    else if ( kind < 74 ) {
+      // Rebotes del pulsador
+      for ( uint32_t n = rng.range(2, 6) ; n ; n-- ) {
+        add(steps, rng.range(200, 3000), ACT_SEL_PRESS);
+        add(steps, rng.range(200, 3000), ACT_SEL_RELEASE);
+      }
+    }
+    else if ( kind < 77 ) {
+      add(steps, rng.range(0, 500000), ACT_PLAYER_DUP);
+    }
+    else if ( kind < 79 ) {
+      add(steps, rng.range(0, 500000), ACT_PLAYER_ERROR);
+    }
+    else if ( kind < 80 ) {
+      add(steps, rng.range(0, 5000000), ACT_PLAYER_RESET);
+    }
+    else if ( kind < 81 ) {
+      add(steps, rng.range(0, 10000000), ACT_POWER_CYCLE);
+    }
+    else if ( kind < 97 ) {
+      add(steps, rng.range(500000, 8000000), ACT_NOP);
+    }
+    else {
+      // Inactividad prolongada (modo IDDLE)
+      add(steps, rng.range(60000000, 180000000), ACT_NOP);
+    }
+
+    for ( size_t i = first ; i < steps.size() ; i++ )
+      elapsed += steps[i].dt;
+  }
+
+  return steps;
+
+}
+
+
+////////////////////////////////////
+//
+//    Reduccion y trazas
+//
+
+static Failure replay(uint32_t seed, const std::vector<Step> &steps, bool verbose, SoakTimeline *timeline) {
+
+  Instance *instance = new Instance();
+  Failure failure;
+
+  instance->heartbeat = NULL;
+  instance->timeline = timeline;
+
+  try {
+    instance->begin(seed);
+    failure = instance->run(steps, verbose);
+  } catch ( SoakHang &hang ) {
+    failure = { FAIL_HANG, 0, hang.elapsed, "setup did not finish" };
+  }
+
+  if ( timeline )
+    timeline->end(instance->board);
+
+  delete instance;
+
+  return failure;
+
+}
+
+
+/*
+ * Delta debugging (ddmin) sobre las entradas: conserva el
+ * menor subconjunto que reproduce una falla del mismo tipo
+ */
+static std::vector<Step> reduce(uint32_t seed, std::vector<Step> steps, uint8_t kind) {
+
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(SOAK_REDUCE_S);
+  size_t chunks = 2;
+
+  while ( steps.size() >= 2 && std::chrono::steady_clock::now() < deadline ) {
+
+    size_t size = (steps.size() + chunks - 1) / chunks;
+    bool reduced = false;
+
+    for ( size_t start = 0 ; start < steps.size() && std::chrono::steady_clock::now() < deadline ; start += size ) {
+
+      std::vector<Step> candidate;
+      uint32_t removed = 0;
+
+      /*
+       * El tiempo de las entradas eliminadas se suma a la
+       * siguiente, para conservar la separacion del resto
+       */
+      for ( size_t i = 0 ; i < steps.size() ; i++ ) {
+        if ( i >= start && i < start + size ) {
+          removed += steps[i].dt;
+          continue;
+        }
+        candidate.push_back({ steps[i].dt + removed, steps[i].action });
+        removed = 0;
+      }
+
+      Failure failure = replay(seed, candidate, false, NULL);
+
+      if ( failure.kind == kind ) {
+        candidate.resize((std::min)(candidate.size(), failure.step + 1));
+        steps = candidate;
+        chunks = (std::max<size_t>)(chunks - 1, 2);
+        reduced = true;
+        break;
+      }
+    }
+
+    if ( ! reduced ) {
+      if ( chunks >= steps.size() )
+        break;
+      chunks = (std::min)(chunks * 2, steps.size());
+    }
+  }
+
+  return steps;
+
+}
+
+
+static std::string saveTrace(uint32_t seed, const Failure &failure, const std::vector<Step> &steps) {
+
+  char path[128];
+
+  mkdir("soak-failures", 0755);
+  snprintf(path, sizeof(path), "soak-failures/%s-%u.trace", failNames[failure.kind], seed);
+
+  FILE *file = fopen(path, "w");
+  if ( file == NULL )
+    return "";
+
+  fprintf(file, "# %s\n", failure.detail.c_str());
+  fprintf(file, "seed %u\n", seed);
+  fprintf(file, "kind %s\n", failNames[failure.kind]);
+  fprintf(file, "budget %lu\n", passBudget);
+  for ( const Step &step : steps )
+    fprintf(file, "%u %s\n", step.dt, actionNames[step.action]);
+  fclose(file);
+
+  return path;
+
+}
+
+
+static bool loadTrace(const char *path, uint32_t &seed, uint8_t &kind, std::vector<Step> &steps) {
+
+  FILE *file = fopen(path, "r");
+  char line[128], name[32];
+  unsigned long value;
+
+  if ( file == NULL )
+    return false;
+
+  while ( fgets(line, sizeof(line), file) ) {
+
+    if ( line[0] == '#' )
+      continue;
+
+    if ( sscanf(line, "seed %lu", &value) == 1 ) {
+      seed = value;
+      continue;
+    }
+
+    if ( sscanf(line, "budget %lu", &value) == 1 ) {
+      passBudget = value;
+      continue;
+    }
+
+    if ( sscanf(line, "kind %31s", name) == 1 ) {
+      for ( uint8_t k = 0 ; k < sizeof(failNames) / sizeof(failNames[0]) ; k++ )
+        if ( strcmp(name, failNames[k]) == 0 )
+          kind = k;
+      continue;
+    }
+
+    if ( sscanf(line, "%lu %31s", &value, name) == 2 )
+      for ( uint8_t a = 0 ; a < ACT_COUNT ; a++ )
+        if ( strcmp(name, actionNames[a]) == 0 )
+          steps.push_back({ (uint32_t) value, a });
+  }
+
+  fclose(file);
+
+  return true;
+
+}
+
+
+////////////////////////////////////
+//
+//    Ejecucion en paralelo
+//
+
+struct Worker {
+
+  std::atomic<uint64_t> heartbeat;
+  std::atomic<uint32_t> seed;
+  std::atomic<bool> busy;
+
+};
+
+static std::atomic<uint32_t> nextInstance;
+static std::atomic<uint64_t> totalPasses;
+static std::atomic<uint64_t> totalTime;
+static std::atomic<uint32_t> failures;
+
+/*
+ * Uso de recursos de todas las instancias (--usage): incrementos
+ * de los contadores del firmware, bytes enviados al DFPlayer
+ * simulado y escrituras de cada byte de la EEPROM
+ */
+static bool usageReport = false;
+static std::mutex usageLock;
+#ifdef RULI_ACCOUNTING
+static uint64_t usageCounters[ACC_COUNTERS];
+#endif
+static uint64_t usageMp3Bytes;
+static uint64_t usageCells[SOAK_EEPROM_SIZE];
+
+// Latencias de todas las instancias (--latency)
+static bool latencyReport = false;
+static LatencySum latencyTotal[SOAK_LATENCY_PATHS];
+
+
+/*
+ * Linea de tiempo (--timeline): archivo compartido por los
+ * hilos, duracion minima de los intervalos y totales
+ */
+static FILE *timelineFile = NULL;
+static std::mutex timelineLock;
+static uint64_t timelineMin = SOAK_TIMELINE_MIN_US;
+static std::atomic<uint64_t> timelineSpans;
+static std::atomic<uint64_t> timelineEvents;
+
+
+static SoakTimeline *timelineBegin(uint32_t seed) {
+
+  if ( timelineFile == NULL )
+    return NULL;
+
+  SoakTimeline *timeline = new SoakTimeline();
+  timeline->begin(timelineFile, &timelineLock, seed, timelineMin);
+  timeline->threadName(TIMELINE_INPUT, "input");
+
+  return timeline;
+
+}
+
+
+static void timelineEnd(SoakTimeline *timeline) {
+
+  if ( timeline == NULL )
+    return;
+
+  timelineSpans += timeline->spans;
+  timelineEvents += timeline->events;
+  delete timeline;
+
+}
+
+
+static void collectUsage(Instance &instance) {
+
+  std::lock_guard<std::mutex> lock(usageLock);
+
+#ifdef RULI_ACCOUNTING
+  // Sesiones: los arranques, incluido el primero
+  usageCounters[0] += 1;
+  for ( uint8_t c = 0 ; c < ACC_COUNTERS ; c++ )
+    usageCounters[c] += (uint32_t) (Soak::usage(instance.ruliBrain, c) - instance.usageStart[c]);
+#endif
+
+  // Tramas de 10 bytes
+  usageMp3Bytes += instance.board.commands * 10ULL;
+
+  for ( int i = 0 ; i < SOAK_EEPROM_SIZE ; i++ )
+    usageCells[i] += instance.board.eepromCellWrites[i];
+
+}
+
+
+static void collectLatency(Instance &instance) {
+
+#ifdef RULI_LATENCY
+  std::lock_guard<std::mutex> lock(usageLock);
+
+  Soak::latency(instance.ruliBrain, instance.latency);
+
+  for ( uint8_t i = 0 ; i < SOAK_LATENCY_PATHS ; i++ ) {
+    LatencySum &sum = instance.latency[i];
+    LatencySum &total = latencyTotal[i];
+
+    for ( uint8_t b = 0 ; b < LATENCY_BUCKETS ; b++ )
+      total.buckets[b] += sum.buckets[b];
+
+    if ( sum.count == 0 )
+      continue;
+
+    total.minValue = total.count ? (std::min)(total.minValue, sum.minValue) : sum.minValue;
+    total.maxValue = (std::max)(total.maxValue, sum.maxValue);
+    total.count += sum.count;
+  }
+#else
+  (void) instance;
+#endif
+
+}
+
+
+static void work(Worker *worker, uint32_t firstSeed, uint32_t count, uint64_t duration) {
+
+  uint32_t index;
+
+  while ( (index = nextInstance++) < count ) {
+
+    uint32_t seed = firstSeed + index;
+    std::vector<Step> steps = generate(seed, duration);
+    Instance *instance = new Instance();
+    Failure failure;
+
+    worker->seed = seed;
+    worker->busy = true;
+    instance->heartbeat = &worker->heartbeat;
+    instance->timeline = timelineBegin(seed);
+
+    try {
+      instance->begin(seed);
+      failure = instance->run(steps, false);
+    } catch ( SoakHang &hang ) {
+      failure = { FAIL_HANG, 0, hang.elapsed, "setup did not finish" };
+    }
+
+    totalPasses += instance->passes;
+    totalTime += instance->board.now;
+    if ( usageReport )
+      collectUsage(*instance);
+    if ( latencyReport )
+      collectLatency(*instance);
+    if ( instance->timeline ) {
+      instance->timeline->end(instance->board);
+      timelineEnd(instance->timeline);
+    }
+    worker->busy = false;
+    delete instance;
+
+    if ( failure.kind == FAIL_NONE )
+      continue;
+
+    failures++;
+
+    steps.resize((std::min)(steps.size(), failure.step + 1));
+    steps = reduce(seed, steps, failure.kind);
+
+    std::string path = saveTrace(seed, failure, steps);
+    printf("seed %u: %s at %.3f s (%s), %zu steps -> %s\n", seed, failNames[failure.kind],
+      failure.time / 1e6, failure.detail.c_str(), steps.size(), path.c_str());
+    fflush(stdout);
+  }
+
+}
+
+
+/*
+ * Una instancia sin progreso durante SOAK_WALL_HANG_S segundos
+ * reales esta en un lazo que no consume tiempo simulado
+ */
+static void monitor(std::vector<Worker> *workers, std::atomic<bool> *done, uint64_t duration) {
+
+  std::vector<uint64_t> last(workers->size(), 0);
+  std::vector<int> still(workers->size(), 0);
+
+  while ( ! *done ) {
+
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+
+    for ( size_t i = 0 ; i < workers->size() ; i++ ) {
+
+      Worker &worker = (*workers)[i];
+      uint64_t beat = worker.heartbeat;
+
+      if ( worker.busy && beat == last[i] ) {
+        if ( ++still[i] >= SOAK_WALL_HANG_S ) {
+          Failure failure = { FAIL_WALL, 0, 0, "no progress in wall-clock time" };
+          uint32_t seed = worker.seed;
+          std::string path = saveTrace(seed, failure, generate(seed, duration));
+          printf("seed %u: WALL (instance stopped making progress) -> %s\n", seed, path.c_str());
+          fflush(stdout);
+          _exit(2);
+        }
+      }
+      else
+        still[i] = 0;
+
+      last[i] = beat;
+    }
+  }
+
+}
+
+
+#ifdef RULI_ACCOUNTING
+static const char *modeNames[ACC_MODES] = {
+  "welcome", "simpleRoulette", "randomColor", "followTheColor", "turnMeter", "velocityMeter",
+  "customShape", "soundShooting", "music", "userProgram", "iddle", "stream"
+};
+
+static const char *regionNames[ACC_REGIONS] = { "params", "snapshot", "outcomes", "animation", "accounting" };
+
+// Bytes de cada region (ver RuliBrain.cpp)
+static const unsigned regionSizes[ACC_REGIONS] = { 4, 32, 256, 224, ACC_SIZE };
+#endif
+
+
+/*
+ * Informe de --usage: las tablas de tools/usage.py sobre los
+ * contadores del firmware, y las escrituras medidas por byte
+ * de la EEPROM con la vida util resultante
+ */
+static void printUsage(uint64_t simulated) {
+
+  double days = simulated / 86400e6;
+
+#ifdef RULI_ACCOUNTING
+  uint64_t total[ACC_KINDS] = { 0 };
+
+  printf("\nsessions: %llu\n\n", (unsigned long long) usageCounters[0]);
+  printf("%-16s %12s %12s %14s %10s %10s\n", "mode", "mp3 bytes", "refreshes", "pin writes", "encoder", "eeprom");
+
+  for ( uint8_t m = 0 ; m < ACC_MODES ; m++ ) {
+    uint64_t *row = &usageCounters[1 + ACC_REGIONS + m * ACC_KINDS];
+    printf("%-16s %12llu %12llu %14llu %10llu %10llu\n", modeNames[m],
+      (unsigned long long) row[ACC_MP3_BYTES], (unsigned long long) row[ACC_REFRESHES],
+      (unsigned long long) row[ACC_PIN_WRITES], (unsigned long long) row[ACC_ENCODER_EVENTS],
+      (unsigned long long) row[ACC_EEPROM_WRITES]);
+    for ( uint8_t k = 0 ; k < ACC_KINDS ; k++ )
+      total[k] += row[k];
+  }
+
+  printf("%-16s %12llu %12llu %14llu %10llu %10llu\n\n", "total",
+    (unsigned long long) total[ACC_MP3_BYTES], (unsigned long long) total[ACC_REFRESHES],
+    (unsigned long long) total[ACC_PIN_WRITES], (unsigned long long) total[ACC_ENCODER_EVENTS],
+    (unsigned long long) total[ACC_EEPROM_WRITES]);
+
+  printf("%-16s %12s %12s %14s\n", "region", "writes", "bytes", "writes/byte");
+  for ( uint8_t r = 0 ; r < ACC_REGIONS ; r++ )
+    printf("%-16s %12llu %12u %14.1f\n", regionNames[r], (unsigned long long) usageCounters[1 + r],
+      regionSizes[r], (double) usageCounters[1 + r] / regionSizes[r]);
+
+  /*
+   * Los incrementos en RAM al momento de un corte de energia se
+   * pierden: la diferencia con lo medido es lo no contabilizado
+   */
+  printf("\nmp3 bytes measured by the simulated player: %llu (counted %llu)\n",
+    (unsigned long long) usageMp3Bytes, (unsigned long long) total[ACC_MP3_BYTES]);
+#else
+  printf("\nfirmware without RULI_ACCOUNTING: only the measured usage\n");
+  printf("\nmp3 bytes measured by the simulated player: %llu\n", (unsigned long long) usageMp3Bytes);
+#endif
+
+  std::vector<int> cells(SOAK_EEPROM_SIZE);
+  for ( int i = 0 ; i < SOAK_EEPROM_SIZE ; i++ )
+    cells[i] = i;
+  std::sort(cells.begin(), cells.end(), [](int a, int b) { return usageCells[a] > usageCells[b]; });
+
+  printf("\n%-10s %12s %12s %12s\n", "address", "writes", "writes/day", "years");
+  for ( int i = 0 ; i < SOAK_USAGE_TOP && usageCells[cells[i]] ; i++ ) {
+    double perDay = usageCells[cells[i]] / days;
+    printf("0x%03X      %12llu %12.1f %12.1f\n", cells[i], (unsigned long long) usageCells[cells[i]],
+      perDay, SOAK_EEPROM_ENDURANCE / perDay / 365);
+  }
+
+}
+
+
+/*
+ * Informe de --latency: percentiles (us, reloj virtual) de cada
+ * recorrido con la resolucion del histograma del firmware
+ */
+static void printLatency(void) {
+
+#ifdef RULI_LATENCY
+  static const char *pathNames[SOAK_LATENCY_PATHS] = { "wheel->leds", "wheel->sound" };
+
+  printf("\n%-14s %10s %8s %8s %8s %8s %8s\n", "latency (us)", "n", "min", "p50", "p90", "p99", "max");
+
+  for ( uint8_t i = 0 ; i < SOAK_LATENCY_PATHS ; i++ ) {
+    LatencySum &sum = latencyTotal[i];
+    printf("%-14s %10llu %8lu %8lu %8lu %8lu %8lu\n", pathNames[i], (unsigned long long) sum.count,
+      sum.count ? sum.minValue : 0, Soak::percentile(sum, 50), Soak::percentile(sum, 90),
+      Soak::percentile(sum, 99), sum.maxValue);
+  }
+#else
+  printf("\nfirmware without RULI_LATENCY: no latency samples\n");
+#endif
+
+}
+
+
+/*
+ * Completa el archivo de --timeline: el ultimo evento
+ * (nombre del proceso 0) no lleva coma final
+ */
+static void timelineClose(const char *path) {
+
+  if ( timelineFile == NULL )
+    return;
+
+  fprintf(timelineFile, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,\"args\":{\"name\":\"soak\"}}\n"
+    "],\"displayTimeUnit\":\"ms\"}\n");
+  long size = ftell(timelineFile);
+  fclose(timelineFile);
+
+#ifndef RULI_TRACE
+  printf("firmware without RULI_TRACE: only the eeprom, dfplayer and input tracks\n");
+#endif
+  printf("timeline: %llu spans, %llu events -> %s (%.1f MB)\n", (unsigned long long) timelineSpans.load(),
+    (unsigned long long) timelineEvents.load(), path, size / 1e6);
+
+}
+
+
+static void usage(void) {
+
+  fprintf(stderr,
+    "usage: soak [-n instances] [-m simulated minutes] [-j threads] [-s first seed] [-b pass budget us] [--usage]\n"
+    "            [--latency] [--timeline file.json] [--timeline-min us]\n"
+    "       soak --replay file.trace [-v] [--timeline file.json] [--timeline-min us]\n");
+  exit(1);
+
+}
+
+
+int main(int argc, char **argv) {
+
+  uint32_t count = 1000;
+  uint32_t firstSeed = 1;
+  double minutes = 10;
+  unsigned threads = std::thread::hardware_concurrency();
+  const char *replayPath = NULL;
+  const char *timelinePath = NULL;
+  bool verbose = false;
+
+  for ( int i = 1 ; i < argc ; i++ ) {
+    std::string arg = argv[i];
+    if ( arg == "-v" ) { verbose = true; continue; }
+    if ( arg == "--usage" ) { usageReport = true; continue; }
+    if ( arg == "--latency" ) { latencyReport = true; continue; }
+    if ( i + 1 >= argc ) usage();
+    if ( arg == "-n" ) count = strtoul(argv[++i], NULL, 0);
+    else if ( arg == "-m" ) minutes = atof(argv[++i]);
+    else if ( arg == "-j" ) threads = strtoul(argv[++i], NULL, 0);
+    else if ( arg == "-s" ) firstSeed = strtoul(argv[++i], NULL, 0);
+    else if ( arg == "-b" ) passBudget = strtoul(argv[++i], NULL, 0);
+    else if ( arg == "--replay" ) replayPath = argv[++i];
+    else if ( arg == "--timeline" ) timelinePath = argv[++i];
+    else if ( arg == "--timeline-min" ) timelineMin = strtoull(argv[++i], NULL, 0);
+    else usage();
+  }
+
+  if ( timelinePath ) {
+    timelineFile = fopen(timelinePath, "w");
+    if ( timelineFile == NULL ) {
+      fprintf(stderr, "soak: cannot write %s\n", timelinePath);
+      return 1;
+    }
+    fprintf(timelineFile, "{\"traceEvents\":[\n");
+  }
+
+  if ( replayPath ) {
+
+    uint32_t seed = 0;
+    uint8_t kind = FAIL_NONE;
+    std::vector<Step> steps;
+
+    if ( ! loadTrace(replayPath, seed, kind, steps) ) {
+      fprintf(stderr, "soak: cannot read %s\n", replayPath);
+      return 1;
+    }
+
+    SoakTimeline *timeline = timelineBegin(seed);
+    Failure failure = replay(seed, steps, verbose, timeline);
+    timelineEnd(timeline);
+    printf("seed %u, %zu steps: %s", seed, steps.size(), failNames[failure.kind]);
+    if ( failure.kind != FAIL_NONE )
+      printf(" at %.3f s, step %zu (%s)", failure.time / 1e6, failure.step, failure.detail.c_str());
+    printf("\n");
+    timelineClose(timelinePath);
+
+    return failure.kind == kind ? 0 : 1;
+  }
+
+  if ( threads == 0 )
+    threads = 1;
+
+  std::vector<Worker> workers(threads);
+  std::vector<std::thread> pool;
+  std::atomic<bool> done(false);
+  auto start = std::chrono::steady_clock::now();
+
+  for ( Worker &worker : workers ) {
+    worker.heartbeat = 0;
+    worker.busy = false;
+  }
+
+  uint64_t duration = minutes * 60e6;
+  std::thread watchdog(monitor, &workers, &done, duration);
+
+  for ( unsigned t = 0 ; t < threads ; t++ )
+    pool.emplace_back(work, &workers[t], firstSeed, count, duration);
+
+  for ( std::thread &thread : pool )
+    thread.join();
+
+  done = true;
+  watchdog.join();
+
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  printf("%u instances (seeds %u-%u), %u threads, %.1f s: %.0f instances/s, %.0f passes/s, "
+    "%.1f simulated hours, %u failures\n",
+    count, firstSeed, firstSeed + count - 1, threads, seconds, count / seconds,
+    totalPasses / seconds, totalTime / 3.6e9, (unsigned) failures);
+
+  if ( usageReport )
+    printUsage(totalTime);
+
+  if ( latencyReport )
+    printLatency();
+
+  timelineClose(timelinePath);
+
+  return failures ? 1 : 0;
+
+}
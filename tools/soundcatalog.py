@@ -0,0 +1,215 @@
+#!/usr/bin/env python3
+#
+# soundcatalog.py
+# Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)
+#
+# Generador del catalogo de sonidos de Ruli. Recorre la tarjeta SD del
+# DFPlayer (carpetas NN, archivos NNN*.mp3 / NNN*.wav), mide la duracion
+# de cada archivo y genera:
+#
+#   include/SoundCatalog.h    cues con nombre (constexpr SoundCue, ver
+#                             AudioManager.h) con su duracion
+#   include/SoundDurations.h  duracion de cada archivo en memoria flash
+#                             (PROGMEM), solo incluido por AudioManager.cpp
+#
+# Con las duraciones AudioManager da por finalizado cada sonido al
+# cumplirse, sin esperar el mensaje de fin del reproductor, y music()
+# muestra el progreso del tema.
+#
+# Los nombres, carpetas y archivos de los cues se definen en CUES; el
+# generador informa los archivos que usa el firmware y no estan en la
+# tarjeta. Sin tarjeta (ni --layout) genera las tablas con duracion 0
+# (desconocida): el firmware espera el mensaje de fin como antes.
+#
+# Uso:
+#   python3 tools/soundcatalog.py <tarjeta_sd> -o include
+#   python3 tools/soundcatalog.py --layout sd.json -o include
+#   python3 tools/soundcatalog.py <tarjeta_sd> --json sd.json
+#
+# El layout es el de tools/dfplayer_emu.py ({"carpeta": {"archivo":
+# duracion_ms}}): --json lo genera desde la tarjeta para el emulador.
+#
+# Requiere ffprobe (ffmpeg) para medir la duracion.
+#
+
+import argparse
+import json
+import os
+import re
+import subprocess
+import sys
+
+
+UNIT_MS       = 10      # Unidad de las duraciones en flash (SOUND_UNIT_MS)
+MAX_UNITS     = 0xFFFF
+FUNCTIONS     = 10      # Carpetas 01..10: una por funcionalidad (welcome .. userProgram)
+
+# Cues: nombre, carpeta (None: la de cada funcionalidad), primer archivo,
+# cantidad de archivos de la familia y descripcion
+CUES = [
+    ('FUNCTION_NAME',   None,  1,  1, 'Nombre de cada funcionalidad, al seleccionarla'),
+    ('SPIN',            None,  2,  5, 'Sonidos de giro de la rueda de cada funcionalidad'),
+    ('GREETING',        1,     1,  1, 'Saludo al terminar welcome()'),
+    ('VOLUME',          1,     2,  1, 'Inicio del ajuste de volumen'),
+    ('WELCOME',         1,     3,  1, 'Efecto de welcome()'),
+    ('IDDLE',           1,     4,  4, 'Voces de inactividad (1, 2, 4 y 8 minutos)'),
+    ('COLOR_SECTION',   3,     4,  5, 'Seccion elegida por randomColor(), BLUE a RED'),
+    ('FOLLOW_SPEECH',   4,     2,  5, 'Frases de followTheColor(), en rotacion'),
+    ('FOLLOW_COLOR',    4,     7,  5, 'Color a seguir, BLUE a RED'),
+    ('FOLLOW_START',    4,    12,  1, 'Largada de followTheColor()'),
+    ('FOLLOW_HIT',      4,    13,  1, 'Color alcanzado'),
+    ('VELOCITY',        6,     2, 40, 'Velocidad de velocityMeter(), desde 1'),
+    ('SHAPE_DRAW',      7,     3,  1, 'Led dibujado en customShape()'),
+    ('SHOOTING',        8,     2, 40, 'Sonidos de soundShooting(), uno por led'),
+    ('MUSIC_TRACK',     9,     2, 40, 'Temas de music(), uno por led'),
+]
+
+
+def probe(path):
+    """Duracion (ms) del archivo mediante ffprobe."""
+    cmd = ['ffprobe', '-v', 'quiet', '-show_entries', 'format=duration',
+           '-of', 'default=noprint_wrappers=1:nokey=1', path]
+    out = subprocess.run(cmd, stdout=subprocess.PIPE, check=True).stdout
+    return int(round(float(out) * 1000))
+
+
+def scan(root):
+    """Duracion de cada archivo de la tarjeta: {carpeta: {archivo: ms}}."""
+    layout = {}
+    for folder in sorted(os.listdir(root)):
+        path = os.path.join(root, folder)
+        if not re.match(r'^\d{2}$', folder) or not os.path.isdir(path):
+            continue
+        files = {}
+        for name in sorted(os.listdir(path)):
+            m = re.match(r'^(\d{3})', name)
+            if m and name.lower().endswith(('.mp3', '.wav')):
+                try:
+                    files[int(m.group(1))] = probe(os.path.join(path, name))
+                except (OSError, subprocess.CalledProcessError, ValueError) as err:
+                    print('%s/%s: %s' % (folder, name, err), file=sys.stderr)
+        layout[int(folder)] = files
+    return layout
+
+
+def load_layout(path):
+    with open(path) as f:
+        raw = json.load(f)
+    return {int(folder): {int(n): int(ms) for n, ms in files.items()}
+            for folder, files in raw.items()}
+
+
+def cue_folders(folder):
+    return range(1, FUNCTIONS + 1) if folder is None else [folder]
+
+
+def tables(layout):
+    """Cantidad de archivos de cada carpeta: los de la tarjeta y los de CUES."""
+    sizes = {}
+    for folder, files in layout.items():
+        if 1 <= folder <= 99 and files:
+            sizes[folder] = max(files)
+    for _, folder, first, count, _ in CUES:
+        for f in cue_folders(folder):
+            sizes[f] = max(sizes.get(f, 0), first + count - 1)
+    folders = max(sizes)
+    return folders, [sizes.get(f, 0) for f in range(1, folders + 1)]
+
+
+def missing(layout):
+    """Archivos de CUES que no estan en la tarjeta."""
+    out = []
+    for name, folder, first, count, _ in CUES:
+        for f in cue_folders(folder):
+            for n in range(first, first + count):
+                if n not in layout.get(f, {}):
+                    out.append('%s: %02d/%03d' % (name, f, n))
+    return out
+
+
+def rows(values, fmt, per_row):
+    items = [fmt % v for v in values]
+    return ',\n'.join('  ' + ', '.join(items[i:i + per_row])
+                      for i in range(0, len(items), per_row))
+
+
+def write_catalog(path, layout, folders, source):
+    with open(path, 'w', newline='\r\n') as f:
+        f.write('/*\n * SoundCatalog.h\n * Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)\n *\n')
+        f.write(' * ARCHIVO GENERADO por tools/soundcatalog.py (%s), no editar a mano.\n' % source)
+        f.write(' * Solo debe ser incluido por AudioManager.h\n */\n\n')
+        f.write('#ifndef SoundCatalog_h\n#define SoundCatalog_h\n\n')
+        f.write('// Unidad (ms) de las duraciones de SoundDurations.h\n')
+        f.write('#define SOUND_UNIT_MS %d\n\n' % UNIT_MS)
+        f.write('#define SOUND_FOLDERS %d\n\n' % folders)
+        f.write('// Carpeta de los sonidos de la funcionalidad [function]\n')
+        f.write('constexpr uint8_t soundFolder(uint8_t function) { return function + 1; }\n\n')
+        f.write('/*\n * Cues: carpeta (0: la de cada funcionalidad, ver inFolder()), primer\n')
+        f.write(' * archivo, archivos de la familia (ver at()) y duracion (ms) del primero\n */\n')
+        for name, folder, first, count, text in CUES:
+            ms = 0 if folder is None else layout.get(folder, {}).get(first, 0)
+            f.write('\n// %s\n' % text)
+            f.write('constexpr SoundCue CUE_%s = { %d, %d, %d, %dUL };\n'
+                    % (name, folder or 0, first, count, ms))
+        f.write('\n#endif\n')
+
+
+def write_durations(path, layout, sizes, source):
+    index = []
+    durations = []
+    for folder, size in enumerate(sizes, 1):
+        index.append(len(durations))
+        files = layout.get(folder, {})
+        durations += [min(MAX_UNITS, (files.get(n, 0) + UNIT_MS - 1) // UNIT_MS)
+                      for n in range(1, size + 1)]
+    index.append(len(durations))
+
+    with open(path, 'w', newline='\r\n') as f:
+        f.write('/*\n * SoundDurations.h\n * Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)\n *\n')
+        f.write(' * ARCHIVO GENERADO por tools/soundcatalog.py (%s), no editar a mano.\n' % source)
+        f.write(' * Solo debe ser incluido por AudioManager.cpp\n */\n\n')
+        f.write('#ifndef SoundDurations_h\n#define SoundDurations_h\n\n')
+        f.write('#define SOUND_FILES %d\n\n' % len(durations))
+        f.write('// Posicion en soundDurations del archivo 001 de cada carpeta\n')
+        f.write('const uint16_t soundFolderIndex[SOUND_FOLDERS + 1] PROGMEM = {\n%s\n};\n\n'
+                % rows(index, '%d', 10))
+        f.write('// Duracion de cada archivo (x SOUND_UNIT_MS, 0 = desconocida)\n')
+        f.write('const uint16_t soundDurations[SOUND_FILES] PROGMEM = {\n%s\n};\n\n'
+                % rows(durations, '%d', 10))
+        f.write('#endif\n')
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Catalogo de sonidos de Ruli')
+    parser.add_argument('sd', nargs='?', help='raiz de la tarjeta SD')
+    parser.add_argument('--layout', help='duraciones en el formato de tools/dfplayer_emu.py')
+    parser.add_argument('-o', '--output', default='include', help='carpeta de los headers')
+    parser.add_argument('--json', help='escribe ademas el layout para tools/dfplayer_emu.py')
+    args = parser.parse_args()
+
+    if args.sd:
+        layout, source = scan(args.sd), 'tarjeta SD'
+    elif args.layout:
+        layout, source = load_layout(args.layout), os.path.basename(args.layout)
+    else:
+        layout, source = {}, 'sin duraciones'
+
+    for item in missing(layout) if layout else []:
+        print('falta %s' % item, file=sys.stderr)
+
+    folders, sizes = tables(layout)
+    write_catalog(os.path.join(args.output, 'SoundCatalog.h'), layout, folders, source)
+    write_durations(os.path.join(args.output, 'SoundDurations.h'), layout, sizes, source)
+
+    if args.json:
+        with open(args.json, 'w') as f:
+            json.dump({'%02d' % folder: {'%03d' % n: ms for n, ms in sorted(files.items())}
+                       for folder, files in sorted(layout.items())}, f, indent=1)
+
+    known = sum(1 for files in layout.values() for ms in files.values() if ms)
+    print('%d carpetas, %d archivos (%d con duracion), %d bytes de flash -> %s'
+          % (folders, sum(sizes), known, 2 * (sum(sizes) + folders + 1), args.output))
+
+
+if __name__ == '__main__':
+    main()
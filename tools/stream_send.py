@@ -0,0 +1,240 @@
+#!/usr/bin/env python3
+#
+# stream_send.py
+# Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)
+#
+# Transmisor de shows de luces y sonido para el modo STREAM de Ruli (ver
+# LightStream.h). Reproduce un archivo de show enviando cada cuadro en su
+# instante, y muestra las estadisticas que el equipo informa por telemetria
+# (cuadros/s presentados, descartados y jitter del latch).
+#
+# Uso:
+#   python3 tools/stream_send.py /dev/ttyUSB0 show.txt
+#   python3 tools/stream_send.py /dev/ttyUSB0 captura.bin --loop
+#   python3 tools/stream_send.py /dev/ttyUSB0 --pattern 100 --duration 30
+#
+# Formato del archivo de show (texto, una accion por linea):
+#
+#   # comentario
+#   <ms> leds <func> <azul> <verde> <blanco> <amarillo> <rojo>   (hexadecimal)
+#   <ms> cue <clase> <carpeta> <archivo>                          (carpeta 0: detener)
+#
+# donde <clase> es music, spin, effect o voice (AudioManager.h). Tambien se
+# acepta una captura de telemetria (telemetry_decode.py --write): se
+# reproducen los leds y los playFolder() registrados.
+#
+
+import argparse
+import os
+import select
+import sys
+import termios
+import time
+import tty
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import telemetry_decode  # noqa: E402
+
+
+SYNC        = 0x5A
+RECORD_SIZE = 12
+BAUDS       = termios.B115200
+
+ST_CLOCK    = 0x01
+ST_FRAME    = 0x02
+ST_CUE      = 0x03
+ST_END      = 0x04
+
+JITTER_MS   = 30        # Debe coincidir con STREAM_JITTER_MS de LightStream.h
+
+CLASSES = {'music': 0, 'spin': 1, 'effect': 2, 'voice': 3}
+
+
+def record(rtype, seq, ms, payload=b''):
+    body = bytes([rtype, seq & 0xFF, ms & 0xFF, (ms >> 8) & 0xFF]) + bytes(payload).ljust(6, b'\0')
+    return bytes([SYNC]) + body + bytes([-sum(body) & 0xFF])
+
+
+def load_text(path):
+    events = []
+    with open(path) as f:
+        for number, line in enumerate(f, 1):
+            fields = line.split('#')[0].split()
+            if not fields:
+                continue
+            try:
+                ms = int(fields[0])
+                if fields[1] == 'leds' and len(fields) == 8:
+                    events.append((ms, ST_FRAME, bytes(int(v, 16) for v in fields[2:])))
+                elif fields[1] == 'cue' and len(fields) == 5:
+                    events.append((ms, ST_CUE, bytes([CLASSES[fields[2]],
+                                                      int(fields[3]), int(fields[4])])))
+                else:
+                    raise ValueError
+            except (ValueError, KeyError, IndexError):
+                sys.exit('%s:%d: linea invalida' % (path, number))
+    return sorted(events, key=lambda e: e[0])
+
+
+class CaptureReader(telemetry_decode.Decoder):
+    """Convierte una captura de telemetria en la lista de eventos del show."""
+
+    def __init__(self):
+        super().__init__(quiet=True)
+        self.events = []
+        self.frame = None
+
+    def handle(self, record):
+        super().handle(record)
+        rtype, p = record[1], record[5:11]
+        if rtype in (telemetry_decode.TM_LEDS_FRAME, telemetry_decode.TM_LEDS_DIFF):
+            # Sin cuadros desconocidos (perdidas) ni repetidos (resincronizacion periodica)
+            if None not in self.leds and bytes(self.leds) != self.frame:
+                self.frame = bytes(self.leds)
+                self.events.append((self.clock, ST_FRAME, self.frame))
+        elif rtype == telemetry_decode.TM_MP3_COMMAND:
+            if p[0] == 0x0F:
+                self.events.append((self.clock, ST_CUE, bytes([CLASSES['music'], p[2], p[1]])))
+            elif p[0] == 0x16:
+                self.events.append((self.clock, ST_CUE, bytes([CLASSES['music'], 0, 0])))
+
+
+def load_capture(path):
+    reader = CaptureReader()
+    with open(path, 'rb') as f:
+        reader.feed(f.read())
+    if not reader.events:
+        return []
+    start = reader.events[0][0]
+    return [(ms - start, rtype, payload) for ms, rtype, payload in reader.events]
+
+
+def pattern(fps, duration):
+    """Rotacion de un led por cuadro, para medir la tasa sostenida."""
+    events = []
+    for n in range(int(fps * duration)):
+        led = n % 32
+        leds = [0xFF] + [0] * 5
+        leds[1 + led // 8] = 0x01 << (led % 8)
+        events.append((int(n * 1000 / fps), ST_FRAME, bytes(leds)))
+    return events
+
+
+class StatsMonitor(telemetry_decode.Decoder):
+    """Muestra solo las estadisticas del stream informadas por el equipo."""
+
+    def __init__(self):
+        super().__init__(quiet=True)
+
+    def handle(self, record):
+        super().handle(record)
+        if record[1] == telemetry_decode.TM_STREAM:
+            print('equipo: %s' % self.describe(record[1], record[5:11]), flush=True)
+
+
+def open_port(path):
+    fd = os.open(path, os.O_RDWR | os.O_NOCTTY)
+    if os.isatty(fd):
+        tty.setraw(fd)
+        attrs = termios.tcgetattr(fd)
+        attrs[4] = attrs[5] = BAUDS
+        termios.tcsetattr(fd, termios.TCSANOW, attrs)
+    return fd
+
+
+def play(fd, events, args, monitor):
+    seq = 0
+    sent = 0
+    late = 0
+    length = events[-1][0] + 1 if events else 0
+    loops = 0
+    started = time.monotonic()
+
+    def send(data):
+        os.write(fd, data)
+
+    def poll(timeout):
+        ready, _, _ = select.select([fd], [], [], max(0.0, timeout))
+        if ready:
+            data = os.read(fd, 4096)
+            if data:
+                monitor.feed(data)
+
+    send(record(ST_CLOCK, seq, 0))
+    seq += 1
+
+    while True:
+        base = loops * length
+        for ms, rtype, payload in events:
+            show_ms = (base + ms) / args.speed
+            when = started + (show_ms - args.lead_ms) / 1000.0
+            while time.monotonic() < when:
+                poll(when - time.monotonic())
+            if (time.monotonic() - started) * 1000.0 - show_ms > JITTER_MS:
+                late += 1
+            send(record(rtype, seq, int(show_ms)))
+            seq += 1
+            sent += 1
+        loops += 1
+        if not args.loop:
+            break
+
+    # Espera a que se presente el ultimo cuadro antes de terminar
+    end = time.monotonic() + (JITTER_MS + 100) / 1000.0
+    while time.monotonic() < end:
+        poll(end - time.monotonic())
+    send(record(ST_END, seq, 0))
+
+    elapsed = time.monotonic() - started
+    return sent, late, elapsed
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Transmisor de shows para el modo STREAM de Ruli')
+    parser.add_argument('port', help='puerto serie del equipo')
+    parser.add_argument('show', nargs='?', help='archivo de show (texto) o captura de telemetria (.bin)')
+    parser.add_argument('--pattern', type=float, metavar='FPS',
+                        help='en lugar de un show, generar un patron de prueba a FPS cuadros/s')
+    parser.add_argument('--duration', type=float, default=10,
+                        help='segundos del patron de prueba')
+    parser.add_argument('--lead-ms', type=float, default=0,
+                        help='anticipacion del envio respecto del instante de cada cuadro '
+                             '(menor que %d ms)' % JITTER_MS)
+    parser.add_argument('--speed', type=float, default=1.0)
+    parser.add_argument('--loop', action='store_true', help='repetir el show hasta Ctrl-C')
+    parser.add_argument('--boot-wait', type=float, default=2.0,
+                        help='segundos de espera por el reinicio del equipo al abrir el puerto')
+    args = parser.parse_args()
+
+    if args.pattern:
+        events = pattern(args.pattern, args.duration)
+    elif args.show:
+        events = load_capture(args.show) if args.show.endswith('.bin') else load_text(args.show)
+    else:
+        parser.error('se requiere un archivo de show o --pattern')
+
+    if not events:
+        sys.exit('el show no contiene cuadros')
+
+    fd = open_port(args.port)
+    monitor = StatsMonitor()
+    time.sleep(args.boot_wait)
+    if os.isatty(fd):
+        termios.tcflush(fd, termios.TCIFLUSH)
+
+    try:
+        sent, late, elapsed = play(fd, events, args, monitor)
+    except KeyboardInterrupt:
+        os.write(fd, record(ST_END, 0, 0))
+        sent, late, elapsed = 0, 0, 0
+    finally:
+        os.close(fd)
+
+    if elapsed:
+        print('host: %d registros en %.1f s (%.1f/s), %d enviados tarde'
+              % (sent, elapsed, sent / elapsed, late))
+    monitor.summary()
+
+
+if __name__ == '__main__':
+    main()
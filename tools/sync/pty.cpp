@@ -0,0 +1,34 @@
+/*
+ * pty.cpp
+ * Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)
+ *
+ * Lineas serie de tools/sync/sync_test.cpp sobre ptys locales (aparte:
+ * los nombres de velocidades de termios.h coinciden con los de binary.h)
+ */
+
+#include <stddef.h>
+#include <fcntl.h>
+#include <pty.h>
+#include <termios.h>
+
+#include "pty.h"
+
+
+int openLine(int *hubFd, int *unitFd) {
+
+  struct termios raw;
+
+  if ( openpty(hubFd, unitFd, NULL, NULL, NULL) < 0 )
+    return -1;
+
+  // Sin eco ni traduccion de caracteres, ambos lados sin bloqueo
+  tcgetattr(*unitFd, &raw);
+  cfmakeraw(&raw);
+  tcsetattr(*unitFd, TCSANOW, &raw);
+
+  fcntl(*unitFd, F_SETFL, fcntl(*unitFd, F_GETFL) | O_NONBLOCK);
+  fcntl(*hubFd, F_SETFL, fcntl(*hubFd, F_GETFL) | O_NONBLOCK);
+
+  return 0;
+
+}
@@ -0,0 +1,15 @@
+/*
+ * pty.h
+ * Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)
+ */
+
+#ifndef pty_h
+#define pty_h
+
+/**
+ * Abre un pty en modo crudo: [hubFd] lado del hub, [unitFd] puerto
+ * serie de la unidad. Devuelve -1 si falla (errno)
+ */
+int openLine(int *hubFd, int *unitFd);
+
+#endif
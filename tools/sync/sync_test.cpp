@@ -0,0 +1,580 @@
+/*
+ * sync_test.cpp
+ * Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)
+ *
+ * Prueba en el host del bus de sincronismo (ver SyncBus.h). Ejecuta N
+ * unidades del firmware (src/, sin modificar) sobre el hardware simulado
+ * de tools/soak/mock, cada una con su reloj (desplazamiento aleatorio y
+ * deriva de hasta -r ppm) y su puerto serie sobre un pty local. El hub
+ * lee lo que transmite cada unidad por el lado master de su pty y lo
+ * entrega a las demas al terminar cada byte en la linea (10 bits a la
+ * velocidad del puerto); dos rafagas superpuestas se entregan corruptas
+ * y se cuentan como colisiones.
+ *
+ * Las unidades se ejecutan en tiempo virtual: siempre avanza la que esta
+ * mas atrasada en el tiempo real simulado, una pasada del lazo principal
+ * (-p us mas hasta -j us de variacion) por vez, con lo que el resultado
+ * es reproducible para cada semilla y no depende de la carga del host.
+ *
+ * Sin entradas las unidades pasan a IDDLE a los 60 s y siguen los cuadros
+ * del bus: para cada cuadro con latch de los leds en todas las unidades
+ * se mide la dispersion (max - min, tiempo real) de los instantes de latch.
+ * Los cuadros incompletos (voz en curso en alguna unidad, latch omitido
+ * por tardio) se informan aparte.
+ * Con --failover se apaga el master a mitad de la medicion y se informa
+ * el nuevo master y el tiempo hasta el primer cuadro con latch comun de
+ * las restantes. Falla (estado 1) sin cuadros completos o sin un unico
+ * master al final.
+ *
+ * Compilacion: pio run -e sync_test (ver platformio.ini), o bien
+ *
+ *   g++ -O2 -std=gnu++17 -D RULI_SYNC -I tools/soak/mock -I include \
+ *     tools/sync/sync_test.cpp tools/sync/pty.cpp \
+ *     tools/soak/mock/mock.cpp src/[A-Z]*.cpp -lutil -o sync_test
+ *
+ * Uso:
+ *
+ *   sync_test [-n 2,4,8] [-d segundos] [-p us] [-j us] [-r ppm] [-s semilla] [--failover]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <Arduino.h>
+
+#include "RotaryEncoder.h"
+#include "EncoderBank.h"
+#include "MP3Player.h"
+#include "LedsPanel.h"
+#include "RuliBrain.h"
+#include "SyncBus.h"
+#include <DFRobotDFPlayerMini.h>
+
+#include "pty.h"
+
+
+// Pines del equipo (ver main.cpp)
+#define MW_CLK_PIN     16
+#define MW_DATA_PIN    15
+#define RS_SWITCH_PIN  19
+#define RS_CLK_PIN     18
+#define RS_DATA_PIN    17
+#define MP_RX          10
+#define MP_TX          11
+#define LP_ENABLE_PIN  8
+#define LP_CLOCK_PIN   9
+#define LP_DATA_PIN    12
+#define SB_DE_PIN      2
+
+// Numero de unidad en EEPROM (ver RuliBrain.cpp)
+#define EEPROM_SYNC_UNIT  3
+
+/*
+ * Arranque: IDDLE comienza a los 60 s sin entradas, luego se
+ * espera la primera ventana completa de estimacion del reloj
+ */
+#define SETTLE_S            62.0
+
+// Desplazamiento inicial maximo de micros(): el reloj del master no supera 32 bits
+#define MAX_CLOCK_OFFSET    (1UL << 30)
+
+// Duracion simulada de los sonidos
+#define TRACK_US            800000ULL
+
+#define PASS_LIMIT_US      2000000ULL
+
+
+/*
+ * Generador pseudoaleatorio de la prueba (independiente del
+ * random() del firmware, que usa el de SoakBoard)
+ */
+struct Rng {
+
+  uint64_t state;
+
+  uint32_t next(void) {
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    return (uint32_t) (state >> 33);
+  }
+
+};
+
+
+// Byte en camino hacia una unidad: fin de su ultimo bit (tiempo real)
+struct Delivery {
+  double time;
+  uint8_t value;
+};
+
+
+struct Unit {
+
+  SoakBoard board;
+
+  EncoderBank encoderBank;
+  RotaryEncoder mainWheel;
+  RotaryEncoder rotarySelector;
+  MP3Player mp3Player;
+  FastLedsPanel<LP_ENABLE_PIN, LP_CLOCK_PIN, LP_DATA_PIN> ledsPanel;
+  RuliBrain ruliBrain;
+  SyncBus syncBus;
+
+  uint8_t id;
+  bool alive;
+
+  // Reloj local: now = offset + tiempo real x rate
+  uint64_t offset;
+  double rate;
+
+  // Lado del hub del pty y bytes ya leidos / entregados
+  int hubFd;
+  uint64_t received;
+  uint64_t delivered;
+  std::deque<Delivery> inbox;
+
+  uint16_t seenFrame;
+  unsigned long seenRefresh;
+
+  uint32_t lastStarted;
+  uint64_t finishAt;
+
+  double trueTime(uint64_t local) {
+    return ( (double) local - (double) offset ) / rate;
+  }
+
+  double trueNow(void) {
+    return trueTime(board.now);
+  }
+
+  void begin(uint8_t pid, Rng &rng, double ppm);
+  void deliver(void);
+  void pass(uint32_t passUs);
+
+};
+
+
+static void fail(const char *what) {
+
+  perror(what);
+  exit(2);
+
+}
+
+
+void Unit::begin(uint8_t pid, Rng &rng, double ppm) {
+
+  int unitFd;
+
+  soakBoard = &board;
+
+  memset(&board, 0x00, sizeof(board));
+  board.hangLimit = PASS_LIMIT_US;
+  board.rng = rng.next() | 1;
+
+  id = pid;
+  alive = true;
+  offset = rng.next() % MAX_CLOCK_OFFSET;
+  rate = 1.0 + ppm * 1e-6 * ( (int32_t) (rng.next() % 2001) - 1000 ) / 1000.0;
+  board.now = offset;
+  board.passStart = offset;
+
+  // EEPROM en blanco salvo el numero de unidad
+  memset(board.eeprom, 0xFF, SOAK_EEPROM_SIZE);
+  board.eeprom[EEPROM_SYNC_UNIT] = id;
+
+  if ( openLine(&hubFd, &unitFd) < 0 )
+    fail("openpty");
+
+  board.serialFd = unitFd;
+  received = 0;
+  delivered = 0;
+
+  seenFrame = SYNC_NO_FRAME;
+  seenRefresh = 0;
+  lastStarted = 0;
+  finishAt = 0;
+
+  // Entradas con pull-up en reposo
+  PINB = 0xFF;
+  PINC = 0xFF;
+  PIND = 0xFF;
+
+  // Igual que setup() de main.cpp
+  mainWheel.begin(MW_CLK_PIN, MW_DATA_PIN);
+  rotarySelector.begin(RS_CLK_PIN, RS_DATA_PIN, RS_SWITCH_PIN);
+  encoderBank.begin();
+  mainWheel.attach(&encoderBank);
+  rotarySelector.attach(&encoderBank);
+  mp3Player.begin(MP_RX, MP_TX);
+  ledsPanel.begin();
+  ruliBrain.begin(&mainWheel, &rotarySelector, &mp3Player, &ledsPanel);
+  syncBus.begin(SB_DE_PIN);
+  ruliBrain.attach(&syncBus);
+
+}
+
+
+/**
+ * Escribe en el pty los bytes que ya terminaron de llegar y espera
+ * a que el kernel los ponga a disposicion del lado de la unidad
+ */
+void Unit::deliver(void) {
+
+  double now = trueNow();
+  uint8_t buffer[256];
+  size_t count = 0;
+  int pending;
+
+  while ( ! inbox.empty() && inbox.front().time <= now && count < sizeof(buffer) ) {
+    buffer[count++] = inbox.front().value;
+    inbox.pop_front();
+  }
+
+  if ( count == 0 )
+    return;
+
+  if ( write(hubFd, buffer, count) != (ssize_t) count )
+    fail("write");
+
+  delivered += count;
+
+  for ( int wait = 0 ; ; wait++ ) {
+    if ( ioctl(board.serialFd, FIONREAD, &pending) < 0 )
+      fail("ioctl");
+    if ( (uint64_t) pending >= delivered - board.serialRxBytes )
+      break;
+    if ( wait == 1000 ) {
+      fprintf(stderr, "sync_test: pty of unit %u stalled\n", id);
+      exit(2);
+    }
+    usleep(100);
+  }
+
+}
+
+
+void Unit::pass(uint32_t passUs) {
+
+  board.passStart = board.now;
+
+  try {
+    encoderBank.sample();
+    ruliBrain.run();
+  }
+  catch ( SoakHang &hang ) {
+    fprintf(stderr, "sync_test: unit %u pass hung (%llu us)\n", id, (unsigned long long) hang.elapsed);
+    exit(2);
+  }
+
+  board.now += passUs;
+
+  // Reproductor: cada sonido termina TRACK_US despues de comenzar
+  if ( board.started != lastStarted ) {
+    lastStarted = board.started;
+    finishAt = board.now + TRACK_US;
+  }
+
+  if ( board.playing && board.now >= finishAt ) {
+    board.playing = 0;
+    board.respond(DFPlayerPlayFinished, board.file);
+  }
+
+}
+
+
+////////////////////////////////////
+//
+//    Bus
+//
+
+struct Bus {
+
+  std::vector<std::unique_ptr<Unit>> units;
+
+  // Ultima rafaga en la linea (tiempo real)
+  double busyUntil;
+  uint8_t busySender;
+  uint32_t collisions;
+
+  void collect(Unit &sender);
+
+};
+
+
+/**
+ * Lee lo transmitido por [sender] en la ultima pasada y lo
+ * encola hacia las demas unidades con el instante de llegada
+ */
+void Bus::collect(Unit &sender) {
+
+  uint8_t buffer[256];
+  ssize_t count = 0;
+  double byteUs, end, start;
+  bool collision;
+
+  while ( sender.received + count < sender.board.serialTxBytes ) {
+    ssize_t n = read(sender.hubFd, buffer + count, sizeof(buffer) - count);
+    if ( n > 0 )
+      count += n;
+    else {
+      struct pollfd fd = { sender.hubFd, POLLIN, 0 };
+      if ( poll(&fd, 1, 1000) <= 0 ) {
+        fprintf(stderr, "sync_test: pty of unit %u stalled\n", sender.id);
+        exit(2);
+      }
+    }
+  }
+
+  if ( count == 0 )
+    return;
+
+  sender.received += count;
+
+  // Los bytes leidos son los ultimos de la rafaga en curso
+  byteUs = sender.board.serialByteUs / sender.rate;
+  end = sender.trueTime(sender.board.serialTxStart + sender.board.serialTxCount * (uint64_t) sender.board.serialByteUs);
+  start = end - count * byteUs;
+
+  collision = start < busyUntil && busySender != sender.id;
+  if ( collision )
+    collisions++;
+
+  if ( end > busyUntil ) {
+    busyUntil = end;
+    busySender = sender.id;
+  }
+
+  for ( std::unique_ptr<Unit> &unit : units ) {
+
+    if ( unit.get() == &sender || ! unit->alive )
+      continue;
+
+    for ( ssize_t i = 0 ; i < count ; i++ ) {
+      Delivery delivery = { end - (count - 1 - i) * byteUs, (uint8_t) (collision ? buffer[i] ^ 0xA5 : buffer[i]) };
+      auto at = std::upper_bound(unit->inbox.begin(), unit->inbox.end(), delivery.time,
+        [](double time, const Delivery &d) { return time < d.time; });
+      unit->inbox.insert(at, delivery);
+    }
+  }
+
+}
+
+
+////////////////////////////////////
+//
+//    Medicion
+//
+
+struct Options {
+  std::vector<unsigned> counts;
+  double seconds;
+  uint32_t passUs;
+  uint32_t jitterUs;
+  double ppm;
+  uint32_t seed;
+  bool failover;
+};
+
+
+static double percentile(std::vector<double> &values, double p) {
+
+  if ( values.empty() )
+    return 0;
+
+  size_t index = (size_t) (p * (values.size() - 1) + 0.5);
+
+  std::nth_element(values.begin(), values.begin() + index, values.end());
+
+  return values[index];
+
+}
+
+
+/**
+ * Ejecuta [count] unidades y devuelve 0 si todos los cuadros
+ * medidos quedaron en paso comun en todas las unidades vivas
+ */
+static int run(unsigned count, const Options &options) {
+
+  Bus bus;
+  Rng rng = { options.seed * 0x9E3779B97F4A7C15ULL + count };
+  std::map<uint32_t, std::vector<double>> latches;
+  std::map<uint32_t, unsigned> expected;
+  double settle = SETTLE_S * 1e6;
+  double finish = settle + options.seconds * 1e6;
+  double killAt = options.failover ? settle + options.seconds * 0.5e6 : finish + 1;
+  double killed = 0;
+  unsigned alive = count;
+  uint8_t killedUnit = 0;
+
+  bus.busyUntil = 0;
+  bus.busySender = 0;
+  bus.collisions = 0;
+
+  for ( unsigned i = 0 ; i < count ; i++ ) {
+    bus.units.emplace_back(new Unit);
+    bus.units.back()->begin(i + 1, rng, options.ppm);
+  }
+
+  for ( ;; ) {
+
+    Unit *unit = NULL;
+
+    for ( std::unique_ptr<Unit> &candidate : bus.units )
+      if ( candidate->alive && ( unit == NULL || candidate->trueNow() < unit->trueNow() ) )
+        unit = candidate.get();
+
+    double now = unit->trueNow();
+
+    if ( now >= finish )
+      break;
+
+    // Falla del master: deja de ejecutarse y de transmitir
+    if ( killed == 0 && now >= killAt ) {
+      for ( std::unique_ptr<Unit> &candidate : bus.units )
+        if ( candidate->syncBus.isMaster() ) {
+          candidate->alive = false;
+          killedUnit = candidate->id;
+          alive--;
+        }
+      killed = now;
+      continue;
+    }
+
+    soakBoard = &unit->board;
+
+    unit->deliver();
+    unit->pass(options.passUs + ( options.jitterUs ? rng.next() % options.jitterUs : 0 ));
+    bus.collect(*unit);
+
+    uint16_t frame = unit->syncBus.getFrame();
+
+    if ( frame != unit->seenFrame ) {
+      unit->seenFrame = frame;
+      if ( ( frame % 9 == 1 || frame % 9 == 2 ) && unit->ledsPanel.getRefreshTimestamp() != unit->seenRefresh ) {
+        unit->seenRefresh = unit->ledsPanel.getRefreshTimestamp();
+        double latch = unit->trueTime(unit->seenRefresh);
+        if ( latch >= settle ) {
+          latches[frame].push_back(latch);
+          expected[frame] = alive;
+        }
+      }
+    }
+  }
+
+  std::vector<double> skews, after;
+  unsigned partial = 0;
+  double relock = -1;
+
+  for ( auto &entry : latches ) {
+
+    std::vector<double> &times = entry.second;
+    double first = *std::min_element(times.begin(), times.end());
+    double skew = *std::max_element(times.begin(), times.end()) - first;
+
+    /*
+     * Cuadros sin todas las unidades: voz en curso en alguna (el
+     * firmware no sigue los cuadros mientras habla), latch omitido
+     * por tardio o final de la medicion
+     */
+    if ( times.size() < expected[entry.first] ) {
+      partial++;
+      continue;
+    }
+
+    if ( killed && first > killed ) {
+      if ( relock < 0 || first - killed < relock )
+        relock = first - killed;
+      after.push_back(skew);
+    }
+    else
+      skews.push_back(skew);
+  }
+
+  printf("%2u units  %4zu frames  skew p50 %6.0f us  p95 %6.0f us  max %6.0f us  partial %u  collisions %u\n",
+    count, skews.size(), percentile(skews, 0.5), percentile(skews, 0.95),
+    skews.empty() ? 0 : *std::max_element(skews.begin(), skews.end()), partial, bus.collisions);
+
+  // Un unico master al final (luego de la eleccion, con --failover)
+  unsigned masters = 0;
+  uint8_t masterUnit = 0;
+
+  for ( std::unique_ptr<Unit> &unit : bus.units )
+    if ( unit->alive && unit->syncBus.isMaster() ) {
+      masters++;
+      masterUnit = unit->id;
+    }
+
+  if ( options.failover ) {
+    if ( relock < 0 )
+      printf("          failover: unit %u off, %u masters, no common frame afterwards\n", killedUnit, masters);
+    else
+      printf("          failover: unit %u off, %u masters (unit %u), first common frame after %.0f ms,"
+        " skew p50 %.0f us  max %.0f us\n",
+        killedUnit, masters, masterUnit, relock / 1000, percentile(after, 0.5),
+        after.empty() ? 0 : *std::max_element(after.begin(), after.end()));
+  }
+
+  for ( std::unique_ptr<Unit> &unit : bus.units ) {
+    close(unit->hubFd);
+    close(unit->board.serialFd);
+  }
+
+  return skews.empty() || masters != 1 || ( options.failover && relock < 0 ) ? 1 : 0;
+
+}
+
+
+static void usage(void) {
+
+  fprintf(stderr, "usage: sync_test [-n 2,4,8] [-d seconds] [-p us] [-j us] [-r ppm] [-s seed] [--failover]\n");
+  exit(2);
+
+}
+
+
+int main(int argc, char **argv) {
+
+  Options options = { { 2, 4, 8 }, 60, 200, 300, 100, 1, false };
+  int result = 0;
+
+  for ( int i = 1 ; i < argc ; i++ ) {
+    std::string arg = argv[i];
+    if ( arg == "--failover" ) { options.failover = true; continue; }
+    if ( i + 1 >= argc ) usage();
+    if ( arg == "-n" ) {
+      options.counts.clear();
+      for ( char *item = strtok(argv[++i], ",") ; item ; item = strtok(NULL, ",") ) {
+        unsigned count = strtoul(item, NULL, 0);
+        if ( count < 1 || count > SYNC_MAX_UNITS ) usage();
+        options.counts.push_back(count);
+      }
+    }
+    else if ( arg == "-d" ) options.seconds = atof(argv[++i]);
+    else if ( arg == "-p" ) options.passUs = strtoul(argv[++i], NULL, 0);
+    else if ( arg == "-j" ) options.jitterUs = strtoul(argv[++i], NULL, 0);
+    else if ( arg == "-r" ) options.ppm = atof(argv[++i]);
+    else if ( arg == "-s" ) options.seed = strtoul(argv[++i], NULL, 0);
+    else usage();
+  }
+
+  printf("pass %u us (+%u), drift up to %.0f ppm, %.0f s per run, seed %u\n",
+    options.passUs, options.jitterUs, options.ppm, options.seconds, options.seed);
+
+  for ( unsigned count : options.counts )
+    result |= run(count, options);
+
+  return result;
+
+}
@@ -0,0 +1,132 @@
+#!/usr/bin/env python3
+#
+# sync_unit.py
+# Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)
+#
+# Asigna el numero de unidad del bus de sincronismo (ver SyncBus.h) a un
+# equipo conectado solo (USB o adaptador RS-485), y muestra el trafico del
+# bus: beacons del master, eventos y reportes de las unidades.
+#
+# El numero queda en EEPROM. Sin otras unidades el equipo asume como master
+# luego de su turno de eleccion: su beacon confirma el numero asignado.
+#
+# Uso:
+#   python3 tools/sync_unit.py /dev/ttyUSB0 3
+#   python3 tools/sync_unit.py /dev/ttyUSB0 --listen 10
+#
+
+import argparse
+import os
+import select
+import sys
+import termios
+import time
+import tty
+
+
+SYNC        = 0xC3
+RECORD_SIZE = 12
+BAUDS       = termios.B115200
+MAX_UNITS   = 8
+
+SY_BEACON   = 0x01
+SY_EVENT    = 0x02
+SY_REPORT   = 0x03
+SY_UNIT     = 0x04
+
+TYPES  = {SY_BEACON: 'beacon', SY_EVENT: 'event', SY_REPORT: 'report', SY_UNIT: 'unit'}
+EVENTS = {0: '', 1: 'race-start', 2: 'race-report', 3: 'race-result', 4: 'unit'}
+
+# Arranque del equipo al abrir el puerto (reinicio por DTR y bootloader)
+BOOT_S      = 2.5
+
+# Eleccion de una unidad sola: SYNC_MASTER_TIMEOUT_MS + 8 x SYNC_ELECTION_STEP_MS
+ELECTION_S  = 1.7
+
+
+def record(rtype, unit, stamp, event, value):
+    body = bytes([rtype, unit]) + stamp.to_bytes(4, 'little') + bytes([event]) + value.to_bytes(3, 'little')
+    return bytes([SYNC]) + body + bytes([-sum(body) & 0xFF])
+
+
+def open_port(path):
+    fd = os.open(path, os.O_RDWR | os.O_NOCTTY)
+    if os.isatty(fd):
+        tty.setraw(fd)
+        attrs = termios.tcgetattr(fd)
+        attrs[4] = attrs[5] = BAUDS
+        termios.tcsetattr(fd, termios.TCSANOW, attrs)
+    return fd
+
+
+def records(fd, seconds):
+    """Genera los registros validos recibidos durante [seconds] segundos."""
+    buffer = b''
+    deadline = time.monotonic() + seconds
+    while True:
+        remaining = deadline - time.monotonic()
+        if remaining <= 0:
+            return
+        if not select.select([fd], [], [], remaining)[0]:
+            continue
+        buffer += os.read(fd, 256)
+        while len(buffer) >= RECORD_SIZE:
+            start = buffer.find(bytes([SYNC]))
+            if start < 0:
+                buffer = b''
+                break
+            buffer = buffer[start:]
+            if len(buffer) < RECORD_SIZE:
+                break
+            if sum(buffer[1:RECORD_SIZE]) & 0xFF:
+                buffer = buffer[1:]
+                continue
+            yield buffer[:RECORD_SIZE]
+            buffer = buffer[RECORD_SIZE:]
+
+
+def describe(data):
+    stamp = int.from_bytes(data[3:7], 'little')
+    value = int.from_bytes(data[8:11], 'little')
+    text = '%-6s unit %u  clock %10u us' % (TYPES.get(data[1], '?%02X' % data[1]), data[2], stamp)
+    if data[1] != SY_BEACON:
+        text += '  %s %u' % (EVENTS.get(data[7], '?%u' % data[7]), value)
+    return text
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Numero de unidad y trafico del bus de sincronismo de Ruli')
+    parser.add_argument('port', help='puerto serie del equipo')
+    parser.add_argument('unit', nargs='?', type=int, help='numero de unidad a asignar (1 a %u)' % MAX_UNITS)
+    parser.add_argument('--listen', type=float, metavar='S', default=0,
+                        help='muestra el trafico del bus durante S segundos')
+    args = parser.parse_args()
+
+    if args.unit is None and not args.listen:
+        parser.error('indicar el numero de unidad o --listen')
+    if args.unit is not None and not 1 <= args.unit <= MAX_UNITS:
+        parser.error('numero de unidad fuera de rango')
+
+    fd = open_port(args.port)
+    time.sleep(BOOT_S)
+
+    if args.unit is not None:
+        termios.tcflush(fd, termios.TCIFLUSH)
+        os.write(fd, record(SY_UNIT, 0, 0, 0, args.unit))
+
+        # Un beacon con el nuevo numero confirma la asignacion
+        confirmed = False
+        for data in records(fd, ELECTION_S + 1):
+            if data[1] == SY_BEACON and data[2] == args.unit:
+                confirmed = True
+                break
+        if not confirmed:
+            sys.exit('sin confirmacion: otra unidad en el bus o equipo sin RULI_SYNC')
+        print('unidad %u asignada' % args.unit)
+
+    for data in records(fd, args.listen):
+        print(describe(data), flush=True)
+
+
+if __name__ == '__main__':
+    main()
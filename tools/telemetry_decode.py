@@ -0,0 +1,251 @@
+#!/usr/bin/env python3
+#
+# telemetry_decode.py
+# Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)
+#
+# Decodificador del canal de telemetria binaria de Ruli (ver Telemetry.h).
+# Lee los registros desde el puerto serie o desde un archivo capturado,
+# imprime un log legible y al finalizar un resumen con estadisticas.
+#
+# Uso:
+#   python3 tools/telemetry_decode.py /dev/ttyUSB0
+#   python3 tools/telemetry_decode.py captura.bin --quiet
+#
+
+import argparse
+import os
+import struct
+import sys
+import termios
+import tty
+
+
+SYNC        = 0xA5
+RECORD_SIZE = 12
+BAUDS       = termios.B115200
+
+TM_LEDS_FRAME   = 0x01
+TM_LEDS_DIFF    = 0x02
+TM_ENCODER      = 0x03
+TM_MP3_COMMAND  = 0x04
+TM_MP3_RESPONSE = 0x05
+TM_MODE         = 0x06
+TM_TIMING       = 0x07
+TM_STATS        = 0x08
+TM_STREAM       = 0x09
+TM_OUTCOMES     = 0x0A
+TM_USAGE        = 0x0B
+TM_REACTION     = 0x0C
+
+TYPE_NAMES = {TM_LEDS_FRAME: 'leds', TM_LEDS_DIFF: 'leds-diff', TM_ENCODER: 'encoder',
+              TM_MP3_COMMAND: 'mp3-cmd', TM_MP3_RESPONSE: 'mp3-rsp', TM_MODE: 'mode',
+              TM_TIMING: 'timing', TM_STATS: 'stats', TM_STREAM: 'stream',
+              TM_OUTCOMES: 'outcomes', TM_USAGE: 'usage', TM_REACTION: 'reaction'}
+
+FUNCTIONS = ['WELCOME', 'SIMPLE_ROULETTE', 'RANDOM_COLOR', 'FOLLOW_THE_COLOR',
+             'TURN_METER', 'VELOCITY_METER', 'CUSTOM_SHAPE', 'SOUND_SHOOTING',
+             'MUSIC', 'USER_PROGRAM', 'IDDLE', 'STREAM']
+EVENTS = ['NONE', 'LEFT_TURN', 'RIGHT_TURN', 'SWITCH_CLICK', 'SWITCH_HELD',
+          'SWITCH_DOUBLE_CLICK', 'SWITCH_REPEAT']
+ENCODERS = ['wheel', 'selector']
+SECTIONS = ['FUNC', 'BLUE', 'GREEN', 'WHITE', 'YELLOW', 'RED']
+MP3_COMMANDS = {0x01: 'next', 0x02: 'previous', 0x03: 'play', 0x04: 'volumeUp',
+                0x05: 'volumeDown', 0x06: 'volume', 0x0F: 'playFolder', 0x16: 'stop',
+                0x19: 'loop'}
+TIMINGS = ['loop-max', 'leds-latency', 'sound-latency', 'reaction', 'reaction-best']
+OUTCOME_MODES = ['randomColor', 'soundShooting']
+
+
+def name(table, index):
+    if isinstance(table, dict):
+        return table.get(index, '0x%02X' % index)
+    return table[index] if index < len(table) else str(index)
+
+
+class Decoder:
+
+    def __init__(self, quiet):
+        self.quiet = quiet
+        self.buffer = bytearray()
+        self.last_seq = None
+        self.last_ms = None
+        self.clock = 0          # millis() desenvuelto a 32 bits
+        self.leds = [None] * 6  # None: seccion desconocida luego de una perdida
+        self.counts = {}
+        self.bad = 0
+        self.lost = 0
+        self.device_dropped = 0
+        self.timings = {}
+        self.loops = []
+        self.stream = []
+        self.outcomes = {}
+        self.usage = {}         # contador -> valor (ver Accounting.h)
+        self.usage_counters = None
+        self.reaction = None    # mediana, demoras minima y maxima del latch, rebote maximo (us)
+
+    def feed(self, data):
+        self.buffer += data
+        while len(self.buffer) >= RECORD_SIZE:
+            if self.buffer[0] != SYNC:
+                del self.buffer[0]
+                continue
+            record = self.buffer[:RECORD_SIZE]
+            if sum(record[1:]) & 0xFF:
+                self.bad += 1
+                del self.buffer[0]
+                continue
+            del self.buffer[:RECORD_SIZE]
+            self.handle(record)
+
+    def handle(self, record):
+        rtype, seq, ms = record[1], record[2], record[3] | record[4] << 8
+        payload = record[5:11]
+
+        if self.last_seq is not None:
+            gap = (seq - self.last_seq - 1) & 0xFF
+            self.lost += gap
+            # Una diferencia perdida deja el panel desconocido hasta el proximo cuadro completo
+            if gap:
+                self.leds = [None] * 6
+        self.last_seq = seq
+
+        if self.last_ms is not None:
+            self.clock += (ms - self.last_ms) & 0xFFFF
+        self.last_ms = ms
+
+        self.counts[rtype] = self.counts.get(rtype, 0) + 1
+        text = self.describe(rtype, payload)
+        if not self.quiet:
+            print('%10.3f  %-9s %s' % (self.clock / 1000.0, name(TYPE_NAMES, rtype), text))
+
+    def describe(self, rtype, p):
+        if rtype == TM_LEDS_FRAME:
+            self.leds = list(p)
+            return self.leds_text()
+        if rtype == TM_LEDS_DIFF:
+            values = iter(p[1:])
+            for i in range(6):
+                if p[0] & (1 << i):
+                    self.leds[i] = next(values)
+            return self.leds_text()
+        if rtype == TM_ENCODER:
+            ts = struct.unpack('<I', bytes(p[2:6]))[0]
+            return '%s %s @%dus' % (name(ENCODERS, p[0]), name(EVENTS, p[1]), ts)
+        if rtype == TM_MP3_COMMAND:
+            param = p[1] | p[2] << 8
+            if p[0] == 0x0F:
+                return 'playFolder(%d, %d)' % (param >> 8, param & 0xFF)
+            return '%s(%d)' % (name(MP3_COMMANDS, p[0]), param)
+        if rtype == TM_MP3_RESPONSE:
+            return 'type=%d value=%d' % (p[0], p[1] | p[2] << 8)
+        if rtype == TM_MODE:
+            flags = [f for bit, f in enumerate(['selector', 'volume', 'speaking', 'spinning'])
+                     if p[2] & (1 << bit)]
+            return '%s -> %s %s' % (name(FUNCTIONS, p[0]), name(FUNCTIONS, p[1]), ','.join(flags))
+        if rtype == TM_TIMING:
+            us = struct.unpack('<I', bytes(p[1:5]))[0]
+            self.timings.setdefault(name(TIMINGS, p[0]), []).append(us)
+            return '%s %dus' % (name(TIMINGS, p[0]), us)
+        if rtype == TM_STATS:
+            loops, dropped, sent = struct.unpack('<HHH', bytes(p))
+            self.loops.append(loops)
+            self.device_dropped = dropped
+            return 'loops/s=%d dropped=%d sent=%d' % (loops, dropped, sent)
+        if rtype == TM_STREAM:
+            frames, dropped, jitter = struct.unpack('<HHH', bytes(p))
+            self.stream.append((frames, dropped, jitter))
+            return 'frames/s=%d dropped=%d jitter-max=%dus' % (frames, dropped, jitter)
+        if rtype == TM_OUTCOMES:
+            first, second = struct.unpack('<HH', bytes(p[2:6]))
+            self.outcomes[(p[0], p[1])] = first
+            self.outcomes[(p[0], p[1] + 1)] = second
+            return '%s led %d=%d led %d=%d' % (name(OUTCOME_MODES, p[0]), p[1], first,
+                                               p[1] + 1, second)
+        if rtype == TM_USAGE:
+            value = struct.unpack('<I', bytes(p[1:5]))[0]
+            self.usage[p[0]] = value
+            self.usage_counters = p[5]
+            return 'counter %d/%d=%d' % (p[0], p[5], value)
+        if rtype == TM_REACTION:
+            median, latch_min, latch_max, bounce = struct.unpack('<HBBH', bytes(p))
+            latch_min, latch_max = latch_min * 4, latch_max * 4
+            self.reaction = (median * 100, latch_min, latch_max, bounce)
+            return 'median=%dus latch-delay min=%dus max=%dus jitter=%dus bounce=%dus' % (
+                median * 100, latch_min, latch_max, latch_max - latch_min, bounce)
+        return p.hex()
+
+    def leds_text(self):
+        return ' '.join('%s=%s' % (s, '??' if v is None else '%02X' % v)
+                        for s, v in zip(SECTIONS, self.leds))
+
+    def summary(self):
+        total = sum(self.counts.values())
+        print('\n--- resumen ---')
+        print('duracion       %.1f s' % (self.clock / 1000.0))
+        print('registros      %d (%d con error de checksum)' % (total, self.bad))
+        print('perdidos       %d por secuencia, %d informados por el equipo'
+              % (self.lost, self.device_dropped))
+        for rtype, count in sorted(self.counts.items()):
+            print('  %-10s %d' % (name(TYPE_NAMES, rtype), count))
+        if self.loops:
+            print('lazo/s         min=%d media=%d max=%d'
+                  % (min(self.loops), sum(self.loops) // len(self.loops), max(self.loops)))
+        if self.stream:
+            rates = [f for f, _, _ in self.stream]
+            print('stream         cuadros/s min=%d media=%d, descartados=%d, jitter max=%dus'
+                  % (min(rates), sum(rates) // len(rates), self.stream[-1][1],
+                     max(j for _, _, j in self.stream)))
+        for key, values in sorted(self.timings.items()):
+            values = sorted(values)
+            pick = lambda q: values[min(len(values) - 1, int(q * len(values)))]
+            print('%-14s n=%d p50=%dus p90=%dus p99=%dus max=%dus'
+                  % (key, len(values), pick(0.5), pick(0.9), pick(0.99), values[-1]))
+        if self.reaction:
+            best = self.timings.get('reaction-best')
+            print('reaccion       mejor=%sus mediana=%dus, jitter del latch=%dus (%d a %dus),'
+                  ' rebote max=%dus'
+                  % (best[-1] if best else '?', self.reaction[0],
+                     self.reaction[2] - self.reaction[1], self.reaction[1], self.reaction[2],
+                     self.reaction[3]))
+
+
+def open_source(path):
+    fd = os.open(path, os.O_RDONLY | os.O_NOCTTY)
+    if os.isatty(fd):
+        tty.setraw(fd)
+        attrs = termios.tcgetattr(fd)
+        attrs[4] = attrs[5] = BAUDS
+        termios.tcsetattr(fd, termios.TCSANOW, attrs)
+    return fd
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Decodificador de telemetria de Ruli')
+    parser.add_argument('source', help='puerto serie o archivo capturado')
+    parser.add_argument('-q', '--quiet', action='store_true', help='solo el resumen')
+    parser.add_argument('-w', '--write', help='guardar los bytes recibidos en un archivo')
+    args = parser.parse_args()
+
+    decoder = Decoder(args.quiet)
+    capture = open(args.write, 'wb') if args.write else None
+    fd = open_source(args.source)
+    try:
+        while True:
+            data = os.read(fd, 4096)
+            if not data:
+                break
+            if capture:
+                capture.write(data)
+            decoder.feed(data)
+    except KeyboardInterrupt:
+        pass
+    finally:
+        os.close(fd)
+        if capture:
+            capture.close()
+
+    decoder.summary()
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,134 @@
+#!/usr/bin/env python3
+#
+# usage.py
+# Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)
+#
+# Exportacion de la contabilidad de uso de recursos de Ruli (firmware con
+# RULI_ACCOUNTING, ver Accounting.h): bytes enviados al DFPlayer, refrescos
+# del panel, escrituras de pines y de EEPROM y eventos de los encoders por
+# funcionalidad, acumulados entre sesiones. Solicita los contadores por el
+# puerto serie, o los lee de un volcado de la EEPROM en formato Intel HEX.
+#
+# El informe tiene el formato del de tools/soak/soak.cpp --usage, que
+# obtiene los mismos contadores del firmware sobre el hardware simulado.
+#
+# Uso:
+#   python3 tools/usage.py /dev/ttyUSB0
+#   python3 tools/usage.py --eeprom eeprom.hex
+#   python3 tools/usage.py /dev/ttyUSB0 --csv > uso.csv
+#
+# El volcado se obtiene por ejemplo con:
+#   avrdude -p m328p -c arduino -P /dev/ttyUSB0 -U eeprom:r:eeprom.hex:i
+#
+
+import argparse
+import os
+import select
+import sys
+import time
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import outcomes           # noqa: E402
+import stream_send        # noqa: E402
+import telemetry_decode   # noqa: E402
+
+
+ADDRESS     = 0x2F0     # EEPROM_ACCOUNTING de RuliBrain.cpp
+KEY         = ord('U')
+ST_EXPORT   = 0x05
+
+MODES   = ['welcome', 'simpleRoulette', 'randomColor', 'followTheColor', 'turnMeter',
+           'velocityMeter', 'customShape', 'soundShooting', 'music', 'userProgram',
+           'iddle', 'stream']
+KINDS   = ['mp3 bytes', 'refreshes', 'pin writes', 'encoder', 'eeprom']
+REGIONS = ['params', 'snapshot', 'outcomes', 'animation', 'accounting']
+
+# Bytes de cada region (ver RuliBrain.cpp y ACC_SIZE)
+REGION_SIZES = [4, 32, 256, 224, 3 + (len(REGIONS) + len(MODES) * len(KINDS)) * 4]
+
+COUNTERS = 1 + len(REGIONS) + len(MODES) * len(KINDS)
+
+
+def from_serial(port, timeout, boot_wait):
+    fd = stream_send.open_port(port)
+    decoder = telemetry_decode.Decoder(quiet=True)
+    time.sleep(boot_wait)
+    os.write(fd, stream_send.record(ST_EXPORT, 0, 0))
+    end = time.monotonic() + timeout
+    try:
+        while time.monotonic() < end and len(decoder.usage) < COUNTERS:
+            ready, _, _ = select.select([fd], [], [], 0.1)
+            if ready:
+                decoder.feed(os.read(fd, 4096))
+    finally:
+        os.close(fd)
+    if decoder.usage_counters is None:
+        sys.exit('sin respuesta: equipo sin RULI_ACCOUNTING o sin RULI_TELEMETRY')
+    if decoder.usage_counters != COUNTERS:
+        sys.exit('el equipo informa %d contadores, se esperaban %d' % (decoder.usage_counters, COUNTERS))
+    if len(decoder.usage) < COUNTERS:
+        sys.exit('exportacion incompleta: %d de %d contadores' % (len(decoder.usage), COUNTERS))
+    return [decoder.usage[counter] for counter in range(COUNTERS)]
+
+
+def from_eeprom(path):
+    memory = outcomes.read_hex(path)
+    if memory.get(ADDRESS) != KEY:
+        sys.exit('la region de contabilidad no tiene formato')
+    values = [memory.get(ADDRESS + 1, 0) | memory.get(ADDRESS + 2, 0) << 8]
+    for counter in range(1, COUNTERS):
+        address = ADDRESS + 3 + (counter - 1) * 4
+        values.append(int.from_bytes(bytes(memory.get(address + i, 0) for i in range(4)), 'little'))
+    return values
+
+
+def table(values):
+    """Contadores de cada funcionalidad, en el orden de KINDS."""
+    first = 1 + len(REGIONS)
+    return [values[first + mode * len(KINDS):first + (mode + 1) * len(KINDS)]
+            for mode in range(len(MODES))]
+
+
+def report(values):
+    print('sessions: %d' % values[0])
+    print()
+    print('%-16s %12s %12s %14s %10s %10s' % ('mode', *KINDS))
+    rows = table(values)
+    for mode, row in zip(MODES, rows):
+        print('%-16s %12d %12d %14d %10d %10d' % (mode, *row))
+    print('%-16s %12d %12d %14d %10d %10d' % ('total', *[sum(c) for c in zip(*rows)]))
+    print()
+    print('%-16s %12s %12s %14s' % ('region', 'writes', 'bytes', 'writes/byte'))
+    for region, size, writes in zip(REGIONS, REGION_SIZES, values[1:1 + len(REGIONS)]):
+        print('%-16s %12d %12d %14.1f' % (region, writes, size, writes / size))
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Contabilidad de uso de recursos de Ruli')
+    parser.add_argument('port', nargs='?', help='puerto serie del equipo')
+    parser.add_argument('--eeprom', help='volcado de la EEPROM (Intel HEX)')
+    parser.add_argument('--csv', action='store_true', help='salida modo,recurso,cantidad')
+    parser.add_argument('--timeout', type=float, default=5)
+    parser.add_argument('--boot-wait', type=float, default=2.0)
+    args = parser.parse_args()
+
+    if args.eeprom:
+        values = from_eeprom(args.eeprom)
+    elif args.port:
+        values = from_serial(args.port, args.timeout, args.boot_wait)
+    else:
+        parser.error('se requiere un puerto serie o --eeprom')
+
+    if args.csv:
+        print('modo,recurso,cantidad')
+        for mode, row in zip(MODES, table(values)):
+            for kind, value in zip(KINDS, row):
+                print('%s,%s,%d' % (mode, kind, value))
+        for region, writes in zip(REGIONS, values[1:1 + len(REGIONS)]):
+            print('eeprom,%s,%d' % (region, writes))
+    else:
+        report(values)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,389 @@
+/*
+ * ws2812_test.cpp
+ * Copyright 2019 - Juan C. Bryksa (jcbryksa@gmail.com)
+ *
+ * Prueba en el host de la salida a leds WS2812 (ver Ws2812.h y
+ * RgbLedsPanel.h). Ws2812LedsPanel (src/, sin modificar) se ejecuta
+ * sobre el hardware simulado de tools/soak/mock, que captura los bytes
+ * de cada cuadro. Cada cuadro se expande a la forma de onda que genera
+ * sendPixel() (duracion en alto de cada bit segun WS2812_T0H_CYCLES y
+ * WS2812_T1H_CYCLES) y se decodifica como lo hace un led: los colores
+ * resultantes se comparan con los esperados para leds apagados, cada
+ * seccion, cada led de la rueda, la columna indicadora, capas y paleta.
+ *
+ * Verifica ademas los tiempos de la forma de onda contra la hoja de
+ * datos y la separacion minima entre cuadros, e informa el presupuesto
+ * de tiempo de un refresco frente a las interrupciones y a la pasada
+ * del lazo principal. Falla (estado 1) ante cualquier diferencia.
+ *
+ * Los tiempos reales del codigo ensamblado se miden con el caso
+ * leds_refresh_ws2812 de tools/benchmark.py (simavr).
+ *
+ * Compilacion: pio run -e ws2812_test (ver platformio.ini), o bien
+ *
+ *   g++ -O2 -std=gnu++17 -I tools/soak/mock -I include \
+ *     tools/ws2812/ws2812_test.cpp tools/soak/mock/mock.cpp \
+ *     src/LedsPanel.cpp src/RgbLedsPanel.cpp -o ws2812_test
+ *
+ * Uso:
+ *
+ *   ws2812_test [-v]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <Arduino.h>
+
+#include "LedsPanel.h"
+#include "RgbLedsPanel.h"
+#include "Animation.h"
+#include "SyncBus.h"
+
+
+// Pin de datos de los leds (LP_DATA_PIN de main.cpp)
+#define TEST_PIN            12
+
+#define TEST_CYCLE_NS       62.5
+
+/*
+ * Ventanas de la hoja de datos del WS2812B (ns): alto y bajo de
+ * cada bit (+-150ns) y umbral con que el led distingue un 1
+ */
+#define TEST_T0H_MIN        250
+#define TEST_T0H_MAX        550
+#define TEST_T1H_MIN        650
+#define TEST_T1H_MAX        950
+#define TEST_T0L_MIN        700
+#define TEST_T0L_MAX       1000
+#define TEST_T1L_MIN        300
+#define TEST_T1L_MAX        600
+#define TEST_THRESHOLD_NS   625
+#define TEST_RESET_MIN_US   280
+
+/*
+ * Ciclos entre led y led en sendFrame() (indice de la paleta y
+ * ventana de interrupciones), estimados: la medicion sobre el
+ * codigo ensamblado la da leds_refresh_ws2812
+ */
+#define TEST_GAP_CYCLES      48
+
+// Presupuesto de una pasada del lazo principal (ver tools/soak/soak.cpp)
+#define TEST_PASS_BUDGET_US  30000UL
+
+
+// Colores por omision (R, G, B) de FUNC_INDICATOR a RED
+static const uint8_t sectionRgb[6][3] = {
+  { 0, 48, 0 }, { 0, 0, 64 }, { 0, 64, 0 }, { 40, 40, 40 }, { 56, 40, 0 }, { 64, 0, 0 }
+};
+
+// Seccion de cada grupo de 8 leds de la rueda (ver LedsPanel.cpp)
+static const uint8_t wheelOrder[5] = { WHITE, GREEN, BLUE, RED, YELLOW };
+
+
+static SoakBoard board;
+static Ws2812LedsPanel<TEST_PIN> panel;
+
+static uint32_t failures = 0;
+static uint32_t checks = 0;
+static int verbose = 0;
+
+
+/*
+ * Cuadro esperado: color (R, G, B) de cada pixel
+ */
+struct Frame {
+  uint8_t rgb[RGB_PIXELS][3];
+
+  void clear(void) {
+    memset(rgb, 0x00, sizeof(rgb));
+  }
+
+  void set(uint8_t pixel, const uint8_t *color) {
+    memcpy(rgb[pixel], color, 3);
+  }
+};
+
+
+// Pixel del led [bit] (0: MSB) de la seccion [section]
+static int pixelOf(uint8_t section, uint8_t bit) {
+
+  if ( section == FUNC_INDICATOR )
+    return RGB_WHEEL_PIXELS + bit;
+
+  for ( uint8_t group = 0 ; group < 5 ; group++ )
+    if ( wheelOrder[group] == section )
+      return group * 8 + bit;
+
+  return -1;
+
+}
+
+
+/**
+ * Forma de onda de [count] bytes: duracion en alto (ns) de cada
+ * bit, MSB primero, como la genera sendPixel()
+ */
+static void waveform(const uint8_t *data, uint16_t count, double *high) {
+
+  for ( uint16_t i = 0 ; i < count ; i++ )
+    for ( uint8_t bit = 0 ; bit < 8 ; bit++ )
+      high[i * 8 + bit] = ( data[i] & (0x80 >> bit) ? WS2812_T1H_CYCLES : WS2812_T0H_CYCLES ) * TEST_CYCLE_NS;
+
+}
+
+
+/**
+ * Decodifica la forma de onda como un led: cada uno toma los
+ * primeros 24 bits (G, R, B) y reenvia el resto
+ */
+static void decode(const double *high, uint16_t bits, Frame &frame) {
+
+  frame.clear();
+
+  for ( uint16_t i = 0 ; i < bits && i / 24 < RGB_PIXELS ; i++ ) {
+    uint8_t pixel = i / 24;
+    uint8_t component = ( i % 24 ) / 8;
+    uint8_t value = high[i] > TEST_THRESHOLD_NS ? 1 : 0;
+    // G, R, B en el cable, R, G, B en frame
+    uint8_t *target = &frame.rgb[pixel][component == 0 ? 1 : ( component == 1 ? 0 : 2 )];
+    *target = (*target << 1) | value;
+  }
+
+}
+
+
+static void check(const char *name, const Frame &expected) {
+
+  static double high[SOAK_WS2812_BYTES * 8];
+  Frame received;
+  uint32_t frames = board.ws2812Frames;
+
+  panel.refresh();
+
+  checks++;
+
+  if ( board.ws2812Frames != frames + 1 || board.ws2812Count != SOAK_WS2812_BYTES || board.ws2812Pin != TEST_PIN ) {
+    printf("FAIL %s: %u cuadros, %u bytes, pin %u\n", name, board.ws2812Frames - frames, board.ws2812Count,
+      board.ws2812Pin);
+    failures++;
+    return;
+  }
+
+  waveform(board.ws2812Data, board.ws2812Count, high);
+  decode(high, board.ws2812Count * 8, received);
+
+  for ( uint8_t pixel = 0 ; pixel < RGB_PIXELS ; pixel++ )
+    if ( memcmp(received.rgb[pixel], expected.rgb[pixel], 3) ) {
+      printf("FAIL %s: pixel %u = (%u, %u, %u), se esperaba (%u, %u, %u)\n", name, pixel,
+        received.rgb[pixel][0], received.rgb[pixel][1], received.rgb[pixel][2],
+        expected.rgb[pixel][0], expected.rgb[pixel][1], expected.rgb[pixel][2]);
+      failures++;
+      return;
+    }
+
+  if ( verbose )
+    printf("ok   %s\n", name);
+
+}
+
+
+static void expect(int ok, const char *format, double value) {
+
+  checks++;
+
+  if ( ! ok ) {
+    printf("FAIL ");
+    printf(format, value);
+    printf("\n");
+    failures++;
+  }
+  else if ( verbose ) {
+    printf("ok   ");
+    printf(format, value);
+    printf("\n");
+  }
+
+}
+
+
+// Tiempos de cada bit contra la hoja de datos
+static void checkTiming(void) {
+
+  double t0h = WS2812_T0H_CYCLES * TEST_CYCLE_NS;
+  double t1h = WS2812_T1H_CYCLES * TEST_CYCLE_NS;
+  double period = WS2812_BIT_CYCLES * TEST_CYCLE_NS;
+
+  expect(t0h >= TEST_T0H_MIN && t0h <= TEST_T0H_MAX, "T0H %.1f ns", t0h);
+  expect(t1h >= TEST_T1H_MIN && t1h <= TEST_T1H_MAX, "T1H %.1f ns", t1h);
+  expect(period - t0h >= TEST_T0L_MIN && period - t0h <= TEST_T0L_MAX, "T0L %.1f ns", period - t0h);
+  expect(period - t1h >= TEST_T1L_MIN && period - t1h <= TEST_T1L_MAX, "T1L %.1f ns", period - t1h);
+  expect(period == 1250, "periodo %.1f ns (800kHz)", period);
+  expect(WS2812_RESET_US >= TEST_RESET_MIN_US, "reset %.0f us", WS2812_RESET_US);
+
+}
+
+
+// Cuadros con el contenido de cada seccion y de cada led
+static void checkFrames(void) {
+
+  Frame expected;
+  char name[64];
+
+  expected.clear();
+  check("apagado", expected);
+
+  for ( uint8_t section = FUNC_INDICATOR ; section <= RED ; section++ ) {
+    panel.setValue(section, 0xFF, 0);
+    expected.clear();
+    for ( uint8_t bit = 0 ; bit < 8 ; bit++ )
+      expected.set(pixelOf(section, bit), sectionRgb[section]);
+    sprintf(name, "seccion %u", section);
+    check(name, expected);
+    panel.setValue(section, 0x00, 0);
+  }
+
+  // Cada led de la rueda, en el orden de setWheelValues()
+  for ( uint8_t led = 0 ; led < RGB_WHEEL_PIXELS ; led++ ) {
+    panel.setWheelValues(led, 1, 0);
+    expected.clear();
+    expected.set(led, sectionRgb[wheelOrder[led / 8]]);
+    sprintf(name, "rueda %u", led);
+    check(name, expected);
+    panel.setWheelValues(led, 0, 0);
+  }
+
+  // Columna indicadora desde el MSB
+  for ( uint8_t bit = 0 ; bit < 8 ; bit++ ) {
+    panel.setValue(FUNC_INDICATOR, 0x80 >> bit, 0);
+    expected.clear();
+    expected.set(RGB_WHEEL_PIXELS + bit, sectionRgb[FUNC_INDICATOR]);
+    sprintf(name, "indicador %u", bit);
+    check(name, expected);
+  }
+  panel.setValue(FUNC_INDICATOR, 0x00, 0);
+
+  // Capa que reemplaza la mitad de los leds rojos
+  panel.setValue(RED, 0xF0, 0);
+  panel.setBlend(LAYER_UI, BLEND_COPY);
+  panel.setLayerValue(LAYER_UI, RED, 0x0F);
+  expected.clear();
+  for ( uint8_t bit = 4 ; bit < 8 ; bit++ )
+    expected.set(pixelOf(RED, bit), sectionRgb[RED]);
+  check("capa", expected);
+  panel.clearLayer(LAYER_UI);
+  panel.setValue(RED, 0x00, 0);
+
+  // Color de la paleta asignado a una seccion, y color de los leds apagados
+  static const uint8_t custom[3] = { 0xA5, 0x5A, 0xC3 };
+  static const uint8_t dim[3] = { 1, 2, 3 };
+  panel.setColor(9, custom[0], custom[1], custom[2]);
+  panel.setSectionColor(BLUE, 9);
+  panel.setColor(RGB_OFF, dim[0], dim[1], dim[2]);
+  panel.setValue(BLUE, 0x81, 0);
+  for ( uint8_t pixel = 0 ; pixel < RGB_PIXELS ; pixel++ )
+    expected.set(pixel, dim);
+  expected.set(pixelOf(BLUE, 0), custom);
+  expected.set(pixelOf(BLUE, 7), custom);
+  check("paleta", expected);
+
+  checks++;
+  if ( panel.getPixel(pixelOf(BLUE, 0)) != 9 || panel.getPixel(pixelOf(BLUE, 1)) != RGB_OFF ) {
+    printf("FAIL getPixel\n");
+    failures++;
+  }
+
+  panel.setValue(BLUE, 0x00, 0);
+  panel.setSectionColor(BLUE, BLUE + 1);
+  panel.setColor(RGB_OFF, 0, 0, 0);
+
+}
+
+
+// Separacion entre dos refrescos consecutivos
+static void checkLatch(void) {
+
+  uint64_t end, start;
+
+  panel.refresh();
+  end = board.ws2812End;
+  panel.refresh();
+  start = board.ws2812End - SOAK_WS2812_BYTES * SOAK_WS2812_BYTE_US;
+
+  expect(start - end >= WS2812_RESET_US, "separacion entre cuadros %.0f us", (double) (start - end));
+
+}
+
+
+// Presupuesto de tiempo de un refresco
+static void report(void) {
+
+  double bitUs = WS2812_BIT_CYCLES * TEST_CYCLE_NS / 1000;
+  double pixelUs = 24 * bitUs;
+  double gapUs = TEST_GAP_CYCLES * TEST_CYCLE_NS / 1000;
+  double frameUs = RGB_PIXELS * (pixelUs + gapUs);
+  double refreshUs = frameUs + WS2812_RESET_US;
+  uint64_t start;
+
+  start = board.now;
+  panel.refresh();
+
+  printf("\npresupuesto de un refresco (%u leds, %u bits)\n", RGB_PIXELS, RGB_PIXELS * 24);
+  printf("  bits                      %8.1f us\n", RGB_PIXELS * pixelUs);
+  printf("  entre leds (estimado)     %8.1f us\n", RGB_PIXELS * gapUs);
+  printf("  reset antes del siguiente %8u us\n", WS2812_RESET_US);
+  printf("  total                     %8.1f us  (simulado: %llu us)\n", refreshUs,
+    (unsigned long long) (board.now - start));
+  printf("  shift registers CD4094          ~40 us (FastLedsPanel)\n");
+  printf("  cuadro en RAM             %8u bytes (paleta %u, pixeles %u, secciones 6)\n",
+    RGB_COLORS * WS2812_PIXEL_BYTES + RGB_PIXELS / 2 + 6, RGB_COLORS * WS2812_PIXEL_BYTES, RGB_PIXELS / 2);
+
+  printf("\ninterrupciones deshabilitadas: %.1f us por led\n", pixelUs);
+  printf("  %-34s %8.1f us  %s\n", "UART 115200 (2 bytes de FIFO)", 2 * 10 * 1e6 / 115200,
+    pixelUs < 2 * 10 * 1e6 / 115200 ? "ok" : "PIERDE BYTES");
+  printf("  %-34s %8.1f us  %s\n", "SoftwareSerial 9600 (medio bit)", 0.5 * 1e6 / 9600,
+    pixelUs < 0.5 * 1e6 / 9600 ? "ok" : "PIERDE BYTES");
+  printf("  %-34s %8.1f us  %s\n", "Timer0 (desborde, millis())", 1024.0,
+    pixelUs < 1024 ? "ok" : "ATRASA EL RELOJ");
+  printf("  espera mayor a %u us entre leds: cuadro reenviado (hasta %u veces)\n",
+    WS2812_LATCH_TICKS * 4, WS2812_RESTARTS);
+
+  printf("\nlazo principal\n");
+  printf("  pasada (%lu us)                %5.1f %% por refresco\n", TEST_PASS_BUDGET_US,
+    100 * refreshUs / TEST_PASS_BUDGET_US);
+  printf("  cuadro de animacion (%u ms)     %5.1f %%\n", ANIMATION_UNIT_MS,
+    100 * refreshUs / (ANIMATION_UNIT_MS * 1000.0));
+  printf("  latch tardio (SYNC_FRAME_LATE_US %lu us): %.0f refrescos\n", SYNC_FRAME_LATE_US,
+    SYNC_FRAME_LATE_US / refreshUs);
+
+}
+
+
+int main(int argc, char **argv) {
+
+  for ( int i = 1 ; i < argc ; i++ )
+    if ( ! strcmp(argv[i], "-v") )
+      verbose = 1;
+    else {
+      fprintf(stderr, "uso: %s [-v]\n", argv[0]);
+      return 2;
+    }
+
+  memset(&board, 0x00, sizeof(board));
+  board.hangLimit = ~0ULL;
+  soakBoard = &board;
+
+  panel.begin();
+
+  checkTiming();
+  checkFrames();
+  checkLatch();
+
+  report();
+
+  printf("\n%u verificaciones, %u fallas\n", checks, failures);
+
+  return failures ? 1 : 0;
+
+}